@@ -13,6 +13,7 @@
 
 BookmarkFilterModel::BookmarkFilterModel(QObject *parent)
     : QSortFilterProxyModel(parent)
+    , m_rowsChecked(0)
 {
 
 }
@@ -32,13 +33,32 @@ bool BookmarkFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sou
 
 bool BookmarkFilterModel::filterAcceptsRowUnbounded(int sourceRow, const QModelIndex &sourceParent) const
 {
-    QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+    if (m_candidates.size() != sourceModel()->rowCount()) {
+        m_candidates.fill(true, sourceModel()->rowCount());
+    }
+    if (sourceRow < m_candidates.size() && !m_candidates.testBit(sourceRow)) {
+        return false;
+    }
 
-    if ((sourceModel()->data(index, DeclarativeBookmarkModel::UrlRole).toString().trimmed().contains(m_search, Qt::CaseInsensitive)
-         || sourceModel()->data(index, DeclarativeBookmarkModel::TitleRole).toString().trimmed().contains(m_search, Qt::CaseInsensitive))) {
-        return true;
+    ++m_rowsChecked;
+    bool accepted;
+    if (m_bookmarkModel) {
+        accepted = m_bookmarkModel->matches(sourceRow, m_foldedSearch);
+    } else {
+        QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+        accepted = sourceModel()->data(index, DeclarativeBookmarkModel::UrlRole).toString().trimmed().contains(m_search, Qt::CaseInsensitive)
+                || sourceModel()->data(index, DeclarativeBookmarkModel::TitleRole).toString().trimmed().contains(m_search, Qt::CaseInsensitive);
     }
-    return false;
+
+    if (!accepted && sourceRow < m_candidates.size()) {
+        m_candidates.clearBit(sourceRow);
+    }
+    return accepted;
+}
+
+void BookmarkFilterModel::resetCandidates()
+{
+    m_candidates.clear();
 }
 
 void BookmarkFilterModel::setSourceModel(QAbstractItemModel *sourceModel)
@@ -46,9 +66,33 @@ void BookmarkFilterModel::setSourceModel(QAbstractItemModel *sourceModel)
     if (sourceModel) {
         beginResetModel();
         resetCounts();
+        resetCandidates();
+        for (const QMetaObject::Connection &connection : m_sourceConnections) {
+            disconnect(connection);
+        }
         m_maxDisplayedItems = sourceModel->rowCount();
+        m_bookmarkModel = qobject_cast<DeclarativeBookmarkModel *>(sourceModel);
+
+        // Changed rows have to be checked again. Connected before the proxy
+        // so that candidates are reset before the proxy filters changed rows.
+        m_sourceConnections = {
+            connect(sourceModel, &QAbstractItemModel::rowsInserted, this, &BookmarkFilterModel::resetCandidates),
+            connect(sourceModel, &QAbstractItemModel::rowsRemoved, this, &BookmarkFilterModel::resetCandidates),
+            connect(sourceModel, &QAbstractItemModel::rowsMoved, this, &BookmarkFilterModel::resetCandidates),
+            connect(sourceModel, &QAbstractItemModel::modelReset, this, &BookmarkFilterModel::resetCandidates),
+            connect(sourceModel, &QAbstractItemModel::dataChanged, this, &BookmarkFilterModel::resetCandidates)
+        };
         QSortFilterProxyModel::setSourceModel(sourceModel);
         endResetModel();
+        fetchAll();
+    }
+}
+
+// Rows that are not fetched yet are searched too.
+void BookmarkFilterModel::fetchAll()
+{
+    if (m_bookmarkModel && !m_search.isEmpty()) {
+        m_bookmarkModel->fetchAll();
     }
 }
 
@@ -67,7 +111,15 @@ void BookmarkFilterModel::setSearch(const QString &search)
     if (m_search == search)
         return;
 
+    const QString foldedSearch = search.toCaseFolded();
+    // Only rows that matched the previous query can match a query that extends it.
+    if (!foldedSearch.contains(m_foldedSearch)) {
+        resetCandidates();
+    }
+
     m_search = search;
+    m_foldedSearch = foldedSearch;
+    fetchAll();
     resetCounts();
     invalidateFilter();
     emit searchChanged(m_search);
@@ -84,6 +136,11 @@ void BookmarkFilterModel::setMaxDisplayedItems(const int maxDisplayedItems)
     emit maxDisplayedItemsChanged(m_maxDisplayedItems);
 }
 
+int BookmarkFilterModel::rowsChecked() const
+{
+    return m_rowsChecked;
+}
+
 void BookmarkFilterModel::resetCounts()
 {
     m_maxSourceModelPosition = 0;
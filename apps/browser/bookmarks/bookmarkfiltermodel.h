@@ -11,8 +11,12 @@
 #ifndef BOOKMARKFILTERMODEL_H
 #define BOOKMARKFILTERMODEL_H
 
+#include <QBitArray>
+#include <QPointer>
 #include <QSortFilterProxyModel>
 
+class DeclarativeBookmarkModel;
+
 class BookmarkFilterModel : public QSortFilterProxyModel
 {
     Q_OBJECT
@@ -31,6 +35,9 @@ public:
     void setSearch(const QString &search);
     void setMaxDisplayedItems(const int maxDisplayedItems);
 
+    // Rows checked against the search, for tests.
+    int rowsChecked() const;
+
 signals:
     void searchChanged(QString search);
     void maxDisplayedItemsChanged(int maxDisplayedItems);
@@ -39,9 +46,18 @@ private:
     void resetCounts();
     void extendCheckPosition(int sourceRow, const QModelIndex &sourceParent) const;
     bool filterAcceptsRowUnbounded(int sourceRow, const QModelIndex &sourceParent) const;
+    void resetCandidates();
+    void fetchAll();
 
 private:
     QString m_search;
+    QString m_foldedSearch;
+    QPointer<DeclarativeBookmarkModel> m_bookmarkModel;
+    QList<QMetaObject::Connection> m_sourceConnections;
+    // Rows that may match the search. Rows that did not match a query do not
+    // match a query that extends it, so they are not checked again.
+    mutable QBitArray m_candidates;
+    mutable int m_rowsChecked;
     int m_maxDisplayedItems;
     mutable int m_countFilterAccepts;
     mutable int m_sourceMaxAccept;
@@ -9,21 +9,29 @@
  * You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "bookmarkmanager.h"
+#include <QBuffer>
 #include <QDebug>
 #include <QFile>
-#include <QTextStream>
+#include <QHash>
+#include <QImageReader>
 #include <QJsonObject>
-#include <QJsonArray>
 #include <QJsonDocument>
-#include <QRegularExpression>
+#include <QSaveFile>
 #include <MGConfItem>
 #include <QStandardPaths>
 
-#include "bookmark.h"
+#include "bookmarkreader.h"
 #include "browserpaths.h"
+#include "dbmanager.h"
+
+// Bookmarks are added and exported in pages of this size.
+static const int gPageSize = 200;
+
+static const QString gImportedSetting = QStringLiteral("bookmarksImported");
 
 BookmarkManager::BookmarkManager()
   : QObject(nullptr)
+  , m_urlsLoaded(false)
 {
     m_clearBookmarksConfItem = new MGConfItem("/apps/sailfish-browser/actions/clear_bookmarks", this);
 
@@ -43,114 +51,289 @@ BookmarkManager* BookmarkManager::instance()
     return singleton;
 }
 
-void BookmarkManager::save(const QList<Bookmark*> & bookmarks)
+/**
+ * @brief BookmarkManager::initialize
+ * Bookmarks were stored in bookmarks.json before they were moved to the
+ * database. The file is imported and removed, default bookmarks are
+ * imported when the database has never had bookmarks.
+ */
+void BookmarkManager::initialize()
 {
-    QString dataLocation = BrowserPaths::dataLocation();
-    if (dataLocation.isNull()) {
-        return;
+    DBManager *dbManager = DBManager::instance();
+    const QString bookmarkFile = BrowserPaths::dataLocation() + "/bookmarks.json";
+
+    if (QFile::exists(bookmarkFile)) {
+        importLegacyFile(bookmarkFile);
+    } else if (dbManager->getSetting(gImportedSetting).isEmpty()) {
+        importBookmarks(QLatin1Literal("/usr/share/sailfish-browser/default-content/bookmarks.json"));
     }
-    QString path = dataLocation + "/bookmarks.json";
-    QFile file(path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qWarning() << "Can't create file " << path;
+
+    // Cleanup after next stop release. See JB#53083 and JB#52736
+    const QString legacyFile = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation)
+            + QLatin1String("/org.sailfishos/sailfish-browser/bookmarks.json");
+    if (QFile::exists(legacyFile)) {
+        importLegacyFile(legacyFile);
+    }
+    // End of stop release cleanup...
+
+    if (dbManager->getSetting(gImportedSetting).isEmpty()) {
+        dbManager->saveSetting(gImportedSetting, QStringLiteral("true"));
+    }
+}
+
+// A file that cannot be imported completely is kept as a backup.
+void BookmarkManager::importLegacyFile(const QString &path)
+{
+    bool ok = false;
+    importBookmarks(path, 0, true, &ok);
+    if (ok) {
+        QFile::remove(path);
         return;
     }
-    QTextStream out(&file);
-    QJsonArray items;
-
-    for (const Bookmark* const bookmark : bookmarks) {
-        QJsonObject title;
-        title.insert("url", QJsonValue(bookmark->url()));
-        title.insert("title", QJsonValue(bookmark->title()));
-        title.insert("favicon", QJsonValue(bookmark->favicon()));
-        title.insert("hasTouchIcon", QJsonValue(bookmark->hasTouchIcon()));
-        items.append(QJsonValue(title));
-    }
-    QJsonDocument doc(items);
-    out.setCodec("UTF-8");
-    out << doc.toJson();
-    file.close();
+
+    const QString backup = path + QLatin1String(".bak");
+    qWarning() << "Failed to import bookmarks, keeping them in" << backup;
+    QFile::remove(backup);
+    QFile::rename(path, backup);
 }
 
 void BookmarkManager::clear()
 {
-    save(QList<Bookmark*>());
+    DBManager::instance()->clearBookmarks();
+    m_urls.clear();
+    m_urlsLoaded = true;
     emit cleared();
 }
 
-QList<Bookmark*> BookmarkManager::load() {
-    QList<Bookmark*> bookmarks;
-    QString bookmarkFile = BrowserPaths::dataLocation() + "/bookmarks.json";
-    QScopedPointer<QFile> file(new QFile(bookmarkFile));
-
-    if (!file->open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qWarning() << "Unable to open bookmarks " << bookmarkFile;
+bool BookmarkManager::isBookmarked(const QString &url)
+{
+    if (url.isEmpty()) {
+        return false;
+    }
 
-        file.reset(new QFile(QLatin1Literal("/usr/share/sailfish-browser/default-content/bookmarks.json")));
-        if (!file->open(QIODevice::ReadOnly | QIODevice::Text)) {
-            qWarning() << "Unable to open bookmarks defaults";
-            return bookmarks;
+    if (!m_urlsLoaded) {
+        m_urls.clear();
+        const QStringList urls = DBManager::instance()->getBookmarkUrls();
+        for (const QString &bookmarkUrl : urls) {
+            ++m_urls[bookmarkUrl];
         }
+        m_urlsLoaded = true;
     }
+    return m_urls.contains(url);
+}
+
+void BookmarkManager::bookmarkAdded(const QString &url)
+{
+    if (m_urlsLoaded) {
+        ++m_urls[url];
+    }
+}
+
+void BookmarkManager::bookmarkRemoved(const QString &url)
+{
+    QHash<QString, int>::iterator it = m_urls.find(url);
+    if (it != m_urls.end() && --it.value() <= 0) {
+        m_urls.erase(it);
+    }
+}
+
+void BookmarkManager::invalidateUrls()
+{
+    m_urlsLoaded = false;
+}
+
+/**
+ * @brief BookmarkManager::importBookmarks
+ * Reads the file entry by entry and adds the bookmarks to the folder in
+ * batches. Returns the number of bookmarks and folders added, ok is set to
+ * false if the file could not be read or written completely.
+ */
+int BookmarkManager::importBookmarks(const QString &path, int folderId, bool skipExisting, bool *ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Unable to open bookmarks " << path;
+        return 0;
+    }
+
+    DBManager *dbManager = DBManager::instance();
+    BookmarkReader reader(&file, BookmarkReader::format(path));
+    // Folder ids of the file to folder ids in the database.
+    QHash<int, int> folders;
+    folders.insert(0, folderId);
+    BookmarkList batch;
+    batch.reserve(gPageSize);
+    int added = 0;
+    bool failed = false;
+    auto addBatch = [&]() {
+        const int count = dbManager->addBookmarks(batch, skipExisting);
+        if (count < 0) {
+            failed = true;
+        } else {
+            added += count;
+        }
+        batch.clear();
+    };
+
+    BookmarkReader::Entry entry;
+    while (reader.readNext(entry)) {
+        const int parentId = folders.value(entry.folderId, folderId);
+        if (entry.folder) {
+            // Rows before the folder keep their position.
+            if (!batch.isEmpty()) {
+                addBatch();
+            }
 
-    QJsonDocument doc = QJsonDocument::fromJson(file->readAll());
-    if (doc.isArray()) {
-        QJsonArray array = doc.array();
-        for (const QJsonValue &value : array) {
-            if (value.isObject()) {
-                QJsonObject obj = value.toObject();
-                QString url = obj.value("url").toString();
-                QString favicon = obj.value("favicon").toString();
-                Bookmark* m = new Bookmark(obj.value("title").toString(),
-                                           url,
-                                           favicon,
-                                           obj.value("hasTouchIcon").toBool());
-                bookmarks.append(m);
+            const int id = dbManager->addBookmark(Bookmark::folder(entry.title, parentId));
+            if (id > 0) {
+                folders.insert(entry.id, id);
+                ++added;
+            } else {
+                failed = true;
+            }
+        } else {
+            Bookmark bookmark(entry.title, entry.url, entry.favicon, entry.hasTouchIcon);
+            bookmark.setFolderId(parentId);
+            batch.append(bookmark);
+            if (batch.count() >= gPageSize) {
+                addBatch();
             }
         }
+    }
+    if (!batch.isEmpty()) {
+        addBatch();
+    }
+    if (added > 0) {
+        invalidateUrls();
+    }
+
+    if (reader.hasError()) {
+        qWarning() << "Failed to read all bookmarks of" << path;
+    } else if (failed) {
+        qWarning() << "Failed to add all bookmarks of" << path;
+    } else if (ok) {
+        *ok = true;
+    }
+    return added;
+}
+
+bool BookmarkManager::exportBookmarks(const QString &path)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Can't create file " << path;
+        return false;
+    }
+
+    if (BookmarkReader::format(path) == BookmarkReader::Html) {
+        file.write("<!DOCTYPE NETSCAPE-Bookmark-file-1>\n"
+                   "<META HTTP-EQUIV=\"Content-Type\" CONTENT=\"text/html; charset=UTF-8\">\n"
+                   "<TITLE>Bookmarks</TITLE>\n"
+                   "<H1>Bookmarks</H1>\n"
+                   "<DL><p>\n");
+        writeHtml(file, 0, 1);
+        file.write("</DL><p>\n");
     } else {
-        qWarning() << "Bookmarks.json should be an array of items";
+        bool first = true;
+        file.write("[");
+        writeJson(file, 0, first);
+        file.write("\n]\n");
     }
-    file->close();
 
-    // Cleanup after next stop release. See JB#53083 and JB#52736
-    bookmarkFile = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation)
-            + QLatin1String("/org.sailfishos/sailfish-browser/bookmarks.json");
-    file.reset(new QFile(bookmarkFile));
-    if (file->exists() && file->open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QJsonDocument doc = QJsonDocument::fromJson(file->readAll());
-        if (doc.isArray()) {
-            QJsonArray array = doc.array();
-            for (const QJsonValue &value : array) {
-                if (value.isObject()) {
-                    QJsonObject obj = value.toObject();
-                    QString url = obj.value("url").toString();
-
-                    bool migrate = true;
-                    for (const Bookmark *bookmark : bookmarks) {
-                        if (bookmark->url() == url) {
-                            migrate = false;
-                            break;
-                        }
-                    }
-
-                    if (migrate) {
-                        Bookmark* m = new Bookmark(obj.value("title").toString(),
-                                                   url,
-                                                   obj.value("favicon").toString(),
-                                                   obj.value("hasTouchIcon").toBool());
-                        bookmarks.append(m);
-                    }
+    if (!file.commit()) {
+        qWarning() << "Can't write bookmarks " << path << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+// Folders are written before their contents and refer to their folder by id.
+void BookmarkManager::writeJson(QIODevice &file, int folderId, bool &first)
+{
+    for (int offset = 0;; offset += gPageSize) {
+        const BookmarkList bookmarks = DBManager::instance()->getBookmarks(folderId, offset, gPageSize);
+        for (const Bookmark &bookmark : bookmarks) {
+            QJsonObject item;
+            item.insert("title", QJsonValue(bookmark.title()));
+            if (bookmark.isFolder()) {
+                item.insert("type", QJsonValue(QStringLiteral("folder")));
+                item.insert("id", QJsonValue(bookmark.id()));
+            } else {
+                item.insert("url", QJsonValue(bookmark.url()));
+                item.insert("favicon", QJsonValue(exportedFavicon(bookmark.favicon())));
+                item.insert("hasTouchIcon", QJsonValue(bookmark.hasTouchIcon()));
+            }
+            if (folderId > 0) {
+                item.insert("folderId", QJsonValue(folderId));
+            }
+
+            file.write(first ? "\n" : ",\n");
+            file.write(QJsonDocument(item).toJson(QJsonDocument::Compact));
+            first = false;
+
+            if (bookmark.isFolder()) {
+                writeJson(file, bookmark.id(), first);
+            }
+        }
+
+        if (bookmarks.count() < gPageSize) {
+            break;
+        }
+    }
+}
+
+void BookmarkManager::writeHtml(QIODevice &file, int folderId, int depth)
+{
+    const QByteArray indent(depth * 4, ' ');
+    for (int offset = 0;; offset += gPageSize) {
+        const BookmarkList bookmarks = DBManager::instance()->getBookmarks(folderId, offset, gPageSize);
+        for (const Bookmark &bookmark : bookmarks) {
+            if (bookmark.isFolder()) {
+                file.write(indent + "<DT><H3>" + bookmark.title().toHtmlEscaped().toUtf8() + "</H3>\n");
+                file.write(indent + "<DL><p>\n");
+                writeHtml(file, bookmark.id(), depth + 1);
+                file.write(indent + "</DL><p>\n");
+            } else {
+                QByteArray line = indent + "<DT><A HREF=\"" + bookmark.url().toHtmlEscaped().toUtf8() + "\"";
+                const QString favicon = exportedFavicon(bookmark.favicon());
+                if (favicon.startsWith(QLatin1String("data:"))) {
+                    line += " ICON=\"" + favicon.toLatin1() + "\"";
                 }
+                line += ">" + bookmark.title().toHtmlEscaped().toUtf8() + "</A>\n";
+                file.write(line);
             }
         }
-        file->close();
-        file->remove();
-        save(bookmarks);
+
+        if (bookmarks.count() < gPageSize) {
+            break;
+        }
+    }
+}
+
+// Icon data stored in the database is exported as a data url.
+QString BookmarkManager::exportedFavicon(const QString &favicon)
+{
+    static const QString providerPrefix = QStringLiteral("image://%1/").arg(QStringLiteral(FAVICON_PROVIDER));
+    if (!favicon.startsWith(providerPrefix)) {
+        return favicon;
     }
-    // End of stop release cleanup...
 
-    return bookmarks;
+    QByteArray data = DBManager::instance()->getFaviconData(favicon.mid(providerPrefix.length()));
+    if (data.isEmpty()) {
+        return QString();
+    }
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QByteArray format = QImageReader::imageFormat(&buffer);
+    if (format.isEmpty()) {
+        format = "png";
+    }
+    return QStringLiteral("data:image/%1;base64,%2").arg(QString::fromLatin1(format), QString::fromLatin1(data.toBase64()));
 }
 
 void BookmarkManager::clearBookmarks()
@@ -12,13 +12,20 @@
 #ifndef BOOKMARKMANAGER_H
 #define BOOKMARKMANAGER_H
 
+#include <QHash>
 #include <QObject>
-#include <QList>
 #include <QPointer>
 
-class Bookmark;
+#include "bookmark.h"
+
 class MGConfItem;
+class QIODevice;
 
+/**
+ * Bookmarks are stored in the browser database. The manager imports and
+ * exports them as JSON arrays or Netscape bookmark files (HTML), reading and
+ * writing one page of bookmarks at a time.
+ */
 class BookmarkManager : public QObject
 {
     Q_OBJECT
@@ -26,9 +33,25 @@ class BookmarkManager : public QObject
 public:
     static BookmarkManager* instance();
 
-    void save(const QList<Bookmark*> & bookmarks);
+    // Imports bookmarks.json files of older versions, only does work once.
+    void initialize();
     void clear();
-    QList<Bookmark*> load();
+
+    // The format is chosen by the suffix of the file, html or json.
+    int importBookmarks(const QString &path, int folderId = 0, bool skipExisting = false, bool *ok = nullptr);
+    bool exportBookmarks(const QString &path);
+
+    // Whether the url is bookmarked in any folder. Urls of all bookmarks are
+    // read once and kept in memory, models report the changes they make.
+    bool isBookmarked(const QString &url);
+    void bookmarkAdded(const QString &url);
+    void bookmarkRemoved(const QString &url);
+    // Urls are read again on next lookup, for removed folders.
+    void invalidateUrls();
+
+    // Icon data of an image://favicons url as a data url, other favicons as
+    // is. Blocks on the database, can be called from any thread.
+    static QString exportedFavicon(const QString &favicon);
 
 signals:
     void cleared();
@@ -39,7 +62,14 @@ private slots:
 private:
     BookmarkManager();
 
+    void importLegacyFile(const QString &path);
+    void writeJson(QIODevice &file, int folderId, bool &first);
+    void writeHtml(QIODevice &file, int folderId, int depth);
+
     QPointer<MGConfItem> m_clearBookmarksConfItem;
+    // Url -> number of bookmarks of the url.
+    QHash<QString, int> m_urls;
+    bool m_urlsLoaded;
 };
 
 #endif // BOOKMARKMANAGER_H
@@ -0,0 +1,205 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bookmarkreader.h"
+
+#include <QDebug>
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+
+static const qint64 gChunkSize = 64 * 1024;
+
+// Text content of an HTML fragment.
+static QString htmlText(const QString &html)
+{
+    static const QRegularExpression tag(QStringLiteral("<[^>]*>"));
+    QString text = html;
+    text.remove(tag);
+    text.replace(QLatin1String("&lt;"), QLatin1String("<"));
+    text.replace(QLatin1String("&gt;"), QLatin1String(">"));
+    text.replace(QLatin1String("&quot;"), QLatin1String("\""));
+    text.replace(QLatin1String("&#39;"), QLatin1String("'"));
+    text.replace(QLatin1String("&#x27;"), QLatin1String("'"));
+    text.replace(QLatin1String("&amp;"), QLatin1String("&"));
+    return text.trimmed();
+}
+
+BookmarkReader::BookmarkReader(QIODevice *device, Format format)
+    : m_device(device)
+    , m_format(format)
+    , m_error(false)
+    , m_position(0)
+    , m_depth(0)
+    , m_inString(false)
+    , m_escaped(false)
+    , m_finished(false)
+    , m_pendingFolder(-1)
+    , m_lastFolderId(0)
+{
+}
+
+BookmarkReader::Format BookmarkReader::format(const QString &path)
+{
+    return path.endsWith(QLatin1String(".html"), Qt::CaseInsensitive)
+            || path.endsWith(QLatin1String(".htm"), Qt::CaseInsensitive) ? Html : Json;
+}
+
+bool BookmarkReader::readNext(Entry &entry)
+{
+    return m_format == Json ? readJson(entry) : readHtml(entry);
+}
+
+bool BookmarkReader::hasError() const
+{
+    return m_error;
+}
+
+/**
+ * @brief BookmarkReader::readJson
+ * Scans the top level array chunk by chunk and parses one object at a time.
+ */
+bool BookmarkReader::readJson(Entry &entry)
+{
+    while (!m_finished) {
+        if (m_position >= m_chunk.size()) {
+            m_chunk = m_device->read(gChunkSize);
+            m_position = 0;
+            if (m_chunk.isEmpty()) {
+                // The array was not closed.
+                m_error = true;
+                m_finished = true;
+                return false;
+            }
+        }
+
+        const char c = m_chunk.at(m_position++);
+        if (m_depth > 1 || (m_depth == 1 && c == '{')) {
+            m_object.append(c);
+        }
+
+        if (m_inString) {
+            if (m_escaped) {
+                m_escaped = false;
+            } else if (c == '\\') {
+                m_escaped = true;
+            } else if (c == '"') {
+                m_inString = false;
+            }
+            continue;
+        }
+
+        // Anything but white space and a byte order mark before the array is an error.
+        if (m_depth == 0 && c != '[' && !QChar::isSpace(uchar(c)) && uchar(c) < 0x80) {
+            qWarning() << "Bookmarks should be an array of items";
+            m_error = true;
+            m_finished = true;
+            return false;
+        }
+
+        switch (c) {
+        case '"':
+            m_inString = true;
+            break;
+        case '{':
+        case '[':
+            ++m_depth;
+            break;
+        case '}':
+        case ']':
+            if (--m_depth == 0) {
+                m_finished = true;
+                return false;
+            }
+            if (m_depth == 1 && c == '}') {
+                const QJsonDocument document = QJsonDocument::fromJson(m_object);
+                m_object.clear();
+                if (!document.isObject()) {
+                    m_error = true;
+                    break;
+                }
+
+                const QJsonObject object = document.object();
+                entry = Entry();
+                entry.folder = object.value(QLatin1String("type")).toString() == QLatin1String("folder");
+                entry.title = object.value(QLatin1String("title")).toString();
+                entry.url = object.value(QLatin1String("url")).toString();
+                entry.favicon = object.value(QLatin1String("favicon")).toString();
+                entry.hasTouchIcon = object.value(QLatin1String("hasTouchIcon")).toBool();
+                entry.id = object.value(QLatin1String("id")).toInt();
+                entry.folderId = object.value(QLatin1String("folderId")).toInt();
+                return true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+// Bookmark files have one entry per line, lines are read one at a time.
+bool BookmarkReader::readHtml(Entry &entry)
+{
+    while (m_entries.isEmpty()) {
+        if (m_device->atEnd()) {
+            return false;
+        }
+        parseHtml(QString::fromUtf8(m_device->readLine()));
+    }
+
+    entry = m_entries.dequeue();
+    return true;
+}
+
+void BookmarkReader::parseHtml(const QString &line)
+{
+    static const QRegularExpression tags(QStringLiteral("<(H3|A)\\b([^>]*)>(.*?)</\\1>|<(/?)DL\\b[^>]*>"),
+                                         QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression attributes(QStringLiteral("(\\w+)\\s*=\\s*\"([^\"]*)\""));
+
+    QRegularExpressionMatchIterator it = tags.globalMatch(line);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        const int folderId = m_folders.isEmpty() ? 0 : m_folders.top();
+
+        if (!match.capturedRef(1).isEmpty()) {
+            Entry entry;
+            entry.title = htmlText(match.captured(3));
+            entry.folderId = folderId;
+            if (match.capturedRef(1).compare(QLatin1String("H3"), Qt::CaseInsensitive) == 0) {
+                // Contents of the folder follow in the next list.
+                entry.folder = true;
+                entry.id = ++m_lastFolderId;
+                m_pendingFolder = entry.id;
+            } else {
+                QRegularExpressionMatchIterator attribute = attributes.globalMatch(match.captured(2));
+                while (attribute.hasNext()) {
+                    const QRegularExpressionMatch value = attribute.next();
+                    if (value.capturedRef(1).compare(QLatin1String("HREF"), Qt::CaseInsensitive) == 0) {
+                        entry.url = htmlText(value.captured(2));
+                    } else if (value.capturedRef(1).compare(QLatin1String("ICON"), Qt::CaseInsensitive) == 0) {
+                        entry.favicon = value.captured(2);
+                    }
+                }
+                if (entry.url.isEmpty()) {
+                    continue;
+                }
+            }
+            m_entries.enqueue(entry);
+        } else if (match.capturedRef(4).isEmpty()) {
+            m_folders.push(m_pendingFolder >= 0 ? m_pendingFolder : folderId);
+            m_pendingFolder = -1;
+        } else if (!m_folders.isEmpty()) {
+            m_folders.pop();
+        }
+    }
+}
@@ -0,0 +1,80 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BOOKMARKREADER_H
+#define BOOKMARKREADER_H
+
+#include <QByteArray>
+#include <QQueue>
+#include <QStack>
+#include <QString>
+
+class QIODevice;
+
+/**
+ * Reads bookmarks from a JSON array or a Netscape bookmark file (HTML) one
+ * entry at a time, only the entry being read is kept in memory. Folders and
+ * bookmarks refer to their folder by an id that is local to the file.
+ */
+class BookmarkReader
+{
+public:
+    enum Format {
+        Json,
+        Html
+    };
+
+    struct Entry {
+        Entry() : folder(false), hasTouchIcon(false), id(0), folderId(0) {}
+
+        bool folder;
+        QString title;
+        QString url;
+        QString favicon;
+        bool hasTouchIcon;
+        // Id of a folder entry and the folder containing the entry, 0 for the top level.
+        int id;
+        int folderId;
+    };
+
+    BookmarkReader(QIODevice *device, Format format);
+
+    static Format format(const QString &path);
+
+    // Returns false at the end of the file or on error.
+    bool readNext(Entry &entry);
+    bool hasError() const;
+
+private:
+    bool readJson(Entry &entry);
+    bool readHtml(Entry &entry);
+    void parseHtml(const QString &line);
+
+    QIODevice *m_device;
+    Format m_format;
+    bool m_error;
+
+    // JSON: bytes of the object being read and the scanner state.
+    QByteArray m_chunk;
+    int m_position;
+    QByteArray m_object;
+    int m_depth;
+    bool m_inString;
+    bool m_escaped;
+    bool m_finished;
+
+    // HTML: entries of the current line and the open folders.
+    QQueue<Entry> m_entries;
+    QStack<int> m_folders;
+    int m_pendingFolder;
+    int m_lastFolderId;
+};
+
+#endif // BOOKMARKREADER_H
@@ -8,7 +8,7 @@ SOURCES += \
     $$PWD/declarativebookmarkmodel.cpp \
     $$PWD/desktopbookmarkwriter.cpp \
     $$PWD/bookmarkmanager.cpp \
-    $$PWD/bookmark.cpp
+    $$PWD/bookmarkreader.cpp
 
 # C++ headers
 HEADERS += \
@@ -16,7 +16,7 @@ HEADERS += \
     $$PWD/declarativebookmarkmodel.h \
     $$PWD/desktopbookmarkwriter.h \
     $$PWD/bookmarkmanager.h \
-    $$PWD/bookmark.h
+    $$PWD/bookmarkreader.h
 
 DEFINES += DESKTOP_FILE_PATTERN=\\\"%1/sailfish-browser-%2-%3.desktop\\\"
 DEFINES += DESKTOP_FILE=\\\"sailfish-browser-%2-%3.desktop\\\"
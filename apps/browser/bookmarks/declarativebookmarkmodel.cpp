@@ -8,23 +8,28 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this file,
  * You can obtain one at http://mozilla.org/MPL/2.0/. */
 
+#include <QDebug>
+
 #include "declarativebookmarkmodel.h"
 #include "bookmarkmanager.h"
+#include "dbmanager.h"
+
+// Rows are fetched from the database in pages of this size.
+static const int gPageSize = 100;
 
 DeclarativeBookmarkModel::DeclarativeBookmarkModel(QObject *parent) :
     QAbstractListModel(parent)
+  , m_folderId(0)
+  , m_count(0)
+  , m_validRows(0)
 {
     connect(BookmarkManager::instance(), &BookmarkManager::cleared,
             this, &DeclarativeBookmarkModel::clearBookmarks);
-    bookmarks = BookmarkManager::instance()->load();
+    connect(DBManager::instance(), &DBManager::bookmarkAppended,
+            this, &DeclarativeBookmarkModel::bookmarkAppended);
+    BookmarkManager::instance()->initialize();
 
-    // Generate mapping URL -> bookmark's index in the loaded list.
-    int index(0);
-    for (const Bookmark* const bookmark : bookmarks) {
-        // Use multi insert as there might be multiple bookmark instances with the same url.
-        bookmarkIndexes.insertMulti(bookmark->url(), index);
-        index++;
-    }
+    reset();
 }
 
 QHash<int, QByteArray> DeclarativeBookmarkModel::roleNames() const
@@ -34,120 +39,130 @@ QHash<int, QByteArray> DeclarativeBookmarkModel::roleNames() const
     roles[TitleRole] = "title";
     roles[FaviconRole] = "favicon";
     roles[TouchIconRole] = "hasTouchIcon";
+    roles[FolderRole] = "folder";
+    roles[IdRole] = "bookmarkId";
     return roles;
 }
 
 void DeclarativeBookmarkModel::add(const QString& url, const QString& title, const QString& favicon, bool touchIcon)
 {
-    beginInsertRows(QModelIndex(), rowCount(), rowCount());
-    bookmarkIndexes.insert(url, bookmarks.count());
-    bookmarks.append(new Bookmark(title, url, favicon, touchIcon));
-    endInsertRows();
-    emit countChanged();
-    // Getter will check if active page is still bookmarked.
-    emit activeUrlBookmarkedChanged();
+    Bookmark bookmark(title, url, favicon, touchIcon);
+    bookmark.setFolderId(m_folderId);
+    insert(bookmark);
+}
 
-    save();
+void DeclarativeBookmarkModel::addFolder(const QString &title)
+{
+    insert(Bookmark::folder(title, m_folderId));
 }
 
 void DeclarativeBookmarkModel::remove(const QString& url)
 {
-    if (!contains(url)) {
-        return;
+    const int row = rowOfUrl(url);
+    if (row >= 0) {
+        remove(row);
+    } else if (BookmarkManager::instance()->isBookmarked(url)) {
+        // Not fetched or in another folder.
+        DBManager::instance()->removeBookmark(url);
+        BookmarkManager::instance()->bookmarkRemoved(url);
+        m_count = DBManager::instance()->getBookmarkCount(m_folderId);
+        emit countChanged();
+        // Getter will check if active page is still bookmarked.
+        emit activeUrlBookmarkedChanged();
     }
-
-    int index = bookmarkIndexes.value(url, -1);
-    remove(index);
 }
 
 void DeclarativeBookmarkModel::remove(int index)
 {
-    if (index >= 0 && index < bookmarks.count()) {
+    if (index >= 0 && index < m_bookmarks.count()) {
         beginRemoveRows(QModelIndex(), index, index);
-        Bookmark* bookmark = bookmarks.takeAt(index);
-        delete bookmark;
-
-        // Remove index mapping and update remaining indices
-        QMap<QString, int>::iterator i = bookmarkIndexes.begin();
-        while (i != bookmarkIndexes.end()) {
-            if (i.value() == index) {
-                i = bookmarkIndexes.erase(i);
-                // Erased item was the last one.
-                if (i == bookmarkIndexes.end()) {
-                    break;
-                }
-            }
-
-            if (i.value() > index) {
-                i.value()--;
-            }
-            i++;
+        const Bookmark &bookmark = m_bookmarks.at(index);
+        if (bookmark.id() < 0) {
+            // Removed once written.
+            m_pendingWrites[-1 - bookmark.id()].removed = true;
+        } else {
+            DBManager::instance()->removeBookmark(bookmark.id());
         }
-
+        if (bookmark.isFolder()) {
+            // Bookmarks of the folder are removed with it.
+            BookmarkManager::instance()->invalidateUrls();
+        } else {
+            BookmarkManager::instance()->bookmarkRemoved(bookmark.url());
+        }
+        m_ids.remove(bookmark.url(), bookmark.id());
+        m_rows.remove(bookmark.id());
+        m_bookmarks.remove(index);
+        m_searchKeys.remove(index);
+        // Rows after the removed one are refreshed on demand.
+        m_validRows = qMin(m_validRows, index);
+        --m_count;
         endRemoveRows();
 
         emit countChanged();
         // Getter will check if active page is still bookmarked.
         emit activeUrlBookmarkedChanged();
-        save();
     }
 }
 
 void DeclarativeBookmarkModel::updateFavoriteIcon(const QString &url, const QString &favicon, bool touchIcon)
 {
-    int bookmarkIndex = bookmarkIndexes.value(url, -1);
+    int bookmarkIndex = rowOfUrl(url);
     if (bookmarkIndex >= 0) {
-        Bookmark *bookmark = bookmarks[bookmarkIndex];
+        Bookmark &bookmark = m_bookmarks[bookmarkIndex];
         QVector<int> roles;
-        if (bookmark->favicon() != favicon) {
+        if (bookmark.favicon() != favicon) {
             roles << FaviconRole;
-            bookmark->setFavicon(favicon);
+            bookmark.setFavicon(favicon);
         }
-        if (bookmark->hasTouchIcon() != touchIcon) {
+        if (bookmark.hasTouchIcon() != touchIcon) {
             roles << TouchIconRole;
-            bookmark->setHasTouchIcon(touchIcon);
+            bookmark.setHasTouchIcon(touchIcon);
         }
         if (roles.count() > 0) {
             emit dataChanged(index(bookmarkIndex), index(bookmarkIndex), roles);
-            save();
+            DBManager::instance()->updateBookmarkFavicon(url, favicon, touchIcon);
         }
+    } else if (BookmarkManager::instance()->isBookmarked(url)) {
+        DBManager::instance()->updateBookmarkFavicon(url, favicon, touchIcon);
     }
 }
 
 void DeclarativeBookmarkModel::edit(int index, const QString& url, const QString& title)
 {
-    if (index < 0 || index >= bookmarks.count())
+    if (index < 0 || index >= m_bookmarks.count())
         return;
 
-    Bookmark * bookmark = bookmarks.value(index);
+    Bookmark &bookmark = m_bookmarks[index];
     QVector<int> roles;
-    if (url != bookmark->url()) {
-        bookmark->setUrl(url);
+    if (url != bookmark.url() && !bookmark.isFolder()) {
+        // Re-key the url index, the url might be already bookmarked.
+        m_ids.remove(bookmark.url(), bookmark.id());
+        m_ids.insert(url, bookmark.id());
+        BookmarkManager::instance()->bookmarkRemoved(bookmark.url());
+        BookmarkManager::instance()->bookmarkAdded(url);
+        bookmark.setUrl(url);
+        m_searchKeys[index].url = searchText(url);
         roles << UrlRole;
 
-        // Update key indexes
-        QMap<QString, int>::iterator i = bookmarkIndexes.begin();
-        while (i != bookmarkIndexes.end()) {
-            if (i.value() == index) {
-                i = bookmarkIndexes.erase(i);
-                break;
-            }
-            ++i;
-        }
-        // Use multi insert here as the url might be already bookmarked.
-        bookmarkIndexes.insertMulti(url, index);
-
         // Getter will check if active page is still bookmarked.
         emit activeUrlBookmarkedChanged();
     }
-    if (title != bookmark->title()) {
-        bookmark->setTitle(title);
+    if (title != bookmark.title()) {
+        bookmark.setTitle(title);
+        m_searchKeys[index].title = searchText(title);
         roles << TitleRole;
     }
     if (roles.count() > 0) {
         QModelIndex modelIndex = QAbstractListModel::index(index);
         emit dataChanged(modelIndex, modelIndex, roles);
-        save();
+        if (bookmark.id() < 0) {
+            // Updated once written.
+            PendingWrite &pending = m_pendingWrites[-1 - bookmark.id()];
+            pending.bookmark = bookmark;
+            pending.edited = true;
+        } else {
+            DBManager::instance()->updateBookmark(bookmark);
+        }
     }
 }
 
@@ -171,45 +186,257 @@ bool DeclarativeBookmarkModel::activeUrlBookmarked() const
     return contains(m_activeUrl);
 }
 
-void DeclarativeBookmarkModel::clearBookmarks()
+int DeclarativeBookmarkModel::folderId() const
 {
-    beginRemoveRows(QModelIndex(), 0, qMax<int>(0, bookmarks.count()-1));
-    bookmarks.clear();
-    bookmarkIndexes.clear();
-    endRemoveRows();
+    return m_folderId;
+}
+
+void DeclarativeBookmarkModel::setFolderId(int folderId)
+{
+    if (m_folderId != folderId) {
+        m_folderId = folderId;
+        reset();
+        emit folderIdChanged();
+        emit countChanged();
+    }
+}
+
+int DeclarativeBookmarkModel::bookmarkId(int index) const
+{
+    if (index < 0 || index >= m_bookmarks.count())
+        return -1;
+
+    return m_bookmarks.at(index).id();
+}
+
+int DeclarativeBookmarkModel::row(int id) const
+{
+    const int row = m_rows.value(id, -1);
+    if (row >= 0 && row < m_validRows) {
+        return row;
+    }
+
+    if (m_validRows < m_bookmarks.count()) {
+        // Refresh rows that have moved since the last lookup.
+        for (int i = m_validRows; i < m_bookmarks.count(); ++i) {
+            m_rows.insert(m_bookmarks.at(i).id(), i);
+        }
+        m_validRows = m_bookmarks.count();
+        return m_rows.value(id, -1);
+    }
+    return -1;
+}
+
+bool DeclarativeBookmarkModel::matches(int index, const QString &foldedText) const
+{
+    if (index < 0 || index >= m_searchKeys.count())
+        return false;
+
+    const SearchKey &key = m_searchKeys.at(index);
+    return key.url.contains(foldedText) || key.title.contains(foldedText);
+}
+
+QString DeclarativeBookmarkModel::searchText(const QString &text)
+{
+    return text.trimmed().toCaseFolded();
+}
+
+// Adds the bookmark to the end of the folder, the row is shown once fetched.
+// The bookmark is written without waiting, the row has a placeholder id
+// until the database tells the id.
+void DeclarativeBookmarkModel::insert(const Bookmark &bookmark)
+{
+    const int requestId = DBManager::instance()->appendBookmark(bookmark);
+    m_pendingWrites.insert(requestId, PendingWrite());
+
+    Bookmark added(bookmark);
+    added.setId(placeholderId(requestId));
+    if (!added.isFolder()) {
+        BookmarkManager::instance()->bookmarkAdded(added.url());
+    }
+
+    const int row = m_bookmarks.count();
+    const bool fetched = row == m_count;
+    ++m_count;
+    if (fetched) {
+        beginInsertRows(QModelIndex(), row, row);
+        if (!added.isFolder()) {
+            m_ids.insert(added.url(), added.id());
+        }
+        if (m_validRows == row) {
+            m_rows.insert(added.id(), m_validRows++);
+        }
+        m_bookmarks.append(added);
+        m_searchKeys.append({ searchText(added.url()), searchText(added.title()) });
+        endInsertRows();
+    }
     emit countChanged();
+    // Getter will check if active page is still bookmarked.
+    emit activeUrlBookmarkedChanged();
 }
 
-void DeclarativeBookmarkModel::save()
+void DeclarativeBookmarkModel::bookmarkAppended(int requestId, int id)
 {
-    BookmarkManager::instance()->save(bookmarks);
+    if (!m_pendingWrites.contains(requestId)) {
+        // Appended by another model.
+        return;
+    }
+
+    const PendingWrite pending = m_pendingWrites.take(requestId);
+    const int placeholder = placeholderId(requestId);
+    const int index = pending.removed ? -1 : row(placeholder);
+
+    if (id <= 0) {
+        qWarning() << "Can't add bookmark";
+        if (index >= 0) {
+            remove(index);
+            m_pendingWrites.remove(requestId);
+        }
+        return;
+    }
+
+    if (pending.removed) {
+        DBManager::instance()->removeBookmark(id);
+        return;
+    }
+    if (pending.edited) {
+        Bookmark edited(pending.bookmark);
+        edited.setId(id);
+        DBManager::instance()->updateBookmark(edited);
+    }
+
+    if (index >= 0) {
+        Bookmark &bookmark = m_bookmarks[index];
+        if (!bookmark.isFolder()) {
+            m_ids.remove(bookmark.url(), placeholder);
+            m_ids.insert(bookmark.url(), id);
+        }
+        m_rows.remove(placeholder);
+        if (index < m_validRows) {
+            m_rows.insert(id, index);
+        }
+        bookmark.setId(id);
+        emit dataChanged(QAbstractListModel::index(index), QAbstractListModel::index(index), QVector<int>() << IdRole);
+    }
+}
+
+void DeclarativeBookmarkModel::reset()
+{
+    beginResetModel();
+    m_bookmarks.clear();
+    m_searchKeys.clear();
+    m_ids.clear();
+    m_rows.clear();
+    m_validRows = 0;
+    m_count = DBManager::instance()->getBookmarkCount(m_folderId);
+    endResetModel();
+
+    fetchMore(QModelIndex());
+}
+
+// Negative and below -1, which tells that a row was not found.
+int DeclarativeBookmarkModel::placeholderId(int requestId)
+{
+    return -1 - requestId;
+}
+
+int DeclarativeBookmarkModel::rowOfUrl(const QString &url) const
+{
+    const int id = m_ids.value(url, -1);
+    return id >= 0 ? row(id) : -1;
+}
+
+void DeclarativeBookmarkModel::clearBookmarks()
+{
+    // Cleared in the database after they are written.
+    m_pendingWrites.clear();
+    beginResetModel();
+    m_bookmarks.clear();
+    m_searchKeys.clear();
+    m_ids.clear();
+    m_rows.clear();
+    m_validRows = 0;
+    m_count = 0;
+    endResetModel();
+    emit countChanged();
 }
 
 int DeclarativeBookmarkModel::rowCount(const QModelIndex & parent) const
 {
     Q_UNUSED(parent)
-    return bookmarks.count();
+    return m_bookmarks.count();
+}
+
+bool DeclarativeBookmarkModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_bookmarks.count() < m_count;
+}
+
+void DeclarativeBookmarkModel::fetchMore(const QModelIndex &parent)
+{
+    if (canFetchMore(parent)) {
+        fetch(gPageSize);
+    }
+}
+
+void DeclarativeBookmarkModel::fetchAll()
+{
+    if (canFetchMore(QModelIndex())) {
+        fetch(m_count - m_bookmarks.count());
+    }
+}
+
+void DeclarativeBookmarkModel::fetch(int limit)
+{
+    const int first = m_bookmarks.count();
+    const BookmarkList bookmarks = DBManager::instance()->getBookmarks(m_folderId, first, limit);
+    if (bookmarks.isEmpty()) {
+        // Removed meanwhile.
+        m_count = first;
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), first, first + bookmarks.count() - 1);
+    m_bookmarks.reserve(first + bookmarks.count());
+    m_searchKeys.reserve(first + bookmarks.count());
+    for (const Bookmark &bookmark : bookmarks) {
+        if (!bookmark.isFolder()) {
+            m_ids.insert(bookmark.url(), bookmark.id());
+        }
+        if (m_validRows == m_bookmarks.count()) {
+            m_rows.insert(bookmark.id(), m_validRows++);
+        }
+        m_bookmarks.append(bookmark);
+        m_searchKeys.append({ searchText(bookmark.url()), searchText(bookmark.title()) });
+    }
+    endInsertRows();
+    emit countChanged();
 }
 
 QVariant DeclarativeBookmarkModel::data(const QModelIndex & index, int role) const
 {
-    if (index.row() < 0 || index.row() >= bookmarks.count())
+    if (index.row() < 0 || index.row() >= m_bookmarks.count())
         return QVariant();
 
-    const Bookmark * bookmark = bookmarks.value(index.row());
+    const Bookmark &bookmark = m_bookmarks.at(index.row());
     if (role == UrlRole) {
-        return bookmark->url();
+        return bookmark.url();
     } else if (role == TitleRole) {
-        return bookmark->title();
+        return bookmark.title();
     } else if (role == FaviconRole) {
-        return bookmark->favicon();
+        return bookmark.favicon();
     } else if (role == TouchIconRole) {
-        return bookmark->hasTouchIcon();
+        return bookmark.hasTouchIcon();
+    } else if (role == FolderRole) {
+        return bookmark.isFolder();
+    } else if (role == IdRole) {
+        return bookmark.id();
     }
     return QVariant();
 }
 
+// Bookmarks of other folders and rows not fetched yet count as bookmarked.
 bool DeclarativeBookmarkModel::contains(const QString& url) const
 {
-    return bookmarkIndexes.contains(url);
+    return BookmarkManager::instance()->isBookmarked(url);
 }
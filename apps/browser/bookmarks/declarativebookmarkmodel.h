@@ -13,8 +13,8 @@
 #define DECLARATIVEBOOKMARKMODEL_H
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QStringList>
-#include <QMap>
 
 #include "bookmark.h"
 
@@ -24,6 +24,7 @@ class DeclarativeBookmarkModel : public QAbstractListModel
     Q_PROPERTY(int count READ rowCount NOTIFY countChanged FINAL)
     Q_PROPERTY(QString activeUrl READ activeUrl WRITE setActiveUrl NOTIFY activeUrlChanged FINAL)
     Q_PROPERTY(bool activeUrlBookmarked READ activeUrlBookmarked NOTIFY activeUrlBookmarkedChanged FINAL)
+    Q_PROPERTY(int folderId READ folderId WRITE setFolderId NOTIFY folderIdChanged FINAL)
 public:
     DeclarativeBookmarkModel(QObject *parent = 0);
 
@@ -32,9 +33,12 @@ public:
            TitleRole,
            FaviconRole,
            TouchIconRole,
+           FolderRole,
+           IdRole,
     };
 
     Q_INVOKABLE void add(const QString& url, const QString& title, const QString& favicon, bool touchIcon = false);
+    Q_INVOKABLE void addFolder(const QString& title);
     Q_INVOKABLE void remove(const QString& url);
     Q_INVOKABLE void remove(int index);
     Q_INVOKABLE void updateFavoriteIcon(const QString& url, const QString& favicon, bool touchIcon);
@@ -46,27 +50,75 @@ public:
 
     bool activeUrlBookmarked() const;
 
-    // From QAbstractListModel
+    // Folder whose bookmarks are shown, 0 for the top level.
+    int folderId() const;
+    void setFolderId(int folderId);
+
+    // Ids stay the same while rows move, -1 if not found. Rows that are
+    // being written have a negative id until the database tells theirs.
+    int bookmarkId(int index) const;
+    int row(int id) const;
+
+    // Whether the trimmed url or title of the row contains the case folded text.
+    bool matches(int index, const QString &foldedText) const;
+
+    // From QAbstractListModel, rows are read from the database a page at a time.
     int rowCount(const QModelIndex & parent = QModelIndex()) const;
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+    // Fetches the remaining rows of the folder in one go, for searching.
+    void fetchAll();
     QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
     QHash<int, QByteArray> roleNames() const;
 
 private slots:
     void clearBookmarks();
+    void bookmarkAppended(int requestId, int id);
 
 signals:
     void countChanged();
     void activeUrlChanged();
     void activeUrlBookmarkedChanged();
+    void folderIdChanged();
 
 private:
-    void save();
+    struct SearchKey {
+        QString url;
+        QString title;
+    };
+
+    // Changes to a row made before its bookmark was written.
+    struct PendingWrite {
+        PendingWrite() : edited(false), removed(false) {}
+
+        Bookmark bookmark;
+        bool edited;
+        bool removed;
+    };
+
+    void insert(const Bookmark &bookmark);
+    void reset();
+    void fetch(int limit);
+    int rowOfUrl(const QString &url) const;
+    static QString searchText(const QString &text);
+    static int placeholderId(int requestId);
 
     QString m_activeUrl;
+    int m_folderId;
+    // Rows of the folder in the database, rows are fetched up to this count.
+    int m_count;
 
-    QList<Bookmark*> bookmarks;
-    // This map accelerates access to the `bookmarks` list's elements by their URL.
-    // Consider this as an analog of a DB index for `bookmarks` table indexed by URLs.
-    QMap<QString, int> bookmarkIndexes;
+    // Bookmarks in row order.
+    BookmarkList m_bookmarks;
+    // Trimmed and case folded url and title of each row, for searching.
+    QVector<SearchKey> m_searchKeys;
+    // Url -> id, the same url can be bookmarked more than once.
+    QMultiHash<QString, int> m_ids;
+    // Id -> row. Removing a row does not renumber the rows after it, entries
+    // from m_validRows onwards are refreshed when they are looked up.
+    mutable QHash<int, int> m_rows;
+    mutable int m_validRows;
+    // Request id of appended bookmarks -> changes waiting for the id.
+    QHash<int, PendingWrite> m_pendingWrites;
 };
 #endif // DECLARATIVEBOOKMARKMODEL_H
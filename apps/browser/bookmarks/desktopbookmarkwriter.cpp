@@ -13,6 +13,7 @@
 #include <QtConcurrent>
 
 #include "desktopbookmarkwriter.h"
+#include "bookmarkmanager.h"
 #include "browserpaths.h"
 
 static bool dbw_testMode = false;
@@ -89,13 +90,19 @@ QString DesktopBookmarkWriter::uniqueDesktopFileName(QString title)
 
 QString DesktopBookmarkWriter::write(const QString &url, const QString &title, const QString &icon)
 {
+    // The launcher can't load icons of the favicon image provider.
+    QString desktopIcon = BookmarkManager::exportedFavicon(icon);
+    if (desktopIcon.isEmpty()) {
+        desktopIcon = DEFAULT_DESKTOP_BOOKMARK_ICON;
+    }
+
     QString fileName = uniqueDesktopFileName(title);
     QString desktopFileData = QString("[Desktop Entry]\n" \
                                       "Type=Link\n" \
                                       "Name=%1\n" \
                                       "Icon=%2\n" \
                                       "URL=%3\n" \
-                                      "Comment=%4\n").arg(title.trimmed(), icon,
+                                      "Comment=%4\n").arg(title.trimmed(), desktopIcon,
                                                           url.trimmed(), title.trimmed());
     QFile desktopFile(fileName);
     if (desktopFile.open(QFile::WriteOnly)) {
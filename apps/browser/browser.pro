@@ -39,6 +39,7 @@ include(../factories/factories.pri)
 include(../shared/shared.pri)
 include(settings/settings.pri)
 include(bookmarks/bookmarks.pri)
+include(suggestions/suggestions.pri)
 
 # QML files and folders of browser
 qml.path = $$DEPLOYMENT_PATH
@@ -28,6 +28,7 @@
 #include "browserservice.h"
 #include "persistenttabmodel.h"
 #include "privatetabmodel.h"
+#include "tabfiltermodel.h"
 #include "declarativehistorymodel.h"
 #include "declarativewebcontainer.h"
 #include "declarativewebpage.h"
@@ -37,7 +38,10 @@
 #include "datafetcher.h"
 #include "inputregion.h"
 #include "searchenginemodel.h"
+#include "suggestionmodel.h"
+#include "faviconimageprovider.h"
 #include "faviconmanager.h"
+#include "tabthumbnailprovider.h"
 
 #ifdef HAS_BOOSTER
 #include <MDeclarativeCache>
@@ -141,7 +145,9 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
         qmlRegisterType<DeclarativeBookmarkModel>(uri, 1, 0, "BookmarkModel");
         qmlRegisterUncreatableType<PersistentTabModel>(uri, 1, 0, "PersistentTabModel", "");
         qmlRegisterType<DeclarativeHistoryModel>(uri, 1, 0, "HistoryModel");
+        qmlRegisterType<SuggestionModel>(uri, 1, 0, "SuggestionModel");
         qmlRegisterType<BookmarkFilterModel>(uri, 1, 0, "BookmarkFilterModel");
+        qmlRegisterType<TabFilterModel>(uri, 1, 0, "TabFilterModel");
         qmlRegisterType<DeclarativeLoginModel>(uri, 1, 0, "LoginModel");
         qmlRegisterType<LoginFilterModel>(uri, 1, 0, "LoginFilterModel");
     }
@@ -155,6 +161,9 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
     qmlRegisterType<InputRegion>(uri, 1, 0, "InputRegion");
     qmlRegisterSingletonType<SearchEngineModel>(uri, 1, 0, "SearchEngineModel", search_model_factory);
 
+    view->engine()->addImageProvider(QStringLiteral(TAB_THUMBNAIL_PROVIDER), new TabThumbnailProvider);
+    view->engine()->addImageProvider(QStringLiteral(FAVICON_PROVIDER), new FaviconImageProvider);
+
     Browser *browser = new Browser(view.data(), app.data());
     browser->connect(service, &BrowserService::openUrlRequested,
                      browser, &Browser::openUrl);
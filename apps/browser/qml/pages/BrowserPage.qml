@@ -16,6 +16,7 @@ import Sailfish.Silica 1.0
 import Sailfish.Silica.private 1.0 as Private
 import Sailfish.Browser 1.0
 import Sailfish.Policy 1.0
+import org.nemomobile.configuration 1.0
 import "components" as Browser
 import "../shared" as Shared
 
@@ -25,7 +26,15 @@ Page {
     readonly property rect inputMask: inputMaskForOrientation(orientation)
     readonly property bool active: status == PageStatus.Active
     property bool tabPageActive
-    readonly property size thumbnailSize: Qt.size(width - Theme.horizontalPageMargin * 2, Math.max(height / 2.5, width / 1.66) - (Theme.iconSizeSmall + Theme.paddingMedium * 2))
+    // Image area of a tab card in TabGridView, thumbnails are stored at this size.
+    readonly property int _tabColumns: Screen.sizeCategory > Screen.Medium
+                                       ? isPortrait ? 2 : 3
+                                       : width < 2 * height ? width <= height ? 1 : 2 : 3
+    readonly property real _tabCardHeight: Screen.sizeCategory > Screen.Medium
+                                           ? Screen.width / 3
+                                           : !isPortrait ? height / 2.5 : width / 1.66
+    readonly property size thumbnailSize: Qt.size((width - Theme.horizontalPageMargin * 2 - Theme.paddingLarge * (_tabColumns - 1)) / _tabColumns,
+                                                  _tabCardHeight - (Theme.iconSizeSmall + Theme.paddingMedium * 2))
     property Item debug
     property Component tabPageComponent
 
@@ -121,6 +130,10 @@ Page {
 
     HistoryModel {
         id: historyModel
+
+        // Visits are applied to the rows only while the history page is shown,
+        // url bar suggestions come from their own model.
+        active: browserPage.status !== PageStatus.Active
     }
 
     Private.VirtualKeyboardObserver {
@@ -151,6 +164,8 @@ Page {
         fullscreenHeight: portrait ? Screen.height : Screen.width
         portrait: browserPage.isPortrait
         maxLiveTabCount: 3
+        idleTabTimeout: idleTabTimeoutConfig.value
+        thumbnailCacheSize: thumbnailCacheSizeConfig.value
         toolbarHeight: overlay.animator.opened ? overlay.toolBar.rowHeight : 0
         rotationHandler: browserPage
         imOpened: virtualKeyboardObserver.opened
@@ -418,6 +433,20 @@ Page {
         }
     }
 
+    ConfigurationValue {
+        id: idleTabTimeoutConfig
+        // Seconds until an inactive tab is suspended, zero disables idle sleeping.
+        key: "/apps/sailfish-browser/settings/idle_tab_timeout"
+        defaultValue: 600
+    }
+
+    ConfigurationValue {
+        id: thumbnailCacheSizeConfig
+        // Disk budget of tab thumbnails in megabytes.
+        key: "/apps/sailfish-browser/settings/thumbnail_cache_size"
+        defaultValue: 20
+    }
+
     Component.onCompleted: {
         if (!WebUtils.firstUseDone) {
             window.setBrowserCover(webView.tabModel)
@@ -34,6 +34,7 @@ Shared.Background {
     property alias dragArea: dragArea
     property alias searchField: searchField
     readonly property alias enteringNewTabUrl: searchField.enteringNewTabUrl
+    readonly property bool historyVisible: historyContainer.showHistoryList
     property var favoriteGrid: historyList.headerItem
     property string enteredUrl
 
@@ -546,6 +547,12 @@ Shared.Background {
                 activeUrl: toolBar.url
             }
 
+            SuggestionModel {
+                id: suggestionModel
+                search: historyContainer.showHistoryList ? searchField.text : ""
+                tabModel: webView.tabModel
+            }
+
             Browser.HistoryList {
                 id: historyList
 
@@ -593,8 +600,7 @@ Shared.Background {
                 enabled: overlayAnimator.atTop
                 visible: !overlayAnimator.atBottom && _showUrlEntry
                 onMovingChanged: if (moving) historyList.focus = true
-                onSearchChanged: if (search !== webView.url) historyModel.search(search)
-                model: historyContainer.showHistoryList ? historyModel : 0
+                model: historyContainer.showHistoryList ? suggestionModel : 0
                 contentY: favoriteGrid.y
                 showDeleteButton: true
                 onLoad: {
@@ -605,7 +611,7 @@ Shared.Background {
                 onContentHeightChanged: if (menuClosed) contentY = favoriteGrid.y
                 onSaveBookmark: bookmarkModel.add(url, title || url, "", true)
 
-                viewPlaceholder.enabled: historyList.model && !historyList.model.count
+                viewPlaceholder.enabled: historyList.model && historyList.model.complete && !historyList.model.count
 
                 Behavior on opacity { FadeAnimator {} }
             }
@@ -139,11 +139,12 @@ BackgroundItem {
             Image {
                 id: image
 
-                source: thumbnailPath
+                source: thumbnailSource
                 y: header.height
                 width: root.implicitWidth
                 height: root.implicitHeight
 
+                // Decoded thumbnails are cached by the tab thumbnail provider.
                 cache: false
                 asynchronous: true
                 opacity: status !== Image.Ready && source !== "" ? 0.0 : 1.0
@@ -91,8 +91,15 @@ QVariant DeclarativeLoginModel::data(const QModelIndex &index, int role) const
         return m_logins.at(index.row()).second.username();
     case PasswordRole:
         return m_logins.at(index.row()).second.password();
-    case FavIconRole:
-        return FaviconManager::instance()->get("logins", m_logins.at(index.row()).second.hostname());
+    case FavIconRole: {
+        // Hostnames are sanitized and hashed once per login, not on every lookup.
+        const UidLoginInfo &login = m_logins.at(index.row());
+        QHash<int, FaviconManager::Host>::iterator host = m_hostKeys.find(login.first);
+        if (host == m_hostKeys.end()) {
+            host = m_hostKeys.insert(login.first, FaviconManager::host(login.second.hostname()));
+        }
+        return FaviconManager::instance()->favicon(QStringLiteral("logins"), *host);
+    }
     default:
         return QVariant();
     }
@@ -135,6 +142,7 @@ void DeclarativeLoginModel::setLoginList(const QVariantList &data)
 
     m_index.clear();
     m_logins.clear();
+    m_hostKeys.clear();
 
     for (const auto &iter : data) {
         QVariantMap varMap = iter.toMap();
@@ -176,6 +184,7 @@ void DeclarativeLoginModel::remove(int uid)
     SailfishOS::WebEngine::instance()->notifyObservers(LOGINS_ACTION, QVariant(data));
     m_logins.removeAt(index);
     m_index.remove(uid);
+    m_hostKeys.remove(uid);
 
     // Update the index (every item above has its position decremented)
     for (int pos = index; pos < m_logins.count(); ++pos) {
@@ -13,8 +13,10 @@
 
 #include <QAbstractListModel>
 #include <QQmlParserStatus>
+#include <QHash>
 #include <QMap>
 
+#include "faviconmanager.h"
 #include "logininfo.h"
 
 typedef QPair<int, LoginInfo> UidLoginInfo;
@@ -68,6 +70,8 @@ private:
     QMap<int, int> m_index;
     // <uid, data>
     QList<UidLoginInfo> m_logins;
+    // <uid, favicon lookup key>, resolved when first needed
+    mutable QHash<int, FaviconManager::Host> m_hostKeys;
     int m_nextUid;
     bool m_populated;
 };
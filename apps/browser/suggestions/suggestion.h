@@ -0,0 +1,45 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef SUGGESTION_H
+#define SUGGESTION_H
+
+#include <QList>
+#include <QMetaType>
+#include <QString>
+
+struct Suggestion {
+    enum Source {
+        History = 0x1,
+        Bookmark = 0x2,
+        Tab = 0x4,
+        SearchEngine = 0x8
+    };
+
+    Suggestion() : sources(0), visitCount(0), lastVisit(0), score(0) {}
+
+    QString url;
+    QString title;
+    QString favicon;
+    // Sources the suggestion was merged from.
+    int sources;
+    int visitCount;
+    // Seconds since the epoch.
+    uint lastVisit;
+    qreal score;
+};
+
+typedef QList<Suggestion> SuggestionList;
+
+Q_DECLARE_TYPEINFO(Suggestion, Q_MOVABLE_TYPE);
+Q_DECLARE_METATYPE(Suggestion)
+Q_DECLARE_METATYPE(SuggestionList)
+
+#endif // SUGGESTION_H
@@ -0,0 +1,488 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "suggestionmodel.h"
+#include "suggestionprovider.h"
+#include "dbmanager.h"
+#include "faviconmanager.h"
+#include "link.h"
+#include "searchenginemodel.h"
+
+#include <QDateTime>
+#include <QSet>
+#include <QUrl>
+#include <QtMath>
+
+#include <algorithm>
+
+// Leaves a few milliseconds of the frame for the view to lay out the rows.
+static const int gDefaultTimeBudget = 12;
+static const int gDefaultMaximumCount = 10;
+
+// Key of a suggestion, suggestions without an url such as search engines are keyed by title.
+static QString suggestionKey(const Suggestion &suggestion)
+{
+    return suggestion.url.isEmpty() ? QLatin1Char('\n') + suggestion.title
+                                    : SuggestionModel::canonicalUrl(suggestion.url);
+}
+
+static qreal sourceWeight(int sources)
+{
+    qreal weight = 0;
+    if (sources & Suggestion::Tab) {
+        weight += 1.0;
+    }
+    if (sources & Suggestion::Bookmark) {
+        weight += 0.8;
+    }
+    if (sources & Suggestion::History) {
+        weight += 0.4;
+    }
+    if (sources & Suggestion::SearchEngine) {
+        weight += 0.2;
+    }
+    return weight;
+}
+
+SuggestionModel::SuggestionModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_maximumCount(gDefaultMaximumCount)
+    , m_complete(true)
+    , m_tabProvider(new ModelSuggestionProvider(Suggestion::Tab))
+    , m_searchEngineProvider(new ModelSuggestionProvider(Suggestion::SearchEngine))
+    , m_queryId(0)
+    , m_pending(0)
+{
+    m_budgetTimer.setSingleShot(true);
+    m_budgetTimer.setInterval(gDefaultTimeBudget);
+    connect(&m_budgetTimer, &QTimer::timeout, this, &SuggestionModel::budgetExpired);
+
+    // Engines that are not installed cannot be searched with.
+    m_searchEngineProvider->setExcludedStatus(SearchEngineModel::Available);
+
+    addProvider(new HistorySuggestionProvider);
+    addProvider(new BookmarkSuggestionProvider);
+    addProvider(m_tabProvider);
+    addProvider(m_searchEngineProvider);
+}
+
+SuggestionModel::~SuggestionModel()
+{
+    for (SuggestionProvider *provider : m_providers) {
+        provider->cancel();
+    }
+}
+
+QString SuggestionModel::search() const
+{
+    return m_search;
+}
+
+void SuggestionModel::setSearch(const QString &search)
+{
+    if (m_search != search) {
+        m_search = search;
+        emit searchChanged();
+        query();
+    }
+}
+
+int SuggestionModel::timeBudget() const
+{
+    return m_budgetTimer.interval();
+}
+
+void SuggestionModel::setTimeBudget(int timeBudget)
+{
+    if (m_budgetTimer.interval() != timeBudget) {
+        m_budgetTimer.setInterval(timeBudget);
+        emit timeBudgetChanged();
+    }
+}
+
+int SuggestionModel::maximumCount() const
+{
+    return m_maximumCount;
+}
+
+void SuggestionModel::setMaximumCount(int maximumCount)
+{
+    if (m_maximumCount != maximumCount) {
+        m_maximumCount = maximumCount;
+        emit maximumCountChanged();
+        query();
+    }
+}
+
+QAbstractItemModel *SuggestionModel::tabModel() const
+{
+    return m_tabProvider->model();
+}
+
+void SuggestionModel::setTabModel(QAbstractItemModel *model)
+{
+    if (m_tabProvider->model() != model) {
+        m_tabProvider->setModel(model);
+        emit tabModelChanged();
+        query();
+    }
+}
+
+QAbstractItemModel *SuggestionModel::searchEngineModel() const
+{
+    return m_searchEngineProvider->model();
+}
+
+void SuggestionModel::setSearchEngineModel(QAbstractItemModel *model)
+{
+    if (m_searchEngineProvider->model() != model) {
+        m_searchEngineProvider->setModel(model);
+        emit searchEngineModelChanged();
+        query();
+    }
+}
+
+bool SuggestionModel::complete() const
+{
+    return m_complete;
+}
+
+void SuggestionModel::addProvider(SuggestionProvider *provider)
+{
+    provider->setParent(this);
+    const int index = m_providers.count();
+    m_providers.append(provider);
+    connect(provider, &SuggestionProvider::finished, this, [this, index](int queryId, const SuggestionList &suggestions) {
+        providerFinished(index, queryId, suggestions);
+    });
+}
+
+void SuggestionModel::remove(const QString &url)
+{
+    DBManager::instance()->removeHistoryEntry(url);
+
+    // Results of the running query are published again.
+    for (SuggestionList &results : m_results) {
+        for (int i = results.count() - 1; i >= 0; --i) {
+            if (results.at(i).url == url && results.at(i).sources == Suggestion::History) {
+                results.removeAt(i);
+            }
+        }
+    }
+
+    for (int row = 0; row < m_suggestions.count(); ++row) {
+        Suggestion &suggestion = m_suggestions[row];
+        if (suggestion.url != url || !(suggestion.sources & Suggestion::History)) {
+            continue;
+        }
+
+        if (suggestion.sources == Suggestion::History) {
+            beginRemoveRows(QModelIndex(), row, row);
+            m_suggestions.removeAt(row);
+            m_keys.removeAt(row);
+            m_hostKeys.remove(row);
+            endRemoveRows();
+            emit countChanged();
+        } else {
+            suggestion.sources &= ~Suggestion::History;
+            suggestion.visitCount = 0;
+            const QModelIndex modelIndex = index(row);
+            emit dataChanged(modelIndex, modelIndex, QVector<int>() << SourceRole);
+        }
+        break;
+    }
+}
+
+/**
+ * @brief SuggestionModel::canonicalUrl
+ * Canonical url of Link::canonicalUrl without the fragment, the scheme and
+ * the "www." prefix of the host, so that variants of the same page are
+ * suggested once.
+ */
+QString SuggestionModel::canonicalUrl(const QString &url)
+{
+    const QUrl parsed(url);
+    if (parsed.host().isEmpty()) {
+        return url;
+    }
+
+    QString canonical = Link::canonicalUrl(parsed.adjusted(QUrl::RemoveFragment).toString());
+    canonical.remove(0, canonical.indexOf(QLatin1String("://")) + 3);
+    if (canonical.startsWith(QLatin1String("www."))) {
+        canonical.remove(0, 4);
+    }
+    return canonical;
+}
+
+/**
+ * @brief SuggestionModel::score
+ * How well the suggestion matches times how valuable its sources are. Visits
+ * add to the value, recent visits more than old ones.
+ */
+qreal SuggestionModel::score(const Suggestion &suggestion, const QString &search, uint now)
+{
+    const QString canonical = canonicalUrl(suggestion.url);
+    qreal match = 0.3;
+    if (canonical.startsWith(search, Qt::CaseInsensitive)) {
+        match = 1.0;
+    } else if (suggestion.title.startsWith(search, Qt::CaseInsensitive)) {
+        match = 0.9;
+    } else if (suggestion.title.contains(QLatin1Char(' ') + search, Qt::CaseInsensitive)) {
+        match = 0.8;
+    } else if (canonical.contains(search, Qt::CaseInsensitive)) {
+        match = 0.6;
+    } else if (suggestion.title.contains(search, Qt::CaseInsensitive)) {
+        match = 0.5;
+    }
+
+    qreal frecency = 0;
+    if (suggestion.visitCount > 0) {
+        const qreal ageDays = now > suggestion.lastVisit ? (now - suggestion.lastVisit) / 86400.0 : 0;
+        frecency = 0.25 * qLn(1 + suggestion.visitCount) / M_LN2 / (1 + ageDays / 7);
+    }
+
+    return match * (sourceWeight(suggestion.sources) + frecency);
+}
+
+int SuggestionModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return m_suggestions.count();
+}
+
+QVariant SuggestionModel::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= m_suggestions.count()) {
+        return QVariant();
+    }
+
+    const Suggestion &suggestion = m_suggestions.at(index.row());
+    switch (role) {
+    case UrlRole:
+        return suggestion.url;
+    case TitleRole:
+        return suggestion.title;
+    case FaviconRole:
+        if (suggestion.favicon.isEmpty() && !suggestion.url.isEmpty()) {
+            return FaviconManager::instance()->favicon(QStringLiteral("history"), hostKey(index.row()));
+        }
+        return suggestion.favicon;
+    case SourceRole:
+        return suggestion.sources;
+    case ScoreRole:
+        return suggestion.score;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> SuggestionModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[UrlRole] = "url";
+    roles[TitleRole] = "title";
+    roles[FaviconRole] = "favicon";
+    roles[SourceRole] = "source";
+    roles[ScoreRole] = "score";
+    return roles;
+}
+
+void SuggestionModel::budgetExpired()
+{
+    publish();
+}
+
+void SuggestionModel::query()
+{
+    ++m_queryId;
+    for (SuggestionProvider *provider : m_providers) {
+        provider->cancel();
+    }
+    m_results = QVector<SuggestionList>(m_providers.count());
+
+    const QString text = m_search.trimmed();
+    if (text.isEmpty() || m_maximumCount <= 0) {
+        m_pending = 0;
+        m_budgetTimer.stop();
+        updateRows(SuggestionList(), QStringList());
+        setComplete(true);
+        return;
+    }
+
+    m_pending = m_providers.count();
+    setComplete(false);
+    m_budgetTimer.start();
+
+    // Providers that match in place answer before start() returns.
+    const int queryId = m_queryId;
+    for (SuggestionProvider *provider : m_providers) {
+        provider->start(queryId, text, m_maximumCount);
+    }
+}
+
+void SuggestionModel::providerFinished(int provider, int queryId, const SuggestionList &suggestions)
+{
+    if (queryId != m_queryId) {
+        return;
+    }
+
+    m_results[provider] = suggestions;
+    if (--m_pending == 0) {
+        m_budgetTimer.stop();
+        publish();
+        setComplete(true);
+    } else if (!m_budgetTimer.isActive()) {
+        // Late result, the budget has already been spent.
+        publish();
+    }
+}
+
+void SuggestionModel::publish()
+{
+    const QString text = m_search.trimmed();
+    const uint now = QDateTime::currentDateTimeUtc().toTime_t();
+
+    SuggestionList merged;
+    QStringList keys;
+    QHash<QString, int> rows;
+    for (const SuggestionList &results : m_results) {
+        for (const Suggestion &suggestion : results) {
+            const QString key = suggestionKey(suggestion);
+            const int row = rows.value(key, -1);
+            if (row < 0) {
+                rows.insert(key, merged.count());
+                merged.append(suggestion);
+                keys.append(key);
+                continue;
+            }
+
+            Suggestion &existing = merged[row];
+            existing.sources |= suggestion.sources;
+            if (existing.title.isEmpty()) {
+                existing.title = suggestion.title;
+            }
+            if (existing.favicon.isEmpty()) {
+                existing.favicon = suggestion.favicon;
+            }
+            existing.visitCount = qMax(existing.visitCount, suggestion.visitCount);
+            existing.lastVisit = qMax(existing.lastVisit, suggestion.lastVisit);
+        }
+    }
+
+    QVector<int> order(merged.count());
+    for (int i = 0; i < merged.count(); ++i) {
+        merged[i].score = score(merged.at(i), text, now);
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&merged](int a, int b) {
+        return merged.at(a).score > merged.at(b).score;
+    });
+
+    SuggestionList suggestions;
+    QStringList suggestionKeys;
+    for (int i = 0; i < order.count() && i < m_maximumCount; ++i) {
+        suggestions.append(merged.at(order.at(i)));
+        suggestionKeys.append(keys.at(order.at(i)));
+    }
+
+    updateRows(suggestions, suggestionKeys);
+}
+
+/**
+ * @brief SuggestionModel::updateRows
+ * Keeps rows of unchanged suggestions so that the view does not recreate
+ * delegates on every keystroke.
+ */
+void SuggestionModel::updateRows(const SuggestionList &suggestions, const QStringList &keys)
+{
+    const int count = m_suggestions.count();
+    const QSet<QString> newKeys = keys.toSet();
+    for (int row = m_keys.count() - 1; row >= 0; --row) {
+        if (newKeys.contains(m_keys.at(row))) {
+            continue;
+        }
+        const int last = row;
+        while (row > 0 && !newKeys.contains(m_keys.at(row - 1))) {
+            --row;
+        }
+        beginRemoveRows(QModelIndex(), row, last);
+        m_keys.erase(m_keys.begin() + row, m_keys.begin() + last + 1);
+        m_suggestions.erase(m_suggestions.begin() + row, m_suggestions.begin() + last + 1);
+        m_hostKeys.remove(row, last - row + 1);
+        endRemoveRows();
+    }
+
+    for (int i = 0; i < suggestions.count(); ++i) {
+        const Suggestion &suggestion = suggestions.at(i);
+        const int from = m_keys.indexOf(keys.at(i), i);
+        if (from < 0) {
+            beginInsertRows(QModelIndex(), i, i);
+            m_keys.insert(i, keys.at(i));
+            m_suggestions.insert(i, suggestion);
+            m_hostKeys.insert(i, FaviconManager::Host());
+            endInsertRows();
+            continue;
+        }
+
+        if (from != i) {
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), i);
+            m_keys.move(from, i);
+            m_suggestions.move(from, i);
+            m_hostKeys.move(from, i);
+            endMoveRows();
+        }
+
+        Suggestion &current = m_suggestions[i];
+        QVector<int> roles;
+        if (current.url != suggestion.url) {
+            roles << UrlRole << FaviconRole;
+            m_hostKeys[i] = FaviconManager::Host();
+        }
+        if (current.title != suggestion.title) {
+            roles << TitleRole;
+        }
+        if (current.favicon != suggestion.favicon && !roles.contains(FaviconRole)) {
+            roles << FaviconRole;
+        }
+        if (current.sources != suggestion.sources) {
+            roles << SourceRole;
+        }
+        if (current.score != suggestion.score) {
+            roles << ScoreRole;
+        }
+        current = suggestion;
+        if (!roles.isEmpty()) {
+            const QModelIndex modelIndex = index(i);
+            emit dataChanged(modelIndex, modelIndex, roles);
+        }
+    }
+
+    if (count != m_suggestions.count()) {
+        emit countChanged();
+    }
+}
+
+// Sanitizing and hashing the url is done once per row, not on every favicon lookup.
+const FaviconManager::Host &SuggestionModel::hostKey(int row) const
+{
+    FaviconManager::Host &host = m_hostKeys[row];
+    if (host.isNull()) {
+        host = FaviconManager::host(m_suggestions.at(row).url);
+    }
+    return host;
+}
+
+void SuggestionModel::setComplete(bool complete)
+{
+    if (m_complete != complete) {
+        m_complete = complete;
+        emit completeChanged();
+    }
+}
@@ -0,0 +1,131 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef SUGGESTIONMODEL_H
+#define SUGGESTIONMODEL_H
+
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+#include "faviconmanager.h"
+#include "suggestion.h"
+
+class QAbstractItemModel;
+class SuggestionProvider;
+class ModelSuggestionProvider;
+
+/**
+ * Url bar suggestions from history, bookmarks, open tabs and search engines.
+ * All providers are queried for every change of the search text and the
+ * previous query is cancelled. Results are merged by canonical url and
+ * ranked with one scoring function. The model is updated once every provider
+ * has answered or when the time budget runs out, results arriving after the
+ * budget update the model again.
+ */
+class SuggestionModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QString search READ search WRITE setSearch NOTIFY searchChanged)
+    Q_PROPERTY(int timeBudget READ timeBudget WRITE setTimeBudget NOTIFY timeBudgetChanged)
+    Q_PROPERTY(int maximumCount READ maximumCount WRITE setMaximumCount NOTIFY maximumCountChanged)
+    Q_PROPERTY(QAbstractItemModel *tabModel READ tabModel WRITE setTabModel NOTIFY tabModelChanged)
+    Q_PROPERTY(QAbstractItemModel *searchEngineModel READ searchEngineModel WRITE setSearchEngineModel NOTIFY searchEngineModelChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+    Q_PROPERTY(bool complete READ complete NOTIFY completeChanged)
+
+public:
+    enum Roles {
+        UrlRole = Qt::UserRole + 1,
+        TitleRole,
+        FaviconRole,
+        SourceRole,
+        ScoreRole
+    };
+
+    explicit SuggestionModel(QObject *parent = nullptr);
+    ~SuggestionModel();
+
+    QString search() const;
+    void setSearch(const QString &search);
+
+    // Milliseconds from a change of the search text to the first update.
+    int timeBudget() const;
+    void setTimeBudget(int timeBudget);
+
+    int maximumCount() const;
+    void setMaximumCount(int maximumCount);
+
+    QAbstractItemModel *tabModel() const;
+    void setTabModel(QAbstractItemModel *model);
+
+    QAbstractItemModel *searchEngineModel() const;
+    void setSearchEngineModel(QAbstractItemModel *model);
+
+    // True when every provider has answered the current query.
+    bool complete() const;
+
+    // Takes ownership of the provider.
+    void addProvider(SuggestionProvider *provider);
+
+    // Removes the url from the history. The row stays while another source suggests the url.
+    Q_INVOKABLE void remove(const QString &url);
+
+    static QString canonicalUrl(const QString &url);
+    static qreal score(const Suggestion &suggestion, const QString &search, uint now);
+
+    // From QAbstractListModel
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void searchChanged();
+    void timeBudgetChanged();
+    void maximumCountChanged();
+    void tabModelChanged();
+    void searchEngineModelChanged();
+    void countChanged();
+    void completeChanged();
+
+private slots:
+    void budgetExpired();
+
+private:
+    void query();
+    void providerFinished(int provider, int queryId, const SuggestionList &suggestions);
+    void publish();
+    void updateRows(const SuggestionList &suggestions, const QStringList &keys);
+    void setComplete(bool complete);
+    const FaviconManager::Host &hostKey(int row) const;
+
+    QString m_search;
+    int m_maximumCount;
+    bool m_complete;
+
+    QVector<SuggestionProvider *> m_providers;
+    ModelSuggestionProvider *m_tabProvider;
+    ModelSuggestionProvider *m_searchEngineProvider;
+
+    // Results of the current query by provider and the number of providers yet to answer.
+    QVector<SuggestionList> m_results;
+    int m_queryId;
+    int m_pending;
+    QTimer m_budgetTimer;
+
+    SuggestionList m_suggestions;
+    QStringList m_keys;
+    // Favicon lookup keys parallel to m_suggestions, resolved when first needed.
+    mutable QVector<FaviconManager::Host> m_hostKeys;
+};
+
+#endif // SUGGESTIONMODEL_H
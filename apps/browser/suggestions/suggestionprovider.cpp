@@ -0,0 +1,152 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "suggestionprovider.h"
+#include "dbmanager.h"
+
+#include <QAbstractItemModel>
+
+SuggestionProvider::SuggestionProvider(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void SuggestionProvider::cancel()
+{
+}
+
+HistorySuggestionProvider::HistorySuggestionProvider(QObject *parent)
+    : SuggestionProvider(parent)
+    , m_requestId(0)
+{
+}
+
+HistorySuggestionProvider::~HistorySuggestionProvider()
+{
+    cancel();
+}
+
+void HistorySuggestionProvider::start(int queryId, const QString &text, int limit)
+{
+    cancel();
+    m_requestId = DBManager::instance()->searchHistory(text, limit, this, [this, queryId](const QList<Link> &links) {
+        m_requestId = 0;
+        SuggestionList suggestions;
+        suggestions.reserve(links.count());
+        for (const Link &link : links) {
+            Suggestion suggestion;
+            suggestion.url = link.url();
+            suggestion.title = link.title();
+            suggestion.sources = Suggestion::History;
+            suggestion.visitCount = link.visitCount();
+            suggestion.lastVisit = link.lastVisit();
+            suggestions.append(suggestion);
+        }
+        emit finished(queryId, suggestions);
+    });
+}
+
+void HistorySuggestionProvider::cancel()
+{
+    if (m_requestId > 0) {
+        DBManager::instance()->cancelSearch(m_requestId);
+        m_requestId = 0;
+    }
+}
+
+BookmarkSuggestionProvider::BookmarkSuggestionProvider(QObject *parent)
+    : SuggestionProvider(parent)
+    , m_requestId(0)
+{
+}
+
+BookmarkSuggestionProvider::~BookmarkSuggestionProvider()
+{
+    cancel();
+}
+
+void BookmarkSuggestionProvider::start(int queryId, const QString &text, int limit)
+{
+    cancel();
+    m_requestId = DBManager::instance()->searchBookmarks(text, limit, this, [this, queryId](const BookmarkList &bookmarks) {
+        m_requestId = 0;
+        SuggestionList suggestions;
+        suggestions.reserve(bookmarks.count());
+        for (const Bookmark &bookmark : bookmarks) {
+            Suggestion suggestion;
+            suggestion.url = bookmark.url();
+            suggestion.title = bookmark.title();
+            suggestion.favicon = bookmark.favicon();
+            suggestion.sources = Suggestion::Bookmark;
+            suggestions.append(suggestion);
+        }
+        emit finished(queryId, suggestions);
+    });
+}
+
+void BookmarkSuggestionProvider::cancel()
+{
+    if (m_requestId > 0) {
+        DBManager::instance()->cancelSearch(m_requestId);
+        m_requestId = 0;
+    }
+}
+
+ModelSuggestionProvider::ModelSuggestionProvider(Suggestion::Source source, QObject *parent)
+    : SuggestionProvider(parent)
+    , m_source(source)
+    , m_excludedStatus(-1)
+{
+}
+
+QAbstractItemModel *ModelSuggestionProvider::model() const
+{
+    return m_model;
+}
+
+void ModelSuggestionProvider::setModel(QAbstractItemModel *model)
+{
+    m_model = model;
+}
+
+void ModelSuggestionProvider::setExcludedStatus(int status)
+{
+    m_excludedStatus = status;
+}
+
+void ModelSuggestionProvider::start(int queryId, const QString &text, int limit)
+{
+    SuggestionList suggestions;
+    if (m_model) {
+        const QHash<int, QByteArray> roles = m_model->roleNames();
+        const int urlRole = roles.key("url", -1);
+        const int titleRole = roles.key("title", -1);
+        const int statusRole = roles.key("status", -1);
+
+        const int rows = m_model->rowCount();
+        for (int row = 0; row < rows && suggestions.count() < limit; ++row) {
+            const QModelIndex index = m_model->index(row, 0);
+            if (statusRole >= 0 && m_excludedStatus >= 0
+                    && m_model->data(index, statusRole).toInt() == m_excludedStatus) {
+                continue;
+            }
+
+            Suggestion suggestion;
+            suggestion.url = urlRole >= 0 ? m_model->data(index, urlRole).toString() : QString();
+            suggestion.title = titleRole >= 0 ? m_model->data(index, titleRole).toString() : QString();
+            if (suggestion.url.contains(text, Qt::CaseInsensitive)
+                    || suggestion.title.contains(text, Qt::CaseInsensitive)) {
+                suggestion.sources = m_source;
+                suggestions.append(suggestion);
+            }
+        }
+    }
+    emit finished(queryId, suggestions);
+}
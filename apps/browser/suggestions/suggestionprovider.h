@@ -0,0 +1,97 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef SUGGESTIONPROVIDER_H
+#define SUGGESTIONPROVIDER_H
+
+#include <QObject>
+#include <QPointer>
+
+#include "suggestion.h"
+
+class QAbstractItemModel;
+
+/**
+ * Source of url bar suggestions. A query is started for every change of the
+ * typed text and finishes by emitting finished() with the id of the query,
+ * either from start() or later. Starting a new query cancels the previous one.
+ */
+class SuggestionProvider : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SuggestionProvider(QObject *parent = nullptr);
+
+    virtual void start(int queryId, const QString &text, int limit) = 0;
+    // Stops the running query, finished() is not emitted for it.
+    virtual void cancel();
+
+signals:
+    void finished(int queryId, const SuggestionList &suggestions);
+};
+
+// Most visited history entries, searched in the database thread.
+class HistorySuggestionProvider : public SuggestionProvider
+{
+    Q_OBJECT
+
+public:
+    explicit HistorySuggestionProvider(QObject *parent = nullptr);
+    ~HistorySuggestionProvider();
+
+    void start(int queryId, const QString &text, int limit) override;
+    void cancel() override;
+
+private:
+    int m_requestId;
+};
+
+// Bookmarks of all folders, searched in the database thread.
+class BookmarkSuggestionProvider : public SuggestionProvider
+{
+    Q_OBJECT
+
+public:
+    explicit BookmarkSuggestionProvider(QObject *parent = nullptr);
+    ~BookmarkSuggestionProvider();
+
+    void start(int queryId, const QString &text, int limit) override;
+    void cancel() override;
+
+private:
+    int m_requestId;
+};
+
+/**
+ * Rows of a small model with "url" and "title" roles such as open tabs or
+ * search engines, matched in place. Rows whose "status" role is excluded
+ * are skipped.
+ */
+class ModelSuggestionProvider : public SuggestionProvider
+{
+    Q_OBJECT
+
+public:
+    ModelSuggestionProvider(Suggestion::Source source, QObject *parent = nullptr);
+
+    QAbstractItemModel *model() const;
+    void setModel(QAbstractItemModel *model);
+    void setExcludedStatus(int status);
+
+    void start(int queryId, const QString &text, int limit) override;
+
+private:
+    Suggestion::Source m_source;
+    QPointer<QAbstractItemModel> m_model;
+    int m_excludedStatus;
+};
+
+#endif // SUGGESTIONPROVIDER_H
@@ -0,0 +1,12 @@
+INCLUDEPATH += $$PWD
+
+# C++ sources
+SOURCES += \
+    $$PWD/suggestionprovider.cpp \
+    $$PWD/suggestionmodel.cpp
+
+# C++ headers
+HEADERS += \
+    $$PWD/suggestion.h \
+    $$PWD/suggestionprovider.h \
+    $$PWD/suggestionmodel.h
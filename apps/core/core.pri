@@ -15,8 +15,12 @@ SOURCES += \
     $$PWD/downloadmimetypehandler.cpp \
     $$PWD/declarativewebcontainer.cpp \
     $$PWD/declarativewebutils.cpp \
+    $$PWD/faviconimageprovider.cpp \
     $$PWD/faviconmanager.cpp \
+    $$PWD/fetchservice.cpp \
+    $$PWD/imagekernels.cpp \
     $$PWD/inputregion.cpp \
+    $$PWD/loadscheduler.cpp \
     $$PWD/logging.cpp \
     $$PWD/settingmanager.cpp \
     $$PWD/webpagequeue.cpp \
@@ -33,9 +37,13 @@ HEADERS += \
     $$PWD/downloadmanager.h \
     $$PWD/downloadmimetypehandler.h \
     $$PWD/downloadstatus.h \
+    $$PWD/faviconimageprovider.h \
     $$PWD/faviconmanager.h \
+    $$PWD/fetchservice.h \
+    $$PWD/imagekernels.h \
     $$PWD/inputregion.h \
     $$PWD/inputregion_p.h \
+    $$PWD/loadscheduler.h \
     $$PWD/logging.h \
     $$PWD/settingmanager.h \
     $$PWD/webpagequeue.h \
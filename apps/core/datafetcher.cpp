@@ -9,11 +9,11 @@
  * You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "datafetcher.h"
+#include "fetchservice.h"
 #include "opensearchconfigs.h"
 
 #include <webengine.h>
 
-#include <QImage>
 #include <QUrl>
 #include <QDir>
 #include <QFile>
@@ -23,6 +23,7 @@ DataFetcher::DataFetcher(QObject *parent)
     , m_status(Null)
     , m_minimumIconSize(64) // Initial value that matches theme iconSizeMedium.
     , m_hasAcceptedTouchIcon(false)
+    , m_networkError(QNetworkReply::NoError)
     , m_type(Icon)
 {
 }
@@ -32,7 +33,11 @@ void DataFetcher::fetch(const QString &url)
     if (m_type == Icon)
         updateAcceptedTouchIcon(false);
 
+    // Only the latest fetch is reported.
+    delete m_reply;
+
     m_url = url;
+    m_networkError = QNetworkReply::NoError;
     QString path = m_url.path();
     updateStatus(Fetching);
     if (m_type == Icon && (path.endsWith(".ico") || url.isEmpty())) {
@@ -41,13 +46,12 @@ void DataFetcher::fetch(const QString &url)
         emit dataChanged();
     } else {
         m_networkData.clear();
-        QNetworkRequest request(m_url);
-        QNetworkReply *reply = m_networkAccessManager.get(request);
-        connect(reply, &QNetworkReply::finished, this, &DataFetcher::dataReady);
-        // qOverload(T functionPointer) would be handy to resolve right error method but it is introduced only
-        // in Qt5.7. QNetWorkReply has signal error(QNetworkReply::NetworkError) and method error().
-        // connect(reply, qOverload<QNetworkReply::NetworkError>(&QNetworkReply::error), this, DataFetcher::error);
-        connect(reply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(error(QNetworkReply::NetworkError)));
+        m_base64Data.clear();
+        m_imageSize = QSize();
+        // Requests go through the shared service, icon dimensions are probed there.
+        m_reply = FetchService::instance()->fetch(m_url, m_type == Icon ? FetchService::ProbeImage | FetchService::EncodeBase64
+                                                                        : FetchService::NoOptions, this);
+        connect(m_reply.data(), &FetchReply::finished, this, &DataFetcher::dataReady);
     }
 }
 
@@ -84,14 +88,30 @@ bool DataFetcher::hasAcceptedTouchIcon()
     return m_hasAcceptedTouchIcon;
 }
 
+QNetworkReply::NetworkError DataFetcher::networkError() const
+{
+    return m_networkError;
+}
+
 void DataFetcher::dataReady()
 {
-    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
-    if (reply) {
-        m_networkData = reply->readAll();
-        reply->deleteLater();
+    FetchReply *reply = m_reply.data();
+    if (!reply) {
+        return;
     }
 
+    m_reply.clear();
+    reply->deleteLater();
+    m_networkError = reply->error();
+    if (m_networkError != QNetworkReply::NoError) {
+        error();
+        return;
+    }
+
+    m_networkData = reply->data();
+    m_imageSize = reply->imageSize();
+    m_base64Data = reply->base64Data();
+
     if (m_type == OpenSearch)
         saveAsSearchEngine();
     else
@@ -103,12 +123,10 @@ void DataFetcher::saveAsImage()
     if (m_networkData.isEmpty()) {
         m_data = defaultIcon();
     } else {
-        QImage image;
-        image.loadFromData(m_networkData);
-        if (image.width() < m_minimumIconSize || image.height() < m_minimumIconSize) {
+        if (m_imageSize.width() < m_minimumIconSize || m_imageSize.height() < m_minimumIconSize) {
             m_data = defaultIcon();
         } else {
-            m_data = QString(BASE64_IMAGE).arg(QString(m_networkData.toBase64()));
+            m_data = QString(BASE64_IMAGE).arg(QString::fromLatin1(m_base64Data));
         }
     }
     updateAcceptedTouchIcon(true);
@@ -116,13 +134,8 @@ void DataFetcher::saveAsImage()
     emit dataChanged();
 }
 
-void DataFetcher::error(QNetworkReply::NetworkError)
+void DataFetcher::error()
 {
-    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
-    if (reply) {
-        reply->deleteLater();
-    }
-
     updateStatus(Error);
     if (m_type == Icon) {
         m_data = defaultIcon();
@@ -12,8 +12,11 @@
 #define DATAFETCHER_H
 
 #include <QObject>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QPointer>
+#include <QSize>
+
+class FetchReply;
 
 class DataFetcher : public QObject {
     Q_OBJECT
@@ -39,6 +42,7 @@ public:
     QString data() const;
     QString defaultIcon() const;
     bool hasAcceptedTouchIcon();
+    QNetworkReply::NetworkError networkError() const;
     Type type() const;
     void setType(Type type);
 
@@ -51,20 +55,23 @@ signals:
 
 private slots:
     void dataReady();
-    void error(QNetworkReply::NetworkError);
 
 private:
+    void error();
     void updateStatus(Status status);
     void updateAcceptedTouchIcon(bool acceptedTouchIcon);
     void saveAsImage();
     void saveAsSearchEngine();
 
-    QNetworkAccessManager m_networkAccessManager;
+    QPointer<FetchReply> m_reply;
     Status m_status;
     QString m_data;
     qreal m_minimumIconSize;
     bool m_hasAcceptedTouchIcon;
     QByteArray m_networkData;
+    QByteArray m_base64Data;
+    QSize m_imageSize;
+    QNetworkReply::NetworkError m_networkError;
     QUrl m_url;
     Type m_type;
 };
@@ -20,6 +20,7 @@
 #include "browserapp.h"
 #include "logging.h"
 #include "declarativehistorymodel.h"
+#include "thumbnailcache.h"
 
 #include <webengine.h>
 #include <QTimerEvent>
@@ -297,6 +298,31 @@ void DeclarativeWebContainer::setMaxLiveTabCount(int count)
     }
 }
 
+int DeclarativeWebContainer::idleTabTimeout() const
+{
+    return m_webPages->idleTimeout();
+}
+
+void DeclarativeWebContainer::setIdleTabTimeout(int seconds)
+{
+    if (m_webPages->setIdleTimeout(seconds)) {
+        emit idleTabTimeoutChanged();
+    }
+}
+
+int DeclarativeWebContainer::thumbnailCacheSize() const
+{
+    return ThumbnailCache::instance()->budget() / (1024 * 1024);
+}
+
+void DeclarativeWebContainer::setThumbnailCacheSize(int megabytes)
+{
+    if (megabytes > 0 && megabytes != thumbnailCacheSize()) {
+        ThumbnailCache::instance()->setBudget(qint64(megabytes) * 1024 * 1024);
+        emit thumbnailCacheSizeChanged();
+    }
+}
+
 bool DeclarativeWebContainer::portrait() const
 {
     return m_portrait;
@@ -879,6 +905,9 @@ void DeclarativeWebContainer::initialize()
                 this, &DeclarativeWebContainer::drawUnderlay, Qt::DirectConnection);
         connect(m_mozWindow.data(), &QMozWindow::orientationChangeFiltered,
                 this, &DeclarativeWebContainer::handleContentOrientationChanged);
+        // Emitted from the compositor thread, the window shows the active page.
+        connect(m_mozWindow.data(), &QMozWindow::compositingFinished,
+                this, &DeclarativeWebContainer::onCompositingFinished);
         m_mozWindow->setReadyToPaint(false);
         if (m_chromeWindow) {
             updateContentOrientation(m_chromeWindow->contentOrientation());
@@ -1031,6 +1060,13 @@ void DeclarativeWebContainer::updateActiveTabRendered()
                this, &DeclarativeWebContainer::updateActiveTabRendered);
 }
 
+void DeclarativeWebContainer::onCompositingFinished()
+{
+    if (m_webPage) {
+        m_webPage->frameRendered();
+    }
+}
+
 void DeclarativeWebContainer::onLastViewDestroyed()
 {
     if (m_closing) {
@@ -46,6 +46,8 @@ class DeclarativeWebContainer : public QWindow, public QQmlParserStatus, protect
     Q_PROPERTY(bool enabled MEMBER m_enabled NOTIFY enabledChanged FINAL)
     Q_PROPERTY(bool foreground READ foreground WRITE setForeground NOTIFY foregroundChanged FINAL)
     Q_PROPERTY(int maxLiveTabCount READ maxLiveTabCount WRITE setMaxLiveTabCount NOTIFY maxLiveTabCountChanged FINAL)
+    Q_PROPERTY(int idleTabTimeout READ idleTabTimeout WRITE setIdleTabTimeout NOTIFY idleTabTimeoutChanged FINAL)
+    Q_PROPERTY(int thumbnailCacheSize READ thumbnailCacheSize WRITE setThumbnailCacheSize NOTIFY thumbnailCacheSizeChanged FINAL)
     // This property should cover all possible popus
     Q_PROPERTY(bool touchBlocked MEMBER m_touchBlocked NOTIFY touchBlockedChanged FINAL)
     Q_PROPERTY(bool portrait READ portrait WRITE setPortrait NOTIFY portraitChanged FINAL)
@@ -101,6 +103,12 @@ public:
     int maxLiveTabCount() const;
     void setMaxLiveTabCount(int count);
 
+    int idleTabTimeout() const;
+    void setIdleTabTimeout(int seconds);
+
+    int thumbnailCacheSize() const;
+    void setThumbnailCacheSize(int megabytes);
+
     bool portrait() const;
     void setPortrait(bool portrait);
 
@@ -172,6 +180,8 @@ signals:
     void foregroundChanged();
     void allowHidingChanged();
     void maxLiveTabCountChanged();
+    void idleTabTimeoutChanged();
+    void thumbnailCacheSizeChanged();
     void touchBlockedChanged();
     void portraitChanged();
     void fullscreenModeChanged();
@@ -231,6 +241,7 @@ private slots:
     void updateLoadProgress();
     void updateLoading();
     void updateActiveTabRendered();
+    void onCompositingFinished();
     void onLastViewDestroyed();
 
     void updateWindowFlags();
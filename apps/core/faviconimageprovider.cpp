@@ -0,0 +1,55 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Open Mobile Platform LLC.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <QBuffer>
+#include <QImageReader>
+#include <QRegularExpression>
+
+#include "faviconimageprovider.h"
+#include "dbmanager.h"
+#include "logging.h"
+
+FaviconImageProvider::FaviconImageProvider()
+    : QQuickImageProvider(QQmlImageProviderBase::Image,
+                          QQmlImageProviderBase::ForceAsynchronousImageLoading)
+{
+}
+
+// Called in the image loader thread.
+QImage FaviconImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    static const QRegularExpression contentHash(QStringLiteral("^[0-9a-f]{40}$"));
+
+    if (!contentHash.match(id).hasMatch()) {
+        qCWarning(lcFavoritesLog) << "Invalid favicon id" << id;
+        return QImage();
+    }
+
+    QByteArray data = DBManager::instance()->getFaviconData(id);
+    QBuffer buffer(&data);
+    QImageReader reader(&buffer);
+    if (requestedSize.isValid() && !requestedSize.isEmpty()) {
+        QSize scaledSize = reader.size();
+        if (scaledSize.isValid()) {
+            scaledSize.scale(requestedSize, Qt::KeepAspectRatio);
+            reader.setScaledSize(scaledSize);
+        }
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qCDebug(lcFavoritesLog) << "Can't read favicon" << id << reader.errorString();
+    }
+
+    if (size) {
+        *size = image.size();
+    }
+    return image;
+}
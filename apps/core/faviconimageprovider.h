@@ -0,0 +1,29 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Open Mobile Platform LLC.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef FAVICONIMAGEPROVIDER_H
+#define FAVICONIMAGEPROVIDER_H
+
+#include <QQuickImageProvider>
+
+/**
+ * Serves icon data stored by FaviconManager as image://favicons/<hash>. Icon
+ * data is content addressed and never changes, so the urls can be cached by
+ * the QML pixmap cache.
+ */
+class FaviconImageProvider : public QQuickImageProvider
+{
+public:
+    FaviconImageProvider();
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+};
+
+#endif // FAVICONIMAGEPROVIDER_H
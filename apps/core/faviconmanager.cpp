@@ -8,26 +8,72 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this file,
  * You can obtain one at http://mozilla.org/MPL/2.0/. */
 
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QFile>
-#include <QTextStream>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonDocument>
-#include <QUrl>
+#include <QSet>
 #include <memory>
 
 #include "browserpaths.h"
 #include "datafetcher.h"
+#include "dbmanager.h"
+#include "fetchservice.h"
 #include "logging.h"
 
 #include "faviconmanager.h"
 
 #include "declarativewebpage.h"
 
+// Changes of a page load are written in one go.
+static const int gSaveDelay = 2000;
+// Hosts without a touch icon are asked again after a week.
+static const qint64 gFailureTtl = 7 * 24 * 60 * 60 * 1000LL;
+// First retry after a network error, doubled on every failure up to the TTL.
+static const qint64 gRetryDelay = 5 * 60 * 1000LL;
+
+static QString changeKey(const QString &type, const QString &host)
+{
+    return type + QLatin1Char('\n') + host;
+}
+
+static QByteArray decodeDataUrl(const QString &dataUrl)
+{
+    const int start = dataUrl.indexOf(QLatin1String(";base64,"));
+    if (!dataUrl.startsWith(QLatin1String("data:")) || start < 0) {
+        return QByteArray();
+    }
+    return QByteArray::fromBase64(dataUrl.midRef(start + 8).toLatin1());
+}
+
+// Connection and server errors may go away, missing content does not.
+static bool isTransient(QNetworkReply::NetworkError error)
+{
+    return (error > QNetworkReply::NoError && error < QNetworkReply::ContentAccessDenied)
+            || error >= QNetworkReply::InternalServerError;
+}
+
 FaviconManager::FaviconManager(QObject *parent)
     : QObject(parent)
     , m_faviconSets()
+    , m_failuresLoaded(false)
+    , m_fetchesAvoided(0)
+    , m_fetchesFailed(0)
 {
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(gSaveDelay);
+    connect(&m_saveTimer, &QTimer::timeout, this, &FaviconManager::save);
+    connect(DBManager::instance(), &DBManager::historyHostsRemoved,
+            this, &FaviconManager::removeHistoryHosts);
+
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this]() {
+            flush(true);
+        });
+    }
 }
 
 FaviconManager *FaviconManager::instance()
@@ -43,176 +89,335 @@ FaviconManager *FaviconManager::instance()
 QString FaviconManager::sanitizedHostname(const QString &hostname)
 {
     // Should port should be included too?
-    const QUrl url(hostname);
-    return QStringLiteral("%1://%2").arg(url.scheme(), url.host());
+    return Favicon::hostOf(hostname);
 }
 
-void FaviconManager::save(const QString &type)
+FaviconManager::Host FaviconManager::host(const QString &hostname)
 {
-    if (!m_faviconSets.contains(type)) {
-        qCDebug(lcFavoritesLog) << "No" << type << "favicons loaded, skipping save";
-        return;
+    Host host;
+    host.name = sanitizedHostname(hostname);
+    host.hash = qHash(host.name);
+    return host;
+}
+
+QString FaviconManager::source(const Favicon &favicon)
+{
+    if (favicon.hash.isEmpty()) {
+        return favicon.icon;
     }
+    return QStringLiteral("image://%1/%2").arg(QStringLiteral(FAVICON_PROVIDER), favicon.hash);
+}
 
-    const FaviconSet &faviconSet = m_faviconSets.value(type);
-    if (!faviconSet.loaded) {
-        qCDebug(lcFavoritesLog) << "No changes to" << type << "favicons, skipping save";
-        return;
+// Favicons and failed fetches of hosts that have no history left are removed.
+void FaviconManager::removeHistoryHosts(const QStringList &hosts)
+{
+    for (const QString &host : hosts) {
+        remove(QStringLiteral("history"), host);
     }
 
-    QString dataLocation = BrowserPaths::dataLocation();
-    if (dataLocation.isNull()) {
-        qWarning() << "No datalocation set to save" << type << "favicons to";
-        return;
+    loadFailures();
+    const QSet<QString> removedHosts = QSet<QString>::fromList(hosts);
+    for (QHash<QString, FaviconFailure>::iterator it = m_failures.begin(); it != m_failures.end();) {
+        if (removedHosts.contains(it->host)) {
+            removeFailure(it->host, it->iconUrl);
+            it = m_failures.erase(it);
+        } else {
+            ++it;
+        }
     }
-    QString path = QString("%1/%2.json").arg(dataLocation).arg(type);
-    QFile file(path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qWarning() << "Can't create favicons file " << path;
-        return;
+}
+
+void FaviconManager::save()
+{
+    flush(false);
+}
+
+void FaviconManager::flush(bool wait)
+{
+    m_saveTimer.stop();
+    if (!m_pendingChanges.isEmpty()) {
+        qCDebug(lcFavoritesLog) << "Writing" << m_pendingChanges.count() << "favicon changes";
+        DBManager::instance()->updateFavicons(m_pendingChanges.values(), wait);
+        m_pendingChanges.clear();
     }
-    QTextStream out(&file);
-    QJsonArray items;
 
-    for (const QString &hostname : faviconSet.favicons.keys()) {
-        const Favicon &favicon = faviconSet.favicons.value(hostname);
-        QJsonObject item;
-        item.insert("hostname", QJsonValue(hostname));
-        item.insert("favicon", QJsonValue(favicon.favicon));
-        item.insert("hasTouchIcon", QJsonValue(favicon.hasTouchIcon));
-        items.append(QJsonValue(item));
+    if (!m_pendingFailures.isEmpty()) {
+        DBManager::instance()->updateFaviconFailures(m_pendingFailures.values(), wait);
+        m_pendingFailures.clear();
     }
-    QJsonDocument doc(items);
-    out.setCodec("UTF-8");
-    out << doc.toJson();
-    file.close();
 }
 
 // After calling load it must be safe to assume the type exists in the map
 void FaviconManager::load(const QString &type)
 {
     // Once loaded, future calls to load return immediately
-    if (m_faviconSets.contains(type) && m_faviconSets.value(type).loaded) {
+    QHash<QString, FaviconSet>::const_iterator it = m_faviconSets.constFind(type);
+    if (it != m_faviconSets.constEnd() && it->loaded) {
         // Favicons already loaded
         return;
     }
 
+    // Pending changes were written when the set was released.
     FaviconSet faviconSet;
     faviconSet.loaded = true;
+    const FaviconList favicons = DBManager::instance()->getFavicons(type);
+    for (const Favicon &favicon : favicons) {
+        faviconSet.favicons.insert(favicon.host, favicon);
+        faviconSet.sources.insert(host(favicon.host), source(favicon));
+    }
     m_faviconSets.insert(type, faviconSet);
 
+    importJson(type);
+}
+
+/**
+ * @brief FaviconManager::importJson
+ * Moves favicons of the type from the json file of older versions to the
+ * database. This happens once, the file is removed.
+ */
+void FaviconManager::importJson(const QString &type)
+{
     QString dataLocation = BrowserPaths::dataLocation();
     if (dataLocation.isNull()) {
-        qWarning() << "No datalocation set to load" << type << "favicons from";
         return;
     }
-    QString path = QString("%1/%2.json").arg(dataLocation).arg(type);
-    QScopedPointer<QFile> file(new QFile(path));
 
-    if (!file->open(QIODevice::ReadOnly | QIODevice::Text)) {
-        // The file may not exist yet; that's okay
-        qCDebug(lcFavoritesLog) << "Unable to open favicons file " << path;
+    QString path = QString("%1/%2.json").arg(dataLocation).arg(type);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        // Already imported or never created
         return;
     }
 
-    QJsonDocument doc = QJsonDocument::fromJson(file->readAll());
+    int imported = 0;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
     if (doc.isArray()) {
         QJsonArray array = doc.array();
         for (const QJsonValue &value : array) {
-            if (value.isObject()) {
-                QJsonObject obj = value.toObject();
-                QString hostname = obj.value("hostname").toString();
-                Favicon favicon;
-                favicon.favicon = obj.value("favicon").toString();
-                favicon.hasTouchIcon = obj.value("hasTouchIcon").toBool();
-                faviconSet.favicons.insert(hostname, favicon);
+            if (!value.isObject()) {
+                continue;
+            }
+
+            QJsonObject obj = value.toObject();
+            Favicon favicon;
+            favicon.type = type;
+            favicon.host = obj.value("hostname").toString();
+            favicon.hasTouchIcon = obj.value("hasTouchIcon").toBool();
+            if (favicon.host.isEmpty() || m_faviconSets[type].favicons.contains(favicon.host)) {
+                continue;
+            }
+
+            favicon.icon = obj.value("favicon").toString();
+            const QByteArray data = decodeDataUrl(favicon.icon);
+            if (!data.isEmpty()) {
+                favicon.icon.clear();
+                favicon.hash = storeData(data);
+            }
+
+            if (!favicon.isNull()) {
+                update(favicon);
+                ++imported;
             }
         }
     } else {
         qWarning() << "Favicons json file should be an array of items";
     }
-    file->close();
 
-    m_faviconSets.insert(type, faviconSet);
+    // The file is removed only once the favicons have been written.
+    flush(true);
+    removeJson(type);
+    qCInfo(lcFavoritesLog) << "Imported" << imported << type << "favicons from" << path;
+}
+
+void FaviconManager::removeJson(const QString &type)
+{
+    QString dataLocation = BrowserPaths::dataLocation();
+    if (!dataLocation.isNull()) {
+        QFile::remove(QString("%1/%2.json").arg(dataLocation).arg(type));
+    }
+}
+
+/**
+ * @brief FaviconManager::update
+ * Updates the loaded set and schedules the change to be written.
+ */
+void FaviconManager::update(const Favicon &favicon)
+{
+    FaviconSet &faviconSet = m_faviconSets[favicon.type];
+    if (favicon.isNull()) {
+        faviconSet.favicons.remove(favicon.host);
+        faviconSet.sources.remove(host(favicon.host));
+    } else {
+        faviconSet.favicons.insert(favicon.host, favicon);
+        faviconSet.sources.insert(host(favicon.host), source(favicon));
+    }
+
+    m_pendingChanges.insert(changeKey(favicon.type, favicon.host), favicon);
+    if (!m_saveTimer.isActive()) {
+        m_saveTimer.start();
+    }
+}
+
+// Icon data is stored once per content hash.
+QString FaviconManager::storeData(const QByteArray &data)
+{
+    const QString hash = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+    DBManager::instance()->storeFaviconData(hash, data);
+    return hash;
 }
 
+/**
+ * @brief FaviconManager::add
+ * Stores the favicon of the host. Data urls are stored as icon data,
+ * other favicons such as theme icon names as they are.
+ */
 void FaviconManager::add(const QString &type, const QString &hostname, const QString &favicon, bool hasTouchIcon)
 {
+    const QByteArray data = decodeDataUrl(favicon);
+    if (!data.isEmpty()) {
+        addImage(type, hostname, data, hasTouchIcon);
+        return;
+    }
+
     load(type);
 
-    const QString host = sanitizedHostname(hostname);
-    FaviconSet faviconSet = m_faviconSets.value(type);
+    Favicon item;
+    item.type = type;
+    item.host = sanitizedHostname(hostname);
+    item.icon = favicon;
+    item.hasTouchIcon = hasTouchIcon;
 
-    if (faviconSet.favicons.contains(host)) {
-        const Favicon &current = faviconSet.favicons.value(host);
-        if ((current.favicon == favicon) && (current.hasTouchIcon == hasTouchIcon)) {
-            // No changes
-            return;
-        }
+    // After calling load() it's safe to assume the type exists in the map
+    const Favicon &current = m_faviconSets[type].favicons.value(item.host);
+    if (current.hash.isEmpty() && current.icon == favicon && current.hasTouchIcon == hasTouchIcon) {
+        // No changes
+        return;
+    }
+
+    update(item);
+}
+
+void FaviconManager::addImage(const QString &type, const QString &hostname, const QByteArray &data, bool hasTouchIcon)
+{
+    if (data.isEmpty()) {
+        return;
     }
 
+    load(type);
+
     Favicon item;
-    item.favicon = favicon;
+    item.type = type;
+    item.host = sanitizedHostname(hostname);
+    item.hash = storeData(data);
     item.hasTouchIcon = hasTouchIcon;
-    // After calling load() it's safe to assume the type exists in the map
-    faviconSet.favicons.insert(host, item);
-    m_faviconSets.insert(type, faviconSet);
 
-    save(type);
+    const Favicon &current = m_faviconSets[type].favicons.value(item.host);
+    if (current.hash == item.hash && current.hasTouchIcon == hasTouchIcon) {
+        // No changes
+        return;
+    }
+
+    update(item);
 }
 
 void FaviconManager::remove(const QString &type, const QString &hostname)
 {
     load(type);
 
+    Favicon item;
+    item.type = type;
+    item.host = sanitizedHostname(hostname);
     // After calling load() it's safe to assume the type exists in the map
-    FaviconSet faviconSet = m_faviconSets.value(type);
-    faviconSet.favicons.remove(sanitizedHostname(hostname));
-    m_faviconSets.insert(type, faviconSet);
-
-    save(type);
+    if (m_faviconSets[type].favicons.contains(item.host)) {
+        update(item);
+    }
 }
 
 QString FaviconManager::get(const QString &type, const QString &hostname)
 {
-    load(type);
+    return favicon(type, host(hostname));
+}
 
-    // After calling load() it's safe to assume the type exists in the map
-    QString favicon;
-    QString host = sanitizedHostname(hostname);
-    if (m_faviconSets.value(type).favicons.contains(host)) {
-        favicon = m_faviconSets.value(type).favicons.value(host).favicon;
+/**
+ * @brief FaviconManager::favicon
+ * Returns the image source of the host's favicon without copying or parsing
+ * anything. The reference is valid until the favicons of the type change.
+ */
+const QString &FaviconManager::favicon(const QString &type, const Host &host)
+{
+    static const QString none;
+
+    QHash<QString, FaviconSet>::const_iterator set = m_faviconSets.constFind(type);
+    if (set == m_faviconSets.constEnd() || !set->loaded) {
+        load(type);
+        set = m_faviconSets.constFind(type);
     }
-    return favicon;
+
+    // After calling load() it's safe to assume the type exists in the map
+    QHash<Host, QString>::const_iterator it = set->sources.constFind(host);
+    return it != set->sources.constEnd() ? it.value() : none;
 }
 
+/**
+ * @brief FaviconManager::grabIcon
+ * Fetches the touch icon of the page, or grabs a thumbnail of the page if
+ * it has none. Failed fetches are not repeated before their retry time.
+ */
 void FaviconManager::grabIcon(const QString &type, DeclarativeWebPage *webPage, const QSize &size)
 {
-    if (!get(type, webPage->url().toString()).isEmpty()) {
-        return; // favicon was previously already loaded.
+    load(type);
+
+    const QString host = sanitizedHostname(webPage->url().toString());
+    const QString iconUrl = webPage->property("favicon").toString();
+    const Favicon current = m_faviconSets[type].favicons.value(host);
+    if (current.hasTouchIcon) {
+        return; // touch icon was previously already loaded.
+    }
+
+    // A thumbnail grabbed before is kept until a touch icon is found.
+    const bool hasFallback = !current.isNull();
+    if (!fetchAllowed(host, iconUrl, QDateTime::currentMSecsSinceEpoch())) {
+        if (!hasFallback) {
+            grabThumbnail(type, webPage, size);
+        }
+        return;
     }
 
     DataFetcher *dataFetcher = new DataFetcher(this);
 
     std::shared_ptr<QMetaObject::Connection> dataConn = std::make_shared<QMetaObject::Connection>();
-    *dataConn = connect(dataFetcher, &DataFetcher::dataChanged, this, [this, dataFetcher, type, webPage, size, dataConn]() {
+    *dataConn = connect(dataFetcher, &DataFetcher::dataChanged, this, [this, dataFetcher, type, webPage, size, dataConn,
+                                                                       host, iconUrl, hasFallback]() {
         QObject::disconnect(*dataConn);
         if (dataFetcher->hasAcceptedTouchIcon()) {
             qCDebug(lcFavoritesLog) << "Storing favicon for" << type;
+            fetchSucceeded(host, iconUrl);
             add(type, webPage->url().toString(), dataFetcher->data(), true);
-        }
-        else {
-            std::shared_ptr<QMetaObject::Connection> thumbConn = std::make_shared<QMetaObject::Connection>();
-            *thumbConn = connect(webPage, &DeclarativeWebPage::thumbnailResult, [this, type, webPage, thumbConn](const QString &data) {
-                qCDebug(lcFavoritesLog) << "Storing thumbnail for" << type;
-                QObject::disconnect(*thumbConn);
-                add(type, webPage->url().toString(), data, false);
-            });
-            webPage->grabThumbnail(size);
+        } else {
+            fetchFailed(host, iconUrl, isTransient(dataFetcher->networkError()), QDateTime::currentMSecsSinceEpoch());
+            if (!hasFallback) {
+                grabThumbnail(type, webPage, size);
+            }
         }
         dataFetcher->deleteLater();
     });
-    dataFetcher->fetch(webPage->property("favicon").toString());
+    dataFetcher->fetch(iconUrl);
+}
+
+void FaviconManager::grabThumbnail(const QString &type, DeclarativeWebPage *webPage, const QSize &size)
+{
+    std::shared_ptr<QMetaObject::Connection> thumbConn = std::make_shared<QMetaObject::Connection>();
+    *thumbConn = connect(webPage, &DeclarativeWebPage::thumbnailData, [this, type, webPage, thumbConn](const QByteArray &data) {
+        qCDebug(lcFavoritesLog) << "Storing thumbnail for" << type;
+        QObject::disconnect(*thumbConn);
+        if (data.isEmpty()) {
+            add(type, webPage->url().toString(), DEFAULT_DESKTOP_BOOKMARK_ICON, false);
+        } else {
+            addImage(type, webPage->url().toString(), data, false);
+        }
+    });
+    webPage->grabThumbnail(size);
 }
 
 void FaviconManager::clear(const QString &type)
@@ -220,5 +425,121 @@ void FaviconManager::clear(const QString &type)
     FaviconSet faviconSet;
     faviconSet.loaded = true;
     m_faviconSets.insert(type, faviconSet);
-    save(type);
+
+    for (QHash<QString, Favicon>::iterator it = m_pendingChanges.begin(); it != m_pendingChanges.end();) {
+        if (it->type == type) {
+            it = m_pendingChanges.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Failed fetches and fetched icons tell which hosts were visited.
+    m_failures.clear();
+    m_pendingFailures.clear();
+    m_failuresLoaded = true;
+    FetchService::instance()->clearCache();
+
+    // Icon data of other types must be referred to before unused data is removed.
+    flush(false);
+    DBManager::instance()->clearFavicons(type);
+    DBManager::instance()->clearFaviconFailures();
+    removeJson(type);
+}
+
+void FaviconManager::releaseCache()
+{
+    // Pending changes are written so that loaded sets can be dropped
+    // and read back from the database upon next access.
+    qCDebug(lcFavoritesLog) << "Releasing" << m_faviconSets.count() << "loaded favicon sets";
+    flush(false);
+    m_faviconSets.clear();
+}
+
+int FaviconManager::fetchesAvoided() const
+{
+    return m_fetchesAvoided;
+}
+
+int FaviconManager::fetchesFailed() const
+{
+    return m_fetchesFailed;
+}
+
+void FaviconManager::loadFailures()
+{
+    if (m_failuresLoaded) {
+        return;
+    }
+
+    // Failures past their retry time tell nothing anymore, their rows are removed.
+    m_failuresLoaded = true;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const FaviconFailureList failures = DBManager::instance()->getFaviconFailures();
+    for (const FaviconFailure &failure : failures) {
+        if (now >= failure.retryAfter) {
+            removeFailure(failure.host, failure.iconUrl);
+        } else {
+            m_failures.insert(changeKey(failure.host, failure.iconUrl), failure);
+        }
+    }
+}
+
+bool FaviconManager::fetchAllowed(const QString &host, const QString &iconUrl, qint64 now)
+{
+    loadFailures();
+
+    QHash<QString, FaviconFailure>::const_iterator it = m_failures.constFind(changeKey(host, iconUrl));
+    if (it == m_failures.constEnd() || now >= it->retryAfter) {
+        return true;
+    }
+
+    ++m_fetchesAvoided;
+    qCDebug(lcFavoritesLog) << "Not fetching" << iconUrl << "of" << host << "before" << it->retryAfter
+                            << "fetches avoided:" << m_fetchesAvoided;
+    return false;
+}
+
+void FaviconManager::fetchFailed(const QString &host, const QString &iconUrl, bool transient, qint64 now)
+{
+    loadFailures();
+
+    const QString key = changeKey(host, iconUrl);
+    FaviconFailure &failure = m_failures[key];
+    failure.host = host;
+    failure.iconUrl = iconUrl;
+    ++failure.failures;
+
+    qint64 delay = gFailureTtl;
+    if (transient) {
+        delay = qMin(gFailureTtl, gRetryDelay << qMin(failure.failures - 1, 16));
+    }
+    failure.retryAfter = now + delay;
+    ++m_fetchesFailed;
+
+    m_pendingFailures.insert(key, failure);
+    if (!m_saveTimer.isActive()) {
+        m_saveTimer.start();
+    }
+}
+
+void FaviconManager::fetchSucceeded(const QString &host, const QString &iconUrl)
+{
+    loadFailures();
+
+    if (m_failures.remove(changeKey(host, iconUrl)) > 0) {
+        removeFailure(host, iconUrl);
+    }
+}
+
+// Queues removing the row of the failure, null failures are deleted when written.
+void FaviconManager::removeFailure(const QString &host, const QString &iconUrl)
+{
+    FaviconFailure failure;
+    failure.host = host;
+    failure.iconUrl = iconUrl;
+    m_pendingFailures.insert(changeKey(host, iconUrl), failure);
+    if (!m_saveTimer.isActive()) {
+        m_saveTimer.start();
+    }
 }
@@ -11,8 +11,11 @@
 #ifndef FAVICONMANAGER_H
 #define FAVICONMANAGER_H
 
+#include <QHash>
 #include <QObject>
-#include <QMap>
+#include <QTimer>
+
+#include "favicon.h"
 
 class DeclarativeWebPage;
 class FaviconManager : public QObject
@@ -20,32 +23,81 @@ class FaviconManager : public QObject
     Q_OBJECT
 
 public:
+    // Sanitized host with its hash computed once, models cache these per row.
+    struct Host {
+        Host() : hash(0) {}
+
+        bool isNull() const { return name.isEmpty(); }
+        bool operator==(const Host &other) const { return hash == other.hash && name == other.name; }
+
+        QString name;
+        uint hash;
+    };
+
     static FaviconManager *instance();
     static QString sanitizedHostname(const QString &hostname);
+    static Host host(const QString &hostname);
 
     Q_INVOKABLE void add(const QString &type, const QString &hostname, const QString &favicon, bool hasTouchIcon);
+    void addImage(const QString &type, const QString &hostname, const QByteArray &data, bool hasTouchIcon);
     Q_INVOKABLE void remove(const QString &type, const QString &hostname);
     QString get(const QString &type, const QString &hostname);
+    const QString &favicon(const QString &type, const Host &host);
     Q_INVOKABLE void grabIcon(const QString &type, DeclarativeWebPage *webPage, const QSize &size);
     Q_INVOKABLE void clear(const QString &type);
+    void releaseCache();
+
+    int fetchesAvoided() const;
+    int fetchesFailed() const;
+
+private slots:
+    void save();
+    void removeHistoryHosts(const QStringList &hosts);
 
 private:
     FaviconManager(QObject *parent = nullptr);
 
-    void save(const QString &type);
     void load(const QString &type);
+    void importJson(const QString &type);
+    void removeJson(const QString &type);
+    void update(const Favicon &favicon);
+    QString storeData(const QByteArray &data);
+    void flush(bool wait);
+    void grabThumbnail(const QString &type, DeclarativeWebPage *webPage, const QSize &size);
 
-    struct Favicon {
-        QString favicon;
-        bool hasTouchIcon;
-    };
+    void loadFailures();
+    bool fetchAllowed(const QString &host, const QString &iconUrl, qint64 now);
+    void fetchFailed(const QString &host, const QString &iconUrl, bool transient, qint64 now);
+    void fetchSucceeded(const QString &host, const QString &iconUrl);
+    void removeFailure(const QString &host, const QString &iconUrl);
 
     struct FaviconSet {
         bool loaded;
-        QMap<QString, Favicon> favicons;
+        QHash<QString, Favicon> favicons;
+        // Image source of each favicon for lookups from models.
+        QHash<Host, QString> sources;
     };
 
-    QMap<QString, FaviconSet> m_faviconSets;
+    static QString source(const Favicon &favicon);
+
+    QHash<QString, FaviconSet> m_faviconSets;
+    // Changes waiting to be written in one transaction keyed by type and host.
+    QHash<QString, Favicon> m_pendingChanges;
+    QTimer m_saveTimer;
+
+    // Failed touch icon fetches keyed by host and icon url.
+    QHash<QString, FaviconFailure> m_failures;
+    QHash<QString, FaviconFailure> m_pendingFailures;
+    bool m_failuresLoaded;
+    int m_fetchesAvoided;
+    int m_fetchesFailed;
+
+    friend class tst_faviconmanager;
 };
 
+inline uint qHash(const FaviconManager::Host &host, uint seed = 0)
+{
+    return host.hash ^ seed;
+}
+
 #endif // FAVICONMANAGER_H
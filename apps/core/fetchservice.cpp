@@ -0,0 +1,321 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "fetchservice.h"
+#include "browserpaths.h"
+#include "logging.h"
+
+#include <QBuffer>
+#include <QImage>
+#include <QImageReader>
+#include <QNetworkDiskCache>
+#include <QNetworkRequest>
+#include <QtConcurrent>
+
+static const int gMaximumActiveRequests = 4;
+static const qint64 gMaximumCacheSize = 5 * 1024 * 1024;
+
+FetchReply::FetchReply(const QUrl &url, QObject *parent)
+    : QObject(parent)
+    , m_url(url)
+    , m_error(QNetworkReply::NoError)
+    , m_finished(false)
+    , m_fromCache(false)
+{
+}
+
+QUrl FetchReply::url() const
+{
+    return m_url;
+}
+
+QByteArray FetchReply::data() const
+{
+    return m_data;
+}
+
+QNetworkReply::NetworkError FetchReply::error() const
+{
+    return m_error;
+}
+
+bool FetchReply::isFinished() const
+{
+    return m_finished;
+}
+
+bool FetchReply::fromCache() const
+{
+    return m_fromCache;
+}
+
+QSize FetchReply::imageSize() const
+{
+    return m_imageSize;
+}
+
+QByteArray FetchReply::base64Data() const
+{
+    return m_base64Data;
+}
+
+FetchService *FetchService::instance()
+{
+    static FetchService *singleton = nullptr;
+    if (!singleton) {
+        singleton = new FetchService();
+    }
+
+    return singleton;
+}
+
+FetchService::FetchService(QObject *parent)
+    : QObject(parent)
+    , m_cache(new QNetworkDiskCache(this))
+    , m_maximumActiveRequests(gMaximumActiveRequests)
+    , m_activeCount(0)
+    , m_requestsStarted(0)
+    , m_requestsShared(0)
+    , m_cacheHits(0)
+{
+    m_cache->setCacheDirectory(QStringLiteral("%1/network").arg(BrowserPaths::cacheLocation()));
+    m_cache->setMaximumCacheSize(gMaximumCacheSize);
+    m_networkAccessManager.setCache(m_cache);
+}
+
+FetchService::~FetchService()
+{
+    for (Job *job : m_jobs) {
+        if (job->reply) {
+            job->reply->disconnect(this);
+        }
+        if (job->processWatcher) {
+            job->processWatcher->disconnect(this);
+            job->processWatcher->waitForFinished();
+        }
+    }
+    qDeleteAll(m_jobs);
+}
+
+/**
+ * @brief FetchService::fetch
+ * Requests the url. A request of an url that is already being fetched
+ * waits for the same network request. Deleting the returned reply before
+ * it has finished cancels the request if nobody else waits for it.
+ */
+FetchReply *FetchService::fetch(const QUrl &url, Options options, QObject *parent)
+{
+    FetchReply *reply = new FetchReply(url, parent);
+
+    Job *job = m_jobs.value(url);
+    if (job) {
+        ++m_requestsShared;
+        qCDebug(lcNetworkLog) << "Sharing request of" << url;
+    } else {
+        job = new Job;
+        job->url = url;
+        m_jobs.insert(url, job);
+        m_queue.enqueue(job);
+    }
+    job->options |= options;
+    job->replies.append(reply);
+
+    startNext();
+    return reply;
+}
+
+void FetchService::setMaximumActiveRequests(int count)
+{
+    if (count > 0 && m_maximumActiveRequests != count) {
+        m_maximumActiveRequests = count;
+        startNext();
+    }
+}
+
+int FetchService::maximumActiveRequests() const
+{
+    return m_maximumActiveRequests;
+}
+
+int FetchService::activeCount() const
+{
+    return m_activeCount;
+}
+
+int FetchService::queuedCount() const
+{
+    return m_queue.count();
+}
+
+int FetchService::requestsStarted() const
+{
+    return m_requestsStarted;
+}
+
+int FetchService::requestsShared() const
+{
+    return m_requestsShared;
+}
+
+int FetchService::cacheHits() const
+{
+    return m_cacheHits;
+}
+
+void FetchService::setCacheDirectory(const QString &directory)
+{
+    m_cache->setCacheDirectory(directory);
+}
+
+qint64 FetchService::cacheSize() const
+{
+    return m_cache->cacheSize();
+}
+
+void FetchService::clearCache()
+{
+    m_cache->clear();
+}
+
+// Reads only the image header, returns an invalid size if the format does not tell.
+QSize FetchService::imageSize(const QByteArray &data)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    return reader.size();
+}
+
+// Runs in a worker thread.
+QSize FetchService::decodedImageSize(const QByteArray &data)
+{
+    QImage image;
+    if (!image.loadFromData(data)) {
+        return QSize();
+    }
+    return image.size();
+}
+
+// Runs in a worker thread.
+FetchService::Processed FetchService::process(const QByteArray &data, Options options, const QSize &imageSize)
+{
+    Processed processed;
+    processed.imageSize = imageSize;
+    if ((options & ProbeImage) && !imageSize.isValid()) {
+        processed.imageSize = decodedImageSize(data);
+    }
+    if (options & EncodeBase64) {
+        processed.base64Data = data.toBase64();
+    }
+    return processed;
+}
+
+void FetchService::startNext()
+{
+    while (m_activeCount < m_maximumActiveRequests && !m_queue.isEmpty()) {
+        Job *job = m_queue.dequeue();
+        if (!hasReplies(job)) {
+            // Cancelled before it was started.
+            m_jobs.remove(job->url);
+            delete job;
+            continue;
+        }
+
+        ++m_activeCount;
+        ++m_requestsStarted;
+        job->reply = m_networkAccessManager.get(QNetworkRequest(job->url));
+        connect(job->reply, &QNetworkReply::finished, this, [this, job]() {
+            replyFinished(job);
+        });
+    }
+}
+
+void FetchService::replyFinished(Job *job)
+{
+    QNetworkReply *reply = job->reply;
+    job->reply = nullptr;
+    --m_activeCount;
+
+    job->error = reply->error();
+    if (job->error == QNetworkReply::NoError) {
+        job->data = reply->readAll();
+    }
+    job->fromCache = reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
+    if (job->fromCache) {
+        ++m_cacheHits;
+    }
+    reply->deleteLater();
+
+    qCDebug(lcNetworkLog) << "Fetched" << job->url << "error:" << job->error
+                          << "bytes:" << job->data.size() << "from cache:" << job->fromCache;
+
+    startNext();
+
+    Processed processed;
+    if ((job->options & (ProbeImage | EncodeBase64)) && !job->data.isEmpty() && hasReplies(job)) {
+        if (job->options & ProbeImage) {
+            processed.imageSize = imageSize(job->data);
+        }
+        if ((job->options & EncodeBase64) || ((job->options & ProbeImage) && !processed.imageSize.isValid())) {
+            // Decode and encode without blocking the GUI thread.
+            job->processWatcher = new QFutureWatcher<Processed>(this);
+            connect(job->processWatcher, &QFutureWatcher<Processed>::finished, this, [this, job]() {
+                const Processed result = job->processWatcher->result();
+                job->processWatcher->deleteLater();
+                job->processWatcher = nullptr;
+                finish(job, result);
+            });
+            job->processWatcher->setFuture(QtConcurrent::run(&FetchService::process, job->data,
+                                                             job->options, processed.imageSize));
+            return;
+        }
+    }
+
+    finish(job, processed);
+}
+
+void FetchService::finish(Job *job, const Processed &processed)
+{
+    // Replies may start new fetches of the same url when notified.
+    m_jobs.remove(job->url);
+    const QList<QPointer<FetchReply> > replies = job->replies;
+    const QByteArray data = job->data;
+    const QNetworkReply::NetworkError error = job->error;
+    const bool fromCache = job->fromCache;
+    delete job;
+
+    for (const QPointer<FetchReply> &reply : replies) {
+        if (reply) {
+            reply->m_data = data;
+            reply->m_error = error;
+            reply->m_fromCache = fromCache;
+            reply->m_imageSize = processed.imageSize;
+            reply->m_base64Data = processed.base64Data;
+            reply->m_finished = true;
+        }
+    }
+
+    for (const QPointer<FetchReply> &reply : replies) {
+        if (reply) {
+            emit reply->finished();
+        }
+    }
+}
+
+bool FetchService::hasReplies(const Job *job) const
+{
+    for (const QPointer<FetchReply> &reply : job->replies) {
+        if (reply) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,141 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef FETCHSERVICE_H
+#define FETCHSERVICE_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QSize>
+#include <QUrl>
+
+class QNetworkDiskCache;
+
+class FetchReply : public QObject
+{
+    Q_OBJECT
+
+public:
+    QUrl url() const;
+    QByteArray data() const;
+    QNetworkReply::NetworkError error() const;
+    bool isFinished() const;
+    bool fromCache() const;
+    // Valid for image requests whose data could be read as an image.
+    QSize imageSize() const;
+    // Valid for requests with the EncodeBase64 option.
+    QByteArray base64Data() const;
+
+signals:
+    void finished();
+
+private:
+    explicit FetchReply(const QUrl &url, QObject *parent);
+
+    QUrl m_url;
+    QByteArray m_data;
+    QNetworkReply::NetworkError m_error;
+    QSize m_imageSize;
+    QByteArray m_base64Data;
+    bool m_finished;
+    bool m_fromCache;
+
+    friend class FetchService;
+};
+
+/**
+ * Fetches small resources such as touch icons and search engine
+ * descriptions for the whole browser. All requests share one network access
+ * manager and an HTTP disk cache, concurrent requests of the same url share
+ * one network request and at most a few requests are in flight at a time.
+ * Dimensions of fetched images are read from the image header, images are
+ * decoded in a worker thread only when the header does not tell the size.
+ * Data that is needed base64 encoded is encoded in the same worker.
+ */
+class FetchService : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Option {
+        NoOptions = 0x0,
+        ProbeImage = 0x1,
+        EncodeBase64 = 0x2
+    };
+    Q_DECLARE_FLAGS(Options, Option)
+
+    static FetchService *instance();
+    ~FetchService();
+
+    // The reply is owned by the parent, deleting it cancels the request.
+    FetchReply *fetch(const QUrl &url, Options options = NoOptions, QObject *parent = nullptr);
+
+    void setMaximumActiveRequests(int count);
+    int maximumActiveRequests() const;
+    int activeCount() const;
+    int queuedCount() const;
+
+    int requestsStarted() const;
+    int requestsShared() const;
+    int cacheHits() const;
+
+    void setCacheDirectory(const QString &directory);
+    qint64 cacheSize() const;
+    void clearCache();
+
+    static QSize imageSize(const QByteArray &data);
+    static QSize decodedImageSize(const QByteArray &data);
+
+private:
+    FetchService(QObject *parent = nullptr);
+
+    struct Processed {
+        QSize imageSize;
+        QByteArray base64Data;
+    };
+
+    struct Job {
+        Job() : reply(nullptr), processWatcher(nullptr), options(NoOptions), error(QNetworkReply::NoError), fromCache(false) {}
+
+        QUrl url;
+        QList<QPointer<FetchReply> > replies;
+        QNetworkReply *reply;
+        QFutureWatcher<Processed> *processWatcher;
+        Options options;
+        QByteArray data;
+        QNetworkReply::NetworkError error;
+        bool fromCache;
+    };
+
+    void startNext();
+    void replyFinished(Job *job);
+    void finish(Job *job, const Processed &processed);
+    static Processed process(const QByteArray &data, Options options, const QSize &imageSize);
+    bool hasReplies(const Job *job) const;
+
+    QNetworkAccessManager m_networkAccessManager;
+    QNetworkDiskCache *m_cache;
+    QHash<QUrl, Job *> m_jobs;
+    QQueue<Job *> m_queue;
+    int m_maximumActiveRequests;
+    int m_activeCount;
+    int m_requestsStarted;
+    int m_requestsShared;
+    int m_cacheHits;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(FetchService::Options)
+
+#endif // FETCHSERVICE_H
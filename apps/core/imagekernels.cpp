@@ -0,0 +1,141 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "imagekernels.h"
+
+#include <QImage>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGEKERNELS_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define IMAGEKERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Pixels are handled as native 32 bit words. Alpha is always in the top byte
+// for the supported formats, color channels are compared without it.
+const quint32 gColorMask = 0x00ffffff;
+const quint32 gBlack = 0x00000000;
+
+// Rows checked by the sampling pass of the blank detection before the
+// remaining rows are scanned. Most frames are rejected by the sampling pass.
+const int gSampleRowStride = 16;
+
+// Black is the same in both channel orders, other formats are converted.
+QImage frame(const QImage &image)
+{
+    switch (image.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return image;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+        return image;
+#endif
+    default:
+        return image.convertToFormat(QImage::Format_RGB32);
+    }
+}
+
+inline const quint32 *row(const QImage &image, int y)
+{
+    return reinterpret_cast<const quint32 *>(image.constScanLine(y));
+}
+
+bool rowMatches(const quint32 *pixels, int count, quint32 color)
+{
+    int i = 0;
+#if defined(IMAGEKERNELS_SSE2)
+    const __m128i mask = _mm_set1_epi32(gColorMask);
+    const __m128i expected = _mm_set1_epi32(color);
+    for (; i + 16 <= count; i += 16) {
+        const __m128i *p = reinterpret_cast<const __m128i *>(pixels + i);
+        __m128i eq = _mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(p), mask), expected);
+        eq = _mm_and_si128(eq, _mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(p + 1), mask), expected));
+        eq = _mm_and_si128(eq, _mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(p + 2), mask), expected));
+        eq = _mm_and_si128(eq, _mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(p + 3), mask), expected));
+        if (_mm_movemask_epi8(eq) != 0xffff) {
+            return false;
+        }
+    }
+    for (; i + 4 <= count; i += 4) {
+        __m128i px = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i)), mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(px, expected)) != 0xffff) {
+            return false;
+        }
+    }
+#elif defined(IMAGEKERNELS_NEON)
+    const uint32x4_t mask = vdupq_n_u32(gColorMask);
+    const uint32x4_t expected = vdupq_n_u32(color);
+    for (; i + 4 <= count; i += 4) {
+        uint32x4_t eq = vceqq_u32(vandq_u32(vld1q_u32(pixels + i), mask), expected);
+        uint32x2_t folded = vand_u32(vget_low_u32(eq), vget_high_u32(eq));
+        if ((vget_lane_u32(folded, 0) & vget_lane_u32(folded, 1)) != 0xffffffff) {
+            return false;
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        if ((pixels[i] & gColorMask) != color) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+/**
+ * @brief ImageKernels::isBlack
+ * Detects frames that are completely black. Every sixteenth row is checked
+ * first so that frames with content are rejected early, the remaining rows
+ * are scanned only when all sampled rows are black.
+ */
+bool ImageKernels::isBlack(const QImage &image)
+{
+    if (image.isNull()) {
+        return false;
+    }
+
+    const QImage f = frame(image);
+    const int width = f.width();
+    const int height = f.height();
+
+    for (int y = 0; y < height; y += gSampleRowStride) {
+        if (!rowMatches(row(f, y), width, gBlack)) {
+            return false;
+        }
+    }
+
+    for (int y = 0; y < height; ++y) {
+        if (y % gSampleRowStride != 0 && !rowMatches(row(f, y), width, gBlack)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const char *ImageKernels::instructionSet()
+{
+#if defined(IMAGEKERNELS_SSE2)
+    return "sse2";
+#elif defined(IMAGEKERNELS_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,27 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef IMAGEKERNELS_H
+#define IMAGEKERNELS_H
+
+#include <QtGlobal>
+
+class QImage;
+
+// Analysis of captured web page frames. Row kernels use SSE2 or NEON when
+// the target supports them and fall back to plain C++ otherwise.
+struct ImageKernels
+{
+    static bool isBlack(const QImage &image);
+
+    static const char *instructionSet();
+};
+
+#endif // IMAGEKERNELS_H
@@ -0,0 +1,207 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "loadscheduler.h"
+#include "declarativewebpage.h"
+
+#ifndef DEBUG_LOGS
+#define DEBUG_LOGS 0
+#endif
+
+#if DEBUG_LOGS
+#include <QDebug>
+#endif
+
+LoadScheduler::LoadScheduler(QObject *parent)
+    : QObject(parent)
+    , m_maxConcurrentLoads(2)
+{
+}
+
+void LoadScheduler::setMaxConcurrentLoads(int count)
+{
+    count = qMax(0, count);
+    if (m_maxConcurrentLoads != count) {
+        m_maxConcurrentLoads = count;
+        startNext();
+    }
+}
+
+int LoadScheduler::maxConcurrentLoads() const
+{
+    return m_maxConcurrentLoads;
+}
+
+void LoadScheduler::setForegroundPage(DeclarativeWebPage *webPage)
+{
+    if (m_foregroundPage == webPage) {
+        return;
+    }
+
+    if (m_foregroundPage) {
+        disconnect(m_foregroundPage.data(), &DeclarativeWebPage::loadingChanged,
+                   this, &LoadScheduler::foregroundLoadingChanged);
+    }
+
+    m_foregroundPage = webPage;
+
+    if (webPage) {
+        if (m_loading.removeAll(webPage) > 0) {
+            disconnect(webPage, &DeclarativeWebPage::loadingChanged,
+                       this, &LoadScheduler::backgroundLoadingChanged);
+        } else if (m_queue.removeAll(webPage) > 0) {
+            // Load was stopped while waiting in the queue.
+            restart(webPage);
+        }
+
+        connect(webPage, &DeclarativeWebPage::loadingChanged,
+                this, &LoadScheduler::foregroundLoadingChanged);
+    }
+
+    startNext();
+}
+
+void LoadScheduler::moveToBackground(DeclarativeWebPage *webPage)
+{
+    Q_ASSERT(webPage);
+
+    if (m_foregroundPage == webPage) {
+        disconnect(webPage, &DeclarativeWebPage::loadingChanged,
+                   this, &LoadScheduler::foregroundLoadingChanged);
+        m_foregroundPage = 0;
+    }
+
+    if (!webPage->loading()) {
+        webPage->suspendView();
+        return;
+    }
+
+    purge();
+    if (m_loading.count() < m_maxConcurrentLoads) {
+#if DEBUG_LOGS
+        qDebug() << "continue loading in background:" << webPage;
+#endif
+        // Stop rendering but keep network and timers running.
+        webPage->setActive(false);
+        m_loading.append(webPage);
+        connect(webPage, &DeclarativeWebPage::loadingChanged,
+                this, &LoadScheduler::backgroundLoadingChanged, Qt::UniqueConnection);
+    } else {
+#if DEBUG_LOGS
+        qDebug() << "queue background load:" << webPage;
+#endif
+        webPage->stop();
+        webPage->suspendView();
+        m_queue.append(webPage);
+    }
+}
+
+void LoadScheduler::clear()
+{
+    for (const QPointer<DeclarativeWebPage> &webPage : m_loading) {
+        if (webPage) {
+            disconnect(webPage.data(), &DeclarativeWebPage::loadingChanged,
+                       this, &LoadScheduler::backgroundLoadingChanged);
+        }
+    }
+    m_loading.clear();
+    m_queue.clear();
+}
+
+int LoadScheduler::loadingCount() const
+{
+    int count = 0;
+    for (const QPointer<DeclarativeWebPage> &webPage : m_loading) {
+        if (webPage) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int LoadScheduler::queuedCount() const
+{
+    int count = 0;
+    for (const QPointer<DeclarativeWebPage> &webPage : m_queue) {
+        if (webPage) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void LoadScheduler::backgroundLoadingChanged()
+{
+    DeclarativeWebPage *webPage = qobject_cast<DeclarativeWebPage *>(sender());
+    if (!webPage || webPage->loading()) {
+        return;
+    }
+
+#if DEBUG_LOGS
+    qDebug() << "background load finished:" << webPage;
+#endif
+    disconnect(webPage, &DeclarativeWebPage::loadingChanged,
+               this, &LoadScheduler::backgroundLoadingChanged);
+    m_loading.removeAll(webPage);
+    webPage->suspendView();
+    startNext();
+}
+
+void LoadScheduler::foregroundLoadingChanged()
+{
+    startNext();
+}
+
+void LoadScheduler::startLoad(DeclarativeWebPage *webPage)
+{
+#if DEBUG_LOGS
+    qDebug() << "start queued background load:" << webPage;
+#endif
+    webPage->resumeView();
+    webPage->setActive(false);
+    restart(webPage);
+    m_loading.append(webPage);
+    connect(webPage, &DeclarativeWebPage::loadingChanged,
+            this, &LoadScheduler::backgroundLoadingChanged, Qt::UniqueConnection);
+}
+
+// A page stopped before its first url was committed has nothing to reload yet.
+void LoadScheduler::restart(DeclarativeWebPage *webPage)
+{
+    if (webPage->initialLoadHasHappened()) {
+        webPage->reload();
+    } else {
+        webPage->load(webPage->initialUrl());
+    }
+}
+
+void LoadScheduler::startNext()
+{
+    purge();
+
+    // Foreground load has the priority, queued loads wait until it is done.
+    if (m_foregroundPage && m_foregroundPage->loading()) {
+        return;
+    }
+
+    while (m_loading.count() < m_maxConcurrentLoads && !m_queue.isEmpty()) {
+        DeclarativeWebPage *webPage = m_queue.takeFirst();
+        if (webPage) {
+            startLoad(webPage);
+        }
+    }
+}
+
+void LoadScheduler::purge()
+{
+    // Pages virtualized or closed meanwhile are dropped from the scheduler.
+    m_loading.removeAll(QPointer<DeclarativeWebPage>());
+    m_queue.removeAll(QPointer<DeclarativeWebPage>());
+}
@@ -0,0 +1,59 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef LOADSCHEDULER_H
+#define LOADSCHEDULER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QList>
+
+class DeclarativeWebPage;
+
+/**
+ * Lets pages that lose focus while loading finish their load in the background.
+ * At most maxConcurrentLoads background pages load at a time, the rest are
+ * stopped and restarted in order once a slot frees up and the foreground page
+ * is not loading.
+ */
+class LoadScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoadScheduler(QObject *parent = 0);
+
+    void setMaxConcurrentLoads(int count);
+    int maxConcurrentLoads() const;
+
+    void setForegroundPage(DeclarativeWebPage *webPage);
+    void moveToBackground(DeclarativeWebPage *webPage);
+    void clear();
+
+    int loadingCount() const;
+    int queuedCount() const;
+
+private slots:
+    void backgroundLoadingChanged();
+    void foregroundLoadingChanged();
+
+private:
+    void startLoad(DeclarativeWebPage *webPage);
+    void restart(DeclarativeWebPage *webPage);
+    void startNext();
+    void purge();
+
+    QPointer<DeclarativeWebPage> m_foregroundPage;
+    QList<QPointer<DeclarativeWebPage> > m_loading;
+    QList<QPointer<DeclarativeWebPage> > m_queue;
+    int m_maxConcurrentLoads;
+};
+
+#endif
@@ -15,3 +15,5 @@ Q_LOGGING_CATEGORY(lcCoreLog, "org.sailfishos.browser.core", QtWarningMsg)
 Q_LOGGING_CATEGORY(lcBackupLog, "org.sailfishos.browser.backup", QtWarningMsg)
 Q_LOGGING_CATEGORY(lcDownloadLog, "org.sailfishos.browser.download", QtWarningMsg)
 Q_LOGGING_CATEGORY(lcFavoritesLog, "org.sailfishos.browser.favorites", QtWarningMsg)
+Q_LOGGING_CATEGORY(lcMemoryLog, "org.sailfishos.browser.memory", QtWarningMsg)
+Q_LOGGING_CATEGORY(lcNetworkLog, "org.sailfishos.browser.network", QtWarningMsg)
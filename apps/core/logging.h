@@ -18,5 +18,7 @@ Q_DECLARE_LOGGING_CATEGORY(lcCoreLog)
 Q_DECLARE_LOGGING_CATEGORY(lcBackupLog)
 Q_DECLARE_LOGGING_CATEGORY(lcDownloadLog)
 Q_DECLARE_LOGGING_CATEGORY(lcFavoritesLog)
+Q_DECLARE_LOGGING_CATEGORY(lcMemoryLog)
+Q_DECLARE_LOGGING_CATEGORY(lcNetworkLog)
 
 #endif
@@ -12,6 +12,7 @@
 #include "dbmanager.h"
 #include "opensearchconfigs.h"
 #include "faviconmanager.h"
+#include "fetchservice.h"
 
 #include <MGConfItem>
 #include <QVariant>
@@ -102,6 +103,8 @@ bool SettingManager::clearHistory()
     bool actionNeeded = m_clearHistoryConfItem->value(false).toBool();
     if (actionNeeded) {
         DBManager::instance()->clearHistory();
+        // Fetched icons tell which sites were visited.
+        FetchService::instance()->clearCache();
         m_clearHistoryConfItem->set(false);
     }
     return actionNeeded;
@@ -133,6 +136,7 @@ bool SettingManager::clearCache()
     bool actionNeeded = m_clearCacheConfItem->value(false).toBool();
     if (actionNeeded) {
         SailfishOS::WebEngine::instance()->notifyObservers(QString("clear-private-data"), QString("cache"));
+        FetchService::instance()->clearCache();
         m_clearCacheConfItem->set(false);
     }
     return actionNeeded;
@@ -12,6 +12,7 @@
 #include "webpagequeue.h"
 #include "declarativewebpage.h"
 
+#include <QDateTime>
 #include <QObject>
 #include <QRectF>
 
@@ -34,10 +35,15 @@ WebPageQueue::~WebPageQueue()
     clear();
 }
 
+// Virtualized entries stay in place, live pages may follow them.
 int WebPageQueue::count() const
 {
     int count = 0;
-    for (; count < m_queue.count() && m_queue.at(count)->webPage; ++count) {}
+    for (const WebPageEntry *pageEntry : m_queue) {
+        if (pageEntry->webPage) {
+            ++count;
+        }
+    }
     return count;
 }
 
@@ -65,10 +71,16 @@ DeclarativeWebPage *WebPageQueue::activate(int tabId)
     WebPageEntry *pageEntry = find(tabId, index);
     // No need to change position for the first index.
     if (index > 0) {
+        deactivateFirst();
         m_queue.removeAt(index);
         m_queue.prepend(pageEntry);
     }
 
+    if (pageEntry) {
+        pageEntry->inactiveSince = 0;
+        pageEntry->idleSuspended = false;
+    }
+
     return pageEntry ? pageEntry->webPage : 0;
 }
 
@@ -132,6 +144,9 @@ void WebPageQueue::prepend(int tabId, DeclarativeWebPage *webPage)
         m_queue.removeAt(index);
     }
 
+    deactivateFirst();
+    pageEntry->inactiveSince = 0;
+    pageEntry->idleSuspended = false;
     m_queue.prepend(pageEntry);
     updateLivePages();
     m_livePagePrepended = true;
@@ -194,8 +209,7 @@ bool WebPageQueue::virtualizeInactive()
 
     for (int i = 1; i < m_queue.count(); ++i) {
         DeclarativeWebPage* page = m_queue.at(i)->webPage;
-        if (page &&
-                (livePage->parentId() != (int)page->uniqueId() || (int)livePage->uniqueId() != page->parentId())) {
+        if (page && canVirtualize(livePage, page)) {
             release(m_queue.at(i)->tabId, true);
         }
     }
@@ -204,6 +218,85 @@ bool WebPageQueue::virtualizeInactive()
     return true;
 }
 
+/**
+ * @brief WebPageQueue::virtualizeLeastRecentlyUsed
+ * Virtualizes only the least recently used inactive live page. The queue is kept in
+ * activation order so the last live entry is the one that was used longest ago.
+ * @return tab id of the virtualized page or 0 if there was nothing to virtualize.
+ */
+int WebPageQueue::virtualizeLeastRecentlyUsed()
+{
+    if (m_queue.isEmpty() || !m_queue.at(0)->webPage || !m_queue.at(0)->webPage->completed()) {
+        return 0;
+    }
+
+    DeclarativeWebPage* livePage = m_queue.at(0)->webPage;
+
+    for (int i = m_queue.count() - 1; i > 0; --i) {
+        DeclarativeWebPage* page = m_queue.at(i)->webPage;
+        if (page && canVirtualize(livePage, page)) {
+            int tabId = m_queue.at(i)->tabId;
+            release(tabId, true);
+            return tabId;
+        }
+    }
+
+    // Only the active page (and its relatives) are alive.
+    m_livePagePrepended = false;
+    return 0;
+}
+
+/**
+ * @brief WebPageQueue::sleepIdle
+ * Suspends inactive live pages that have not been activated within idleTimeout and
+ * virtualizes them once they have stayed idle for another idleTimeout. Relatives of
+ * the active page and pages playing media are kept running.
+ * @return milliseconds until the next idle page is due or -1 if nothing is pending.
+ */
+qint64 WebPageQueue::sleepIdle(qint64 now, qint64 idleTimeout)
+{
+    if (idleTimeout <= 0 || m_queue.isEmpty() || !m_queue.at(0)->webPage) {
+        return -1;
+    }
+
+    DeclarativeWebPage* livePage = m_queue.at(0)->webPage;
+    qint64 nextDue = -1;
+
+    for (int i = m_queue.count() - 1; i > 0; --i) {
+        WebPageEntry *pageEntry = m_queue.at(i);
+        DeclarativeWebPage* page = pageEntry->webPage;
+        if (!page || !canVirtualize(livePage, page)) {
+            continue;
+        }
+
+        qint64 due = idleTimeout;
+        if (!page->mediaActive()) {
+            qint64 idle = now - pageEntry->inactiveSince;
+            if (idle >= 2 * idleTimeout) {
+#if DEBUG_LOGS
+                qDebug() << "virtualize idle tab:" << pageEntry->tabId << idle;
+#endif
+                release(pageEntry->tabId, true);
+                continue;
+            } else if (idle >= idleTimeout && !pageEntry->idleSuspended) {
+#if DEBUG_LOGS
+                qDebug() << "suspend idle tab:" << pageEntry->tabId << idle;
+#endif
+                if (page->loading()) {
+                    page->stop();
+                }
+                page->suspendView();
+                pageEntry->idleSuspended = true;
+            }
+            due = (pageEntry->idleSuspended ? 2 * idleTimeout : idleTimeout) - idle;
+        }
+        // Pages playing media are checked again after a full timeout.
+        nextDue = nextDue < 0 ? due : qMin(nextDue, due);
+    }
+
+    return nextDue;
+}
+
 void WebPageQueue::dumpPages() const
 {
     qDebug() << "---- start ----";
@@ -225,6 +318,18 @@ void WebPageQueue::updateLivePages()
     }
 }
 
+void WebPageQueue::deactivateFirst()
+{
+    if (!m_queue.isEmpty()) {
+        m_queue.at(0)->inactiveSince = QDateTime::currentMSecsSinceEpoch();
+    }
+}
+
+bool WebPageQueue::canVirtualize(DeclarativeWebPage *livePage, DeclarativeWebPage *page) const
+{
+    return livePage->parentId() != (int)page->uniqueId() || (int)livePage->uniqueId() != page->parentId();
+}
+
 WebPageQueue::WebPageEntry *WebPageQueue::find(int tabId, int &index) const
 {
     int count = m_queue.count();
@@ -245,6 +350,8 @@ WebPageQueue::WebPageEntry::WebPageEntry(DeclarativeWebPage *webPage, QRectF *cs
     , parentId(webPage ? webPage->parentId() : 0)
     , cssContentRect(cssContentRect)
     , allowPageDelete(false)
+    , inactiveSince(0)
+    , idleSuspended(false)
 {
 }
 
@@ -37,6 +37,8 @@ public :
     bool setMaxLivePages(int count);
     int maxLivePages() const;
     bool virtualizeInactive();
+    int virtualizeLeastRecentlyUsed();
+    qint64 sleepIdle(qint64 now, qint64 idleTimeout);
 
     void dumpPages() const;
 
@@ -51,9 +53,14 @@ private:
         int parentId;
         QRectF *cssContentRect;
         bool allowPageDelete;
+        // Time when the page was moved away from the front of the queue.
+        qint64 inactiveSince;
+        bool idleSuspended;
     };
 
     void updateLivePages();
+    void deactivateFirst();
+    bool canVirtualize(DeclarativeWebPage *livePage, DeclarativeWebPage *page) const;
     WebPageEntry *find(int tabId, int &index) const;
 
     QList<WebPageEntry *> m_queue;
@@ -19,12 +19,19 @@
 #include <QQmlContext>
 #include <QMapIterator>
 #include <QRectF>
+#include <QFile>
+#include <QQuickWindow>
 #include <webengine.h>
+#include <unistd.h>
 
 #include "webpages.h"
 #include "declarativewebcontainer.h"
 #include "declarativewebpage.h"
+#include "downloadmanager.h"
+#include "faviconmanager.h"
+#include "logging.h"
 #include "tab.h"
+#include "tabthumbnailprovider.h"
 #include "webpagefactory.h"
 
 #ifndef DEBUG_LOGS
@@ -36,6 +43,11 @@
 #endif
 
 static const qint64 gMemoryPressureTimeout = 600 * 1000; // 600 sec
+// Gives the engine a moment to return memory and MCE to report the new level
+// before the next page is evicted.
+static const int gEvictionInterval = 250; // 250 ms
+// Number of pages allowed to keep loading after they have lost focus.
+static const int gMaxBackgroundLoads = 2;
 // In normal cases gLowMemoryEnabled is true. Can be disabled e.g. for test runs.
 static const bool gLowMemoryEnabled = qgetenv("LOW_MEMORY_DISABLED").isEmpty();
 
@@ -43,13 +55,40 @@ static const QString MemNormal = QStringLiteral("normal");
 static const QString MemWarning = QStringLiteral("warning");
 static const QString MemCritical = QStringLiteral("critical");
 
+static qint64 residentMemory()
+{
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    // Second field is the resident set size in pages.
+    QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.count() > 1 ? fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) : 0;
+}
+
 WebPages::WebPages(WebPageFactory *pageFactory, QObject *parent)
     : QObject(parent)
     , m_pageFactory(pageFactory)
     , m_backgroundTimestamp(0)
     , m_memoryLevel(MemNormal)
+    , m_handledMemoryLevel(MemNormal)
+    , m_idleTimeout(0)
 {
     Q_ASSERT_X(m_pageFactory, Q_FUNC_INFO, "WebPages initialized with invalid WebPageFactory.");
+    m_evictionTimer.setSingleShot(true);
+    m_evictionTimer.setInterval(gEvictionInterval);
+    connect(&m_evictionTimer, &QTimer::timeout, this, &WebPages::evictNextInactive);
+
+    updateMaxBackgroundLoads();
+
+    m_idleTimer.setSingleShot(true);
+    // Idle sleeping does not need to be accurate, avoid extra wake ups.
+    m_idleTimer.setTimerType(Qt::VeryCoarseTimer);
+    connect(&m_idleTimer, &QTimer::timeout, this, &WebPages::sleepIdlePages);
+    connect(DownloadManager::instance(), &DownloadManager::allTransfersCompleted,
+            this, &WebPages::sleepIdlePages);
+
     if (gLowMemoryEnabled) {
         QDBusConnection systemBus = QDBusConnection::systemBus();
         systemBus.connect("com.nokia.mce", "/com/nokia/mce/signal",
@@ -96,9 +135,10 @@ void WebPages::initialMemoryLevel(QDBusPendingCallWatcher *watcher)
 {
     if (watcher->isValid() && watcher->isFinished()) {
         QDBusPendingReply<QString> reply = *watcher;
-        m_memoryLevel = reply.value();
-        if (m_memoryLevel == MemCritical) {
+        if (reply.value() == MemCritical) {
             handleMemNotify(MemCritical);
+        } else {
+            m_memoryLevel = reply.value();
         }
     }
 
@@ -124,7 +164,11 @@ int WebPages::count() const
 
 bool WebPages::setMaxLivePages(int count)
 {
-    return m_activePages.setMaxLivePages(count);
+    if (m_activePages.setMaxLivePages(count)) {
+        updateMaxBackgroundLoads();
+        return true;
+    }
+    return false;
 }
 
 int WebPages::maxLivePages() const
@@ -132,6 +176,22 @@ int WebPages::maxLivePages() const
     return m_activePages.maxLivePages();
 }
 
+bool WebPages::setIdleTimeout(int seconds)
+{
+    seconds = qMax(0, seconds);
+    if (m_idleTimeout != seconds) {
+        m_idleTimeout = seconds;
+        sleepIdlePages();
+        return true;
+    }
+    return false;
+}
+
+int WebPages::idleTimeout() const
+{
+    return m_idleTimeout;
+}
+
 bool WebPages::alive(int tabId) const
 {
     return m_activePages.alive(tabId);
@@ -169,10 +229,13 @@ WebPageActivationData WebPages::page(const Tab& tab, int parentId)
     dumpPages();
 #endif
 
-    if (m_memoryLevel == MemCritical) {
+    if (m_memoryLevel == MemCritical || m_memoryLevel != m_handledMemoryLevel) {
         handleMemNotify(m_memoryLevel);
     }
 
+    // Previously active page starts idling now.
+    sleepIdlePages();
+
     return WebPageActivationData(newActiveWebPage, true);
 }
 
@@ -185,6 +248,7 @@ void WebPages::release(int tabId)
 
 void WebPages::clear()
 {
+    m_loadScheduler.clear();
     m_activePages.clear();
 }
 
@@ -198,10 +262,8 @@ void WebPages::updateStates(DeclarativeWebPage *oldActivePage, DeclarativeWebPag
     if (oldActivePage) {
         // Allow suspending only the current active page if it is not the creator (parent).
         if (newActivePage->parentId() != (int)oldActivePage->uniqueId()) {
-            if (oldActivePage->loading()) {
-                oldActivePage->stop();
-            }
-            oldActivePage->suspendView();
+            // Suspends the page or lets it finish loading in the background.
+            m_loadScheduler.moveToBackground(oldActivePage);
         } else {
             // Sets parent to inactive and suspends rendering keeping
             // timeouts running.
@@ -210,38 +272,150 @@ void WebPages::updateStates(DeclarativeWebPage *oldActivePage, DeclarativeWebPag
     }
 
     if (newActivePage) {
+        m_loadScheduler.setForegroundPage(newActivePage);
+        newActivePage->requestTabHistory();
         newActivePage->resumeView();
         newActivePage->update();
     }
 }
 
+void WebPages::updateMaxBackgroundLoads()
+{
+    // Background loads must fit into the live page budget next to the active page.
+    m_loadScheduler.setMaxConcurrentLoads(qMin(gMaxBackgroundLoads, m_activePages.maxLivePages() - 1));
+}
+
 void WebPages::dumpPages() const
 {
     m_activePages.dumpPages();
 }
 
+void WebPages::sleepIdlePages()
+{
+    m_idleTimer.stop();
+    if (m_idleTimeout <= 0) {
+        return;
+    }
+
+    if (DownloadManager::instance()->existActiveTransfers()) {
+        // Downloads are not tracked per page, keep pages running until
+        // all transfers have completed.
+        return;
+    }
+
+    qint64 nextDue = m_activePages.sleepIdle(QDateTime::currentMSecsSinceEpoch(),
+                                                  m_idleTimeout * 1000);
+    if (nextDue >= 0) {
+        m_idleTimer.start(qMax<qint64>(nextDue, 1000));
+    }
+}
+
 void WebPages::handleMemNotify(const QString &memoryLevel)
 {
-    // Keep track of memory notification signals.
+    // Keep track of memory notification signals. Levels that arrive before
+    // the container has completed are handled once it has.
     m_memoryLevel = memoryLevel;
 
     if (!m_webContainer || !m_webContainer->completed()) {
         return;
     }
 
-    if (m_memoryLevel == MemWarning || m_memoryLevel == MemCritical) {
+    const QString previousLevel = m_handledMemoryLevel;
+    m_handledMemoryLevel = m_memoryLevel;
 
-        if (!m_activePages.virtualizeInactive() && m_activePages.activeWebPage() && !m_activePages.activeWebPage()->completed()) {
-            connect(m_activePages.activeWebPage(), &DeclarativeWebPage::completedChanged,
-                    this, &WebPages::delayVirtualization, Qt::UniqueConnection);
-        }
+    if (m_memoryLevel != MemWarning && m_memoryLevel != MemCritical) {
+        // Pressure has cleared, keep the remaining pages alive.
+        m_evictionTimer.stop();
+        return;
+    }
 
-        SailfishOS::WebEngine *webEngine = SailfishOS::WebEngine::instance();
-        webEngine->notifyObservers(QString("memory-pressure"), QString("low-memory"));
-        if (!m_webContainer->foreground() &&
-                (QDateTime::currentMSecsSinceEpoch() - m_backgroundTimestamp) > gMemoryPressureTimeout) {
-            m_backgroundTimestamp = QDateTime::currentMSecsSinceEpoch();
-            webEngine->notifyObservers(QString("memory-pressure"), QString("heap-minimize"));
+    DeclarativeWebPage *activePage = m_activePages.activeWebPage();
+    if (activePage && !activePage->completed()) {
+        connect(activePage, &DeclarativeWebPage::completedChanged,
+                this, &WebPages::delayVirtualization, Qt::UniqueConnection);
+    } else if (m_memoryLevel == MemWarning) {
+        // Release least recently used pages one at a time so that a single
+        // notification does not stall the GUI thread nor drop every page.
+        if (!m_evictionTimer.isActive() && evictLeastRecentlyUsed()) {
+            m_evictionTimer.start();
         }
+    } else {
+        m_evictionTimer.stop();
+        if (evictLeastRecentlyUsed()) {
+            while (evictLeastRecentlyUsed()) {}
+            logResidentMemory();
+        }
+    }
+
+    bool enteredCritical = m_memoryLevel == MemCritical && previousLevel != MemCritical;
+    if (enteredCritical) {
+        releaseCaches();
+    }
+
+    SailfishOS::WebEngine *webEngine = SailfishOS::WebEngine::instance();
+    webEngine->notifyObservers(QString("memory-pressure"), QString("low-memory"));
+    if (enteredCritical || (!m_webContainer->foreground() &&
+            (QDateTime::currentMSecsSinceEpoch() - m_backgroundTimestamp) > gMemoryPressureTimeout)) {
+        m_backgroundTimestamp = QDateTime::currentMSecsSinceEpoch();
+        webEngine->notifyObservers(QString("memory-pressure"), QString("heap-minimize"));
+    }
+}
+
+void WebPages::evictNextInactive()
+{
+    if (m_memoryLevel != MemWarning || !m_webContainer) {
+        return;
+    }
+
+    if (evictLeastRecentlyUsed()) {
+        m_evictionTimer.start();
+    } else {
+        logResidentMemory();
+    }
+}
+
+bool WebPages::evictLeastRecentlyUsed()
+{
+    const bool logging = lcMemoryLog().isInfoEnabled();
+    const qint64 residentBefore = logging ? residentMemory() : 0;
+    int tabId = m_activePages.virtualizeLeastRecentlyUsed();
+    if (tabId <= 0) {
+        return false;
+    }
+
+    if (logging) {
+        // Memory the engine returns later is included in the delayed log.
+        qCInfo(lcMemoryLog) << "Virtualized tab" << tabId << "on" << m_memoryLevel << "memory level, reclaimed"
+                            << (residentBefore - residentMemory()) << "bytes,"
+                            << m_activePages.count() << "live pages left";
+    }
+    return true;
+}
+
+void WebPages::releaseCaches()
+{
+    FaviconManager::instance()->releaseCache();
+    TabThumbnailProvider::releaseCache();
+    QQuickWindow *chromeWindow = qobject_cast<QQuickWindow *>(m_webContainer->chromeWindow());
+    if (chromeWindow) {
+        // Drops cached textures such as tab thumbnails that are not visible.
+        chromeWindow->releaseResources();
+    }
+
+    qCInfo(lcMemoryLog) << "Released favicon and thumbnail caches";
+    logResidentMemory();
+}
+
+// The engine and the allocator return memory asynchronously, the resident
+// set is read once they have had time to do so.
+void WebPages::logResidentMemory()
+{
+    if (!lcMemoryLog().isInfoEnabled()) {
+        return;
     }
+
+    QTimer::singleShot(gEvictionInterval, this, [this]() {
+        qCInfo(lcMemoryLog) << "Resident memory" << residentMemory() << "bytes with"
+                            << m_activePages.count() << "live pages";
+    });
 }
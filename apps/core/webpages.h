@@ -12,10 +12,12 @@
 #ifndef WEBPAGES_H
 #define WEBPAGES_H
 
+#include "loadscheduler.h"
 #include "webpagequeue.h"
 
 #include <QObject>
 #include <QPointer>
+#include <QTimer>
 
 class QQmlComponent;
 class WebPageFactory;
@@ -49,6 +51,9 @@ public:
     bool setMaxLivePages(int count);
     int maxLivePages() const;
 
+    bool setIdleTimeout(int seconds);
+    int idleTimeout() const;
+
     bool alive(int tabId) const;
 
     WebPageActivationData page(const Tab& tab, int parentId = 0);
@@ -62,9 +67,15 @@ private slots:
     void updateBackgroundTimestamp();
     void initialMemoryLevel(QDBusPendingCallWatcher *watcher);
     void delayVirtualization();
+    void evictNextInactive();
+    void sleepIdlePages();
 
 private:
     void updateStates(DeclarativeWebPage *oldActivePage, DeclarativeWebPage *newActivePage);
+    bool evictLeastRecentlyUsed();
+    void releaseCaches();
+    void logResidentMemory();
+    void updateMaxBackgroundLoads();
 
     QPointer<DeclarativeWebContainer> m_webContainer;
     QPointer<WebPageFactory> m_pageFactory;
@@ -72,6 +83,14 @@ private:
     WebPageQueue m_activePages;
     qint64 m_backgroundTimestamp;
     QString m_memoryLevel;
+    // Last level that pages and caches were released for.
+    QString m_handledMemoryLevel;
+    // Drives incremental eviction of inactive pages under "warning" memory level.
+    QTimer m_evictionTimer;
+    // Seconds after which an inactive page is suspended, zero disables idle sleeping.
+    int m_idleTimeout;
+    QTimer m_idleTimer;
+    LoadScheduler m_loadScheduler;
 
     friend class tst_webview;
     friend class tst_webpages;
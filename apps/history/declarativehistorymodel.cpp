@@ -13,16 +13,44 @@
 #include "dbmanager.h"
 #include "faviconmanager.h"
 
+#include <QSet>
 #include <QUrl>
 
+// Folds the case of ASCII letters only, like the LIKE operator of SQLite.
+static inline ushort likeFolded(QChar c)
+{
+    const ushort u = c.unicode();
+    return u >= 'A' && u <= 'Z' ? u + ('a' - 'A') : u;
+}
+
+// Same as "text LIKE '%pattern%'" for patterns without wildcards.
+static bool likeContains(const QString &text, const QString &pattern)
+{
+    const int last = text.length() - pattern.length();
+    for (int i = 0; i <= last; ++i) {
+        int j = 0;
+        while (j < pattern.length() && likeFolded(text.at(i + j)) == likeFolded(pattern.at(j))) {
+            ++j;
+        }
+        if (j == pattern.length()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 DeclarativeHistoryModel::DeclarativeHistoryModel(QObject *parent)
     : QAbstractListModel(parent)
     , m_populated(false)
+    , m_active(true)
+    , m_stale(false)
 {
     connect(DBManager::instance(), &DBManager::historyAvailable,
             this, &DeclarativeHistoryModel::historyAvailable);
     connect(DBManager::instance(), &DBManager::titleChanged,
             this, &DeclarativeHistoryModel::updateTitle);
+    connect(DBManager::instance(), &DBManager::historyEntryAdded,
+            this, &DeclarativeHistoryModel::historyEntryAdded);
 }
 
 QHash<int, QByteArray> DeclarativeHistoryModel::roleNames() const
@@ -40,6 +68,7 @@ void DeclarativeHistoryModel::clear()
     beginResetModel();
     m_searchTerm.clear();
     m_links.clear();
+    m_hostKeys.clear();
     endResetModel();
     DBManager::instance()->clearHistory();
     FaviconManager::instance()->clear(QStringLiteral("history"));
@@ -53,49 +82,63 @@ void DeclarativeHistoryModel::remove(int index)
         return;
     }
 
-    beginRemoveRows(QModelIndex(), index, index);
-    Link link = m_links.takeAt(index);
-    DBManager::instance()->removeHistoryEntry(link.linkId());
-    endRemoveRows();
-    emit countChanged();
+    const bool windowFull = m_links.count() >= HISTORY_LIMIT;
+    DBManager::instance()->removeHistoryEntry(m_links.at(index).linkId());
+    removeRow(index);
+
+    // Rows after the window fill the gap.
+    if (windowFull) {
+        search(m_searchTerm);
+    }
 }
 
+// Favicons of hosts without history are removed once the database tells them.
 void DeclarativeHistoryModel::remove(const QString &url)
 {
-    const QString sanitizedUrl = FaviconManager::sanitizedHostname(url);
-    bool canClearFavicon = true;
-    int index = 0;
-    for (const auto &link : m_links) {
-        if (link.url() == url) {
-            remove(index);
-        } else if (FaviconManager::sanitizedHostname(link.url()) == sanitizedUrl) {
-            // this site is still represented in history, so cannot clear icon
-            canClearFavicon = false;
-        }
-        index++;
-    }
-
-    // Not in model but remove from database anyway
+    // Also when not in model
     DBManager::instance()->removeHistoryEntry(url);
 
-    // And clean up favicon if no other urls from the same host
-    if (canClearFavicon) {
-        FaviconManager::instance()->remove(QStringLiteral("history"), url);
+    for (int i = 0; i < m_links.count(); ++i) {
+        if (m_links.at(i).url() == url) {
+            const bool windowFull = m_links.count() >= HISTORY_LIMIT;
+            removeRow(i);
+            if (windowFull) {
+                search(m_searchTerm);
+            }
+            break;
+        }
     }
 }
 
+// The visit is applied to the rows once stored, see historyEntryAdded.
 void DeclarativeHistoryModel::add(const QString &url, const QString &title)
 {
     DBManager::instance()->addHistoryEntry(url, title);
-    search(m_searchTerm);
 }
 
 void DeclarativeHistoryModel::search(const QString &filter)
 {
     m_searchTerm = filter;
+    m_stale = false;
     DBManager::instance()->getHistory(filter);
 }
 
+bool DeclarativeHistoryModel::active() const
+{
+    return m_active;
+}
+
+void DeclarativeHistoryModel::setActive(bool active)
+{
+    if (m_active != active) {
+        m_active = active;
+        if (m_active && m_stale) {
+            search(m_searchTerm);
+        }
+        emit activeChanged();
+    }
+}
+
 int DeclarativeHistoryModel::rowCount(const QModelIndex & parent) const {
     Q_UNUSED(parent);
     return m_links.count();
@@ -105,7 +148,7 @@ QVariant DeclarativeHistoryModel::data(const QModelIndex & index, int role) cons
     if (index.row() < 0 || index.row() >= m_links.count())
         return QVariant();
 
-    const Link url = m_links[index.row()];
+    const Link &url = m_links.at(index.row());
 
     switch (role) {
     case UrlRole:
@@ -115,7 +158,7 @@ QVariant DeclarativeHistoryModel::data(const QModelIndex & index, int role) cons
     case DateRole:
         return url.date();
     case FaviconRole:
-        return FaviconManager::instance()->get(QStringLiteral("history"), url.url());
+        return FaviconManager::instance()->favicon(QStringLiteral("history"), hostKey(index.row()));
     default:
         return QVariant();
     }
@@ -141,42 +184,207 @@ void DeclarativeHistoryModel::historyAvailable(QList<Link> linkList)
     }
 }
 
+/**
+ * @brief DeclarativeHistoryModel::updateModel
+ * Rows are matched by link id. Rows that are not in the new list are removed,
+ * the others are moved to their new row and the new links are inserted, so
+ * that views only update the rows that changed. Lists have HISTORY_LIMIT rows
+ * at most, rows are looked up linearly.
+ */
 void DeclarativeHistoryModel::updateModel(QList<Link> linkList)
 {
-    int i = 0;
-    int startIndex = -1;
-    for (i = 0; i < linkList.count() && i < m_links.count(); i++) {
-        if (m_links.at(i) != linkList.at(i)) {
-            m_links[i] = linkList.at(i);
-            if (startIndex < 0) {
-                startIndex = i;
+    const int oldCount = m_links.count();
+
+    QSet<int> ids;
+    for (const Link &link : linkList) {
+        ids.insert(link.linkId());
+    }
+
+    // Remove from the bottom, contiguous rows at once.
+    for (int last = m_links.count() - 1; last >= 0; --last) {
+        if (ids.contains(m_links.at(last).linkId())) {
+            continue;
+        }
+        int first = last;
+        while (first > 0 && !ids.contains(m_links.at(first - 1).linkId())) {
+            --first;
+        }
+        beginRemoveRows(QModelIndex(), first, last);
+        m_links.erase(m_links.begin() + first, m_links.begin() + last + 1);
+        m_hostKeys.remove(first, last - first + 1);
+        endRemoveRows();
+        last = first;
+    }
+
+    for (int row = 0; row < linkList.count(); ++row) {
+        const Link &link = linkList.at(row);
+        int from = row;
+        while (from < m_links.count() && m_links.at(from).linkId() != link.linkId()) {
+            ++from;
+        }
+
+        if (from == m_links.count()) {
+            beginInsertRows(QModelIndex(), row, row);
+            m_links.insert(row, link);
+            m_hostKeys.insert(row, FaviconManager::Host());
+            endInsertRows();
+            continue;
+        }
+
+        if (from != row) {
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), row);
+            m_links.move(from, row);
+            m_hostKeys.move(from, row);
+            endMoveRows();
+        }
+
+        const Link &current = m_links.at(row);
+        QVector<int> roles;
+        if (current.url() != link.url()) {
+            roles << UrlRole << FaviconRole;
+            m_hostKeys[row] = FaviconManager::Host();
+        }
+        if (current.title() != link.title() || (roles.contains(UrlRole) && link.title().isEmpty())) {
+            roles << TitleRole;
+        }
+        if (current.date() != link.date()) {
+            roles << DateRole;
+        }
+        m_links[row] = link;
+        if (!roles.isEmpty()) {
+            emit dataChanged(index(row), index(row), roles);
+        }
+    }
+
+    if (m_links.count() != oldCount) {
+        emit countChanged();
+    }
+}
+
+void DeclarativeHistoryModel::removeRow(int index)
+{
+    beginRemoveRows(QModelIndex(), index, index);
+    m_links.removeAt(index);
+    m_hostKeys.remove(index);
+    endRemoveRows();
+    emit countChanged();
+}
+
+// Same filter as DBWorker::getHistory.
+bool DeclarativeHistoryModel::matches(const Link &link) const
+{
+    return m_searchTerm.isEmpty()
+            || likeContains(link.url(), m_searchTerm)
+            || likeContains(link.title(), m_searchTerm);
+}
+
+// Same order as DBWorker::getHistory, the latest visit first.
+bool DeclarativeHistoryModel::ranksBefore(const Link &link, const Link &other) const
+{
+    if (link.lastVisit() != other.lastVisit() || m_searchTerm.isEmpty()) {
+        return link.lastVisit() > other.lastVisit();
+    }
+    if (link.visitCount() != other.visitCount()) {
+        return link.visitCount() > other.visitCount();
+    }
+    if (link.url().length() != other.url().length()) {
+        return link.url().length() < other.url().length();
+    }
+    return link.title() < other.title();
+}
+
+/**
+ * @brief DeclarativeHistoryModel::historyEntryAdded
+ * Inserts the visited link or moves it to its place in the rows. The history
+ * is searched again only when the rows of the window cannot tell the result.
+ */
+void DeclarativeHistoryModel::historyEntryAdded(const Link &link)
+{
+    if (!m_populated) {
+        // The pending search has the visit.
+        return;
+    } else if (!m_active) {
+        m_stale = true;
+        return;
+    } else if (m_searchTerm.contains(QLatin1Char('%')) || m_searchTerm.contains(QLatin1Char('_'))) {
+        // Wildcards of LIKE.
+        search(m_searchTerm);
+        return;
+    }
+
+    int from = -1;
+    for (int i = 0; i < m_links.count(); ++i) {
+        if (m_links.at(i).linkId() == link.linkId()) {
+            from = i;
+            break;
+        }
+    }
+
+    const bool windowFull = m_links.count() >= HISTORY_LIMIT;
+    if (!matches(link)) {
+        // The title might not match anymore.
+        if (from >= 0) {
+            removeRow(from);
+            if (windowFull) {
+                search(m_searchTerm);
             }
-        } else if (startIndex >= 0) {
-            emit dataChanged(index(startIndex), index(i-1));
-            startIndex = -1;
         }
+        return;
     }
 
-    if (startIndex >= 0) {
-        emit dataChanged(index(startIndex), index(m_links.count()-1));
+    // Rows are sorted, the rows ranking before the link come first.
+    int to = 0;
+    for (int i = 0; i < m_links.count(); ++i) {
+        if (i != from && ranksBefore(m_links.at(i), link)) {
+            ++to;
+        }
     }
 
-    int difference = linkList.count() - m_links.count();
-    if (difference != 0) {
-        if (difference < 0) {
-            beginRemoveRows(QModelIndex(), linkList.count(), m_links.count()-1);
-            m_links.erase(m_links.begin()+linkList.count(), m_links.end());
-            endRemoveRows();
-        } else {
-            beginInsertRows(QModelIndex(), m_links.count(), linkList.count()-1);
-            m_links.append(linkList.mid(m_links.count()));
-            endInsertRows();
+    if (from >= 0) {
+        if (from != to) {
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), to > from ? to + 1 : to);
+            m_links.move(from, to);
+            m_hostKeys.move(from, to);
+            endMoveRows();
+        }
+
+        QVector<int> roles;
+        if (m_links.at(to).title() != link.title()) {
+            roles << TitleRole;
         }
+        if (m_links.at(to).date() != link.date()) {
+            roles << DateRole;
+        }
+        m_links[to] = link;
+        if (!roles.isEmpty()) {
+            emit dataChanged(index(to), index(to), roles);
+        }
+    } else if (!windowFull || to < m_links.count()) {
+        beginInsertRows(QModelIndex(), to, to);
+        m_links.insert(to, link);
+        m_hostKeys.insert(to, FaviconManager::Host());
+        endInsertRows();
 
+        if (m_links.count() > HISTORY_LIMIT) {
+            beginRemoveRows(QModelIndex(), HISTORY_LIMIT, m_links.count() - 1);
+            m_links.erase(m_links.begin() + HISTORY_LIMIT, m_links.end());
+            m_hostKeys.resize(HISTORY_LIMIT);
+            endRemoveRows();
+        }
         emit countChanged();
     }
 }
 
+// Sanitizing and hashing the url is done once per row, not on every favicon lookup.
+const FaviconManager::Host &DeclarativeHistoryModel::hostKey(int row) const
+{
+    FaviconManager::Host &host = m_hostKeys[row];
+    if (host.isNull()) {
+        host = FaviconManager::host(m_links.at(row).url());
+    }
+    return host;
+}
+
 void DeclarativeHistoryModel::updateTitle(const QString &url, const QString &title)
 {
     QVector<int> roles;
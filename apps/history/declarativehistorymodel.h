@@ -13,7 +13,9 @@
 
 #include <QAbstractListModel>
 #include <QQmlParserStatus>
+#include <QVector>
 
+#include "faviconmanager.h"
 #include "tab.h"
 #include "link.h"
 
@@ -23,6 +25,7 @@ class DeclarativeHistoryModel : public QAbstractListModel, public QQmlParserStat
     Q_INTERFACES(QQmlParserStatus)
 
     Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+    Q_PROPERTY(bool active READ active WRITE setActive NOTIFY activeChanged)
 public:
     DeclarativeHistoryModel(QObject *parent = 0);
 
@@ -39,6 +42,10 @@ public:
     Q_INVOKABLE void search(const QString &filter);
     Q_INVOKABLE void add(const QString &url, const QString &title);
 
+    // While inactive visits are not applied, the history is searched again once active.
+    bool active() const;
+    void setActive(bool active);
+
     // From QAbstractListModel
     int rowCount(const QModelIndex & parent = QModelIndex()) const;
     QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
@@ -51,17 +58,28 @@ public:
 signals:
     void countChanged();
     void populated();
+    void activeChanged();
 
 private slots:
     void historyAvailable(QList<Link> linkList);
     void updateTitle(const QString &url, const QString &title);
+    void historyEntryAdded(const Link &link);
 
 private:
     void updateModel(QList<Link> linkList);
+    void removeRow(int index);
+    bool matches(const Link &link) const;
+    bool ranksBefore(const Link &link, const Link &other) const;
+    const FaviconManager::Host &hostKey(int row) const;
 
     QList<Link> m_links;
+    // Favicon lookup keys parallel to m_links, resolved when first needed.
+    mutable QVector<FaviconManager::Host> m_hostKeys;
     QString m_searchTerm;
     bool m_populated;
+    bool m_active;
+    // Visits were added while inactive.
+    bool m_stale;
 
     friend class tst_declarativehistorymodel;
     friend class tst_webview;
@@ -11,14 +11,17 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this file,
  * You can obtain one at http://mozilla.org/MPL/2.0/. */
 
-#include <QFile>
 #include <QDebug>
+#include <QDir>
 #include <QStringList>
 #include <QUrl>
 
 #include "declarativewebcontainer.h"
 #include "declarativewebpage.h"
 #include "declarativetabmodel.h"
+#include "link.h"
+#include "tabthumbnailprovider.h"
+#include "thumbnailcache.h"
 
 #ifndef DEBUG_LOGS
 #define DEBUG_LOGS 0
@@ -31,6 +34,7 @@ DeclarativeTabModel::DeclarativeTabModel(int nextTabId, DeclarativeWebContainer
     , m_waitingForNewTab(false)
     , m_nextTabId(nextTabId)
     , m_webContainer(webContainer)
+    , m_indexesDirty(true)
 {
 }
 
@@ -42,6 +46,7 @@ QHash<int, QByteArray> DeclarativeTabModel::roleNames() const
 {
     QHash<int, QByteArray> roles;
     roles[ThumbPathRole] = "thumbnailPath";
+    roles[ThumbnailSourceRole] = "thumbnailSource";
     roles[TitleRole] = "title";
     roles[UrlRole] = "url";
     roles[ActiveRole] = "activeTab";
@@ -51,6 +56,12 @@ QHash<int, QByteArray> DeclarativeTabModel::roleNames() const
 }
 
 void DeclarativeTabModel::addTab(const QString& url, const QString &title, int index) {
+    // New tabs are placed after all restored tabs.
+    bool appending = index == m_tabs.count();
+    fetchAll();
+    if (appending) {
+        index = m_tabs.count();
+    }
     Q_ASSERT(index >= 0 && index <= m_tabs.count());
 
     const Tab tab(m_nextTabId, url, title, "");
@@ -61,6 +72,7 @@ void DeclarativeTabModel::addTab(const QString& url, const QString &title, int i
 #endif
     beginInsertRows(QModelIndex(), index, index);
     m_tabs.insert(index, tab);
+    invalidateIndexes();
     endInsertRows();
     // We should trigger this only when
     // tab is added through new window request. In all other
@@ -98,7 +110,7 @@ void DeclarativeTabModel::removeTabById(int tabId, bool activeTab)
     if (activeTab) {
         closeActiveTab();
     } else {
-        int index = findTabIndex(tabId);
+        int index = fetchTabIndex(tabId);
         if (index >= 0) {
             remove(index);
         }
@@ -110,11 +122,88 @@ void DeclarativeTabModel::clear()
     if (count() == 0)
         return;
 
-    for (int i = m_tabs.count() - 1; i >= 0; --i) {
-        removeTab(m_tabs.at(i).tabId(), m_tabs.at(i).thumbnailPath(), i);
+    closeTabs([](const Tab &) { return true; });
+    setWaitingForNewTab(true);
+}
+
+/**
+ * @brief DeclarativeTabModel::closeOtherTabs
+ * Closes all tabs except the active one.
+ */
+void DeclarativeTabModel::closeOtherTabs()
+{
+    const int activeTabId = m_activeTabId;
+    closeTabs([activeTabId](const Tab &tab) { return tab.tabId() != activeTabId; });
+}
+
+/**
+ * @brief DeclarativeTabModel::closeTabs
+ * Closes all tabs matching the predicate with a single model reset and a single
+ * storage update. Thumbnail files are removed in a worker thread. When the active
+ * tab is closed, the closest remaining tab before it gets activated.
+ * @return number of closed tabs
+ */
+int DeclarativeTabModel::closeTabs(const std::function<bool (const Tab &tab)> &predicate)
+{
+    fetchAll();
+
+    QList<Tab> remainingTabs;
+    QList<int> closedTabIds;
+    QStringList thumbnails;
+    int newActiveIndex = -1;
+    bool removingActiveTab = false;
+
+    for (const Tab &tab : m_tabs) {
+        if (predicate(tab)) {
+            closedTabIds.append(tab.tabId());
+            if (!tab.thumbnailPath().isEmpty()) {
+                thumbnails.append(tab.thumbnailPath());
+            }
+            if (tab.tabId() == m_activeTabId) {
+                removingActiveTab = true;
+                newActiveIndex = remainingTabs.count() - 1;
+            }
+        } else {
+            remainingTabs.append(tab);
+        }
+    }
+
+    if (closedTabIds.isEmpty()) {
+        return 0;
     }
 
-    setWaitingForNewTab(true);
+#if DEBUG_LOGS
+    qDebug() << "closing tabs:" << closedTabIds;
+#endif
+
+    removeTabs(closedTabIds);
+    ThumbnailCache::instance()->remove(closedTabIds, thumbnails);
+    for (int tabId : closedTabIds) {
+        m_thumbnailGenerations.remove(tabId);
+    }
+    TabThumbnailProvider::releaseThumbnails(closedTabIds);
+
+    beginResetModel();
+    m_tabs = remainingTabs;
+    invalidateIndexes();
+    if (removingActiveTab) {
+        m_activeTabId = 0;
+    }
+    endResetModel();
+
+    emit countChanged();
+    for (int tabId : closedTabIds) {
+        emit tabClosed(tabId);
+    }
+
+    if (removingActiveTab) {
+        activateTab(newActiveIndex);
+    } else {
+        // Index of the active tab may have moved.
+        emit activeTabIndexChanged();
+    }
+
+    return closedTabIds.count();
 }
 
 bool DeclarativeTabModel::activateTab(const QString& url)
@@ -124,28 +213,41 @@ bool DeclarativeTabModel::activateTab(const QString& url)
         return false;
     }
 
-    QUrl inputUrl(url);
-    if (!inputUrl.hasFragment() && !inputUrl.hasQuery() && inputUrl.path().endsWith(QLatin1Char('/'))) {
-        QString inputUrlStr = url;
-        inputUrlStr.chop(1);
-        inputUrl.setUrl(inputUrlStr);
+    int tabId = tabIdForUrl(url);
+    if (tabId > 0) {
+        activateTab(findTabIndex(tabId));
+        return true;
     }
+    return false;
+}
 
-    for (int i = 0; i < m_tabs.size(); i++) {
-        QString tabUrlStr = m_tabs.at(i).url();
-        QUrl tabUrl(tabUrlStr);
-        // Always chop trailing slash if no fragment or query exists as QUrl::StripTrailingSlash
-        // doesn't remove trailing slash if path is "/" e.i. http://www.sailfishos.org vs http://www.sailfishos.org/
-        if (!tabUrl.hasFragment() && !tabUrl.hasQuery() && tabUrl.path().endsWith(QLatin1Char('/'))) {
-            tabUrlStr.chop(1);
-            tabUrl.setUrl(tabUrlStr);
-        }
-        if (tabUrl.matches(inputUrl, QUrl::FullyDecoded)) {
-            activateTab(i);
-            return true;
+/**
+ * @brief DeclarativeTabModel::tabIdForUrl
+ * Looks up a tab by its canonical url. If several tabs share the url,
+ * the one closest to the beginning of the model is returned.
+ * @return tab id or zero if no tab has the url
+ */
+int DeclarativeTabModel::tabIdForUrl(const QString &url)
+{
+    const QString key = Link::canonicalUrl(url);
+    if (key.isEmpty()) {
+        return 0;
+    }
+
+    fetchAll();
+    ensureIndexes();
+
+    int tabId = 0;
+    int row = m_tabs.count();
+    QMultiHash<QString, int>::const_iterator it = m_urlIndex.constFind(key);
+    for (; it != m_urlIndex.constEnd() && it.key() == key; ++it) {
+        int candidateRow = m_tabRows.value(it.value(), -1);
+        if (candidateRow >= 0 && candidateRow < row) {
+            row = candidateRow;
+            tabId = it.value();
         }
     }
-    return false;
+    return tabId;
 }
 
 void DeclarativeTabModel::activateTab(int index)
@@ -164,7 +266,7 @@ void DeclarativeTabModel::activateTab(int index)
 
 bool DeclarativeTabModel::activateTabById(int tabId)
 {
-    int index = findTabIndex(tabId);
+    int index = fetchTabIndex(tabId);
     if (index >= 0) {
         activateTab(index);
         return true;
@@ -207,7 +309,7 @@ int DeclarativeTabModel::newTab(const QString &url, int parentId)
 
 QString DeclarativeTabModel::url(int tabId) const
 {
-    int index = findTabIndex(tabId);
+    int index = fetchTabIndex(tabId);
     if (index >= 0) {
         return m_tabs.at(index).url();
     }
@@ -233,7 +335,7 @@ int DeclarativeTabModel::activeTabId() const
 
 int DeclarativeTabModel::count() const
 {
-    return m_tabs.count();
+    return m_tabs.count() + pendingCount();
 }
 
 int DeclarativeTabModel::rowCount(const QModelIndex & parent) const {
@@ -258,6 +360,8 @@ QVariant DeclarativeTabModel::data(const QModelIndex & index, int role) const {
         return tab.tabId();
     } else if (role == DesktopModeRole) {
         return tab.desktopMode();
+    } else if (role == ThumbnailSourceRole) {
+        return thumbnailSource(tab);
     }
     return QVariant();
 }
@@ -301,12 +405,12 @@ const Tab &DeclarativeTabModel::activeTab() const
 
 bool DeclarativeTabModel::contains(int tabId) const
 {
-    return findTabIndex(tabId) >= 0;
+    return fetchTabIndex(tabId) >= 0;
 }
 
 void DeclarativeTabModel::updateUrl(int tabId, const QString &url, bool initialLoad)
 {
-    int tabIndex = findTabIndex(tabId);
+    int tabIndex = fetchTabIndex(tabId);
     bool isActiveTab = m_activeTabId == tabId;
     bool updateDb = false;
     if (tabIndex >= 0 && (m_tabs.at(tabIndex).url() != url || isActiveTab)) {
@@ -314,6 +418,18 @@ void DeclarativeTabModel::updateUrl(int tabId, const QString &url, bool initialL
         roles << UrlRole;
         m_tabs[tabIndex].setUrl(url);
 
+        if (!m_indexesDirty) {
+            const QString key = Link::canonicalUrl(url);
+            QPair<QString, QString> &cached = m_urlKeys[tabId];
+            if (cached.second != key) {
+                m_urlIndex.remove(cached.second, tabId);
+                if (!key.isEmpty()) {
+                    m_urlIndex.insert(key, tabId);
+                }
+            }
+            cached = qMakePair(url, key);
+        }
+
         if (!initialLoad) {
             updateDb = true;
         }
@@ -332,10 +448,9 @@ void DeclarativeTabModel::removeTab(int tabId, const QString &thumbnail, int ind
     qDebug() << "index:" << index << tabId;
 #endif
     removeTab(tabId);
-    QFile f(thumbnail);
-    if (f.exists()) {
-        f.remove();
-    }
+    ThumbnailCache::instance()->remove(QList<int>() << tabId, QStringList() << thumbnail);
+    m_thumbnailGenerations.remove(tabId);
+    TabThumbnailProvider::releaseThumbnails(QList<int>() << tabId);
 
     if (index >= 0) {
         if (activeTabIndex() == index) {
@@ -343,6 +458,7 @@ void DeclarativeTabModel::removeTab(int tabId, const QString &thumbnail, int ind
         }
         beginRemoveRows(QModelIndex(), index, index);
         m_tabs.removeAt(index);
+        invalidateIndexes();
         endRemoveRows();
     }
 
@@ -352,12 +468,93 @@ void DeclarativeTabModel::removeTab(int tabId, const QString &thumbnail, int ind
 
 int DeclarativeTabModel::findTabIndex(int tabId) const
 {
-    for (int i = 0; i < m_tabs.size(); i++) {
-        if (m_tabs.at(i).tabId() == tabId) {
-            return i;
+    ensureIndexes();
+    int index = m_tabRows.value(tabId, -1);
+    if (index >= 0 && (index >= m_tabs.count() || m_tabs.at(index).tabId() != tabId)) {
+        // Rows were changed without invalidating the indexes.
+        m_indexesDirty = true;
+        ensureIndexes();
+        index = m_tabRows.value(tabId, -1);
+    }
+    return index;
+}
+
+/**
+ * @brief DeclarativeTabModel::fetchTabIndex
+ * Like findTabIndex but inserts the rows not yet populated when the tab is
+ * not found, tabs of a session being restored are not reported missing.
+ */
+int DeclarativeTabModel::fetchTabIndex(int tabId) const
+{
+    int index = findTabIndex(tabId);
+    if (index < 0 && pendingCount() > 0) {
+        const_cast<DeclarativeTabModel *>(this)->fetchAll();
+        index = findTabIndex(tabId);
+    }
+    return index;
+}
+
+int DeclarativeTabModel::pendingCount() const
+{
+    return 0;
+}
+
+/**
+ * @brief DeclarativeTabModel::invalidateIndexes
+ * Must be called whenever rows of m_tabs are inserted, removed or replaced.
+ */
+void DeclarativeTabModel::invalidateIndexes()
+{
+    m_indexesDirty = true;
+}
+
+void DeclarativeTabModel::ensureIndexes() const
+{
+    if (!m_indexesDirty && m_tabRows.count() == m_tabs.count()) {
+        return;
+    }
+
+    QHash<int, QPair<QString, QString> > urlKeys;
+    urlKeys.reserve(m_tabs.count());
+    m_tabRows.clear();
+    m_tabRows.reserve(m_tabs.count());
+    m_urlIndex.clear();
+    m_urlIndex.reserve(m_tabs.count());
+
+    for (int i = 0; i < m_tabs.count(); ++i) {
+        const Tab &tab = m_tabs.at(i);
+        QPair<QString, QString> cached = m_urlKeys.value(tab.tabId());
+        if (cached.second.isNull() || cached.first != tab.url()) {
+            cached = qMakePair(tab.url(), Link::canonicalUrl(tab.url()));
+        }
+        urlKeys.insert(tab.tabId(), cached);
+        m_tabRows.insert(tab.tabId(), i);
+        if (!cached.second.isEmpty()) {
+            m_urlIndex.insert(cached.second, tab.tabId());
         }
     }
-    return -1;
+
+    m_urlKeys = urlKeys;
+    m_indexesDirty = false;
+}
+
+/**
+ * @brief DeclarativeTabModel::thumbnailSource
+ * Thumbnail files are served decoded by the tab thumbnail image provider,
+ * which reads the path from the source. Data urls of private tabs are used
+ * as such.
+ */
+QString DeclarativeTabModel::thumbnailSource(const Tab &tab) const
+{
+    QString path = tab.thumbnailPath();
+    if (!QDir::isAbsolutePath(path)) {
+        return path;
+    }
+
+    return QStringLiteral("image://%1/%2/%3%4").arg(QStringLiteral(TAB_THUMBNAIL_PROVIDER),
+                                                   QString::number(tab.tabId()),
+                                                   QString::number(m_thumbnailGenerations.value(tab.tabId())),
+                                                   QDir::cleanPath(path));
 }
 
 void DeclarativeTabModel::updateActiveTab(const Tab &activeTab)
@@ -372,6 +569,7 @@ void DeclarativeTabModel::updateActiveTab(const Tab &activeTab)
     if (m_activeTabId != activeTab.tabId()) {
         int oldTabId = m_activeTabId;
         m_activeTabId = activeTab.tabId();
+        ThumbnailCache::instance()->touch(m_activeTabId);
 
         // If tab has changed, update active tab role.
         int tabIndex = activeTabIndex();
@@ -394,6 +592,17 @@ void DeclarativeTabModel::updateActiveTab(const Tab &activeTab)
     }
 }
 
+/**
+ * @brief DeclarativeTabModel::fetchAll
+ * Inserts all rows that a model populating in chunks has not inserted yet.
+ */
+void DeclarativeTabModel::fetchAll()
+{
+    while (canFetchMore(QModelIndex())) {
+        fetchMore(QModelIndex());
+    }
+}
+
 void DeclarativeTabModel::setWebContainer(DeclarativeWebContainer *webContainer)
 {
     m_webContainer = webContainer;
@@ -415,21 +624,17 @@ void DeclarativeTabModel::updateThumbnailPath(int tabId, const QString &path)
     if (tabId <= 0)
         return;
 
-    QVector<int> roles;
-    roles << ThumbPathRole;
-    for (int i = 0; i < m_tabs.count(); i++) {
-        if (m_tabs.at(i).tabId() == tabId) {
+    int i = fetchTabIndex(tabId);
+    if (i >= 0) {
 #if DEBUG_LOGS
-            qDebug() << "model tab thumbnail updated: " << path << i << tabId;
+        qDebug() << "model tab thumbnail updated: " << path << i << tabId;
 #endif
-            QModelIndex start = index(i, 0);
-            QModelIndex end = index(i, 0);
-            m_tabs[i].setThumbnailPath("");
-            emit dataChanged(start, end, roles);
-            m_tabs[i].setThumbnailPath(path);
-            emit dataChanged(start, end, roles);
-            updateThumbPath(tabId, path);
-        }
+        // New generation changes the thumbnail source and makes the view reload it.
+        ++m_thumbnailGenerations[tabId];
+        m_tabs[i].setThumbnailPath(path);
+        QModelIndex modelIndex = index(i, 0);
+        emit dataChanged(modelIndex, modelIndex, QVector<int>() << ThumbPathRole << ThumbnailSourceRole);
+        updateThumbPath(tabId, path);
     }
 }
 
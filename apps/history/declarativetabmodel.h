@@ -13,8 +13,11 @@
 #define DECLARATIVETABMODEL_H
 
 #include <QAbstractListModel>
+#include <QHash>
+#include <QPair>
 #include <QPointer>
 #include <QScopedPointer>
+#include <functional>
 
 #include "tab.h"
 
@@ -40,12 +43,15 @@ public:
         UrlRole,
         ActiveRole,
         TabIdRole,
-        DesktopModeRole
+        DesktopModeRole,
+        ThumbnailSourceRole
     };
 
     Q_INVOKABLE void remove(int index);
     Q_INVOKABLE void clear();
+    Q_INVOKABLE void closeOtherTabs();
     Q_INVOKABLE bool activateTab(const QString &url);
+    Q_INVOKABLE int tabIdForUrl(const QString &url);
     Q_INVOKABLE void activateTab(int index);
     Q_INVOKABLE void closeActiveTab();
     Q_INVOKABLE int newTab(const QString &url, int parentId = 0);
@@ -58,6 +64,7 @@ public:
     int count() const;
     bool activateTabById(int tabId);
     void removeTabById(int tabId, bool activeTab);
+    int closeTabs(const std::function<bool (const Tab &tab)> &predicate);
 
     // From QAbstractListModel
     int rowCount(const QModelIndex & parent = QModelIndex()) const;
@@ -97,16 +104,22 @@ protected:
     void addTab(const QString &url, const QString &title, int index);
     void removeTab(int tabId, const QString &thumbnail, int index);
     int findTabIndex(int tabId) const;
+    int fetchTabIndex(int tabId) const;
     void updateActiveTab(const Tab &activeTab);
     void updateUrl(int tabId, const QString &url, bool initialLoad);
 
     virtual void createTab(const Tab &tab) = 0;
     virtual void updateTitle(int tabId, const QString &url, const QString &title) = 0;
     virtual void removeTab(int tabId) = 0;
+    virtual void removeTabs(const QList<int> &tabIds) = 0;
     virtual void navigateTo(int tabId, const QString &url, const QString &title, const QString &path) = 0;
     virtual void updateThumbPath(int tabId, const QString &path) = 0;
 
     int nextActiveTabIndex(int index);
+    void fetchAll();
+    // Number of tabs not yet inserted to the model, included in count().
+    virtual int pendingCount() const;
+    void invalidateIndexes();
 
     // Used from the tab model unit tests only.
     void setWebContainer(DeclarativeWebContainer *webContainer);
@@ -120,6 +133,21 @@ protected:
 
     QPointer<DeclarativeWebContainer> m_webContainer;
 
+private:
+    void ensureIndexes() const;
+    QString thumbnailSource(const Tab &tab) const;
+
+    // Lookup indexes over m_tabs, rebuilt lazily after rows have moved.
+    // Canonical url keys are cached per tab and only recomputed when the url changes.
+    mutable QHash<int, int> m_tabRows;
+    mutable QHash<int, QPair<QString, QString> > m_urlKeys;
+    mutable QMultiHash<QString, int> m_urlIndex;
+    mutable bool m_indexesDirty;
+
+    // Bumped whenever a thumbnail is written so that its image source changes.
+    // Closed tabs release their decoded thumbnails, so reused ids start over.
+    QHash<int, int> m_thumbnailGenerations;
+
     friend class tst_declarativehistorymodel;
     friend class tst_declarativetabmodel;
     friend class tst_webview;
@@ -8,6 +8,7 @@ SOURCES += \
     $$PWD/declarativetabmodel.cpp \
     $$PWD/persistenttabmodel.cpp \
     $$PWD/privatetabmodel.cpp \
+    $$PWD/tabfiltermodel.cpp \
     $$PWD/declarativehistorymodel.cpp
 
 # C++ headers
@@ -15,4 +16,5 @@ HEADERS += \
     $$PWD/declarativetabmodel.h \
     $$PWD/persistenttabmodel.h \
     $$PWD/privatetabmodel.h \
+    $$PWD/tabfiltermodel.h \
     $$PWD/declarativehistorymodel.h
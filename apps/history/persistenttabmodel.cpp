@@ -13,12 +13,20 @@
 #include "declarativewebcontainer.h"
 #include "persistenttabmodel.h"
 #include "dbmanager.h"
+#include "thumbnailcache.h"
+
+#include <QTimer>
+
+// Number of restored tabs inserted to the model per event loop iteration.
+static const int gTabChunkSize = 50;
 
 PersistentTabModel::PersistentTabModel(int nextTabId, DeclarativeWebContainer *webContainer)
     : DeclarativeTabModel(nextTabId, webContainer)
 {
     connect(DBManager::instance(), &DBManager::tabsAvailable,
             this, &PersistentTabModel::tabsAvailable);
+    connect(ThumbnailCache::instance(), &ThumbnailCache::evicted,
+            this, &PersistentTabModel::thumbnailEvicted);
 
     DBManager::instance()->getAllTabs();
 }
@@ -29,19 +37,34 @@ PersistentTabModel::~PersistentTabModel()
 
 void PersistentTabModel::tabsAvailable(const QList<Tab> &tabs)
 {
-    beginResetModel();
     int oldCount = count();
 
     // Clear always previous tabs
     clear();
+    m_pendingTabs.clear();
+    ThumbnailCache::instance()->restore(tabs);
+
+    beginResetModel();
 
     if (tabs.count() > 0) {
-        m_tabs = tabs;
         QString activeTabId = DBManager::instance()->getSetting("activeTabId");
         bool ok = false;
         int tabId = activeTabId.toInt(&ok);
-        int index = findTabIndex(tabId);
-        if (index >= 0) {
+        int activeIndex = -1;
+        for (int i = 0; i < tabs.count() && activeIndex < 0; ++i) {
+            if (tabs.at(i).tabId() == tabId) {
+                activeIndex = i;
+            }
+        }
+
+        // Large sessions are populated in chunks. The first chunk always
+        // contains the active tab so that it can be loaded right away.
+        int firstChunk = qMax(gTabChunkSize, activeIndex + 1);
+        m_tabs = tabs.mid(0, firstChunk);
+        m_pendingTabs = tabs.mid(firstChunk);
+        invalidateIndexes();
+
+        if (activeIndex >= 0) {
             m_activeTabId = tabId;
         } else {
             // Fallback for browser update as this "activeTabId" is a new setting.
@@ -75,6 +98,43 @@ void PersistentTabModel::tabsAvailable(const QList<Tab> &tabs)
 
     connect(this, &PersistentTabModel::activeTabIndexChanged,
             this, &PersistentTabModel::saveActiveTab, Qt::UniqueConnection);
+
+    if (!m_pendingTabs.isEmpty()) {
+        QTimer::singleShot(0, this, &PersistentTabModel::populate);
+    }
+}
+
+bool PersistentTabModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !m_pendingTabs.isEmpty();
+}
+
+void PersistentTabModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+
+    int chunk = qMin(gTabChunkSize, m_pendingTabs.count());
+    int first = m_tabs.count();
+    beginInsertRows(QModelIndex(), first, first + chunk - 1);
+    m_tabs.append(m_pendingTabs.mid(0, chunk));
+    m_pendingTabs.erase(m_pendingTabs.begin(), m_pendingTabs.begin() + chunk);
+    invalidateIndexes();
+    endInsertRows();
+}
+
+int PersistentTabModel::pendingCount() const
+{
+    return m_pendingTabs.count();
+}
+
+void PersistentTabModel::populate()
+{
+    fetchMore(QModelIndex());
+    if (canFetchMore(QModelIndex())) {
+        QTimer::singleShot(0, this, &PersistentTabModel::populate);
+    }
 }
 
 void PersistentTabModel::createTab(const Tab &tab) {
@@ -91,6 +151,11 @@ void PersistentTabModel::removeTab(int tabId)
     DBManager::instance()->removeTab(tabId);
 }
 
+void PersistentTabModel::removeTabs(const QList<int> &tabIds)
+{
+    DBManager::instance()->removeTabs(tabIds);
+}
+
 void PersistentTabModel::navigateTo(int tabId, const QString &url, const QString &title, const QString &path) {
     Q_UNUSED(title)
     Q_UNUSED(path)
@@ -101,6 +166,26 @@ void PersistentTabModel::navigateTo(int tabId, const QString &url, const QString
 void PersistentTabModel::updateThumbPath(int tabId, const QString &path)
 {
     DBManager::instance()->updateThumbPath(tabId, path);
+    if (!path.isEmpty()) {
+        ThumbnailCache::instance()->insert(tabId, path);
+    }
+}
+
+void PersistentTabModel::thumbnailEvicted(int tabId)
+{
+    // Evictions do not populate the rest of the session.
+    if (findTabIndex(tabId) >= 0) {
+        updateThumbnailPath(tabId, QString());
+        return;
+    }
+
+    for (Tab &tab : m_pendingTabs) {
+        if (tab.tabId() == tabId) {
+            tab.setThumbnailPath(QString());
+            DBManager::instance()->updateThumbPath(tabId, QString());
+            return;
+        }
+    }
 }
 
 void PersistentTabModel::saveActiveTab() const
@@ -24,16 +24,29 @@ protected:
     virtual void createTab(const Tab &tab);
     virtual void updateTitle(int tabId, const QString &url, const QString &title);
     virtual void removeTab(int tabId);
+    virtual void removeTabs(const QList<int> &tabIds);
     virtual void navigateTo(int tabId, const QString &url, const QString &title, const QString &path);
     virtual void updateThumbPath(int tabId, const QString &path);
 
 private slots:
     void saveActiveTab() const;
     void tabsAvailable(const QList<Tab> &tabs);
+    void thumbnailEvicted(int tabId);
+    void populate();
 
 public:
     PersistentTabModel(int nextTabId, DeclarativeWebContainer *webContainer = 0);
     ~PersistentTabModel();
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+protected:
+    int pendingCount() const override;
+
+private:
+    // Restored tabs not yet inserted to the model.
+    QList<Tab> m_pendingTabs;
 };
 
 #endif // PERSISTENTTABMODEL_H
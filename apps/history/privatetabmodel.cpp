@@ -43,6 +43,11 @@ void PrivateTabModel::removeTab(int tabId)
     Q_UNUSED(tabId)
 }
 
+void PrivateTabModel::removeTabs(const QList<int> &tabIds)
+{
+    Q_UNUSED(tabIds)
+}
+
 void PrivateTabModel::navigateTo(int tabId, const QString &url, const QString &title, const QString &path) {
     Q_UNUSED(tabId)
     Q_UNUSED(url)
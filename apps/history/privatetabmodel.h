@@ -24,6 +24,7 @@ protected:
     virtual void createTab(const Tab &tab);
     virtual void updateTitle(int tabId, const QString &url, const QString &title);
     virtual void removeTab(int tabId);
+    virtual void removeTabs(const QList<int> &tabIds);
     virtual void navigateTo(int tabId, const QString &url, const QString &title, const QString &path);
     virtual void updateThumbPath(int tabId, const QString &path);
 
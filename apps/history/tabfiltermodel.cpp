@@ -0,0 +1,179 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "tabfiltermodel.h"
+#include "declarativetabmodel.h"
+
+#include <algorithm>
+
+TabFilterModel::TabFilterModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , m_indexValid(false)
+{
+}
+
+int TabFilterModel::getIndex(int currentIndex)
+{
+    QModelIndex proxyIndex = index(currentIndex, 0);
+    QModelIndex sourceIndex = mapToSource(proxyIndex);
+    return sourceIndex.row();
+}
+
+bool TabFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    Q_UNUSED(sourceParent)
+
+    if (m_search.isEmpty()) {
+        return true;
+    }
+
+    if (!m_indexValid) {
+        buildIndex();
+    }
+
+    return sourceRow >= 0 && sourceRow < m_accepted.count() && m_accepted.at(sourceRow);
+}
+
+void TabFilterModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    if (this->sourceModel()) {
+        disconnect(this->sourceModel(), 0, this, 0);
+    }
+
+    if (sourceModel) {
+        // Connected before the proxy model's own connections so that
+        // the index is up to date when rows get filtered.
+        connect(sourceModel, &QAbstractItemModel::rowsInserted, this, &TabFilterModel::insertIndex);
+        connect(sourceModel, &QAbstractItemModel::rowsRemoved, this, &TabFilterModel::invalidateIndex);
+        connect(sourceModel, &QAbstractItemModel::rowsMoved, this, &TabFilterModel::invalidateIndex);
+        connect(sourceModel, &QAbstractItemModel::modelReset, this, &TabFilterModel::invalidateIndex);
+        connect(sourceModel, &QAbstractItemModel::layoutChanged, this, &TabFilterModel::invalidateIndex);
+        connect(sourceModel, &QAbstractItemModel::dataChanged, this, &TabFilterModel::updateIndex);
+    }
+
+    m_indexValid = false;
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+}
+
+QString TabFilterModel::search() const
+{
+    return m_search;
+}
+
+void TabFilterModel::setSearch(const QString &search)
+{
+    if (m_search == search)
+        return;
+
+    QString previousFoldedSearch = m_foldedSearch;
+    m_search = search;
+
+    if (m_indexValid) {
+        // Rows matching a longer query are a subset of the rows matching
+        // any query it contains, thus only those need to be checked again.
+        QString foldedSearch = m_search.trimmed().toCaseFolded();
+        bool refine = !previousFoldedSearch.isEmpty() && foldedSearch.contains(previousFoldedSearch);
+        m_foldedSearch = foldedSearch;
+        updateMatches(refine);
+    }
+
+    invalidateFilter();
+    emit searchChanged(m_search);
+}
+
+void TabFilterModel::invalidateIndex()
+{
+    m_indexValid = false;
+}
+
+// Rows appended while a session is populated extend the index, other inserts rebuild it.
+void TabFilterModel::insertIndex(const QModelIndex &parent, int first, int last)
+{
+    if (!m_indexValid || parent.isValid() || first != m_index.count()) {
+        m_indexValid = false;
+        return;
+    }
+
+    for (int row = first; row <= last; ++row) {
+        m_index.append(indexText(row));
+        bool accepted = m_index.at(row).contains(m_foldedSearch);
+        m_accepted.append(accepted);
+        if (accepted) {
+            m_matchingRows.append(row);
+        }
+    }
+}
+
+void TabFilterModel::updateIndex(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (!m_indexValid) {
+        return;
+    }
+
+    for (int row = topLeft.row(); row <= bottomRight.row() && row < m_index.count(); ++row) {
+        m_index[row] = indexText(row);
+        bool accepted = m_index.at(row).contains(m_foldedSearch);
+        if (accepted != m_accepted.at(row)) {
+            // Keep the refinement list consistent with the changed row.
+            m_accepted[row] = accepted;
+            QVector<int>::iterator it = std::lower_bound(m_matchingRows.begin(), m_matchingRows.end(), row);
+            if (accepted) {
+                m_matchingRows.insert(it, row);
+            } else {
+                m_matchingRows.erase(it);
+            }
+        }
+    }
+}
+
+QString TabFilterModel::indexText(int sourceRow) const
+{
+    QModelIndex index = sourceModel()->index(sourceRow, 0);
+    QString title = sourceModel()->data(index, DeclarativeTabModel::TitleRole).toString();
+    QString url = sourceModel()->data(index, DeclarativeTabModel::UrlRole).toString();
+    return (title + QLatin1Char(' ') + url).toCaseFolded();
+}
+
+void TabFilterModel::buildIndex() const
+{
+    int count = sourceModel() ? sourceModel()->rowCount() : 0;
+    m_index.resize(count);
+    for (int row = 0; row < count; ++row) {
+        m_index[row] = indexText(row);
+    }
+
+    m_foldedSearch = m_search.trimmed().toCaseFolded();
+    m_indexValid = true;
+    updateMatches(false);
+}
+
+void TabFilterModel::updateMatches(bool refine) const
+{
+    QVector<int> matchingRows;
+    if (refine) {
+        for (int row : m_matchingRows) {
+            if (m_index.at(row).contains(m_foldedSearch)) {
+                matchingRows.append(row);
+            }
+        }
+    } else {
+        for (int row = 0; row < m_index.count(); ++row) {
+            if (m_index.at(row).contains(m_foldedSearch)) {
+                matchingRows.append(row);
+            }
+        }
+    }
+
+    m_accepted.fill(false, m_index.count());
+    for (int row : matchingRows) {
+        m_accepted[row] = true;
+    }
+    m_matchingRows = matchingRows;
+}
@@ -0,0 +1,56 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef TABFILTERMODEL_H
+#define TABFILTERMODEL_H
+
+#include <QSortFilterProxyModel>
+#include <QVector>
+
+class TabFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString search READ search WRITE setSearch NOTIFY searchChanged)
+public:
+    TabFilterModel(QObject *parent = nullptr);
+
+    Q_INVOKABLE int getIndex(int currentIndex);
+
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+    void setSourceModel(QAbstractItemModel *sourceModel) override;
+
+    QString search() const;
+    void setSearch(const QString &search);
+
+signals:
+    void searchChanged(QString search);
+
+private slots:
+    void invalidateIndex();
+    void insertIndex(const QModelIndex &parent, int first, int last);
+    void updateIndex(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
+private:
+    QString indexText(int sourceRow) const;
+    void buildIndex() const;
+    void updateMatches(bool refine) const;
+
+    QString m_search;
+    // Case folded search term the current matches were computed for.
+    mutable QString m_foldedSearch;
+    // Case folded "title url" of each source row.
+    mutable QVector<QString> m_index;
+    // Source rows matching m_foldedSearch, in ascending order.
+    mutable QVector<int> m_matchingRows;
+    mutable QVector<bool> m_accepted;
+    mutable bool m_indexValid;
+};
+
+#endif // TABFILTERMODEL_H
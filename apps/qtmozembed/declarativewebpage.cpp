@@ -13,10 +13,14 @@
 #include "browserapp.h"
 #include "browserpaths.h"
 #include "logging.h"
+#include "thumbnailservice.h"
 
 #include <webenginesettings.h>
 #include <qmozwindow.h>
+#include <QBuffer>
+#include <QFutureWatcher>
 #include <QGuiApplication>
+#include <QMetaMethod>
 #include <QtConcurrent>
 #include <qmozsecurity.h>
 
@@ -29,26 +33,6 @@
 #define FIND_MESSAGE "embed:find"
 #define OPEN_LINK "embed:OpenLink"
 
-bool isBlack(QRgb rgb)
-{
-    return qRed(rgb) == 0 && qGreen(rgb) == 0 && qBlue(rgb) == 0;
-}
-
-bool allBlack(const QImage &image)
-{
-    int h = image.height();
-    int w = image.width();
-
-    for (int j = 0; j < h; ++j) {
-        const QRgb *b = (const QRgb *)image.constScanLine(j);
-        for (int i = 0; i < w; ++i) {
-            if (!isBlack(b[i]))
-                return false;
-        }
-    }
-    return true;
-}
-
 DeclarativeWebPage::DeclarativeWebPage(QObject *parent)
     : QOpenGLWebPage(parent)
     , m_container(0)
@@ -56,7 +40,9 @@ DeclarativeWebPage::DeclarativeWebPage(QObject *parent)
     , m_fullscreen(false)
     , m_forcedChrome(false)
     , m_domContentLoaded(false)
+    , m_mediaActive(false)
     , m_initialLoadHasHappened(false)
+    , m_tabHistoryRequested(false)
     , m_tabHistoryReady(false)
     , m_urlReady(false)
     , m_restoredCurrentLinkId(-1)
@@ -82,7 +68,6 @@ DeclarativeWebPage::DeclarativeWebPage(QObject *parent)
 
     connect(this, &DeclarativeWebPage::recvAsyncMessage,
             this, &DeclarativeWebPage::onRecvAsyncMessage);
-    connect(&m_grabWritter, &QFutureWatcher<QString>::finished, this, &DeclarativeWebPage::grabWritten);
     connect(this, &DeclarativeWebPage::urlChanged, this, &DeclarativeWebPage::onUrlChanged);
     connect(this, &QOpenGLWebPage::virtualKeyboardHeightChanged, this, &DeclarativeWebPage::updateViewMargins);
     connect(this, &QOpenGLWebPage::loadedChanged, [this]() {
@@ -101,13 +86,17 @@ DeclarativeWebPage::DeclarativeWebPage(QObject *parent)
             setChrome(true);
         }
     });
+
+    connect(this, &QOpenGLWebPage::urlChanged, this, &DeclarativeWebPage::markContentChanged);
+    connect(this, &QOpenGLWebPage::loadingChanged, this, &DeclarativeWebPage::markContentChanged);
+    connect(this, &QOpenGLWebPage::loadedChanged, this, &DeclarativeWebPage::markContentChanged);
+    connect(this, &QOpenGLWebPage::scrollableOffsetChanged, this, &DeclarativeWebPage::markContentChanged);
+    connect(this, &QOpenGLWebPage::desktopModeChanged, this, &DeclarativeWebPage::markContentChanged);
 }
 
 DeclarativeWebPage::~DeclarativeWebPage()
 {
-    m_grabWritter.cancel();
-    m_grabWritter.waitForFinished();
-    m_grabResult.clear();
+    ThumbnailService::instance()->cancel(tabId());
     m_thumbnailResult.clear();
 }
 
@@ -131,6 +120,11 @@ int DeclarativeWebPage::tabId() const
     return m_initialTab.tabId();
 }
 
+QString DeclarativeWebPage::initialUrl() const
+{
+    return m_initialTab.url();
+}
+
 void DeclarativeWebPage::setInitialTab(const Tab& tab)
 {
     Q_ASSERT(m_initialTab.tabId() == 0);
@@ -138,9 +132,41 @@ void DeclarativeWebPage::setInitialTab(const Tab& tab)
     m_initialTab = tab;
     setDesktopMode(m_initialTab.desktopMode());
     emit tabIdChanged();
-    connect(DBManager::instance(), &DBManager::tabHistoryAvailable,
-            this, &DeclarativeWebPage::onTabHistoryAvailable);
-    DBManager::instance()->getTabHistory(tabId());
+}
+
+void DeclarativeWebPage::requestTabHistory()
+{
+    // Tab history is restored lazily when the page becomes active for the first time.
+    if (m_tabHistoryRequested || tabId() <= 0) {
+        return;
+    }
+
+    m_tabHistoryRequested = true;
+    DBManager::instance()->getTabHistory(tabId(), this, [this](const QList<Link> &links, int currentLinkId) {
+        onTabHistoryAvailable(links, currentLinkId);
+    });
+}
+
+quint64 DeclarativeWebPage::contentGeneration() const
+{
+    return m_thumbnailGeneration.current();
+}
+
+void DeclarativeWebPage::markContentChanged()
+{
+    m_thumbnailGeneration.contentChanged();
+}
+
+/**
+ * @brief DeclarativeWebPage::frameRendered
+ * Called by the container when a frame of this page, the active one, has
+ * been composited to the shared window.
+ */
+void DeclarativeWebPage::frameRendered()
+{
+    if (active()) {
+        m_thumbnailGeneration.frameRendered();
+    }
 }
 
 void DeclarativeWebPage::onUrlChanged()
@@ -150,17 +176,14 @@ void DeclarativeWebPage::onUrlChanged()
     restoreHistory();
 }
 
-void DeclarativeWebPage::onTabHistoryAvailable(const int& historyTabId, const QList<Link>& links, int currentLinkId)
+void DeclarativeWebPage::onTabHistoryAvailable(const QList<Link>& links, int currentLinkId)
 {
-    if (historyTabId == tabId()) {
-        m_restoredTabHistory = links;
-        m_restoredCurrentLinkId = currentLinkId; // FIXME: consider storing isCurrent flag in Link struct instead to reduce DeclarativeWebPage's state
+    m_restoredTabHistory = links;
+    m_restoredCurrentLinkId = currentLinkId; // FIXME: consider storing isCurrent flag in Link struct instead to reduce DeclarativeWebPage's state
 
-        std::reverse(m_restoredTabHistory.begin(), m_restoredTabHistory.end());
-        DBManager::instance()->disconnect(this);
-        m_tabHistoryReady = true;
-        restoreHistory();
-    }
+    std::reverse(m_restoredTabHistory.begin(), m_restoredTabHistory.end());
+    m_tabHistoryReady = true;
+    restoreHistory();
 }
 
 void DeclarativeWebPage::restoreHistory() {
@@ -214,6 +237,19 @@ bool DeclarativeWebPage::domContentLoaded() const
     return m_domContentLoaded;
 }
 
+bool DeclarativeWebPage::mediaActive() const
+{
+    return m_mediaActive;
+}
+
+void DeclarativeWebPage::setMediaActive(bool mediaActive)
+{
+    if (m_mediaActive != mediaActive) {
+        m_mediaActive = mediaActive;
+        emit mediaActiveChanged();
+    }
+}
+
 bool DeclarativeWebPage::initialLoadHasHappened() const
 {
     return m_initialLoadHasHappened;
@@ -263,19 +299,10 @@ void DeclarativeWebPage::loadTab(const QString &newUrl, bool force)
     }
 }
 
-void DeclarativeWebPage::grabToFile(const QSize &size)
+void DeclarativeWebPage::grabToFile(const QSize &size, const QSize &thumbnailSize)
 {
-    // grabToImage handles invalid geometry.
-    m_grabResult = grabToImage(size);
-    if (m_grabResult && active()) {
-        if (!m_grabResult->isReady()) {
-            connect(m_grabResult.data(), &QMozGrabResult::ready,
-                    this, &DeclarativeWebPage::grabResultReady);
-        } else {
-            grabResultReady();
-        }
-    } else {
-        m_grabResult.clear();
+    if (active()) {
+        ThumbnailService::instance()->grab(this, size, thumbnailSize);
     }
 }
 
@@ -317,18 +344,8 @@ void DeclarativeWebPage::forceChrome(bool forcedChrome)
     }
 }
 
-void DeclarativeWebPage::grabResultReady()
+void DeclarativeWebPage::grabWritten(const QString &path)
 {
-    if (active()) {
-        QImage image = m_grabResult->image();
-        m_grabWritter.setFuture(QtConcurrent::run(this, &DeclarativeWebPage::saveToFile, image));
-    }
-    m_grabResult.clear();
-}
-
-void DeclarativeWebPage::grabWritten()
-{
-    QString path = m_grabWritter.result();
     emit grabResult(path);
 }
 
@@ -336,19 +353,41 @@ void DeclarativeWebPage::thumbnailReady()
 {
     if (active()) {
         QImage image = m_thumbnailResult->image();
-        QByteArray iconData;
-        QBuffer buffer(&iconData);
-        buffer.open(QIODevice::WriteOnly);
-        if (image.save(&buffer, "jpg", 75)) {
-            buffer.close();
-            emit thumbnailResult(QString(BASE64_IMAGE).arg(QString(iconData.toBase64())));
-        } else {
-            emit thumbnailResult(DEFAULT_DESKTOP_BOOKMARK_ICON);
-        }
+        // Data url is only built for QML, favicons are stored as binary.
+        bool dataUrl = isSignalConnected(QMetaMethod::fromSignal(&DeclarativeWebPage::thumbnailResult));
+        QFutureWatcher<EncodedThumbnail> *encoder = new QFutureWatcher<EncodedThumbnail>(this);
+        connect(encoder, &QFutureWatcher<EncodedThumbnail>::finished, this, [this, encoder]() {
+            const EncodedThumbnail thumbnail = encoder->result();
+            encoder->deleteLater();
+            emit thumbnailData(thumbnail.data);
+            if (!thumbnail.dataUrl.isEmpty()) {
+                emit thumbnailResult(thumbnail.dataUrl);
+            }
+        });
+        encoder->setFuture(QtConcurrent::run(&DeclarativeWebPage::encodeThumbnail, image, dataUrl));
     }
     m_thumbnailResult.clear();
 }
 
+// Runs in a worker thread.
+DeclarativeWebPage::EncodedThumbnail DeclarativeWebPage::encodeThumbnail(const QImage &image, bool dataUrl)
+{
+    EncodedThumbnail thumbnail;
+    QBuffer buffer(&thumbnail.data);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "jpg", 75)) {
+        thumbnail.data.clear();
+    }
+    buffer.close();
+
+    if (dataUrl) {
+        thumbnail.dataUrl = thumbnail.data.isEmpty()
+                ? QString(DEFAULT_DESKTOP_BOOKMARK_ICON)
+                : QString(BASE64_IMAGE).arg(QString::fromLatin1(thumbnail.data.toBase64()));
+    }
+    return thumbnail;
+}
+
 void DeclarativeWebPage::updateViewMargins()
 {
     QMargins margins;
@@ -358,17 +397,6 @@ void DeclarativeWebPage::updateViewMargins()
     setMargins(margins);
 }
 
-QString DeclarativeWebPage::saveToFile(QImage image)
-{
-    if (image.isNull() || !active()) {
-        return "";
-    }
-
-    // 75% quality jpg produces small and good enough capture.
-    QString path = QString("%1/tab-%2-thumb.jpg").arg(BrowserPaths::cacheLocation()).arg(tabId());
-    return !allBlack(image) && image.save(path, "jpg", 75) ? path : "";
-}
-
 void DeclarativeWebPage::onRecvAsyncMessage(const QString& message, const QVariant& data)
 {
     if (message == QLatin1String(FULLSCREEN_MESSAGE)) {
@@ -11,7 +11,6 @@
 #define DECLARATIVEWEBPAGE_H
 
 #include <qqml.h>
-#include <QFutureWatcher>
 #include <QPointer>
 #include <QRgb>
 #include <qopenglwebpage.h>
@@ -19,6 +18,7 @@
 #include <qmozsecurity.h>
 
 #include "tab.h"
+#include "thumbnailgeneration.h"
 
 class DeclarativeWebContainer;
 class Link;
@@ -32,6 +32,7 @@ class DeclarativeWebPage : public QOpenGLWebPage {
     Q_PROPERTY(bool forcedChrome READ forcedChrome NOTIFY forcedChromeChanged FINAL)
     Q_PROPERTY(bool domContentLoaded READ domContentLoaded NOTIFY domContentLoadedChanged FINAL)
     Q_PROPERTY(QString favicon MEMBER m_favicon NOTIFY faviconChanged FINAL)
+    Q_PROPERTY(bool mediaActive READ mediaActive WRITE setMediaActive NOTIFY mediaActiveChanged FINAL)
     Q_PROPERTY(QVariant resurrectedContentRect READ resurrectedContentRect WRITE setResurrectedContentRect NOTIFY resurrectedContentRectChanged)
 
     Q_PROPERTY(qreal fullscreenHeight MEMBER m_fullScreenHeight NOTIFY fullscreenHeightChanged FINAL)
@@ -45,7 +46,9 @@ public:
     void setContainer(DeclarativeWebContainer *container);
 
     int tabId() const;
+    QString initialUrl() const;
     void setInitialTab(const Tab& tab);
+    void requestTabHistory();
 
     QVariant resurrectedContentRect() const;
     void setResurrectedContentRect(QVariant resurrectedContentRect);
@@ -57,11 +60,17 @@ public:
     bool forcedChrome() const;
     bool domContentLoaded() const;
 
+    bool mediaActive() const;
+    void setMediaActive(bool mediaActive);
+
     bool initialLoadHasHappened() const;
     void setInitialLoadHasHappened();
 
+    quint64 contentGeneration() const;
+    void frameRendered();
+
     Q_INVOKABLE void loadTab(const QString &newUrl, bool force);
-    Q_INVOKABLE void grabToFile(const QSize& size);
+    Q_INVOKABLE void grabToFile(const QSize& size, const QSize &thumbnailSize = QSize());
     Q_INVOKABLE void grabThumbnail(const QSize& size);
     Q_INVOKABLE void forceChrome(bool forcedChrome);
 
@@ -74,9 +83,11 @@ signals:
     void forcedChromeChanged();
     void domContentLoadedChanged();
     void faviconChanged();
+    void mediaActiveChanged();
     void resurrectedContentRectChanged();
     void grabResult(const QString &fileName);
     void thumbnailResult(const QString &data);
+    void thumbnailData(const QByteArray &data);
 
     void fullscreenHeightChanged();
     void toolbarHeightChanged();
@@ -86,15 +97,20 @@ signals:
 private slots:
     void setFullscreen(const bool fullscreen);
     void onRecvAsyncMessage(const QString& message, const QVariant& data);
-    void onTabHistoryAvailable(const int& historyTabId, const QList<Link>& links, int currentLinkId);
     void onUrlChanged();
-    void grabResultReady();
-    void grabWritten();
     void thumbnailReady();
     void updateViewMargins();
+    void markContentChanged();
 
 private:
-    QString saveToFile(QImage image);
+    struct EncodedThumbnail {
+        QByteArray data;
+        QString dataUrl;
+    };
+
+    void grabWritten(const QString &path);
+    static EncodedThumbnail encodeThumbnail(const QImage &image, bool dataUrl);
+    void onTabHistoryAvailable(const QList<Link>& links, int currentLinkId);
     void restoreHistory();
     void setContentLoaded();
 
@@ -105,14 +121,16 @@ private:
     bool m_fullscreen;
     bool m_forcedChrome;
     bool m_domContentLoaded;
+    bool m_mediaActive;
     bool m_initialLoadHasHappened;
+    bool m_tabHistoryRequested;
     bool m_tabHistoryReady;
     bool m_urlReady;
     QString m_favicon;
     QVariant m_resurrectedContentRect;
-    QSharedPointer<QMozGrabResult> m_grabResult;
     QSharedPointer<QMozGrabResult> m_thumbnailResult;
-    QFutureWatcher<QString> m_grabWritter;
+
+    ThumbnailGeneration m_thumbnailGeneration;
     QList<Link> m_restoredTabHistory;
     int m_restoredCurrentLinkId;
 
@@ -120,6 +138,8 @@ private:
     qreal m_toolbarHeight;
 
     QMozSecurity m_security;
+
+    friend class ThumbnailService;
 };
 
 QDebug operator<<(QDebug, const DeclarativeWebPage *);
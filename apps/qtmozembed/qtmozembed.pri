@@ -5,9 +5,15 @@ QT += concurrent
 # C++ sources
 SOURCES += \
     $$PWD/declarativewebpage.cpp \
-    $$PWD/declarativewebpagecreator.cpp
+    $$PWD/declarativewebpagecreator.cpp \
+    $$PWD/tabthumbnailprovider.cpp \
+    $$PWD/thumbnailgeneration.cpp \
+    $$PWD/thumbnailservice.cpp
 
 # C++ headers
 HEADERS += \
     $$PWD/declarativewebpage.h \
-    $$PWD/declarativewebpagecreator.h
+    $$PWD/declarativewebpagecreator.h \
+    $$PWD/tabthumbnailprovider.h \
+    $$PWD/thumbnailgeneration.h \
+    $$PWD/thumbnailservice.h
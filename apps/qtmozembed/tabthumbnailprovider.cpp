@@ -0,0 +1,137 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "tabthumbnailprovider.h"
+#include "logging.h"
+
+#include <QCache>
+#include <QHash>
+#include <QImageReader>
+#include <QMutex>
+#include <QMutexLocker>
+
+// Roughly two screenfuls of tab cards.
+static const int gDefaultCacheBudget = 32 * 1024 * 1024;
+
+namespace {
+
+// Shared between the image loader thread and the main thread.
+struct DecodedThumbnails
+{
+    DecodedThumbnails()
+    {
+        images.setMaxCost(gDefaultCacheBudget);
+    }
+
+    static quint64 key(int tabId, int generation)
+    {
+        return (quint64(quint32(tabId)) << 32) | quint32(generation);
+    }
+
+    QMutex mutex;
+    // Cost is the size of the decoded image in bytes.
+    QCache<quint64, QImage> images;
+    // Generation of the cached image per tab.
+    QHash<int, int> generations;
+};
+
+}
+
+Q_GLOBAL_STATIC(DecodedThumbnails, gThumbnails)
+
+TabThumbnailProvider::TabThumbnailProvider()
+    : QQuickImageProvider(QQmlImageProviderBase::Image,
+                          QQmlImageProviderBase::ForceAsynchronousImageLoading)
+{
+}
+
+// Called in the image loader thread.
+// Thumbnails are written at the tab card size, requestedSize is not applied.
+QImage TabThumbnailProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    Q_UNUSED(requestedSize)
+
+    // The absolute path of the file follows the generation.
+    bool tabIdOk = false;
+    bool generationOk = false;
+    const int tabId = id.section(QLatin1Char('/'), 0, 0).toInt(&tabIdOk);
+    const int generation = id.section(QLatin1Char('/'), 1, 1).toInt(&generationOk);
+    const QString path = id.section(QLatin1Char('/'), 2, -1, QString::SectionIncludeLeadingSep);
+    if (!tabIdOk || !generationOk || tabId <= 0 || path.length() < 2) {
+        qCWarning(lcCoreLog) << "TabThumbnailProvider: invalid thumbnail id" << id;
+        return QImage();
+    }
+
+    const quint64 key = DecodedThumbnails::key(tabId, generation);
+    QImage image;
+    {
+        QMutexLocker locker(&gThumbnails->mutex);
+        QImage *cached = gThumbnails->images.object(key);
+        if (cached) {
+            image = *cached;
+        }
+    }
+
+    if (image.isNull()) {
+        image = decode(path);
+        if (!image.isNull()) {
+            QMutexLocker locker(&gThumbnails->mutex);
+            QHash<int, int>::iterator it = gThumbnails->generations.find(tabId);
+            if (it == gThumbnails->generations.end() || *it <= generation) {
+                if (it != gThumbnails->generations.end() && *it != generation) {
+                    gThumbnails->images.remove(DecodedThumbnails::key(tabId, *it));
+                }
+                gThumbnails->generations.insert(tabId, generation);
+                gThumbnails->images.insert(key, new QImage(image), image.byteCount());
+            }
+        }
+    }
+
+    if (size) {
+        *size = image.size();
+    }
+    return image;
+}
+
+void TabThumbnailProvider::releaseCache()
+{
+    QMutexLocker locker(&gThumbnails->mutex);
+    gThumbnails->images.clear();
+    gThumbnails->generations.clear();
+}
+
+void TabThumbnailProvider::releaseThumbnails(const QList<int> &tabIds)
+{
+    QMutexLocker locker(&gThumbnails->mutex);
+    for (int tabId : tabIds) {
+        QHash<int, int>::iterator it = gThumbnails->generations.find(tabId);
+        if (it != gThumbnails->generations.end()) {
+            gThumbnails->images.remove(DecodedThumbnails::key(tabId, *it));
+            gThumbnails->generations.erase(it);
+        }
+    }
+}
+
+/**
+ * @brief TabThumbnailProvider::decode
+ * Decodes the thumbnail file to premultiplied ARGB32, which the scene graph
+ * uploads as a texture without converting.
+ */
+QImage TabThumbnailProvider::decode(const QString &path)
+{
+    QImageReader reader(path);
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qCDebug(lcCoreLog) << "TabThumbnailProvider: cannot decode" << path << reader.errorString();
+        return image;
+    }
+
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
@@ -0,0 +1,37 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef TABTHUMBNAILPROVIDER_H
+#define TABTHUMBNAILPROVIDER_H
+
+#include <QQuickImageProvider>
+
+/**
+ * Serves tab thumbnails to QML as image://tabthumbnail/<tabId>/<generation><path>.
+ * Thumbnails are decoded in the image loader thread and kept decoded in a
+ * size bounded least recently used cache, so that recreated tab delegates do
+ * not read and decode the thumbnail files again. A new generation of a tab
+ * replaces the previously cached image of the tab.
+ */
+class TabThumbnailProvider : public QQuickImageProvider
+{
+public:
+    TabThumbnailProvider();
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+    static void releaseCache();
+    // Generations start over for tabs that reuse the ids of closed tabs.
+    static void releaseThumbnails(const QList<int> &tabIds);
+
+    static QImage decode(const QString &path);
+};
+
+#endif // TABTHUMBNAILPROVIDER_H
@@ -0,0 +1,60 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "thumbnailgeneration.h"
+
+ThumbnailGeneration::ThumbnailGeneration()
+    : m_current(1)
+    , m_saved(0)
+    , m_ignoredFrame(0)
+{
+}
+
+quint64 ThumbnailGeneration::current() const
+{
+    return m_current;
+}
+
+void ThumbnailGeneration::contentChanged()
+{
+    ++m_current;
+}
+
+void ThumbnailGeneration::frameRendered()
+{
+    if (m_ignoredFrame == m_current) {
+        m_ignoredFrame = 0;
+    } else {
+        contentChanged();
+    }
+}
+
+void ThumbnailGeneration::grabReady(quint64 generation)
+{
+    m_ignoredFrame = generation == m_current ? generation : 0;
+}
+
+void ThumbnailGeneration::saved(quint64 generation, const QSize &captureSize, const QSize &thumbnailSize)
+{
+    if (generation < m_saved) {
+        return;
+    }
+
+    m_saved = generation;
+    m_captureSize = captureSize;
+    m_thumbnailSize = thumbnailSize;
+}
+
+bool ThumbnailGeneration::isSaved(const QSize &captureSize, const QSize &thumbnailSize) const
+{
+    return m_saved == m_current
+            && m_captureSize == captureSize
+            && m_thumbnailSize == thumbnailSize;
+}
@@ -0,0 +1,47 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef THUMBNAILGENERATION_H
+#define THUMBNAILGENERATION_H
+
+#include <QSize>
+
+/**
+ * Content generation of a web page and the generation of its saved
+ * thumbnail. The generation is bumped on rendered frames and on load,
+ * scroll and url changes, a thumbnail grab is skipped while the saved
+ * thumbnail is of the current generation.
+ */
+class ThumbnailGeneration
+{
+public:
+    ThumbnailGeneration();
+
+    quint64 current() const;
+    void contentChanged();
+    void frameRendered();
+
+    // The grab started at generation has its image. The frame that
+    // completes it is not counted if nothing changed meanwhile.
+    void grabReady(quint64 generation);
+    // Older grabs finishing late do not replace the saved generation.
+    void saved(quint64 generation, const QSize &captureSize, const QSize &thumbnailSize);
+    bool isSaved(const QSize &captureSize, const QSize &thumbnailSize) const;
+
+private:
+    quint64 m_current;
+    quint64 m_saved;
+    // Generation whose next frame is ignored, 0 for none.
+    quint64 m_ignoredFrame;
+    QSize m_captureSize;
+    QSize m_thumbnailSize;
+};
+
+#endif // THUMBNAILGENERATION_H
@@ -0,0 +1,317 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "thumbnailservice.h"
+#include "declarativewebpage.h"
+#include "browserpaths.h"
+#include "imagekernels.h"
+#include "logging.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QThread>
+#include <QtConcurrent>
+#include <qmozgrabresult.h>
+
+// Encoding is best effort work, a single thread keeps it from competing
+// with the UI and the engine when the tab switcher is opened.
+static const int gMaxEncoderThreads = 1;
+static const int gEncoderExpiryTimeout = 5000;
+
+ThumbnailService *ThumbnailService::instance()
+{
+    static ThumbnailService *singleton = nullptr;
+    if (!singleton) {
+        singleton = new ThumbnailService();
+    }
+
+    return singleton;
+}
+
+ThumbnailService::ThumbnailService(QObject *parent)
+    : QObject(parent)
+    , m_lastSequence(0)
+    , m_grabsTaken(0)
+    , m_grabsSkipped(0)
+{
+    m_pool.setMaxThreadCount(gMaxEncoderThreads);
+    m_pool.setExpiryTimeout(gEncoderExpiryTimeout);
+
+    // The singleton is not deleted, encoders are not left running at exit.
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                this, &ThumbnailService::clear);
+    }
+}
+
+ThumbnailService::~ThumbnailService()
+{
+    clear();
+}
+
+// Drops all requests once the running encoders have finished.
+void ThumbnailService::clear()
+{
+    for (Request *request : m_requests) {
+        delete request->checker;
+        delete request->writer;
+    }
+    m_pool.waitForDone();
+    qDeleteAll(m_requests);
+    m_requests.clear();
+}
+
+/**
+ * @brief ThumbnailService::grab
+ * Grabs captureSize of the web page and writes it downscaled to thumbnailSize.
+ * If a grab of the same tab is already in flight, a single new grab is done
+ * once the previous one has been written. The web page emits grabResult when
+ * the thumbnail has been written. Nothing is emitted when the grab is skipped
+ * because the saved thumbnail is up to date and its file still exists.
+ */
+void ThumbnailService::grab(DeclarativeWebPage *webPage, const QSize &captureSize, const QSize &thumbnailSize)
+{
+    if (!webPage || webPage->tabId() <= 0) {
+        return;
+    }
+
+    int tabId = webPage->tabId();
+    Request *request = m_requests.value(tabId);
+    if (!request) {
+        request = new Request;
+        request->sequence = ++m_lastSequence;
+        m_requests.insert(tabId, request);
+    }
+
+    request->webPage = webPage;
+    request->captureSize = captureSize;
+    request->thumbnailSize = thumbnailSize;
+
+    if (request->checker || request->grabResult || request->writer) {
+        qCDebug(lcCoreLog) << "ThumbnailService: coalesced grab of tab" << tabId;
+        request->pending = true;
+        return;
+    }
+
+    start(tabId);
+}
+
+/**
+ * @brief ThumbnailService::cancel
+ * Drops a pending grab of the tab. A file check or an encode that is already
+ * running completes but its result is not delivered.
+ */
+void ThumbnailService::cancel(int tabId)
+{
+    Request *request = m_requests.value(tabId);
+    if (request) {
+        request->webPage.clear();
+        request->pending = false;
+        if (!request->checker && !request->writer) {
+            finish(tabId);
+        }
+    }
+}
+
+int ThumbnailService::pendingCount() const
+{
+    return m_requests.count();
+}
+
+int ThumbnailService::grabsTaken() const
+{
+    return m_grabsTaken;
+}
+
+int ThumbnailService::grabsSkipped() const
+{
+    return m_grabsSkipped;
+}
+
+/**
+ * @brief ThumbnailService::scaled
+ * Downscales image to fit thumbnailSize. Images that are already small enough
+ * are returned as is.
+ */
+QImage ThumbnailService::scaled(const QImage &image, const QSize &thumbnailSize)
+{
+    if (image.isNull() || !thumbnailSize.isValid() || thumbnailSize.isEmpty()
+            || (image.width() <= thumbnailSize.width() && image.height() <= thumbnailSize.height())) {
+        return image;
+    }
+
+    return image.scaled(thumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+}
+
+QString ThumbnailService::thumbnailPath(int tabId)
+{
+    return QString("%1/tab-%2-thumb.jpg").arg(BrowserPaths::cacheLocation()).arg(tabId);
+}
+
+ThumbnailService::Request *ThumbnailService::request(int tabId, quint64 sequence) const
+{
+    Request *request = m_requests.value(tabId);
+    return request && request->sequence == sequence ? request : nullptr;
+}
+
+bool ThumbnailService::isUpToDate(DeclarativeWebPage *webPage, const QSize &captureSize, const QSize &thumbnailSize) const
+{
+    return webPage->m_thumbnailGeneration.isSaved(captureSize, thumbnailSize);
+}
+
+/**
+ * @brief ThumbnailService::start
+ * Grabs the page unless the saved thumbnail is up to date. The thumbnail
+ * file may have been evicted from the cache meanwhile, whether it still
+ * exists is checked in the thread pool.
+ */
+void ThumbnailService::start(int tabId)
+{
+    Request *request = m_requests.value(tabId);
+    Q_ASSERT(request);
+
+    if (!request->webPage || !isUpToDate(request->webPage, request->captureSize, request->thumbnailSize)) {
+        startGrab(tabId);
+        return;
+    }
+
+    request->pending = false;
+    const quint64 sequence = request->sequence;
+    const QString path = thumbnailPath(tabId);
+    request->checker = new QFutureWatcher<bool>(this);
+    connect(request->checker, &QFutureWatcher<bool>::finished, this, [this, tabId, sequence]() {
+        checked(tabId, sequence);
+    });
+    request->checker->setFuture(QtConcurrent::run(&m_pool, [path]() {
+        return QFile::exists(path);
+    }));
+}
+
+void ThumbnailService::checked(int tabId, quint64 sequence)
+{
+    Request *request = this->request(tabId, sequence);
+    if (!request || !request->checker) {
+        return;
+    }
+
+    const bool exists = request->checker->result();
+    request->checker->deleteLater();
+    request->checker = nullptr;
+
+    // The page may have changed or been grabbed at another size meanwhile.
+    if (exists && request->webPage
+            && isUpToDate(request->webPage, request->captureSize, request->thumbnailSize)) {
+        ++m_grabsSkipped;
+        qCDebug(lcCoreLog) << "ThumbnailService: thumbnail of tab" << tabId << "is up to date, skipped"
+                           << m_grabsSkipped << "taken" << m_grabsTaken;
+        finish(tabId);
+    } else {
+        startGrab(tabId);
+    }
+}
+
+void ThumbnailService::startGrab(int tabId)
+{
+    Request *request = m_requests.value(tabId);
+    Q_ASSERT(request);
+
+    request->pending = false;
+    if (!request->webPage || !request->webPage->active()) {
+        finish(tabId);
+        return;
+    }
+
+    ++m_grabsTaken;
+    const quint64 sequence = request->sequence;
+    request->generation = request->webPage->contentGeneration();
+    // grabToImage handles invalid geometry.
+    request->grabResult = request->webPage->grabToImage(request->captureSize);
+    if (!request->grabResult) {
+        finish(tabId);
+    } else if (request->grabResult->isReady()) {
+        grabReady(tabId, sequence);
+    } else {
+        connect(request->grabResult.data(), &QMozGrabResult::ready, this, [this, tabId, sequence]() {
+            grabReady(tabId, sequence);
+        });
+    }
+}
+
+void ThumbnailService::grabReady(int tabId, quint64 sequence)
+{
+    Request *request = this->request(tabId, sequence);
+    if (!request || !request->grabResult) {
+        return;
+    }
+
+    QImage image = request->grabResult->image();
+    request->grabResult.clear();
+    if (request->webPage) {
+        request->webPage->m_thumbnailGeneration.grabReady(request->generation);
+    }
+    if (image.isNull() || !request->webPage || !request->webPage->active()) {
+        finish(tabId);
+        return;
+    }
+
+    request->writer = new QFutureWatcher<QString>(this);
+    connect(request->writer, &QFutureWatcher<QString>::finished, this, [this, tabId, sequence]() {
+        written(tabId, sequence);
+    });
+    request->writer->setFuture(QtConcurrent::run(&m_pool, &ThumbnailService::encode,
+                                                 image, request->thumbnailSize, thumbnailPath(tabId)));
+}
+
+void ThumbnailService::written(int tabId, quint64 sequence)
+{
+    Request *request = this->request(tabId, sequence);
+    if (!request || !request->writer) {
+        return;
+    }
+
+    QString path = request->writer->result();
+    request->writer->deleteLater();
+    request->writer = nullptr;
+
+    if (request->webPage) {
+        // Blank captures are not saved and are grabbed again next time.
+        if (!path.isEmpty()) {
+            request->webPage->m_thumbnailGeneration.saved(request->generation, request->captureSize,
+                                                          request->thumbnailSize);
+        }
+        request->webPage->grabWritten(path);
+    }
+
+    if (request->pending) {
+        start(tabId);
+    } else {
+        finish(tabId);
+    }
+}
+
+void ThumbnailService::finish(int tabId)
+{
+    delete m_requests.take(tabId);
+}
+
+// Runs in the thread pool.
+QString ThumbnailService::encode(const QImage &image, const QSize &thumbnailSize, const QString &path)
+{
+    QThread::currentThread()->setPriority(QThread::IdlePriority);
+
+    // Scan and encode only the pixels of the tab card.
+    QImage thumbnail = scaled(image, thumbnailSize);
+    if (ImageKernels::isBlack(thumbnail)) {
+        return QString();
+    }
+
+    // 75% quality jpg produces small and good enough capture.
+    return thumbnail.save(path, "jpg", 75) ? path : QString();
+}
@@ -0,0 +1,91 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef THUMBNAILSERVICE_H
+#define THUMBNAILSERVICE_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QSize>
+#include <QThreadPool>
+
+class DeclarativeWebPage;
+class QMozGrabResult;
+
+/**
+ * Captures tab thumbnails for all web pages. Requests of a tab are coalesced
+ * so that at most one grab and one encode is in flight per tab, captures are
+ * downscaled to the tab card size and encoded on a small private thread pool.
+ * Grabs of pages whose content has not changed since the saved thumbnail was
+ * captured are skipped.
+ */
+class ThumbnailService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ThumbnailService *instance();
+    ~ThumbnailService();
+
+    void grab(DeclarativeWebPage *webPage, const QSize &captureSize, const QSize &thumbnailSize);
+    void cancel(int tabId);
+    int pendingCount() const;
+    int grabsTaken() const;
+    int grabsSkipped() const;
+
+    static QImage scaled(const QImage &image, const QSize &thumbnailSize);
+    static QString thumbnailPath(int tabId);
+
+private:
+    ThumbnailService(QObject *parent = nullptr);
+
+    struct Request {
+        Request() : sequence(0), generation(0), checker(nullptr), writer(nullptr), pending(false) {}
+
+        // Tells the callbacks of a finished request from the ones of a
+        // later request of the same tab.
+        quint64 sequence;
+        QPointer<DeclarativeWebPage> webPage;
+        QSize captureSize;
+        QSize thumbnailSize;
+        // Content generation of the page when the grab was started.
+        quint64 generation;
+        // Whether the saved thumbnail file still exists.
+        QFutureWatcher<bool> *checker;
+        QSharedPointer<QMozGrabResult> grabResult;
+        QFutureWatcher<QString> *writer;
+        // Another grab was requested while this one was in flight.
+        bool pending;
+    };
+
+    Request *request(int tabId, quint64 sequence) const;
+    bool isUpToDate(DeclarativeWebPage *webPage, const QSize &captureSize, const QSize &thumbnailSize) const;
+    void start(int tabId);
+    void checked(int tabId, quint64 sequence);
+    void startGrab(int tabId);
+    void grabReady(int tabId, quint64 sequence);
+    void written(int tabId, quint64 sequence);
+    void finish(int tabId);
+    void clear();
+
+    static QString encode(const QImage &image, const QSize &thumbnailSize, const QString &path);
+
+    QHash<int, Request *> m_requests;
+    QThreadPool m_pool;
+    quint64 m_lastSequence;
+    int m_grabsTaken;
+    int m_grabsSkipped;
+};
+
+#endif // THUMBNAILSERVICE_H
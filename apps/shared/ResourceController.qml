@@ -32,6 +32,8 @@ Item {
     property string _lastMetaOwner
     property bool _isAudioStream
     property bool _isVideoStream
+    // Page that started the playback, kept awake while media is active.
+    property QtObject _mediaPage
 
     function calculateStatus() {
         var video = false
@@ -52,6 +54,21 @@ Item {
         if (audioActive !== audio) {
             audioActive = audio
         }
+
+        updateMediaPage(video || audio)
+    }
+
+    function updateMediaPage(active) {
+        if (active && webPage && _mediaPage !== webPage) {
+            if (_mediaPage) {
+                _mediaPage.mediaActive = false
+            }
+            _mediaPage = webPage
+            _mediaPage.mediaActive = true
+        } else if (!active && _mediaPage) {
+            _mediaPage.mediaActive = false
+            _mediaPage = null
+        }
     }
 
     function resumeView() {
@@ -81,11 +81,12 @@ WebContainer {
         contentItem.sendAsyncMessage(name, data)
     }
 
+    // Largest area of the page with the aspect ratio of the tab card.
     function thumbnailCaptureSize() {
-        var ratio = browserPage.width / browserPage.thumbnailSize.width
-        var height = browserPage.thumbnailSize.height * ratio
+        var ratio = Math.min(browserPage.width / browserPage.thumbnailSize.width,
+                             browserPage.height / browserPage.thumbnailSize.height)
 
-        return Qt.size(browserPage.width, height)
+        return Qt.size(browserPage.thumbnailSize.width * ratio, browserPage.thumbnailSize.height * ratio)
     }
 
     function grabActivePage() {
@@ -93,7 +94,7 @@ WebContainer {
             if (webView.privateMode) {
                 webView.contentItem.grabThumbnail(thumbnailCaptureSize())
             } else {
-                webView.contentItem.grabToFile(thumbnailCaptureSize())
+                webView.contentItem.grabToFile(thumbnailCaptureSize(), browserPage.thumbnailSize)
             }
         }
     }
@@ -160,7 +161,7 @@ WebContainer {
                     if (webView.privateMode) {
                         grabThumbnail(thumbnailCaptureSize())
                     } else {
-                        grabToFile(thumbnailCaptureSize())
+                        grabToFile(thumbnailCaptureSize(), browserPage.thumbnailSize)
                     }
                 }
             }
@@ -11,8 +11,18 @@
 
 #include "bookmark.h"
 
-Bookmark::Bookmark(const QString &title, const QString &url, const QString &favicon, bool hasTouchIcon, QObject* parent)
-    : QObject(parent)
+Bookmark::Bookmark()
+    : m_id(-1)
+    , m_folderId(0)
+    , m_folder(false)
+    , m_hasTouchIcon(false)
+{
+}
+
+Bookmark::Bookmark(const QString &title, const QString &url, const QString &favicon, bool hasTouchIcon)
+    : m_id(-1)
+    , m_folderId(0)
+    , m_folder(false)
     , m_title(title)
     , m_url(url)
     , m_favicon(favicon)
@@ -24,15 +34,51 @@ Bookmark::Bookmark(const QString &title, const QString &url, const QString &favi
     }
 }
 
+Bookmark Bookmark::folder(const QString &title, int folderId)
+{
+    Bookmark folder;
+    folder.m_title = title;
+    folder.m_folderId = folderId;
+    folder.m_folder = true;
+    return folder;
+}
+
+int Bookmark::id() const
+{
+    return m_id;
+}
+
+void Bookmark::setId(int id)
+{
+    m_id = id;
+}
+
+int Bookmark::folderId() const
+{
+    return m_folderId;
+}
+
+void Bookmark::setFolderId(int folderId)
+{
+    m_folderId = folderId;
+}
+
+bool Bookmark::isFolder() const
+{
+    return m_folder;
+}
+
+void Bookmark::setFolder(bool folder)
+{
+    m_folder = folder;
+}
+
 QString Bookmark::title() const {
     return m_title;
 }
 
 void Bookmark::setTitle(const QString &title) {
-    if(title != m_title) {
-        m_title = title;
-        emit titleChanged();
-    }
+    m_title = title;
 }
 
 QString Bookmark::url() const {
@@ -40,10 +86,7 @@ QString Bookmark::url() const {
 }
 
 void Bookmark::setUrl(const QString &url) {
-    if(url != m_url) {
-        m_url = url;
-        emit urlChanged();
-    }
+    m_url = url;
 }
 
 QString Bookmark::favicon() const {
@@ -51,10 +94,7 @@ QString Bookmark::favicon() const {
 }
 
 void Bookmark::setFavicon(const QString &favicon) {
-    if(favicon != m_favicon) {
-        m_favicon = favicon;
-        emit faviconChanged();
-    }
+    m_favicon = favicon;
 }
 
 bool Bookmark::hasTouchIcon() const
@@ -12,17 +12,28 @@
 #ifndef BOOKMARK_H
 #define BOOKMARK_H
 
-#include <QObject>
+#include <QMetaType>
+#include <QString>
+#include <QVector>
 
-class Bookmark : public QObject {
-    Q_OBJECT
+// Bookmarks are stored by value in contiguous storage. The id is the row id
+// of the bookmark in the database, folders are bookmarks without an url.
+class Bookmark {
+public:
+    Bookmark();
+    Bookmark(const QString &title, const QString &url, const QString &favicon, bool hasTouchIcon);
 
-    Q_PROPERTY(QString title READ title WRITE setTitle NOTIFY titleChanged)
-    Q_PROPERTY(QString url READ url WRITE setUrl NOTIFY urlChanged)
-    Q_PROPERTY(QString favicon READ favicon WRITE setFavicon NOTIFY faviconChanged)
+    static Bookmark folder(const QString &title, int folderId = 0);
 
-public:
-    Bookmark(const QString &title, const QString &url, const QString &favicon, bool hasTouchIcon, QObject* parent = 0);
+    int id() const;
+    void setId(int id);
+
+    // Id of the folder containing the bookmark, 0 for the top level.
+    int folderId() const;
+    void setFolderId(int folderId);
+
+    bool isFolder() const;
+    void setFolder(bool folder);
 
     QString title() const;
     void setTitle(const QString &title);
@@ -35,16 +46,21 @@ public:
 
     bool hasTouchIcon() const;
     void setHasTouchIcon(bool hasTouchIcon);
-signals:
-    void titleChanged();
-    void urlChanged();
-    void faviconChanged();
 
 private:
+    int m_id;
+    int m_folderId;
+    bool m_folder;
     QString m_title;
     QString m_url;
     QString m_favicon;
     bool m_hasTouchIcon;
 };
 
+Q_DECLARE_TYPEINFO(Bookmark, Q_MOVABLE_TYPE);
+
+typedef QVector<Bookmark> BookmarkList;
+
+Q_DECLARE_METATYPE(Bookmark)
+
 #endif // BOOKMARK_H
@@ -10,12 +10,15 @@
 
 #include "dbmanager.h"
 
+#include <QCoreApplication>
 #include <QMetaObject>
 
 #include "dbworker.h"
 #include "faviconmanager.h"
+#include "thumbnailcache.h"
 
 static DBManager *gDbManager = 0;
+static const int gThumbPathFlushDelay = 1000;
 
 DBManager *DBManager::instance()
 {
@@ -27,10 +30,26 @@ DBManager *DBManager::instance()
 
 DBManager::DBManager(QObject *parent)
     : QObject(parent)
+    , m_lastTabHistoryRequestId(0)
+    , m_lastSearchRequestId(0)
+    , m_lastBookmarkRequestId(0)
 {
     qRegisterMetaType<QList<Tab> >("QList<Tab>");
     qRegisterMetaType<QList<Link> >("QList<Link>");
+    qRegisterMetaType<Link>("Link");
     qRegisterMetaType<Tab>("Tab");
+    qRegisterMetaType<QList<int> >("QList<int>");
+    qRegisterMetaType<ThumbPathMap>("ThumbPathMap");
+    qRegisterMetaType<FaviconList>("FaviconList");
+    qRegisterMetaType<FaviconFailureList>("FaviconFailureList");
+    qRegisterMetaType<Bookmark>("Bookmark");
+    qRegisterMetaType<BookmarkList>("BookmarkList");
+
+    m_thumbPathTimer.setSingleShot(true);
+    m_thumbPathTimer.setInterval(gThumbPathFlushDelay);
+    connect(&m_thumbPathTimer, &QTimer::timeout, this, [this]() {
+        flushThumbPaths(false);
+    });
 
     worker = new DBWorker();
     worker->moveToThread(&workerThread);
@@ -38,7 +57,13 @@ DBManager::DBManager(QObject *parent)
     connect(&workerThread, &QThread::finished, worker, &DBWorker::deleteLater);
     connect(worker, &DBWorker::tabsAvailable, this, &DBManager::tabsAvailable);
     connect(worker, &DBWorker::historyAvailable, this, &DBManager::historyAvailable);
+    connect(worker, &DBWorker::historyEntryAdded, this, &DBManager::historyEntryAdded);
+    connect(worker, &DBWorker::historyHostsRemoved, this, &DBManager::historyHostsRemoved);
     connect(worker, &DBWorker::tabHistoryAvailable, this, &DBManager::tabHistoryAvailable);
+    connect(worker, &DBWorker::tabHistoryFetched, this, &DBManager::deliverTabHistory);
+    connect(worker, &DBWorker::historySearched, this, &DBManager::deliverHistorySearch);
+    connect(worker, &DBWorker::bookmarksSearched, this, &DBManager::deliverBookmarkSearch);
+    connect(worker, &DBWorker::bookmarkAppended, this, &DBManager::bookmarkAppended);
     connect(worker, &DBWorker::titleChanged, this, &DBManager::titleChanged);
     connect(worker, &DBWorker::thumbPathChanged, this, &DBManager::thumbPathChanged);
     workerThread.start();
@@ -46,10 +71,18 @@ DBManager::DBManager(QObject *parent)
     QMetaObject::invokeMethod(worker, "init", Qt::BlockingQueuedConnection);
     QMetaObject::invokeMethod(worker, "getSettings", Qt::BlockingQueuedConnection,
                               Q_RETURN_ARG(SettingsMap, m_settings));
+
+    // The instance is not deleted on exit, pending paths are written before quitting.
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this]() {
+            flushThumbPaths(true);
+        });
+    }
 }
 
 DBManager::~DBManager()
 {
+    flushThumbPaths(true);
     workerThread.exit();
     // Use timeout of 500ms to guaranty we won't block
     workerThread.wait(500);
@@ -100,12 +133,23 @@ void DBManager::getAllTabs()
 
 void DBManager::removeTab(int tabId)
 {
+    m_pendingThumbPaths.remove(tabId);
     QMetaObject::invokeMethod(worker, "removeTab", Qt::QueuedConnection,
                               Q_ARG(int, tabId));
 }
 
+void DBManager::removeTabs(const QList<int> &tabIds)
+{
+    for (int tabId : tabIds) {
+        m_pendingThumbPaths.remove(tabId);
+    }
+    QMetaObject::invokeMethod(worker, "removeTabs", Qt::QueuedConnection, Q_ARG(QList<int>, tabIds));
+}
+
 void DBManager::removeAllTabs()
 {
+    m_pendingThumbPaths.clear();
+    ThumbnailCache::instance()->clear();
     QMetaObject::invokeMethod(worker, "removeAllTabs", Qt::BlockingQueuedConnection,
                               Q_ARG(bool, true));
 }
@@ -118,8 +162,24 @@ void DBManager::updateTitle(int tabId, const QString &url, const QString &title)
 
 void DBManager::updateThumbPath(int tabId, const QString &path)
 {
-    QMetaObject::invokeMethod(worker, "updateThumbPath", Qt::QueuedConnection,
-                              Q_ARG(int, tabId), Q_ARG(QString, path));
+    // Thumbnails are captured in bursts e.g. when the tab switcher is opened,
+    // store them with a single transaction.
+    m_pendingThumbPaths.insert(tabId, path);
+    if (!m_thumbPathTimer.isActive()) {
+        m_thumbPathTimer.start();
+    }
+}
+
+void DBManager::flushThumbPaths(bool wait)
+{
+    m_thumbPathTimer.stop();
+    if (m_pendingThumbPaths.isEmpty()) {
+        return;
+    }
+
+    QMetaObject::invokeMethod(worker, "updateThumbPaths", wait ? Qt::BlockingQueuedConnection : Qt::QueuedConnection,
+                              Q_ARG(ThumbPathMap, m_pendingThumbPaths));
+    m_pendingThumbPaths.clear();
 }
 
 void DBManager::removeHistoryEntry(int linkId)
@@ -134,6 +194,12 @@ void DBManager::removeHistoryEntry(const QString &url)
                               Q_ARG(QString, url));
 }
 
+void DBManager::removeHistoryEntries(const QList<int> &linkIds)
+{
+    QMetaObject::invokeMethod(worker, "removeHistoryEntries", Qt::QueuedConnection,
+                              Q_ARG(QList<int>, linkIds));
+}
+
 void DBManager::addHistoryEntry(const QString &url, const QString &title)
 {
     QMetaObject::invokeMethod(worker, "addHistoryEntry", Qt::QueuedConnection,
@@ -143,6 +209,9 @@ void DBManager::addHistoryEntry(const QString &url, const QString &title)
 void DBManager::clearHistory()
 {
     FaviconManager::instance()->clear(QStringLiteral("history"));
+    // Clearing history removes all tabs as well.
+    m_pendingThumbPaths.clear();
+    ThumbnailCache::instance()->clear();
     QMetaObject::invokeMethod(worker, "clearHistory", Qt::QueuedConnection);
 }
 
@@ -156,6 +225,77 @@ void DBManager::getTabHistory(int tabId)
     QMetaObject::invokeMethod(worker, "getTabHistory", Qt::QueuedConnection, Q_ARG(int, tabId));
 }
 
+/**
+ * Fetches history of the tab and delivers it only to the given callback. The
+ * callback is dropped if the context object is destroyed before the reply.
+ */
+void DBManager::getTabHistory(int tabId, QObject *context, TabHistoryCallback callback)
+{
+    Q_ASSERT(context);
+
+    int requestId = ++m_lastTabHistoryRequestId;
+    m_tabHistoryRequests.insert(requestId, { context, callback });
+    QMetaObject::invokeMethod(worker, "fetchTabHistory", Qt::QueuedConnection,
+                              Q_ARG(int, requestId), Q_ARG(int, tabId));
+}
+
+void DBManager::deliverTabHistory(int requestId, const QList<Link> &links, int currentLinkId)
+{
+    TabHistoryRequest request = m_tabHistoryRequests.take(requestId);
+    if (request.context && request.callback) {
+        request.callback(links, currentLinkId);
+    }
+}
+
+int DBManager::searchHistory(const QString &filter, int limit, QObject *context, HistorySearchCallback callback)
+{
+    Q_ASSERT(context);
+
+    int requestId = ++m_lastSearchRequestId;
+    m_searchRequests.insert(requestId, { context, callback, BookmarkSearchCallback() });
+    QMetaObject::invokeMethod(worker, "searchHistory", Qt::QueuedConnection,
+                              Q_ARG(int, requestId), Q_ARG(QString, filter), Q_ARG(int, limit));
+    return requestId;
+}
+
+int DBManager::searchBookmarks(const QString &filter, int limit, QObject *context, BookmarkSearchCallback callback)
+{
+    Q_ASSERT(context);
+
+    int requestId = ++m_lastSearchRequestId;
+    m_searchRequests.insert(requestId, { context, HistorySearchCallback(), callback });
+    QMetaObject::invokeMethod(worker, "searchBookmarks", Qt::QueuedConnection,
+                              Q_ARG(int, requestId), Q_ARG(QString, filter), Q_ARG(int, limit));
+    return requestId;
+}
+
+/**
+ * Drops the callback of a pending search. The worker skips the search if it
+ * has not started it yet.
+ */
+void DBManager::cancelSearch(int requestId)
+{
+    if (m_searchRequests.remove(requestId) > 0) {
+        worker->cancelSearch(requestId);
+    }
+}
+
+void DBManager::deliverHistorySearch(int requestId, const QList<Link> &links)
+{
+    SearchRequest request = m_searchRequests.take(requestId);
+    if (request.context && request.historyCallback) {
+        request.historyCallback(links);
+    }
+}
+
+void DBManager::deliverBookmarkSearch(int requestId, const BookmarkList &bookmarks)
+{
+    SearchRequest request = m_searchRequests.take(requestId);
+    if (request.context && request.bookmarkCallback) {
+        request.bookmarkCallback(bookmarks);
+    }
+}
+
 void DBManager::saveSetting(const QString &name, const QString &value)
 {
     m_settings.insert(name, value);
@@ -182,3 +322,134 @@ void DBManager::deleteSetting(const QString &name)
                                   Q_ARG(QString, name));
     }
 }
+
+FaviconList DBManager::getFavicons(const QString &type)
+{
+    FaviconList favicons;
+    QMetaObject::invokeMethod(worker, "getFavicons", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(FaviconList, favicons), Q_ARG(QString, type));
+    return favicons;
+}
+
+void DBManager::storeFaviconData(const QString &hash, const QByteArray &data)
+{
+    QMetaObject::invokeMethod(worker, "storeFaviconData", Qt::QueuedConnection,
+                              Q_ARG(QString, hash), Q_ARG(QByteArray, data));
+}
+
+// Can be called from any thread but the worker thread, e.g. by image providers.
+QByteArray DBManager::getFaviconData(const QString &hash)
+{
+    QByteArray data;
+    QMetaObject::invokeMethod(worker, "getFaviconData", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(QByteArray, data), Q_ARG(QString, hash));
+    return data;
+}
+
+void DBManager::updateFavicons(const FaviconList &favicons, bool wait)
+{
+    QMetaObject::invokeMethod(worker, "updateFavicons", wait ? Qt::BlockingQueuedConnection : Qt::QueuedConnection,
+                              Q_ARG(FaviconList, favicons));
+}
+
+void DBManager::clearFavicons(const QString &type)
+{
+    QMetaObject::invokeMethod(worker, "clearFavicons", Qt::QueuedConnection,
+                              Q_ARG(QString, type));
+}
+
+FaviconFailureList DBManager::getFaviconFailures()
+{
+    FaviconFailureList failures;
+    QMetaObject::invokeMethod(worker, "getFaviconFailures", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(FaviconFailureList, failures));
+    return failures;
+}
+
+void DBManager::updateFaviconFailures(const FaviconFailureList &failures, bool wait)
+{
+    QMetaObject::invokeMethod(worker, "updateFaviconFailures", wait ? Qt::BlockingQueuedConnection : Qt::QueuedConnection,
+                              Q_ARG(FaviconFailureList, failures));
+}
+
+void DBManager::clearFaviconFailures()
+{
+    QMetaObject::invokeMethod(worker, "clearFaviconFailures", Qt::QueuedConnection);
+}
+
+// Rows of the folder ordered by position, favicon data is not read.
+BookmarkList DBManager::getBookmarks(int folderId, int offset, int limit)
+{
+    BookmarkList bookmarks;
+    QMetaObject::invokeMethod(worker, "getBookmarks", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(BookmarkList, bookmarks),
+                              Q_ARG(int, folderId), Q_ARG(int, offset), Q_ARG(int, limit));
+    return bookmarks;
+}
+
+int DBManager::getBookmarkCount(int folderId)
+{
+    int count = 0;
+    QMetaObject::invokeMethod(worker, "getBookmarkCount", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(int, count), Q_ARG(int, folderId));
+    return count;
+}
+
+QStringList DBManager::getBookmarkUrls()
+{
+    QStringList urls;
+    QMetaObject::invokeMethod(worker, "getBookmarkUrls", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(QStringList, urls));
+    return urls;
+}
+
+int DBManager::addBookmark(const Bookmark &bookmark)
+{
+    int id = -1;
+    QMetaObject::invokeMethod(worker, "addBookmark", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(int, id), Q_ARG(Bookmark, bookmark));
+    return id;
+}
+
+int DBManager::appendBookmark(const Bookmark &bookmark)
+{
+    int requestId = ++m_lastBookmarkRequestId;
+    QMetaObject::invokeMethod(worker, "appendBookmark", Qt::QueuedConnection,
+                              Q_ARG(int, requestId), Q_ARG(Bookmark, bookmark));
+    return requestId;
+}
+
+int DBManager::addBookmarks(const BookmarkList &bookmarks, bool skipExisting)
+{
+    int added = 0;
+    QMetaObject::invokeMethod(worker, "addBookmarks", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(int, added), Q_ARG(BookmarkList, bookmarks), Q_ARG(bool, skipExisting));
+    return added;
+}
+
+void DBManager::updateBookmark(const Bookmark &bookmark)
+{
+    QMetaObject::invokeMethod(worker, "updateBookmark", Qt::QueuedConnection,
+                              Q_ARG(Bookmark, bookmark));
+}
+
+void DBManager::updateBookmarkFavicon(const QString &url, const QString &favicon, bool hasTouchIcon)
+{
+    QMetaObject::invokeMethod(worker, "updateBookmarkFavicon", Qt::QueuedConnection,
+                              Q_ARG(QString, url), Q_ARG(QString, favicon), Q_ARG(bool, hasTouchIcon));
+}
+
+void DBManager::removeBookmark(int id)
+{
+    QMetaObject::invokeMethod(worker, "removeBookmark", Qt::QueuedConnection, Q_ARG(int, id));
+}
+
+void DBManager::removeBookmark(const QString &url)
+{
+    QMetaObject::invokeMethod(worker, "removeBookmark", Qt::QueuedConnection, Q_ARG(QString, url));
+}
+
+void DBManager::clearBookmarks()
+{
+    QMetaObject::invokeMethod(worker, "clearBookmarks", Qt::QueuedConnection);
+}
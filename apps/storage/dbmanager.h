@@ -12,9 +12,15 @@
 #define DBMANAGER_H
 
 #include <QObject>
+#include <QHash>
 #include <QMap>
+#include <QPointer>
 #include <QThread>
+#include <QTimer>
+#include <functional>
 
+#include "bookmark.h"
+#include "favicon.h"
 #include "link.h"
 #include "tab.h"
 
@@ -24,12 +30,17 @@ class DBManager : public QObject
 {
     Q_OBJECT
 public:
+    typedef std::function<void (const QList<Link> &links, int currentLinkId)> TabHistoryCallback;
+    typedef std::function<void (const QList<Link> &links)> HistorySearchCallback;
+    typedef std::function<void (const BookmarkList &bookmarks)> BookmarkSearchCallback;
+
     static DBManager *instance();
     virtual ~DBManager();
 
     void createTab(const Tab &tab);
     void getAllTabs();
     void removeTab(int tabId);
+    void removeTabs(const QList<int> &tabIds);
     void removeAllTabs();
     void navigateTo(int tabId, const QString &url, const QString &title = QString(), const QString &path = QString());
     void goForward(int tabId);
@@ -40,10 +51,17 @@ public:
 
     void removeHistoryEntry(int linkId);
     void removeHistoryEntry(const QString &url);
+    void removeHistoryEntries(const QList<int> &linkIds);
     void addHistoryEntry(const QString &url, const QString &title);
     void clearHistory();
     void getHistory(const QString &filter = "");
     void getTabHistory(int tabId);
+    void getTabHistory(int tabId, QObject *context, TabHistoryCallback callback);
+
+    // Searches for suggestions, returns the request id for cancelling the search.
+    int searchHistory(const QString &filter, int limit, QObject *context, HistorySearchCallback callback);
+    int searchBookmarks(const QString &filter, int limit, QObject *context, BookmarkSearchCallback callback);
+    void cancelSearch(int requestId);
 
     void saveSetting(const QString &name, const QString &value);
     QString getSetting(const QString &name);
@@ -51,21 +69,79 @@ public:
 
     int getMaxTabId();
 
+    FaviconList getFavicons(const QString &type);
+    void storeFaviconData(const QString &hash, const QByteArray &data);
+    QByteArray getFaviconData(const QString &hash);
+    void updateFavicons(const FaviconList &favicons, bool wait = false);
+    void clearFavicons(const QString &type);
+
+    FaviconFailureList getFaviconFailures();
+    void updateFaviconFailures(const FaviconFailureList &failures, bool wait = false);
+    void clearFaviconFailures();
+
+    BookmarkList getBookmarks(int folderId, int offset, int limit);
+    int getBookmarkCount(int folderId);
+    QStringList getBookmarkUrls();
+    int addBookmark(const Bookmark &bookmark);
+    // Adds the bookmark without waiting, bookmarkAppended tells the id.
+    int appendBookmark(const Bookmark &bookmark);
+    int addBookmarks(const BookmarkList &bookmarks, bool skipExisting = false);
+    void updateBookmark(const Bookmark &bookmark);
+    void updateBookmarkFavicon(const QString &url, const QString &favicon, bool hasTouchIcon);
+    void removeBookmark(int id);
+    void removeBookmark(const QString &url);
+    void clearBookmarks();
+
 signals:
     void tabsAvailable(QList<Tab> tab);
     void historyAvailable(QList<Link> links);
+    // A visit was added to the history, the link has the stored title and visit.
+    void historyEntryAdded(Link link);
+    // Removed history entries were the last ones of these hosts.
+    void historyHostsRemoved(const QStringList &hosts);
     void tabHistoryAvailable(int tabId, QList<Link> links, int currentLinkId);
     void thumbPathChanged(int tabId, const QString &path);
     void titleChanged(const QString &url, const QString &title);
     void settingsChanged();
+    // Id of the bookmark of an appendBookmark request, -1 if it was not added.
+    void bookmarkAppended(int requestId, int id);
+
+private slots:
+    void deliverTabHistory(int requestId, const QList<Link> &links, int currentLinkId);
+    void deliverHistorySearch(int requestId, const QList<Link> &links);
+    void deliverBookmarkSearch(int requestId, const BookmarkList &bookmarks);
 
 private:
     DBManager(QObject *parent = 0);
+    void flushThumbPaths(bool wait);
+
+    struct TabHistoryRequest {
+        QPointer<QObject> context;
+        TabHistoryCallback callback;
+    };
+
+    struct SearchRequest {
+        QPointer<QObject> context;
+        HistorySearchCallback historyCallback;
+        BookmarkSearchCallback bookmarkCallback;
+    };
 
     QMap<QString, QString> m_settings;
+    // Pending tab history requests keyed by request id.
+    QHash<int, TabHistoryRequest> m_tabHistoryRequests;
+    int m_lastTabHistoryRequestId;
+    // Pending searches keyed by request id.
+    QHash<int, SearchRequest> m_searchRequests;
+    int m_lastSearchRequestId;
+    int m_lastBookmarkRequestId;
+    // Thumbnail paths waiting to be written in one transaction.
+    QHash<int, QString> m_pendingThumbPaths;
+    QTimer m_thumbPathTimer;
 
     QThread workerThread;
     DBWorker *worker;
+
+    friend class tst_dbmanager;
 };
 
 #endif // DBMANAGER_H
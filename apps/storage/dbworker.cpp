@@ -18,6 +18,7 @@
 #include <QDir>
 #include <QFile>
 #include <QDateTime>
+#include <QCryptographicHash>
 
 #include "dbworker.h"
 #include "browserpaths.h"
@@ -26,7 +27,7 @@
 #define DEBUG_LOGS 0
 #endif
 
-#define DB_USER_VERSION 1
+#define DB_USER_VERSION 5
 
 #define QUOTE(arg) #arg
 #define STR(arg) QUOTE(arg)
@@ -54,6 +55,14 @@ static const char * const create_table_browser_history =
         "date INTEGER"
         ");\n";
 
+// Host of the url as in Favicon::hostOf, tells whether a
+// host still has history without parsing the urls.
+static const char * const alter_table_browser_history_host =
+        "ALTER TABLE browser_history ADD COLUMN host TEXT;\n";
+
+static const char * const create_index_browser_history_host =
+        "CREATE INDEX IF NOT EXISTS browser_history_host_index ON browser_history (host);\n";
+
 static const char * const create_table_tab_history =
         "CREATE TABLE tab_history (id INTEGER PRIMARY KEY AUTOINCREMENT,\n"
         "tab_id INTEGER,\n"
@@ -66,6 +75,53 @@ static const char * const create_table_settings =
         "value TEXT\n"
         ");\n";
 
+// Icon data is stored once per content hash, favicon rows refer to it by hash.
+static const char * const create_table_favicon_data =
+        "CREATE TABLE favicon_data (hash TEXT PRIMARY KEY,\n"
+        "data BLOB\n"
+        ");\n";
+
+static const char * const create_table_favicon =
+        "CREATE TABLE favicon (type TEXT,\n"
+        "host TEXT,\n"
+        "hash TEXT,\n"
+        "icon TEXT,\n"
+        "has_touch_icon INTEGER DEFAULT 0,\n"
+        "PRIMARY KEY (type, host)\n"
+        ");\n";
+
+static const char * const create_index_favicon_hash =
+        "CREATE INDEX favicon_hash_index ON favicon (hash);\n";
+
+// Hosts whose touch icon could not be fetched, retried after retry_after.
+static const char * const create_table_favicon_failure =
+        "CREATE TABLE favicon_failure (host TEXT,\n"
+        "icon_url TEXT,\n"
+        "failures INTEGER,\n"
+        "retry_after INTEGER,\n"
+        "PRIMARY KEY (host, icon_url)\n"
+        ");\n";
+
+// Bookmarks and folders, ordered by position within their folder. Favicon
+// data is kept in favicon_data and read only when the icon is shown.
+static const char * const create_table_bookmark =
+        "CREATE TABLE bookmark (id INTEGER PRIMARY KEY AUTOINCREMENT,\n"
+        "folder_id INTEGER DEFAULT 0,\n"
+        "position INTEGER,\n"
+        "is_folder INTEGER DEFAULT 0,\n"
+        "url TEXT,\n"
+        "title TEXT,\n"
+        "favicon TEXT,\n"
+        "favicon_hash TEXT,\n"
+        "has_touch_icon INTEGER DEFAULT 0\n"
+        ");\n";
+
+static const char * const create_index_bookmark_folder =
+        "CREATE INDEX bookmark_folder_index ON bookmark (folder_id, position);\n";
+
+static const char * const create_index_bookmark_url =
+        "CREATE INDEX bookmark_url_index ON bookmark (url);\n";
+
 static const char * const set_user_version =
         "PRAGMA user_version=" STR(DB_USER_VERSION) ";\n";
 
@@ -74,7 +130,16 @@ static const char *db_schema[] = {
     create_table_tab_history,
     create_table_link,
     create_table_browser_history,
+    alter_table_browser_history_host,
+    create_index_browser_history_host,
     create_table_settings,
+    create_table_favicon_data,
+    create_table_favicon,
+    create_index_favicon_hash,
+    create_table_favicon_failure,
+    create_table_bookmark,
+    create_index_bookmark_folder,
+    create_index_bookmark_url,
     set_user_version
 };
 static int db_schema_count = sizeof(db_schema) / sizeof(*db_schema);
@@ -107,82 +172,203 @@ void DBWorker::init()
             QSqlQuery query = prepare(db_schema[i]);
             execute(query);
         }
-    } else {
-        // Limit history size to 2000 entries
-        QSqlQuery cleanupHistory = prepare("DELETE FROM browser_history WHERE id NOT IN (SELECT id from browser_history"\
-                                           " ORDER BY date DESC LIMIT " STR(MAX_BROWSER_HISTORY_SIZE) ");");
-        if (!execute(cleanupHistory)) {
-            qWarning() << "Failed to clear older history items";
-        }
     }
 
     // check current schema version and migrate if needed
     QSqlQuery schemaQuery = prepare("PRAGMA user_version;");
     if (execute(schemaQuery) && schemaQuery.next()) {
         int userVersion = schemaQuery.value(0).toInt();
-        if (userVersion == 0) {
-            migrateTo_1();
-        }
+        schemaQuery.finish();
+        migrate(userVersion);
     } else {
         qWarning() << "Failed to check schema version";
     }
 
+    // The hosts of the entries are there once migrated.
+    if (dbCreated) {
+        trimHistory();
+    }
+
     m_updateThumbPathQuery = prepare("UPDATE link SET thumb_path = ? "
                                      "WHERE link_id IN (SELECT link.link_id "
                                      "FROM tab_history INNER JOIN link ON tab_history.link_id=link.link_id WHERE tab_history.tab_id = ?);");
 }
 
-void DBWorker::setUserVersion(int userVersion)
+bool DBWorker::setUserVersion(int userVersion)
 {
     QSqlQuery updateQuery = prepare(QString("PRAGMA user_version = %1;").arg(userVersion));
     if (!execute(updateQuery)) {
         qWarning() << "Failed to update schema user version";
+        return false;
+    }
+    return true;
+}
+
+// Each migration is committed on its own and sets the user version, the ones
+// after a failed migration are not run as they depend on the earlier ones.
+void DBWorker::migrate(int userVersion)
+{
+    typedef bool (DBWorker::*Migration)();
+    static const Migration migrations[] = {
+        &DBWorker::migrateTo_1,
+        &DBWorker::migrateTo_2,
+        &DBWorker::migrateTo_3,
+        &DBWorker::migrateTo_4,
+        &DBWorker::migrateTo_5
+    };
+    Q_STATIC_ASSERT(sizeof(migrations) / sizeof(*migrations) == DB_USER_VERSION);
+
+    for (int version = userVersion + 1; version <= DB_USER_VERSION; ++version) {
+        m_database.transaction();
+        if (!(this->*migrations[version - 1])() || !setUserVersion(version) || !m_database.commit()) {
+            qCritical() << "Failed to migrate database to version" << version << m_database.lastError();
+            m_database.rollback();
+            return;
+        }
     }
 }
 
 // This method migrates data from history table (introduced in 42dbd01d23bc90cf1f5e177ceeefc05c91aa19cd) to browser_history table
-void DBWorker::migrateTo_1() {
+bool DBWorker::migrateTo_1() {
     // Check if browser_history table exists
     QSqlQuery browser_history_table_exists = prepare("SELECT name FROM sqlite_master WHERE type='table' AND name='browser_history';");
-    if(execute(browser_history_table_exists)) {
-        if (!browser_history_table_exists.first()) {
-            // browser_history table does not exist, let's create it
-            browser_history_table_exists.clear();
-            QSqlQuery create_browser_history_table = prepare(create_table_browser_history);
-            if (!execute(create_browser_history_table)) {
-                qCritical() << "Failed to create browser_history table";
-            }
-        }
-    } else {
+    if (!execute(browser_history_table_exists)) {
         qCritical() << "Failed to query for browser_history table";
+        return false;
+    }
+    if (!browser_history_table_exists.first()) {
+        // browser_history table does not exist, let's create it
+        browser_history_table_exists.clear();
+        QSqlQuery create_browser_history_table = prepare(create_table_browser_history);
+        if (!execute(create_browser_history_table)) {
+            qCritical() << "Failed to create browser_history table";
+            return false;
+        }
     }
 
     QSqlQuery history_table_exists = prepare("SELECT name FROM sqlite_master WHERE type='table' AND name='history';");
-    if(execute(history_table_exists)) {
-        if (history_table_exists.first()) {
-            // history table exists, migrate all it's data to browser_history table and delete it
-            history_table_exists.clear();
+    if (!execute(history_table_exists)) {
+        qCritical() << "Failed to query for history table";
+        return false;
+    }
+    if (history_table_exists.first()) {
+        // history table exists, migrate all it's data to browser_history table and delete it
+        history_table_exists.clear();
 
-            QSqlQuery update_browser_history = prepare("INSERT INTO browser_history (url, title, date) select "\
-                                               "link.url, link.title, history.date from link, history where "\
-                                               "history.link_id = link.link_id and NULLIF(link.title, '') IS NOT NULL and "\
-                                               "link.link_id in (select MAX(link_id) from link group by url);");
+        QSqlQuery update_browser_history = prepare("INSERT INTO browser_history (url, title, date) select "\
+                                           "link.url, link.title, history.date from link, history where "\
+                                           "history.link_id = link.link_id and NULLIF(link.title, '') IS NOT NULL and "\
+                                           "link.link_id in (select MAX(link_id) from link group by url);");
 
 
-            if (!execute(update_browser_history)) {
-                qCritical() << "Failed to update browser history";
-            }
+        if (!execute(update_browser_history)) {
+            qCritical() << "Failed to update browser history";
+            return false;
+        }
 
-            QSqlQuery delete_history_table = prepare("DROP TABLE history;");
-            if (!execute(delete_history_table)) {
-                qCritical() << "Failed to delete history table";
-            }
+        QSqlQuery delete_history_table = prepare("DROP TABLE history;");
+        if (!execute(delete_history_table)) {
+            qCritical() << "Failed to delete history table";
+            return false;
         }
-    } else {
-        qCritical() << "Failed to query for history table";
     }
 
-    setUserVersion(1);
+    return true;
+}
+
+// Favicons were stored in per type json files before, FaviconManager imports them.
+bool DBWorker::migrateTo_2()
+{
+    const char *statements[] = {
+        create_table_favicon_data,
+        create_table_favicon,
+        create_index_favicon_hash
+    };
+
+    for (const char *statement : statements) {
+        QSqlQuery query = prepare(statement);
+        if (!execute(query)) {
+            qCritical() << "Failed to create favicon tables";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DBWorker::migrateTo_3()
+{
+    QSqlQuery query = prepare(create_table_favicon_failure);
+    if (!execute(query)) {
+        qCritical() << "Failed to create favicon_failure table";
+        return false;
+    }
+
+    return true;
+}
+
+// Bookmarks were stored in bookmarks.json before, BookmarkManager imports them.
+bool DBWorker::migrateTo_4()
+{
+    const char *statements[] = {
+        create_table_bookmark,
+        create_index_bookmark_folder,
+        create_index_bookmark_url
+    };
+
+    for (const char *statement : statements) {
+        QSqlQuery query = prepare(statement);
+        if (!execute(query)) {
+            qCritical() << "Failed to create bookmark tables";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DBWorker::migrateTo_5()
+{
+    // Databases written by a build that failed later on already have the column.
+    bool hasHost = false;
+    QSqlQuery columns = prepare("PRAGMA table_info(browser_history);");
+    if (!execute(columns)) {
+        qCritical() << "Failed to query for browser_history columns";
+        return false;
+    }
+    while (columns.next()) {
+        hasHost |= columns.value(1).toString() == QLatin1String("host");
+    }
+    columns.finish();
+
+    if (!hasHost) {
+        QSqlQuery alter = prepare(alter_table_browser_history_host);
+        if (!execute(alter)) {
+            qCritical() << "Failed to add host to browser history";
+            return false;
+        }
+    }
+
+    QSqlQuery index = prepare(create_index_browser_history_host);
+    if (!execute(index)) {
+        qCritical() << "Failed to index browser history hosts";
+        return false;
+    }
+
+    QSqlQuery select = prepare("SELECT id, url FROM browser_history;");
+    QSqlQuery update = prepare("UPDATE browser_history SET host = ? WHERE id = ?;");
+    if (!execute(select)) {
+        return false;
+    }
+    while (select.next()) {
+        update.bindValue(0, Favicon::hostOf(select.value(1).toString()));
+        update.bindValue(1, select.value(0).toInt());
+        if (!execute(update)) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 QSqlQuery DBWorker::prepare(const QString &statement)
@@ -277,6 +463,45 @@ void DBWorker::removeTab(int tabId)
     }
 }
 
+void DBWorker::removeTabs(const QList<int> &tabIds)
+{
+#if DEBUG_LOGS
+    qDebug() << "tab ids:" << tabIds;
+#endif
+    m_database.transaction();
+
+    QSqlQuery tabQuery = prepare("DELETE FROM tab WHERE tab_id = ?;");
+    // Remove links that are only related to this tab
+    QSqlQuery linkQuery = prepare("DELETE FROM link WHERE link_id IN "
+                                  "(SELECT DISTINCT link_id FROM tab_history WHERE tab_id = ? "
+                                  "AND link_id NOT IN (SELECT link_id FROM tab_history WHERE tab_id != ? "
+                                  "))");
+    QSqlQuery historyQuery = prepare("DELETE FROM tab_history WHERE tab_id = ?;");
+
+    for (int tabId : tabIds) {
+        tabQuery.bindValue(0, tabId);
+        execute(tabQuery);
+
+        linkQuery.bindValue(0, tabId);
+        linkQuery.bindValue(1, tabId);
+        execute(linkQuery);
+
+        historyQuery.bindValue(0, tabId);
+        execute(historyQuery);
+    }
+
+    if (!m_database.commit()) {
+        qWarning() << Q_FUNC_INFO << "failed to commit tab removal:" << m_database.lastError();
+        m_database.rollback();
+    }
+
+    // Check last tab closed
+    if (!tabCount()) {
+        QList<Tab> tabList;
+        emit tabsAvailable(tabList);
+    }
+}
+
 void DBWorker::removeAllTabs(bool noFeedback)
 {
     int oldTabCount(0);
@@ -447,34 +672,51 @@ void DBWorker::addHistoryEntry(const QString &url, const QString &title)
     if (url.startsWith("about:")) {
         return;
     }
-    QSqlQuery query = prepare("SELECT 1 FROM browser_history WHERE url = ?;");
+    QSqlQuery query = prepare("SELECT id, title, visited_count FROM browser_history WHERE url = ?;");
 
     query.bindValue(0, url);
     if (!execute(query)) {
         return;
     }
 
+    const uint timestamp = QDateTime::currentDateTimeUtc().toTime_t();
+    Link link(0, url, "", title, QDateTime::fromMSecsSinceEpoch(timestamp*1000LL).date());
+    link.setLastVisit(timestamp);
+
     // Update history entry if it exists
     if (query.first()) {
+        link.setLinkId(query.value(0).toInt());
+        link.setVisitCount(query.value(2).toInt() + 1);
         if (title.isEmpty()) {
+            link.setTitle(query.value(1).toString());
             query = prepare("UPDATE browser_history SET date = ?, visited_count = visited_count + 1  WHERE url = ?;");
-            query.bindValue(0, QDateTime::currentDateTimeUtc().toTime_t());
+            query.bindValue(0, timestamp);
             query.bindValue(1, url);
         } else {
             query = prepare("UPDATE browser_history SET date = ?, title = ?, visited_count = visited_count + 1  WHERE url = ?;");
-            query.bindValue(0, QDateTime::currentDateTimeUtc().toTime_t());
+            query.bindValue(0, timestamp);
             query.bindValue(1, title);
             query.bindValue(2, url);
         }
-        execute(query);
+        if (!execute(query)) {
+            return;
+        }
     } else {
         // Otherwise create a new history entry
-        query = prepare("INSERT INTO browser_history (url, title, date) VALUES (?, ?, ?);");
+        query = prepare("INSERT INTO browser_history (url, title, date, host) VALUES (?, ?, ?, ?);");
         query.bindValue(0, url);
         query.bindValue(1, title);
-        query.bindValue(2, QDateTime::currentDateTimeUtc().toTime_t());
-        execute(query);
+        query.bindValue(2, timestamp);
+        query.bindValue(3, Favicon::hostOf(url));
+        if (!execute(query)) {
+            return;
+        }
+        link.setLinkId(query.lastInsertId().toInt());
+        link.setVisitCount(1);
     }
+
+    // Models apply the visit to their rows instead of querying the history again.
+    emit historyEntryAdded(link);
 }
 
 void DBWorker::clearHistory()
@@ -548,7 +790,7 @@ void DBWorker::getHistory(const QString &filter)
     QString queryString = QString("SELECT id, url, title, date, visited_count "
                                   "FROM browser_history "
                                   "%1"
-                                  "ORDER BY %2 LIMIT 20;").arg(filterQuery).arg(order);
+                                  "ORDER BY %2 LIMIT %3;").arg(filterQuery).arg(order).arg(HISTORY_LIMIT);
     QSqlQuery query = prepare(queryString);
     if (!filter.isEmpty()) {
         query.bindValue(QString(":search"), QString("%%1%").arg(filter));
@@ -566,6 +808,8 @@ void DBWorker::getHistory(const QString &filter)
                   "",
                   query.value(2).toString(),
                   QDateTime::fromMSecsSinceEpoch(timestamp*1000).date());
+        link.setLastVisit(timestamp);
+        link.setVisitCount(query.value(4).toInt());
 #if DEBUG_LOGS
         qDebug() << &link << "visitedCount:" << query.value(4).toInt();
 #endif
@@ -575,8 +819,108 @@ void DBWorker::getHistory(const QString &filter)
     emit historyAvailable(linkList);
 }
 
+void DBWorker::cancelSearch(int requestId)
+{
+    QMutexLocker locker(&m_cancelledSearchesMutex);
+    m_cancelledSearches.insert(requestId);
+}
+
+// Searches run in the order of their request ids, ids of earlier searches are forgotten.
+bool DBWorker::isCancelled(int requestId)
+{
+    QMutexLocker locker(&m_cancelledSearchesMutex);
+    const bool cancelled = m_cancelledSearches.remove(requestId);
+    QSet<int>::iterator it = m_cancelledSearches.begin();
+    while (it != m_cancelledSearches.end()) {
+        if (*it < requestId) {
+            it = m_cancelledSearches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return cancelled;
+}
+
+/**
+ * @brief DBWorker::searchHistory
+ * Finds history entries for suggestions, the most visited first. Unlike
+ * getHistory the result is only delivered to the request.
+ */
+void DBWorker::searchHistory(int requestId, const QString &filter, int limit)
+{
+    QList<Link> linkList;
+    if (isCancelled(requestId)) {
+        return;
+    }
+
+    QSqlQuery query = prepare("SELECT id, url, title, date, visited_count FROM browser_history "
+                              "WHERE url NOT LIKE 'about:%' AND (url LIKE :search OR title LIKE :search) "
+                              "ORDER BY visited_count DESC, date DESC LIMIT :limit;");
+    query.bindValue(QString(":search"), QString("%%1%").arg(filter));
+    query.bindValue(QString(":limit"), limit);
+    if (execute(query)) {
+        while (query.next()) {
+            qint64 timestamp = query.value(3).toLongLong();
+            Link link(query.value(0).toInt(),
+                      query.value(1).toString(),
+                      "",
+                      query.value(2).toString(),
+                      QDateTime::fromMSecsSinceEpoch(timestamp*1000).date());
+            link.setLastVisit(timestamp);
+            link.setVisitCount(query.value(4).toInt());
+            linkList.append(link);
+        }
+    }
+
+    emit historySearched(requestId, linkList);
+}
+
+void DBWorker::searchBookmarks(int requestId, const QString &filter, int limit)
+{
+    BookmarkList bookmarks;
+    if (isCancelled(requestId)) {
+        return;
+    }
+
+    QSqlQuery query = prepare("SELECT id, folder_id, url, title, favicon, favicon_hash, has_touch_icon FROM bookmark "
+                              "WHERE is_folder = 0 AND (url LIKE :search OR title LIKE :search) "
+                              "ORDER BY folder_id, position LIMIT :limit;");
+    query.bindValue(QString(":search"), QString("%%1%").arg(filter));
+    query.bindValue(QString(":limit"), limit);
+    if (execute(query)) {
+        while (query.next()) {
+            const QString hash = query.value(5).toString();
+            Bookmark bookmark(query.value(3).toString(),
+                              query.value(2).toString(),
+                              hash.isEmpty() ? query.value(4).toString()
+                                             : QStringLiteral("image://%1/%2").arg(QStringLiteral(FAVICON_PROVIDER), hash),
+                              query.value(6).toBool());
+            bookmark.setId(query.value(0).toInt());
+            bookmark.setFolderId(query.value(1).toInt());
+            bookmarks.append(bookmark);
+        }
+    }
+
+    emit bookmarksSearched(requestId, bookmarks);
+}
+
 void DBWorker::getTabHistory(int tabId)
 {
+    int currentLinkId(-1);
+    QList<Link> linkList = tabHistory(tabId, currentLinkId);
+    emit tabHistoryAvailable(tabId, linkList, currentLinkId);
+}
+
+void DBWorker::fetchTabHistory(int requestId, int tabId)
+{
+    int currentLinkId(-1);
+    QList<Link> linkList = tabHistory(tabId, currentLinkId);
+    emit tabHistoryFetched(requestId, linkList, currentLinkId);
+}
+
+QList<Link> DBWorker::tabHistory(int tabId, int &currentLinkId)
+{
+    QList<Link> linkList;
     QSqlQuery query = prepare("SELECT link.link_id, link.url, link.thumb_path, link.title, (tab_history.id == tab.tab_history_id) AS current "
                               "FROM tab_history "
                               "INNER JOIN tab ON tab.tab_id = tab_history.tab_id "
@@ -585,11 +929,9 @@ void DBWorker::getTabHistory(int tabId)
                               "ORDER BY tab_history.id DESC;");
     query.bindValue(0, tabId);
     if (!execute(query)) {
-        return;
+        return linkList;
     }
 
-    QList<Link> linkList;
-    int currentLinkId(-1);
     while (query.next()) {
         int linkId = query.value(0).toInt();
         Link tmp(linkId,
@@ -602,21 +944,88 @@ void DBWorker::getTabHistory(int tabId)
         }
     }
 
-    emit tabHistoryAvailable(tabId, linkList, currentLinkId);
+    return linkList;
 }
 
 void DBWorker::removeHistoryEntry(int linkId)
 {
-    QSqlQuery query = prepare("DELETE FROM browser_history WHERE id = ?");
-    query.bindValue(0, linkId);
-    execute(query);
+    removeHistoryEntries(QList<int>() << linkId);
 }
 
 void DBWorker::removeHistoryEntry(const QString &url)
 {
     QSqlQuery query = prepare("DELETE FROM browser_history WHERE url = ?");
     query.bindValue(0, url);
-    execute(query);
+    if (execute(query) && query.numRowsAffected() > 0) {
+        removeUnusedHosts(QSet<QString>() << Favicon::hostOf(url));
+    }
+}
+
+void DBWorker::removeHistoryEntries(const QList<int> &linkIds)
+{
+    QSet<QString> hosts;
+    m_database.transaction();
+
+    QSqlQuery select = prepare("SELECT host FROM browser_history WHERE id = ?;");
+    QSqlQuery remove = prepare("DELETE FROM browser_history WHERE id = ?;");
+    for (int linkId : linkIds) {
+        select.bindValue(0, linkId);
+        if (execute(select) && select.first()) {
+            hosts.insert(select.value(0).toString());
+            remove.bindValue(0, linkId);
+            execute(remove);
+        }
+    }
+
+    if (!m_database.commit()) {
+        qWarning() << Q_FUNC_INFO << "failed to commit history removal:" << m_database.lastError();
+        m_database.rollback();
+        return;
+    }
+
+    removeUnusedHosts(hosts);
+}
+
+// Limits history size to MAX_BROWSER_HISTORY_SIZE entries.
+void DBWorker::trimHistory()
+{
+    static const QString olderEntries = QStringLiteral("FROM browser_history WHERE id NOT IN (SELECT id FROM browser_history"
+                                                       " ORDER BY date DESC LIMIT " STR(MAX_BROWSER_HISTORY_SIZE) ");");
+    QSet<QString> hosts;
+    m_database.transaction();
+
+    QSqlQuery select = prepare(QStringLiteral("SELECT DISTINCT host ") + olderEntries);
+    if (execute(select)) {
+        while (select.next()) {
+            hosts.insert(select.value(0).toString());
+        }
+    }
+
+    QSqlQuery remove = prepare(QStringLiteral("DELETE ") + olderEntries);
+    if (!execute(remove) || !m_database.commit()) {
+        qWarning() << "Failed to clear older history items";
+        m_database.rollback();
+        return;
+    }
+
+    removeUnusedHosts(hosts);
+}
+
+// Tells the hosts of removed entries that have no history left, one index lookup per host.
+void DBWorker::removeUnusedHosts(const QSet<QString> &hosts)
+{
+    QStringList removedHosts;
+    QSqlQuery query = prepare("SELECT 1 FROM browser_history WHERE host = ? LIMIT 1;");
+    for (const QString &host : hosts) {
+        query.bindValue(0, host);
+        if (execute(query) && !query.first()) {
+            removedHosts.append(host);
+        }
+    }
+
+    if (!removedHosts.isEmpty()) {
+        emit historyHostsRemoved(removedHosts);
+    }
 }
 
 void DBWorker::updateThumbPath(int tabId, const QString &path)
@@ -628,6 +1037,30 @@ void DBWorker::updateThumbPath(int tabId, const QString &path)
     }
 }
 
+void DBWorker::updateThumbPaths(const ThumbPathMap &paths)
+{
+    m_database.transaction();
+
+    QList<int> updatedTabIds;
+    for (ThumbPathMap::const_iterator it = paths.constBegin(); it != paths.constEnd(); ++it) {
+        m_updateThumbPathQuery.bindValue(0, it.value());
+        m_updateThumbPathQuery.bindValue(1, it.key());
+        if (execute(m_updateThumbPathQuery)) {
+            updatedTabIds.append(it.key());
+        }
+    }
+
+    if (!m_database.commit()) {
+        qWarning() << Q_FUNC_INFO << "failed to commit thumbnail paths:" << m_database.lastError();
+        m_database.rollback();
+        return;
+    }
+
+    for (int tabId : updatedTabIds) {
+        emit thumbPathChanged(tabId, paths.value(tabId));
+    }
+}
+
 void DBWorker::updateTitle(int tabId, const QString &url, const QString &title)
 {
     // TODO: add DB indices
@@ -712,3 +1145,349 @@ void DBWorker::deleteSetting(const QString &name)
     query.bindValue(0, name);
     execute(query);
 }
+
+FaviconList DBWorker::getFavicons(const QString &type)
+{
+    FaviconList favicons;
+    QSqlQuery query = prepare("SELECT host, hash, icon, has_touch_icon FROM favicon WHERE type = ?;");
+    query.bindValue(0, type);
+    if (execute(query)) {
+        while (query.next()) {
+            Favicon favicon;
+            favicon.type = type;
+            favicon.host = query.value(0).toString();
+            favicon.hash = query.value(1).toString();
+            favicon.icon = query.value(2).toString();
+            favicon.hasTouchIcon = query.value(3).toBool();
+            favicons.append(favicon);
+        }
+    }
+    return favicons;
+}
+
+void DBWorker::storeFaviconData(const QString &hash, const QByteArray &data)
+{
+    QSqlQuery query = prepare("INSERT OR IGNORE INTO favicon_data (hash, data) VALUES (?, ?);");
+    query.bindValue(0, hash);
+    query.bindValue(1, data);
+    execute(query);
+}
+
+QByteArray DBWorker::getFaviconData(const QString &hash)
+{
+    QSqlQuery query = prepare("SELECT data FROM favicon_data WHERE hash = ?;");
+    query.bindValue(0, hash);
+    if (execute(query) && query.first()) {
+        return query.value(0).toByteArray();
+    }
+    return QByteArray();
+}
+
+/**
+ * @brief DBWorker::updateFavicons
+ * Writes changed favicons in one transaction. Null favicons are removed.
+ * Icon data that is no longer referred to is removed afterwards.
+ */
+void DBWorker::updateFavicons(const FaviconList &favicons)
+{
+    QSqlQuery replaceQuery = prepare("INSERT OR REPLACE INTO favicon (type, host, hash, icon, has_touch_icon) "
+                                     "VALUES (?, ?, ?, ?, ?);");
+    QSqlQuery removeQuery = prepare("DELETE FROM favicon WHERE type = ? AND host = ?;");
+
+    m_database.transaction();
+    for (const Favicon &favicon : favicons) {
+        if (favicon.isNull()) {
+            removeQuery.bindValue(0, favicon.type);
+            removeQuery.bindValue(1, favicon.host);
+            execute(removeQuery);
+        } else {
+            replaceQuery.bindValue(0, favicon.type);
+            replaceQuery.bindValue(1, favicon.host);
+            replaceQuery.bindValue(2, favicon.hash.isEmpty() ? QVariant(QVariant::String) : favicon.hash);
+            replaceQuery.bindValue(3, favicon.icon);
+            replaceQuery.bindValue(4, favicon.hasTouchIcon);
+            execute(replaceQuery);
+        }
+    }
+    removeUnusedFaviconData();
+
+    if (!m_database.commit()) {
+        qWarning() << Q_FUNC_INFO << "failed to commit favicons:" << m_database.lastError();
+        m_database.rollback();
+    }
+}
+
+void DBWorker::clearFavicons(const QString &type)
+{
+    QSqlQuery query = prepare("DELETE FROM favicon WHERE type = ?;");
+    query.bindValue(0, type);
+    if (execute(query)) {
+        removeUnusedFaviconData();
+    }
+}
+
+FaviconFailureList DBWorker::getFaviconFailures()
+{
+    FaviconFailureList failures;
+    QSqlQuery query = prepare("SELECT host, icon_url, failures, retry_after FROM favicon_failure;");
+    if (execute(query)) {
+        while (query.next()) {
+            FaviconFailure failure;
+            failure.host = query.value(0).toString();
+            failure.iconUrl = query.value(1).toString();
+            failure.failures = query.value(2).toInt();
+            failure.retryAfter = query.value(3).toLongLong();
+            failures.append(failure);
+        }
+    }
+    return failures;
+}
+
+// Writes changed failures in one transaction, null failures are removed.
+void DBWorker::updateFaviconFailures(const FaviconFailureList &failures)
+{
+    QSqlQuery replaceQuery = prepare("INSERT OR REPLACE INTO favicon_failure (host, icon_url, failures, retry_after) "
+                                     "VALUES (?, ?, ?, ?);");
+    QSqlQuery removeQuery = prepare("DELETE FROM favicon_failure WHERE host = ? AND icon_url = ?;");
+
+    m_database.transaction();
+    for (const FaviconFailure &failure : failures) {
+        if (failure.isNull()) {
+            removeQuery.bindValue(0, failure.host);
+            removeQuery.bindValue(1, failure.iconUrl);
+            execute(removeQuery);
+        } else {
+            replaceQuery.bindValue(0, failure.host);
+            replaceQuery.bindValue(1, failure.iconUrl);
+            replaceQuery.bindValue(2, failure.failures);
+            replaceQuery.bindValue(3, failure.retryAfter);
+            execute(replaceQuery);
+        }
+    }
+
+    if (!m_database.commit()) {
+        qWarning() << Q_FUNC_INFO << "failed to commit favicon failures:" << m_database.lastError();
+        m_database.rollback();
+    }
+}
+
+void DBWorker::clearFaviconFailures()
+{
+    QSqlQuery query = prepare("DELETE FROM favicon_failure;");
+    execute(query);
+}
+
+BookmarkList DBWorker::getBookmarks(int folderId, int offset, int limit)
+{
+    BookmarkList bookmarks;
+    QSqlQuery query = prepare("SELECT id, is_folder, url, title, favicon, favicon_hash, has_touch_icon FROM bookmark "
+                              "WHERE folder_id = ? ORDER BY position, id LIMIT ? OFFSET ?;");
+    query.bindValue(0, folderId);
+    query.bindValue(1, limit);
+    query.bindValue(2, offset);
+    if (execute(query)) {
+        bookmarks.reserve(limit > 0 ? limit : 0);
+        while (query.next()) {
+            Bookmark bookmark;
+            if (query.value(1).toBool()) {
+                bookmark = Bookmark::folder(query.value(3).toString(), folderId);
+            } else {
+                const QString hash = query.value(5).toString();
+                bookmark = Bookmark(query.value(3).toString(),
+                                    query.value(2).toString(),
+                                    hash.isEmpty() ? query.value(4).toString()
+                                                   : QStringLiteral("image://%1/%2").arg(QStringLiteral(FAVICON_PROVIDER), hash),
+                                    query.value(6).toBool());
+                bookmark.setFolderId(folderId);
+            }
+            bookmark.setId(query.value(0).toInt());
+            bookmarks.append(bookmark);
+        }
+    }
+    return bookmarks;
+}
+
+int DBWorker::getBookmarkCount(int folderId)
+{
+    QSqlQuery query = prepare("SELECT COUNT(*) FROM bookmark WHERE folder_id = ?;");
+    query.bindValue(0, folderId);
+    if (execute(query) && query.first()) {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+// Urls of the bookmarks in all folders, a url is listed once per bookmark.
+QStringList DBWorker::getBookmarkUrls()
+{
+    QStringList urls;
+    QSqlQuery query = prepare("SELECT url FROM bookmark WHERE is_folder = 0;");
+    if (execute(query)) {
+        while (query.next()) {
+            urls.append(query.value(0).toString());
+        }
+    }
+    return urls;
+}
+
+// Appends the bookmark to its folder and returns the id, -1 on failure.
+int DBWorker::addBookmark(const Bookmark &bookmark)
+{
+    QSqlQuery query = prepare("INSERT INTO bookmark (folder_id, position, is_folder, url, title, favicon, favicon_hash, has_touch_icon) "
+                              "VALUES (?, (SELECT IFNULL(MAX(position), 0) + 1 FROM bookmark WHERE folder_id = ?), ?, ?, ?, ?, ?, ?);");
+    return insertBookmark(query, bookmark);
+}
+
+void DBWorker::appendBookmark(int requestId, const Bookmark &bookmark)
+{
+    emit bookmarkAppended(requestId, addBookmark(bookmark));
+}
+
+/**
+ * @brief DBWorker::addBookmarks
+ * Appends the bookmarks to their folders in one transaction and returns the
+ * number of bookmarks added, or -1 if the transaction failed. Urls that are
+ * already bookmarked can be skipped.
+ */
+int DBWorker::addBookmarks(const BookmarkList &bookmarks, bool skipExisting)
+{
+    QSqlQuery insertQuery = prepare("INSERT INTO bookmark (folder_id, position, is_folder, url, title, favicon, favicon_hash, has_touch_icon) "
+                                    "VALUES (?, (SELECT IFNULL(MAX(position), 0) + 1 FROM bookmark WHERE folder_id = ?), ?, ?, ?, ?, ?, ?);");
+    QSqlQuery existsQuery = prepare("SELECT 1 FROM bookmark WHERE url = ? LIMIT 1;");
+    int added = 0;
+
+    m_database.transaction();
+    for (const Bookmark &bookmark : bookmarks) {
+        if (skipExisting && !bookmark.isFolder()) {
+            existsQuery.bindValue(0, bookmark.url());
+            if (execute(existsQuery) && existsQuery.first()) {
+                existsQuery.finish();
+                continue;
+            }
+            existsQuery.finish();
+        }
+        if (insertBookmark(insertQuery, bookmark) > 0) {
+            ++added;
+        }
+    }
+
+    if (!m_database.commit()) {
+        qWarning() << Q_FUNC_INFO << "failed to commit bookmarks:" << m_database.lastError();
+        m_database.rollback();
+        return -1;
+    }
+    return added;
+}
+
+void DBWorker::updateBookmark(const Bookmark &bookmark)
+{
+    QString favicon;
+    const QString hash = storeBookmarkFavicon(bookmark.favicon(), favicon);
+    QSqlQuery query = prepare("UPDATE bookmark SET url = ?, title = ?, favicon = ?, favicon_hash = ?, has_touch_icon = ? "
+                              "WHERE id = ?;");
+    query.bindValue(0, bookmark.url());
+    query.bindValue(1, bookmark.title());
+    query.bindValue(2, favicon);
+    query.bindValue(3, hash.isEmpty() ? QVariant(QVariant::String) : hash);
+    query.bindValue(4, bookmark.hasTouchIcon());
+    query.bindValue(5, bookmark.id());
+    execute(query);
+}
+
+void DBWorker::updateBookmarkFavicon(const QString &url, const QString &favicon, bool hasTouchIcon)
+{
+    QString icon;
+    const QString hash = storeBookmarkFavicon(favicon, icon);
+    QSqlQuery query = prepare("UPDATE bookmark SET favicon = ?, favicon_hash = ?, has_touch_icon = ? WHERE url = ?;");
+    query.bindValue(0, icon);
+    query.bindValue(1, hash.isEmpty() ? QVariant(QVariant::String) : hash);
+    query.bindValue(2, hasTouchIcon);
+    query.bindValue(3, url);
+    execute(query);
+}
+
+// Removes the bookmark, a folder is removed with its contents.
+void DBWorker::removeBookmark(int id)
+{
+    QSqlQuery query = prepare("WITH RECURSIVE removed(id) AS (SELECT ? UNION ALL "
+                              "SELECT bookmark.id FROM bookmark INNER JOIN removed ON bookmark.folder_id = removed.id) "
+                              "DELETE FROM bookmark WHERE id IN (SELECT id FROM removed);");
+    query.bindValue(0, id);
+    execute(query);
+}
+
+// Removes the latest bookmark of the url.
+void DBWorker::removeBookmark(const QString &url)
+{
+    QSqlQuery query = prepare("DELETE FROM bookmark WHERE id = "
+                              "(SELECT MAX(id) FROM bookmark WHERE url = ? AND is_folder = 0);");
+    query.bindValue(0, url);
+    execute(query);
+}
+
+void DBWorker::clearBookmarks()
+{
+    QSqlQuery query = prepare("DELETE FROM bookmark;");
+    execute(query);
+}
+
+int DBWorker::insertBookmark(QSqlQuery &query, const Bookmark &bookmark)
+{
+    QString favicon;
+    const QString hash = storeBookmarkFavicon(bookmark.favicon(), favicon);
+    query.bindValue(0, bookmark.folderId());
+    query.bindValue(1, bookmark.folderId());
+    query.bindValue(2, bookmark.isFolder());
+    query.bindValue(3, bookmark.isFolder() ? QVariant(QVariant::String) : bookmark.url());
+    query.bindValue(4, bookmark.title());
+    query.bindValue(5, favicon);
+    query.bindValue(6, hash.isEmpty() ? QVariant(QVariant::String) : hash);
+    query.bindValue(7, bookmark.hasTouchIcon());
+    if (!execute(query)) {
+        return -1;
+    }
+    return query.lastInsertId().toInt();
+}
+
+/**
+ * @brief DBWorker::storeBookmarkFavicon
+ * Stores the icon data of a data url favicon and returns its hash. Favicons
+ * that already refer to stored data return their hash, other favicons such
+ * as theme icon names are returned in icon.
+ */
+QString DBWorker::storeBookmarkFavicon(const QString &favicon, QString &icon)
+{
+    static const QString providerPrefix = QStringLiteral("image://%1/").arg(QStringLiteral(FAVICON_PROVIDER));
+
+    icon.clear();
+    if (favicon.startsWith(providerPrefix)) {
+        return favicon.mid(providerPrefix.length());
+    }
+
+    const int start = favicon.indexOf(QLatin1String(";base64,"));
+    if (favicon.startsWith(QLatin1String("data:")) && start > 0) {
+        const QByteArray data = QByteArray::fromBase64(favicon.midRef(start + 8).toLatin1());
+        if (!data.isEmpty()) {
+            const QString hash = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+            storeFaviconData(hash, data);
+            return hash;
+        }
+    }
+
+    icon = favicon;
+    return QString();
+}
+
+/**
+ * @brief DBWorker::removeUnusedFaviconData
+ * Icon data is stored as soon as it is received, while the favicon referring
+ * to it is written in the next batch. Unused data is therefore removed only
+ * after FaviconManager has written its pending favicons.
+ */
+void DBWorker::removeUnusedFaviconData()
+{
+    QSqlQuery query = prepare("DELETE FROM favicon_data WHERE hash NOT IN "
+                              "(SELECT hash FROM favicon WHERE hash IS NOT NULL) AND hash NOT IN "
+                              "(SELECT favicon_hash FROM bookmark WHERE favicon_hash IS NOT NULL);");
+    execute(query);
+}
@@ -12,16 +12,23 @@
 #define DBWORKER_H
 
 #include <QObject>
+#include <QHash>
 #include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 
+#include "bookmark.h"
+#include "favicon.h"
 #include "link.h"
 #include "tab.h"
 
-// Typedefs are necessary because of use of Q_RETURN_ARG, which does understand
+// Typedefs are necessary because of use of Q_ARG and Q_RETURN_ARG, which do not understand
 // comma-separated types
 typedef QMap<QString, QString> SettingsMap;
+typedef QHash<int, QString> ThumbPathMap;
 
 enum HistoryResult { Error, Added, Skipped };
 
@@ -32,10 +39,14 @@ class DBWorker : public QObject
 public:
     DBWorker(QObject *parent = 0);
 
+    // Thread safe, a cancelled search is skipped if it has not run yet.
+    void cancelSearch(int requestId);
+
 public slots:
     void init();
     void createTab(const Tab &tab);
     void removeTab(int tabId);
+    void removeTabs(const QList<int> &tabIds);
     void getAllTabs();
     void removeAllTabs(bool noFeedback = false);
     void navigateTo(int tabId, const QString &url, const QString &title, const QString &path);
@@ -43,44 +54,92 @@ public slots:
 
     void updateTitle(int tabId, const QString &url, const QString &title);
     void updateThumbPath(int tabId, const QString &path);
+    void updateThumbPaths(const ThumbPathMap &paths);
 
     void goForward(int tabId);
     void goBack(int tabId);
     void getHistory(const QString &filter);
     void getTabHistory(int tabId);
+    void fetchTabHistory(int requestId, int tabId);
 
     void removeHistoryEntry(int linkId);
     void removeHistoryEntry(const QString &url);
+    void removeHistoryEntries(const QList<int> &linkIds);
     void addHistoryEntry(const QString &url, const QString &title);
     void clearHistory();
+    void searchHistory(int requestId, const QString &filter, int limit);
+    void searchBookmarks(int requestId, const QString &filter, int limit);
 
     void saveSetting(const QString &name, const QString &value);
     SettingsMap getSettings();
     void deleteSetting(const QString &name);
 
+    FaviconList getFavicons(const QString &type);
+    void storeFaviconData(const QString &hash, const QByteArray &data);
+    QByteArray getFaviconData(const QString &hash);
+    void updateFavicons(const FaviconList &favicons);
+    void clearFavicons(const QString &type);
+
+    FaviconFailureList getFaviconFailures();
+    void updateFaviconFailures(const FaviconFailureList &failures);
+    void clearFaviconFailures();
+
+    BookmarkList getBookmarks(int folderId, int offset, int limit);
+    int getBookmarkCount(int folderId);
+    QStringList getBookmarkUrls();
+    int addBookmark(const Bookmark &bookmark);
+    void appendBookmark(int requestId, const Bookmark &bookmark);
+    int addBookmarks(const BookmarkList &bookmarks, bool skipExisting);
+    void updateBookmark(const Bookmark &bookmark);
+    void updateBookmarkFavicon(const QString &url, const QString &favicon, bool hasTouchIcon);
+    void removeBookmark(int id);
+    void removeBookmark(const QString &url);
+    void clearBookmarks();
+
 signals:
     void tabsAvailable(QList<Tab> tabs);
     void thumbPathChanged(int tabId, const QString &path);
     void titleChanged(const QString &url, const QString &title);
     void tabHistoryAvailable(int tabId, QList<Link>, int currentLinkId);
+    void tabHistoryFetched(int requestId, QList<Link>, int currentLinkId);
     void historyAvailable(QList<Link>);
+    void historyEntryAdded(Link link);
+    void historyHostsRemoved(const QStringList &hosts);
+    void historySearched(int requestId, QList<Link> links);
+    void bookmarksSearched(int requestId, BookmarkList bookmarks);
+    void bookmarkAppended(int requestId, int id);
     void error(const QString &query);
 
 private:
     int addToTabHistory(int tabId, int linkId);
     Link getCurrentLink(int tabId);
+    QList<Link> tabHistory(int tabId, int &currentLinkId);
     void clearDeprecatedTabHistory(int tabId, int currentLinkId);
     int createLink(const QString &url, const QString &title = QString(), const QString &thumbPath = QString());
     void updateTab(int tabId, int tabHistoryId);
     int tabCount();
     int integerQuery(const QString &statement);
-    void migrateTo_1();
-    void setUserVersion(int userVersion);
+    void migrate(int userVersion);
+    bool migrateTo_1();
+    bool migrateTo_2();
+    bool migrateTo_3();
+    bool migrateTo_4();
+    bool migrateTo_5();
+    void removeUnusedFaviconData();
+    void trimHistory();
+    void removeUnusedHosts(const QSet<QString> &hosts);
+    bool isCancelled(int requestId);
+    int insertBookmark(QSqlQuery &query, const Bookmark &bookmark);
+    QString storeBookmarkFavicon(const QString &favicon, QString &icon);
+    bool setUserVersion(int userVersion);
 
     QSqlQuery prepare(const QString &statement);
     bool execute(QSqlQuery &query);
     QSqlDatabase m_database;
     QSqlQuery m_updateThumbPathQuery;
+
+    QMutex m_cancelledSearchesMutex;
+    QSet<int> m_cancelledSearches;
 };
 
 #endif // DBWORKER_H
@@ -0,0 +1,73 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Open Mobile Platform LLC.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef FAVICON_H
+#define FAVICON_H
+
+#include <QList>
+#include <QMetaType>
+#include <QString>
+#include <QUrl>
+
+/**
+ * Favicon of a host in a favicon set such as "history" or "logins". Icon data
+ * is stored once per content hash and shared by all the hosts referring to it.
+ * A favicon without a hash and an icon removes the host from the set when
+ * written to the database.
+ */
+struct Favicon
+{
+    Favicon() : hasTouchIcon(false) {}
+
+    bool isNull() const { return hash.isEmpty() && icon.isEmpty(); }
+
+    // Scheme and host of the url. Favicons are stored per host, and history
+    // entries are grouped by the same host.
+    static QString hostOf(const QString &url)
+    {
+        const QUrl parsedUrl(url);
+        return QStringLiteral("%1://%2").arg(parsedUrl.scheme(), parsedUrl.host());
+    }
+
+    QString type;
+    QString host;
+    // Sha1 of the icon data, empty for theme icons.
+    QString hash;
+    // Theme icon name when the icon has no data.
+    QString icon;
+    bool hasTouchIcon;
+};
+
+typedef QList<Favicon> FaviconList;
+
+/**
+ * Failed attempt to fetch the touch icon of a host. The icon is not requested
+ * again before the retry time. A failure without failures clears the host
+ * and icon url when written to the database.
+ */
+struct FaviconFailure
+{
+    FaviconFailure() : failures(0), retryAfter(0) {}
+
+    bool isNull() const { return failures == 0; }
+
+    QString host;
+    QString iconUrl;
+    int failures;
+    // Milliseconds since epoch.
+    qint64 retryAfter;
+};
+
+typedef QList<FaviconFailure> FaviconFailureList;
+
+Q_DECLARE_METATYPE(Favicon)
+Q_DECLARE_METATYPE(FaviconFailure)
+
+#endif // FAVICON_H
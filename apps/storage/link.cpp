@@ -11,14 +11,17 @@
 
 #include "link.h"
 #include <QDebug>
+#include <QUrl>
 
 Link::Link(int linkId, const QString &urlString, const QString &thumbPath, const QString &title, const QDate &date) :
-    m_linkId(linkId), m_url(urlString), m_thumbPath(thumbPath), m_title(title), m_date(date)
+    m_linkId(linkId), m_url(urlString), m_thumbPath(thumbPath), m_title(title), m_date(date),
+    m_lastVisit(0), m_visitCount(0)
 {
 }
 
 Link::Link() :
-    m_linkId(0), m_url(""), m_thumbPath(""), m_title(""), m_date(QDate())
+    m_linkId(0), m_url(""), m_thumbPath(""), m_title(""), m_date(QDate()),
+    m_lastVisit(0), m_visitCount(0)
 {
 }
 
@@ -27,7 +30,9 @@ Link::Link(const Link& l) :
     m_url(l.m_url),
     m_thumbPath(l.m_thumbPath),
     m_title(l.m_title),
-    m_date(l.m_date)
+    m_date(l.m_date),
+    m_lastVisit(l.m_lastVisit),
+    m_visitCount(l.m_visitCount)
 {
 }
 
@@ -100,6 +105,65 @@ void Link::setDate(const QDate &date)
     m_date = date;
 }
 
+uint Link::lastVisit() const
+{
+    return m_lastVisit;
+}
+
+void Link::setLastVisit(uint lastVisit)
+{
+    m_lastVisit = lastVisit;
+}
+
+int Link::visitCount() const
+{
+    return m_visitCount;
+}
+
+void Link::setVisitCount(int visitCount)
+{
+    m_visitCount = visitCount;
+}
+
+/**
+ * @brief Link::canonicalUrl
+ * Returns the key used for comparing urls of tabs and suggestions: scheme and
+ * host are lower cased, default http(s) ports and dot segments are dropped,
+ * and a trailing slash is removed when the url has neither query nor fragment. QUrl::StripTrailingSlash
+ * cannot be used as it keeps the slash when the path is "/" e.i.
+ * http://www.sailfishos.org vs http://www.sailfishos.org/
+ */
+QString Link::canonicalUrl(const QString &url)
+{
+    const QString trimmed = url.trimmed();
+    if (trimmed.isEmpty()) {
+        return QString();
+    }
+
+    QUrl canonical(trimmed);
+    if (!canonical.isValid()) {
+        return QString();
+    }
+
+    const QString scheme = canonical.scheme().toLower();
+    canonical.setScheme(scheme);
+    canonical.setHost(canonical.host().toLower());
+    if ((scheme == QLatin1String("http") && canonical.port() == 80)
+            || (scheme == QLatin1String("https") && canonical.port() == 443)) {
+        canonical.setPort(-1);
+    }
+    canonical = canonical.adjusted(QUrl::NormalizePathSegments);
+
+    if (!canonical.hasFragment() && !canonical.hasQuery()) {
+        QString path = canonical.path(QUrl::FullyEncoded);
+        if (path.endsWith(QLatin1Char('/'))) {
+            path.chop(1);
+            canonical.setPath(path, QUrl::StrictMode);
+        }
+    }
+    return canonical.toString(QUrl::FullyEncoded);
+}
+
 QDebug operator<<(QDebug dbg, const Link *link) {
     if (!link) {
         return dbg << "Link (this = 0x0)";
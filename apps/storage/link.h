@@ -43,12 +43,23 @@ public:
     QDate date() const;
     void setDate(const QDate &date);
 
+    // Browser history: time of the last visit in seconds since the epoch and number of visits.
+    uint lastVisit() const;
+    void setLastVisit(uint lastVisit);
+
+    int visitCount() const;
+    void setVisitCount(int visitCount);
+
+    static QString canonicalUrl(const QString &url);
+
 private:
     int m_linkId;
     QString m_url;
     QString m_thumbPath;
     QString m_title;
     QDate m_date;
+    uint m_lastVisit;
+    int m_visitCount;
 };
 
 QDebug operator<<(QDebug, const Link *);
@@ -1,17 +1,26 @@
 INCLUDEPATH += $$PWD
 
+QT += concurrent
+
 # C++ sources
 SOURCES += \
+    $$PWD/bookmark.cpp \
     $$PWD/dbmanager.cpp \
     $$PWD/dbworker.cpp \
     $$PWD/link.cpp \
-    $$PWD/tab.cpp
+    $$PWD/tab.cpp \
+    $$PWD/thumbnailcache.cpp
 
 # C++ headers
 HEADERS += \
+    $$PWD/bookmark.h \
     $$PWD/dbmanager.h \
     $$PWD/dbworker.h \
+    $$PWD/favicon.h \
     $$PWD/link.h \
-    $$PWD/tab.h
+    $$PWD/tab.h \
+    $$PWD/thumbnailcache.h
 
 DEFINES += DB_NAME=\\\"sailfish-browser.sqlite\\\"
+# Rows of browser history returned by a search
+DEFINES += HISTORY_LIMIT=20
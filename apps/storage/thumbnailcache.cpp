@@ -0,0 +1,385 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "thumbnailcache.h"
+#include "browserpaths.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QtConcurrent>
+
+#ifndef DEBUG_LOGS
+#define DEBUG_LOGS 0
+#endif
+
+static const qint64 gDefaultBudget = 20 * 1024 * 1024;
+// Orphan sweep is deferred so that it does not compete with startup.
+static const int gSweepDelay = 10000;
+
+// Tab id of a thumbnail file name, -1 for other files.
+static int thumbnailTabId(const QString &fileName)
+{
+    static const QRegularExpression thumbnailName(QStringLiteral("^tab-(\\d+)-thumb\\.jpg$"));
+    QRegularExpressionMatch match = thumbnailName.match(fileName);
+    return match.hasMatch() ? match.captured(1).toInt() : -1;
+}
+
+ThumbnailCache *ThumbnailCache::instance()
+{
+    static ThumbnailCache *singleton = nullptr;
+    if (!singleton) {
+        singleton = new ThumbnailCache();
+    }
+
+    return singleton;
+}
+
+ThumbnailCache::ThumbnailCache(QObject *parent)
+    : QObject(parent)
+    , m_directory(QDir::cleanPath(BrowserPaths::cacheLocation()))
+    , m_useCounter(0)
+    , m_size(0)
+    , m_budget(gDefaultBudget)
+    , m_maxTabId(0)
+{
+    m_sweepTimer.setSingleShot(true);
+    m_sweepTimer.setInterval(gSweepDelay);
+    connect(&m_sweepTimer, &QTimer::timeout, this, &ThumbnailCache::sweep);
+    connect(&m_sweepWatcher, &QFutureWatcher<SweepResult>::finished, this, &ThumbnailCache::sweepDone);
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    cancelRemovals();
+    m_sweepWatcher.waitForFinished();
+}
+
+void ThumbnailCache::setBudget(qint64 bytes)
+{
+    if (bytes > 0 && m_budget != bytes) {
+        m_budget = bytes;
+        enforceBudget();
+    }
+}
+
+qint64 ThumbnailCache::budget() const
+{
+    return m_budget;
+}
+
+qint64 ThumbnailCache::size() const
+{
+    return m_size;
+}
+
+int ThumbnailCache::count() const
+{
+    return m_entries.count();
+}
+
+QString ThumbnailCache::path(int tabId) const
+{
+    return m_entries.value(tabId).path;
+}
+
+/**
+ * @brief ThumbnailCache::restore
+ * Indexes thumbnails of the restored tabs and schedules the orphan sweep.
+ * File sizes of restored thumbnails are resolved by the sweep.
+ */
+void ThumbnailCache::restore(const QList<Tab> &tabs)
+{
+    m_entries.clear();
+    m_lru.clear();
+    m_size = 0;
+    m_liveTabIds.clear();
+
+    for (const Tab &tab : tabs) {
+        m_liveTabIds.insert(tab.tabId());
+        m_maxTabId = qMax(m_maxTabId, tab.tabId());
+        if (QDir::isAbsolutePath(tab.thumbnailPath())) {
+            Entry entry = { QDir::cleanPath(tab.thumbnailPath()), 0, ++m_useCounter, false };
+            m_entries.insert(tab.tabId(), entry);
+            m_lru.insert(entry.lastUse, tab.tabId());
+        }
+    }
+
+    m_sweepTimer.start();
+}
+
+/**
+ * @brief ThumbnailCache::insert
+ * Indexes a thumbnail written for the tab as the most recently used one
+ * and evicts least recently used thumbnails if the budget is exceeded.
+ */
+void ThumbnailCache::insert(int tabId, const QString &path)
+{
+    if (!QDir::isAbsolutePath(path)) {
+        return;
+    }
+
+    take(tabId);
+
+    // Running removals keep the new thumbnail, also when the tab id is reused.
+    pruneRemovals();
+    for (const QSharedPointer<Removal> &removal : m_removals) {
+        QMutexLocker locker(&removal->mutex);
+        removal->insertedTabIds.insert(tabId);
+    }
+
+    Entry entry = { QDir::cleanPath(path), QFileInfo(path).size(), ++m_useCounter, true };
+    m_entries.insert(tabId, entry);
+    m_lru.insert(entry.lastUse, tabId);
+    m_size += entry.size;
+    m_liveTabIds.insert(tabId);
+    m_maxTabId = qMax(m_maxTabId, tabId);
+
+    enforceBudget();
+}
+
+void ThumbnailCache::touch(int tabId)
+{
+    QHash<int, Entry>::iterator it = m_entries.find(tabId);
+    if (it != m_entries.end()) {
+        m_lru.remove(it->lastUse);
+        it->lastUse = ++m_useCounter;
+        m_lru.insert(it->lastUse, tabId);
+    }
+}
+
+/**
+ * @brief ThumbnailCache::remove
+ * Forgets thumbnails of closed tabs and removes both the indexed files and
+ * the given paths in a worker thread.
+ */
+void ThumbnailCache::remove(const QList<int> &tabIds, const QStringList &paths)
+{
+    QStringList files;
+    for (int tabId : tabIds) {
+        QString path = m_entries.value(tabId).path;
+        if (!path.isEmpty()) {
+            files.append(path);
+        }
+        take(tabId);
+        m_liveTabIds.remove(tabId);
+    }
+
+    for (const QString &path : paths) {
+        if (QDir::isAbsolutePath(path) && !files.contains(QDir::cleanPath(path))) {
+            files.append(QDir::cleanPath(path));
+        }
+    }
+
+    if (!files.isEmpty()) {
+        QtConcurrent::run(&ThumbnailCache::removeFiles, files);
+    }
+}
+
+/**
+ * @brief ThumbnailCache::clear
+ * Removes all thumbnails, used when all tabs are removed directly from the
+ * database. Tab ids start over, thumbnails inserted after the clear are kept.
+ * A running sweep is cancelled without waiting for it.
+ */
+void ThumbnailCache::clear()
+{
+    m_sweepTimer.stop();
+    // Running sweeps and clears only know the tabs of before.
+    cancelRemovals();
+    m_entries.clear();
+    m_lru.clear();
+    m_size = 0;
+    m_liveTabIds.clear();
+    m_maxTabId = 0;
+
+    QtConcurrent::run(&ThumbnailCache::removeThumbnails, m_directory, startRemoval());
+}
+
+void ThumbnailCache::sweep()
+{
+    if (m_sweepWatcher.isRunning() && !m_sweepRemoval->cancelled) {
+        return;
+    }
+
+    // The result of a cancelled sweep is dropped with its future.
+    m_sweepRemoval = startRemoval();
+    m_sweepWatcher.setFuture(QtConcurrent::run(&ThumbnailCache::sweepDirectory,
+                                               m_directory, m_liveTabIds, m_maxTabId, m_sweepRemoval));
+}
+
+void ThumbnailCache::sweepDone()
+{
+    if (m_sweepRemoval->cancelled) {
+        return;
+    }
+
+    const SweepResult result = m_sweepWatcher.result();
+
+    // Restored thumbnails get their sizes, missing ones are dropped.
+    QList<int> missing;
+    for (QHash<int, Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (!it->sized) {
+            if (result.sizes.contains(it.key())) {
+                it->size = result.sizes.value(it.key());
+                it->sized = true;
+                m_size += it->size;
+            } else {
+                missing.append(it.key());
+            }
+        }
+    }
+
+    for (int tabId : missing) {
+        take(tabId);
+        emit evicted(tabId);
+    }
+
+#if DEBUG_LOGS
+    qDebug() << "removed" << result.removedFiles << "orphaned thumbnails," << result.removedBytes
+             << "bytes, cache size:" << m_size << "bytes";
+#endif
+
+    enforceBudget();
+    emit sweepFinished(result.removedFiles);
+}
+
+void ThumbnailCache::take(int tabId)
+{
+    QHash<int, Entry>::iterator it = m_entries.find(tabId);
+    if (it != m_entries.end()) {
+        m_lru.remove(it->lastUse);
+        m_size -= it->size;
+        m_entries.erase(it);
+    }
+}
+
+void ThumbnailCache::enforceBudget()
+{
+    // The most recently used thumbnail is always kept.
+    QHash<int, QString> files;
+    while (m_size > m_budget && m_lru.count() > 1) {
+        int tabId = m_lru.first();
+        files.insert(tabId, m_entries.value(tabId).path);
+        take(tabId);
+#if DEBUG_LOGS
+        qDebug() << "evicted thumbnail of tab:" << tabId << "cache size:" << m_size;
+#endif
+        emit evicted(tabId);
+    }
+
+    // A page that rewrites its thumbnail meanwhile inserts it again and keeps it.
+    if (!files.isEmpty()) {
+        QtConcurrent::run(&ThumbnailCache::removeEvicted, files, startRemoval());
+    }
+}
+
+QSharedPointer<ThumbnailCache::Removal> ThumbnailCache::startRemoval()
+{
+    pruneRemovals();
+    QSharedPointer<Removal> removal(new Removal);
+    m_removals.append(removal);
+    return removal;
+}
+
+void ThumbnailCache::pruneRemovals()
+{
+    for (QList<QSharedPointer<Removal> >::iterator it = m_removals.begin(); it != m_removals.end();) {
+        QMutexLocker locker(&(*it)->mutex);
+        const bool finished = (*it)->finished;
+        locker.unlock();
+        it = finished ? m_removals.erase(it) : it + 1;
+    }
+}
+
+void ThumbnailCache::cancelRemovals()
+{
+    for (const QSharedPointer<Removal> &removal : m_removals) {
+        QMutexLocker locker(&removal->mutex);
+        removal->cancelled = true;
+    }
+    m_removals.clear();
+}
+
+// Runs in a worker thread.
+ThumbnailCache::SweepResult ThumbnailCache::sweepDirectory(const QString &directory, const QSet<int> &liveTabIds, int maxTabId,
+                                                           QSharedPointer<Removal> removal)
+{
+    SweepResult result;
+    QDirIterator it(directory, QStringList() << QStringLiteral("tab-*-thumb.jpg"), QDir::Files);
+    while (it.hasNext()) {
+        it.next();
+        const int tabId = thumbnailTabId(it.fileName());
+        if (tabId < 0) {
+            continue;
+        }
+
+        const qint64 size = it.fileInfo().size();
+        if (liveTabIds.contains(tabId)) {
+            result.sizes.insert(tabId, size);
+        } else if (tabId <= maxTabId && removeThumbnail(removal.data(), tabId, it.filePath())) {
+            // Tabs created after the sweep was started have larger ids.
+            ++result.removedFiles;
+            result.removedBytes += size;
+        }
+    }
+
+    QMutexLocker locker(&removal->mutex);
+    removal->finished = true;
+    return result;
+}
+
+// Runs in a worker thread.
+void ThumbnailCache::removeThumbnails(const QString &directory, QSharedPointer<Removal> removal)
+{
+    QDirIterator it(directory, QStringList() << QStringLiteral("tab-*-thumb.jpg"), QDir::Files);
+    while (it.hasNext()) {
+        it.next();
+        const int tabId = thumbnailTabId(it.fileName());
+        if (tabId >= 0) {
+            removeThumbnail(removal.data(), tabId, it.filePath());
+        }
+    }
+
+    QMutexLocker locker(&removal->mutex);
+    removal->finished = true;
+}
+
+// Runs in a worker thread.
+void ThumbnailCache::removeEvicted(const QHash<int, QString> &paths, QSharedPointer<Removal> removal)
+{
+    for (QHash<int, QString>::const_iterator it = paths.constBegin(); it != paths.constEnd(); ++it) {
+        removeThumbnail(removal.data(), it.key(), it.value());
+    }
+
+    QMutexLocker locker(&removal->mutex);
+    removal->finished = true;
+}
+
+// Runs in a worker thread. The file is removed while holding the lock, so
+// that a tab inserted meanwhile either keeps its thumbnail or comes after.
+bool ThumbnailCache::removeThumbnail(Removal *removal, int tabId, const QString &path)
+{
+    QMutexLocker locker(&removal->mutex);
+    if (removal->cancelled || removal->insertedTabIds.contains(tabId)) {
+        return false;
+    }
+    return QFile::remove(path);
+}
+
+// Runs in a worker thread.
+void ThumbnailCache::removeFiles(const QStringList &paths)
+{
+    for (const QString &path : paths) {
+        QFile::remove(path);
+    }
+}
@@ -0,0 +1,123 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QSharedPointer>
+#include <QTimer>
+
+#include "tab.h"
+
+/**
+ * Keeps track of tab thumbnail files in the cache directory. Thumbnails are
+ * indexed by the owning tab and evicted in least recently used order when the
+ * disk budget is exceeded. Files that are not owned by any tab are removed by
+ * a sweep that runs in a worker thread a while after the tabs are restored.
+ */
+class ThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ThumbnailCache *instance();
+    ~ThumbnailCache();
+
+    void setBudget(qint64 bytes);
+    qint64 budget() const;
+    qint64 size() const;
+    int count() const;
+    QString path(int tabId) const;
+
+    void restore(const QList<Tab> &tabs);
+    void insert(int tabId, const QString &path);
+    void touch(int tabId);
+    void remove(const QList<int> &tabIds, const QStringList &paths);
+    void clear();
+
+    struct SweepResult {
+        SweepResult() : removedFiles(0), removedBytes(0) {}
+
+        // Sizes of the files owned by live tabs keyed by tab id.
+        QHash<int, qint64> sizes;
+        int removedFiles;
+        qint64 removedBytes;
+    };
+
+signals:
+    void evicted(int tabId);
+    void sweepFinished(int removedFiles);
+
+private slots:
+    void sweep();
+    void sweepDone();
+
+private:
+    ThumbnailCache(QObject *parent = nullptr);
+
+    struct Entry {
+        QString path;
+        qint64 size;
+        quint64 lastUse;
+        // Size is known, restored entries get their size from the sweep.
+        bool sized;
+    };
+
+    // Shared with a sweep or clear running in a worker thread. Thumbnails of
+    // tabs inserted meanwhile are kept and cancelled ones remove no more files.
+    struct Removal {
+        Removal() : cancelled(false), finished(false) {}
+
+        QMutex mutex;
+        bool cancelled;
+        bool finished;
+        QSet<int> insertedTabIds;
+    };
+
+    void take(int tabId);
+    void enforceBudget();
+    QSharedPointer<Removal> startRemoval();
+    void pruneRemovals();
+    void cancelRemovals();
+
+    static SweepResult sweepDirectory(const QString &directory, const QSet<int> &liveTabIds, int maxTabId,
+                                      QSharedPointer<Removal> removal);
+    static void removeThumbnails(const QString &directory, QSharedPointer<Removal> removal);
+    static void removeEvicted(const QHash<int, QString> &paths, QSharedPointer<Removal> removal);
+    static bool removeThumbnail(Removal *removal, int tabId, const QString &path);
+    static void removeFiles(const QStringList &paths);
+
+    QString m_directory;
+    QHash<int, Entry> m_entries;
+    // Least recently used first.
+    QMap<quint64, int> m_lru;
+    quint64 m_useCounter;
+    qint64 m_size;
+    qint64 m_budget;
+
+    // Tabs restored from the database, files of other tabs up to m_maxTabId are orphans.
+    QSet<int> m_liveTabIds;
+    int m_maxTabId;
+    QTimer m_sweepTimer;
+    QFutureWatcher<SweepResult> m_sweepWatcher;
+    QSharedPointer<Removal> m_sweepRemoval;
+    // Sweeps and clears that may still be running.
+    QList<QSharedPointer<Removal> > m_removals;
+
+    friend class tst_thumbnailcache;
+};
+
+#endif // THUMBNAILCACHE_H
@@ -7,4 +7,6 @@ isEmpty(DEFAULT_COMPONENT_PATH) {
 }
 
 DEFINES += BASE64_IMAGE=\\\"data\:image\/png\;base64,%1\\\"
+DEFINES += TAB_THUMBNAIL_PROVIDER=\\\"tabthumbnail\\\"
+DEFINES += FAVICON_PROVIDER=\\\"favicons\\\"
 DEFINES += DEFAULT_DESKTOP_BOOKMARK_ICON=\\\"icon-launcher-bookmark\\\"
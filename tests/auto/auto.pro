@@ -6,9 +6,15 @@ SUBDIRS += tst_dbmanager \
 #    tst_declarativewebcontainer \
     tst_desktopbookmarkwriter \
     tst_downloadmimetypehandler \
+    tst_faviconmanager \
+    tst_fetchservice \
+    tst_imagekernels \
     tst_logins \
     tst_persistenttabmodel \
-#    tst_webpages \
+    tst_suggestionmodel \
+    tst_thumbnailcache \
+    tst_thumbnailgeneration \
+    tst_webpages \
     tst_webpagefactory \
     tst_webutils \
     tst_webview
@@ -13,6 +13,8 @@
 
 DeclarativeWebContainer::DeclarativeWebContainer(QObject *parent)
     : QObject(parent)
+    , m_completed(true)
+    , m_foreground(true)
 {
 }
 
@@ -20,3 +22,29 @@ int DeclarativeWebContainer::findParentTabId(int) const
 {
     return 0;
 }
+
+bool DeclarativeWebContainer::completed() const
+{
+    return m_completed;
+}
+
+void DeclarativeWebContainer::setCompleted(bool completed)
+{
+    if (m_completed != completed) {
+        m_completed = completed;
+        emit completedChanged();
+    }
+}
+
+bool DeclarativeWebContainer::foreground() const
+{
+    return m_foreground;
+}
+
+void DeclarativeWebContainer::setForeground(bool active)
+{
+    if (m_foreground != active) {
+        m_foreground = active;
+        emit foregroundChanged();
+    }
+}
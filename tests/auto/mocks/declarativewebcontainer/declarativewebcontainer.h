@@ -28,9 +28,24 @@ public:
     int findParentTabId(int) const;
     MOCK_CONST_METHOD0(webPage, DeclarativeWebPage*());
     MOCK_CONST_METHOD0(privateMode, bool());
+    MOCK_CONST_METHOD0(chromeWindow, QObject*());
+
+    bool completed() const;
+    void setCompleted(bool completed);
+    bool foreground() const;
+    void setForeground(bool active);
+
+public slots:
+    void clearSurface() {}
 
 signals:
     void portraitChanged();
+    void completedChanged();
+    void foregroundChanged();
+
+private:
+    bool m_completed;
+    bool m_foreground;
 };
 
 
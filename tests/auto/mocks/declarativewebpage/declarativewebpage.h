@@ -14,6 +14,7 @@
 #include <QDebug>
 #include <QUrl>
 #include <QRectF>
+#include <QSize>
 #include <QWindow>
 #include <QTouchEvent>
 #include <QVariant>
@@ -44,6 +45,7 @@ public:
     MOCK_CONST_METHOD0(canGoForward, bool());
     MOCK_CONST_METHOD0(canGoBack, bool());
     MOCK_METHOD0(reload, void());
+    MOCK_METHOD1(load, void(const QString &));
     MOCK_METHOD0(goForward, void());
     MOCK_METHOD0(goBack, void());
     MOCK_METHOD1(setChrome, void(bool));
@@ -73,11 +75,14 @@ public:
 
     MOCK_METHOD1(setResurrectedContentRect, void(QVariant));
     MOCK_METHOD1(setInitialTab, void(const Tab&));
+    MOCK_METHOD0(requestTabHistory, void());
 
     MOCK_METHOD1(forceChrome, void(bool));
     MOCK_CONST_METHOD0(domContentLoaded, bool());
+    MOCK_CONST_METHOD0(mediaActive, bool());
 
     MOCK_CONST_METHOD0(tabId, int());
+    MOCK_CONST_METHOD0(initialUrl, QString());
 
     MOCK_CONST_METHOD0(initialLoadHasHappened, bool());
     MOCK_METHOD0(setInitialLoadHasHappened, void());
@@ -99,6 +104,9 @@ public:
     MOCK_CONST_METHOD0(securityStatus, QString());
     MOCK_CONST_METHOD0(security, QMozSecurity *());
 
+    MOCK_METHOD1(grabThumbnail, void(const QSize &));
+    MOCK_METHOD0(frameRendered, void());
+
 signals:
     void canGoBackChanged();
     void canGoForwardChanged();
@@ -122,6 +130,7 @@ signals:
     void clearGrabResult();
     void grabResult(const QString &fileName);
     void thumbnailResult(const QString &data);
+    void thumbnailData(const QByteArray &data);
 };
 
 QDebug operator<<(QDebug, const DeclarativeWebPage *);
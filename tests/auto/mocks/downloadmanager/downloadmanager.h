@@ -21,9 +21,12 @@ class DownloadManager : public QObject
 public:
     static DownloadManager *instance();
 
+    bool existActiveTransfers() { return false; }
+
 signals:
     void initializedChanged();
     void downloadStarted();
+    void allTransfersCompleted();
 
 private:
     explicit DownloadManager();
@@ -12,6 +12,7 @@
 
 #include "faviconmanager.h" // mock
 
+#include <QHash>
 #include <QUrl>
 
 FaviconManager *FaviconManager::instance()
@@ -25,11 +26,23 @@ QString FaviconManager::sanitizedHostname(const QString &hostname)
     return QUrl(hostname).host();
 }
 
+FaviconManager::Host FaviconManager::host(const QString &hostname)
+{
+    Host host;
+    host.name = hostname;
+    host.hash = qHash(hostname);
+    return host;
+}
+
 void FaviconManager::add(const QString &type, const QString &hostname, const QString &favicon, bool hasTouchIcon)
 {
     m_faviconSets[type].favicons.insert(hostname, { favicon, hasTouchIcon });
 }
 
+void FaviconManager::addImage(const QString &, const QString &, const QByteArray &, bool)
+{
+}
+
 void FaviconManager::remove(const QString &type, const QString &hostname)
 {
     m_faviconSets[type].favicons.remove(hostname);
@@ -40,6 +53,13 @@ QString FaviconManager::get(const QString &type, const QString &hostname)
     return m_faviconSets.value(type).favicons.value(hostname).favicon;
 }
 
+const QString &FaviconManager::favicon(const QString &type, const Host &host)
+{
+    static const QString none;
+    QMap<QString, Favicon>::const_iterator it = m_faviconSets[type].favicons.constFind(host.name);
+    return it != m_faviconSets[type].favicons.constEnd() ? it->favicon : none;
+}
+
 void FaviconManager::grabIcon(const QString &, DeclarativeWebPage *, const QSize &)
 {
 }
@@ -49,6 +69,10 @@ void FaviconManager::clear(const QString &type)
     m_faviconSets.remove(type);
 }
 
+void FaviconManager::releaseCache()
+{
+}
+
 FaviconManager::FaviconManager(QObject *parent)
     : QObject(parent)
 {
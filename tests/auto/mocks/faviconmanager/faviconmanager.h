@@ -21,14 +21,28 @@ class FaviconManager : public QObject
     Q_OBJECT
 
 public:
+    struct Host {
+        Host() : hash(0) {}
+
+        bool isNull() const { return name.isEmpty(); }
+        bool operator==(const Host &other) const { return name == other.name; }
+
+        QString name;
+        uint hash;
+    };
+
     static FaviconManager *instance();
     static QString sanitizedHostname(const QString &hostname);
+    static Host host(const QString &hostname);
 
     Q_INVOKABLE void add(const QString &type, const QString &hostname, const QString &favicon, bool hasTouchIcon);
+    void addImage(const QString &type, const QString &hostname, const QByteArray &data, bool hasTouchIcon);
     Q_INVOKABLE void remove(const QString &type, const QString &hostname);
     QString get(const QString &type, const QString &hostname);
+    const QString &favicon(const QString &type, const Host &host);
     Q_INVOKABLE void grabIcon(const QString &type, DeclarativeWebPage *webPage, const QSize &size);
     Q_INVOKABLE void clear(const QString &type);
+    void releaseCache();
 
 private:
     FaviconManager(QObject *parent = nullptr);
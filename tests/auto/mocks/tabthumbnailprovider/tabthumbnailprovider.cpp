@@ -0,0 +1,36 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// This implementation is mock implementation for testing only.
+
+#include "tabthumbnailprovider.h" // mock
+
+static int gReleaseCount = 0;
+static QList<int> gReleasedThumbnails;
+
+void TabThumbnailProvider::releaseCache()
+{
+    ++gReleaseCount;
+}
+
+int TabThumbnailProvider::releaseCount()
+{
+    return gReleaseCount;
+}
+
+void TabThumbnailProvider::releaseThumbnails(const QList<int> &tabIds)
+{
+    gReleasedThumbnails.append(tabIds);
+}
+
+QList<int> TabThumbnailProvider::releasedThumbnails()
+{
+    return gReleasedThumbnails;
+}
@@ -0,0 +1,26 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOCK_TABTHUMBNAILPROVIDER_H
+#define MOCK_TABTHUMBNAILPROVIDER_H
+
+#include <QList>
+
+class TabThumbnailProvider
+{
+public:
+    static void releaseCache();
+    static int releaseCount();
+
+    static void releaseThumbnails(const QList<int> &tabIds);
+    static QList<int> releasedThumbnails();
+};
+
+#endif // MOCK_TABTHUMBNAILPROVIDER_H
@@ -0,0 +1,6 @@
+# Mock interface for TabThumbnailProvider. Interface is not complete.
+# Currently it includes only methods needed at runtime.
+SOURCES += $$PWD/tabthumbnailprovider.cpp
+HEADERS += $$PWD/tabthumbnailprovider.h
+
+INCLUDEPATH += $$PWD
@@ -36,14 +36,24 @@ private slots:
     void goBack();
     void goForward();
     void updateThumbPath();
+    void updateThumbPathBatched();
+    void updateThumbPathOnQuit();
     void updateTitle();
     void getHistory();
     void getTabHistory();
+    void getTabHistoryWithCallback();
+    void searchHistory();
     void saveSetting();
     void deleteSetting();
     void getMaxTabId();
+    void favicons();
+    void clearFavicons();
+    void faviconDataBeforeReference();
+    void faviconFailures();
 
 private:
+    Favicon favicon(const QString &type, const QString &host, const QString &hash, const QString &icon = QString());
+
     QString mDbFile;
 };
 
@@ -382,6 +392,63 @@ void tst_dbmanager::updateThumbPath()
     QCOMPARE(arguments.at(0).value<QList<Tab> >().at(0).thumbnailPath(), thumbPath);
 }
 
+void tst_dbmanager::updateThumbPathBatched()
+{
+    DBManager::instance()->createTab(Tab(1, "http://example1.com", "Test title 1", ""));
+    DBManager::instance()->createTab(Tab(2, "http://example2.com", "Test title 2", ""));
+    DBManager::instance()->createTab(Tab(3, "http://example3.com", "Test title 3", ""));
+
+    QSignalSpy thumbPathChangedSpy(DBManager::instance(),
+                                   SIGNAL(thumbPathChanged(int,QString)));
+
+    // Only the latest path of a tab is written.
+    DBManager::instance()->updateThumbPath(1, "/path/to/old");
+    DBManager::instance()->updateThumbPath(2, "/path/to/thumbnail2");
+    DBManager::instance()->updateThumbPath(1, "/path/to/thumbnail1");
+    DBManager::instance()->updateThumbPath(3, "/path/to/thumbnail3");
+    // Removed tabs are dropped from the batch.
+    DBManager::instance()->removeTab(3);
+
+    QVERIFY(thumbPathChangedSpy.wait(5000));
+    QTest::qWait(100);
+    QCOMPARE(thumbPathChangedSpy.count(), 2);
+
+    QMap<int, QString> changed;
+    for (const QList<QVariant> &arguments : thumbPathChangedSpy) {
+        changed.insert(arguments.at(0).toInt(), arguments.at(1).toString());
+    }
+    QCOMPARE(changed.value(1), QString("/path/to/thumbnail1"));
+    QCOMPARE(changed.value(2), QString("/path/to/thumbnail2"));
+
+    QSignalSpy tabsAvailableSpy(DBManager::instance(),
+                                SIGNAL(tabsAvailable(QList<Tab>)));
+    DBManager::instance()->getAllTabs();
+    QVERIFY(tabsAvailableSpy.wait(5000));
+    QList<Tab> tabs = tabsAvailableSpy.at(0).at(0).value<QList<Tab> >();
+    QCOMPARE(tabs.count(), 2);
+    QCOMPARE(tabs.at(0).thumbnailPath(), QString("/path/to/thumbnail1"));
+    QCOMPARE(tabs.at(1).thumbnailPath(), QString("/path/to/thumbnail2"));
+}
+
+void tst_dbmanager::updateThumbPathOnQuit()
+{
+    DBManager::instance()->createTab(Tab(1, "http://example1.com", "Test title 1", ""));
+    DBManager::instance()->updateThumbPath(1, "/path/to/thumbnail1");
+
+    // Pending paths are written before the application quits.
+    QVERIFY(QMetaObject::invokeMethod(QCoreApplication::instance(), "aboutToQuit"));
+    QVERIFY(!DBManager::instance()->m_thumbPathTimer.isActive());
+    QVERIFY(DBManager::instance()->m_pendingThumbPaths.isEmpty());
+
+    QSignalSpy tabsAvailableSpy(DBManager::instance(),
+                                SIGNAL(tabsAvailable(QList<Tab>)));
+    DBManager::instance()->getAllTabs();
+    QVERIFY(tabsAvailableSpy.wait(5000));
+    QList<Tab> tabs = tabsAvailableSpy.at(0).at(0).value<QList<Tab> >();
+    QCOMPARE(tabs.count(), 1);
+    QCOMPARE(tabs.at(0).thumbnailPath(), QString("/path/to/thumbnail1"));
+}
+
 void tst_dbmanager::updateTitle()
 {
     // initialize test case
@@ -481,6 +548,94 @@ void tst_dbmanager::getTabHistory()
     QCOMPARE(currentLinkId, 3);
 }
 
+void tst_dbmanager::getTabHistoryWithCallback()
+{
+    // initialize test case
+    Tab tab(1, "http://example1.com", "Test title 1", "");
+    DBManager::instance()->createTab(tab);
+    DBManager::instance()->navigateTo(1, "http://example2.com", "Test title 2", "");
+
+    QSignalSpy tabHistoryAvailableSpy(DBManager::instance(),
+            SIGNAL(tabHistoryAvailable(int,QList<Link>,int)));
+
+    // actual test
+    QObject context;
+    QEventLoop loop;
+    int callbackCount = 0;
+    QList<Link> links;
+    int currentLinkId = -1;
+    DBManager::instance()->getTabHistory(1, &context, [&](const QList<Link> &tabLinks, int tabCurrentLinkId) {
+        ++callbackCount;
+        links = tabLinks;
+        currentLinkId = tabCurrentLinkId;
+        loop.quit();
+    });
+    QTimer::singleShot(5000, &loop, SLOT(quit()));
+    loop.exec();
+
+    QCOMPARE(callbackCount, 1);
+    QCOMPARE(links.count(), 2);
+    QCOMPARE(currentLinkId, 2);
+    // History is delivered only to the requester.
+    QCOMPARE(tabHistoryAvailableSpy.count(), 0);
+
+    // Request of a destroyed context is dropped.
+    QObject *deadContext = new QObject();
+    DBManager::instance()->getTabHistory(1, deadContext, [&](const QList<Link> &, int) {
+        ++callbackCount;
+    });
+    delete deadContext;
+    DBManager::instance()->getTabHistory(1, &context, [&](const QList<Link> &, int) {
+        loop.quit();
+    });
+    QTimer::singleShot(5000, &loop, SLOT(quit()));
+    loop.exec();
+    QCOMPARE(callbackCount, 1);
+}
+
+void tst_dbmanager::searchHistory()
+{
+    QSignalSpy historyEntryAdded(DBManager::instance(), SIGNAL(historyEntryAdded(Link)));
+    DBManager::instance()->addHistoryEntry("http://example.com/once", "Once");
+    DBManager::instance()->addHistoryEntry("http://example.com/twice", "Twice");
+    DBManager::instance()->addHistoryEntry("http://example.com/twice", "Twice");
+    DBManager::instance()->addHistoryEntry("http://example.org", "Example");
+    QTRY_COMPARE(historyEntryAdded.count(), 4);
+
+    QObject context;
+    QEventLoop loop;
+    int callbackCount = 0;
+    QList<Link> links;
+    DBManager::instance()->searchHistory("example.com", 10, &context, [&](const QList<Link> &result) {
+        ++callbackCount;
+        links = result;
+        loop.quit();
+    });
+    QTimer::singleShot(5000, &loop, SLOT(quit()));
+    loop.exec();
+
+    // The most visited first.
+    QCOMPARE(callbackCount, 1);
+    QCOMPARE(links.count(), 2);
+    QCOMPARE(links.at(0).url(), QString("http://example.com/twice"));
+    QCOMPARE(links.at(0).visitCount(), 2);
+    QCOMPARE(links.at(1).url(), QString("http://example.com/once"));
+
+    // Callbacks of cancelled searches are not called.
+    const int requestId = DBManager::instance()->searchHistory("example", 10, &context, [&](const QList<Link> &) {
+        ++callbackCount;
+    });
+    DBManager::instance()->cancelSearch(requestId);
+    DBManager::instance()->searchHistory("example", 1, &context, [&](const QList<Link> &result) {
+        links = result;
+        loop.quit();
+    });
+    QTimer::singleShot(5000, &loop, SLOT(quit()));
+    loop.exec();
+    QCOMPARE(callbackCount, 1);
+    QCOMPARE(links.count(), 1);
+}
+
 void tst_dbmanager::saveSetting()
 {
     QSignalSpy settingChangedSpy1(DBManager::instance(), SIGNAL(settingsChanged()));
@@ -530,5 +685,113 @@ void tst_dbmanager::getMaxTabId()
     QCOMPARE(DBManager::instance()->getMaxTabId(), 1);
 }
 
+void tst_dbmanager::favicons()
+{
+    const QByteArray data("icon data");
+    DBManager::instance()->storeFaviconData("hash1", data);
+    DBManager::instance()->storeFaviconData("hash2", "other icon data");
+
+    // The same icon data is shared by hosts of different types.
+    FaviconList favicons;
+    favicons << favicon("history", "http://example1.com", "hash1")
+             << favicon("logins", "http://example1.com", "hash1")
+             << favicon("history", "http://example2.com", "hash2")
+             << favicon("history", "http://example3.com", QString(), "icon-launcher-bookmark");
+    DBManager::instance()->updateFavicons(favicons);
+
+    favicons = DBManager::instance()->getFavicons("history");
+    QCOMPARE(favicons.count(), 3);
+    for (const Favicon &favicon : favicons) {
+        QCOMPARE(favicon.type, QString("history"));
+        if (favicon.host == "http://example3.com") {
+            QVERIFY(favicon.hash.isEmpty());
+            QCOMPARE(favicon.icon, QString("icon-launcher-bookmark"));
+        }
+    }
+    QCOMPARE(DBManager::instance()->getFavicons("logins").count(), 1);
+    QCOMPARE(DBManager::instance()->getFaviconData("hash1"), data);
+
+    // Null favicons are removed, data that is still referred to is kept.
+    favicons.clear();
+    favicons << favicon("history", "http://example1.com", QString())
+             << favicon("history", "http://example2.com", QString());
+    DBManager::instance()->updateFavicons(favicons, true);
+    QCOMPARE(DBManager::instance()->getFavicons("history").count(), 1);
+    QCOMPARE(DBManager::instance()->getFaviconData("hash1"), data);
+    QVERIFY(DBManager::instance()->getFaviconData("hash2").isEmpty());
+}
+
+void tst_dbmanager::clearFavicons()
+{
+    DBManager::instance()->storeFaviconData("hash1", "icon data");
+    DBManager::instance()->storeFaviconData("hash2", "other icon data");
+    FaviconList favicons;
+    favicons << favicon("history", "http://example1.com", "hash1")
+             << favicon("logins", "http://example2.com", "hash2");
+    DBManager::instance()->updateFavicons(favicons);
+
+    DBManager::instance()->clearFavicons("history");
+    QVERIFY(DBManager::instance()->getFavicons("history").isEmpty());
+    QCOMPARE(DBManager::instance()->getFavicons("logins").count(), 1);
+    QVERIFY(DBManager::instance()->getFaviconData("hash1").isEmpty());
+    QVERIFY(!DBManager::instance()->getFaviconData("hash2").isEmpty());
+}
+
+void tst_dbmanager::faviconDataBeforeReference()
+{
+    // Icon data is stored before the favicon referring to it is written.
+    const QByteArray data("icon data");
+    DBManager::instance()->storeFaviconData("hash1", data);
+
+    Bookmark bookmark;
+    bookmark.setUrl("http://example.com");
+    bookmark.setTitle("Example");
+    DBManager::instance()->removeBookmark(DBManager::instance()->addBookmark(bookmark));
+    QCOMPARE(DBManager::instance()->getFaviconData("hash1"), data);
+
+    DBManager::instance()->updateFavicons(FaviconList() << favicon("history", "http://example.com", "hash1"), true);
+    QCOMPARE(DBManager::instance()->getFaviconData("hash1"), data);
+}
+
+void tst_dbmanager::faviconFailures()
+{
+    FaviconFailure failure;
+    failure.host = "http://example1.com";
+    failure.iconUrl = "http://example1.com/apple-touch-icon.png";
+    failure.failures = 2;
+    failure.retryAfter = Q_INT64_C(1700000000000);
+    FaviconFailure other = failure;
+    other.host = "http://example2.com";
+    DBManager::instance()->updateFaviconFailures(FaviconFailureList() << failure << other);
+
+    FaviconFailureList failures = DBManager::instance()->getFaviconFailures();
+    QCOMPARE(failures.count(), 2);
+    for (const FaviconFailure &stored : failures) {
+        QCOMPARE(stored.iconUrl, failure.iconUrl);
+        QCOMPARE(stored.failures, 2);
+        QCOMPARE(stored.retryAfter, failure.retryAfter);
+    }
+
+    // Null failures are removed.
+    failure.failures = 0;
+    DBManager::instance()->updateFaviconFailures(FaviconFailureList() << failure, true);
+    failures = DBManager::instance()->getFaviconFailures();
+    QCOMPARE(failures.count(), 1);
+    QCOMPARE(failures.at(0).host, QString("http://example2.com"));
+
+    DBManager::instance()->clearFaviconFailures();
+    QVERIFY(DBManager::instance()->getFaviconFailures().isEmpty());
+}
+
+Favicon tst_dbmanager::favicon(const QString &type, const QString &host, const QString &hash, const QString &icon)
+{
+    Favicon favicon;
+    favicon.type = type;
+    favicon.host = host;
+    favicon.hash = hash;
+    favicon.icon = icon;
+    return favicon;
+}
+
 QTEST_MAIN(tst_dbmanager)
 #include "tst_dbmanager.moc"
@@ -9,12 +9,20 @@
  * You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include <QtTest>
+#include <QBuffer>
+#include <QCryptographicHash>
 #include <QFile>
+#include <QImage>
 #include <QTextStream>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 #include "declarativebookmarkmodel.h"
+#include "bookmarkfiltermodel.h"
 #include "bookmarkmanager.h"
 #include "browserpaths.h"
+#include "dbmanager.h"
 
 static const QByteArray BOOKMARKS_JSON = \
     "[{" \
@@ -26,6 +34,7 @@ static const QByteArray BOOKMARKS_JSON = \
 
 static const QString JOLLA_URL = "http://jolla.com/";
 static const QString TEST_URL = "http://www.test1.jolla.com";
+static const int MANY_BOOKMARKS = 20000;
 
 class tst_declarativebookmarkmodel : public QObject
 {
@@ -37,6 +46,7 @@ private slots:
     void cleanup();
 
     void add();
+    void addPending();
     void remove();
     void removeByIndex();
     void contains();
@@ -45,8 +55,24 @@ private slots:
     void clearBookmarks();
     void updateFavoriteIcon();
     void data();
+    void persist();
+    void paging();
+    void folders();
+    void importExport();
+    void importLegacyFailure();
+    void manyBookmarks();
+    void benchmarkRemove();
+    void filter();
+    void refineFilter();
+    void filterUnfetched();
+    void benchmarkFilter();
 
 private:
+    QByteArray readFile(const QString &path) const;
+    void loadBookmarks(int count);
+    void fetchAll();
+    void waitForWrites();
+
     QPointer<DeclarativeBookmarkModel> m_model;
     QString m_bookmarksFile;
 };
@@ -58,6 +84,7 @@ void tst_declarativebookmarkmodel::initTestCase()
         return;
     }
     m_bookmarksFile = settingsLocation + "/bookmarks.json";
+    QFile::remove(settingsLocation + "/" + QLatin1String(DB_NAME));
 }
 
 void tst_declarativebookmarkmodel::init()
@@ -78,8 +105,9 @@ void tst_declarativebookmarkmodel::init()
 void tst_declarativebookmarkmodel::cleanup()
 {
     delete m_model;
-    QFile file(m_bookmarksFile);
-    QVERIFY(file.remove());
+    BookmarkManager::instance()->clear();
+    // Imported by the model.
+    QVERIFY(!QFile::exists(m_bookmarksFile));
 }
 
 void tst_declarativebookmarkmodel::add()
@@ -94,6 +122,38 @@ void tst_declarativebookmarkmodel::add()
     QVERIFY(m_model->contains(TEST_URL));
 }
 
+void tst_declarativebookmarkmodel::addPending()
+{
+    QSignalSpy dataChangedSpy(m_model, SIGNAL(dataChanged(QModelIndex, QModelIndex, QVector<int>)));
+    m_model->add(TEST_URL, "test", "");
+    m_model->add("http://www.test2.jolla.com", "test2", "");
+    m_model->add("http://www.test3.jolla.com", "test3", "");
+
+    // Rows are shown before the database has written them.
+    QCOMPARE(m_model->rowCount(), 4);
+    QVERIFY(m_model->bookmarkId(1) < -1);
+    QCOMPARE(m_model->row(m_model->bookmarkId(1)), 1);
+    QVERIFY(m_model->contains(TEST_URL));
+
+    // Changes wait for the id.
+    m_model->edit(2, "http://www.test2.jolla.com", "edited");
+    m_model->remove(3);
+
+    waitForWrites();
+    QCOMPARE(m_model->rowCount(), 3);
+    QCOMPARE(m_model->row(m_model->bookmarkId(1)), 1);
+    QVector<int> idRole;
+    idRole << DeclarativeBookmarkModel::IdRole;
+    QCOMPARE(dataChangedSpy.last().at(2).value<QVector<int> >(), idRole);
+    QTRY_COMPARE(DBManager::instance()->getBookmarkCount(0), 3);
+
+    DeclarativeBookmarkModel model;
+    QCOMPARE(model.rowCount(), 3);
+    QCOMPARE(model.bookmarkId(1), m_model->bookmarkId(1));
+    QCOMPARE(model.data(model.index(2), DeclarativeBookmarkModel::TitleRole).toString(), QString("edited"));
+    QVERIFY(!m_model->contains("http://www.test3.jolla.com"));
+}
+
 void tst_declarativebookmarkmodel::remove()
 {
     QSignalSpy countChangeSpy(m_model, SIGNAL(countChanged()));
@@ -125,6 +185,14 @@ void tst_declarativebookmarkmodel::contains()
     QVERIFY(!m_model->contains(TEST_URL));
     add();
     QVERIFY(m_model->contains(TEST_URL));
+
+    // A url bookmarked twice stays bookmarked until both are removed.
+    m_model->add(TEST_URL, "Test two", "");
+    m_model->remove(TEST_URL);
+    QVERIFY(m_model->contains(TEST_URL));
+    m_model->remove(TEST_URL);
+    QVERIFY(!m_model->contains(TEST_URL));
+    QTRY_COMPARE(DBManager::instance()->getBookmarkUrls(), QStringList() << JOLLA_URL);
 }
 
 void tst_declarativebookmarkmodel::edit()
@@ -225,5 +293,371 @@ void tst_declarativebookmarkmodel::data()
     QVERIFY(!m_model->data(index, DeclarativeBookmarkModel::UrlRole).isValid());
 }
 
+void tst_declarativebookmarkmodel::persist()
+{
+    m_model->add(TEST_URL, "test", "");
+    m_model->add("http://www.test2.jolla.com", "test2", "");
+    m_model->remove(JOLLA_URL);
+    m_model->edit(1, "http://www.test2.jolla.com/edited", "edited");
+    m_model->updateFavoriteIcon(TEST_URL, "image://theme/icon-launcher-test1", true);
+    waitForWrites();
+
+    // A new model reads back the bookmarks in the same order.
+    DeclarativeBookmarkModel model;
+    QCOMPARE(model.rowCount(), 2);
+    QCOMPARE(model.data(model.index(0), DeclarativeBookmarkModel::UrlRole).toString(), TEST_URL);
+    QCOMPARE(model.data(model.index(0), DeclarativeBookmarkModel::FaviconRole).toString(),
+             QString("image://theme/icon-launcher-test1"));
+    QVERIFY(model.data(model.index(0), DeclarativeBookmarkModel::TouchIconRole).toBool());
+    QCOMPARE(model.data(model.index(1), DeclarativeBookmarkModel::UrlRole).toString(),
+             QString("http://www.test2.jolla.com/edited"));
+    QCOMPARE(model.data(model.index(1), DeclarativeBookmarkModel::TitleRole).toString(), QString("edited"));
+    QCOMPARE(model.bookmarkId(1), m_model->bookmarkId(1));
+}
+
+void tst_declarativebookmarkmodel::paging()
+{
+    loadBookmarks(250);
+
+    // Rows are fetched a page at a time.
+    QCOMPARE(m_model->rowCount(), 100);
+    QVERIFY(m_model->canFetchMore(QModelIndex()));
+    QSignalSpy countChangeSpy(m_model, SIGNAL(countChanged()));
+    m_model->fetchMore(QModelIndex());
+    QCOMPARE(m_model->rowCount(), 200);
+    QCOMPARE(countChangeSpy.count(), 1);
+
+    // Rows not fetched yet are looked up in the database.
+    const QString unfetched("http://www.test.jolla.com/240");
+    QVERIFY(m_model->contains(unfetched));
+    m_model->remove(unfetched);
+    QVERIFY(!m_model->contains(unfetched));
+    QCOMPARE(m_model->rowCount(), 200);
+
+    // Added bookmarks are shown after the rows before them.
+    m_model->add(TEST_URL, "test", "");
+    QCOMPARE(m_model->rowCount(), 200);
+    QVERIFY(m_model->contains(TEST_URL));
+    fetchAll();
+    QCOMPARE(m_model->rowCount(), 250);
+    QCOMPARE(m_model->data(m_model->index(249), DeclarativeBookmarkModel::UrlRole).toString(), TEST_URL);
+    QVERIFY(!m_model->canFetchMore(QModelIndex()));
+}
+
+void tst_declarativebookmarkmodel::folders()
+{
+    QSignalSpy folderIdChangedSpy(m_model, SIGNAL(folderIdChanged()));
+    m_model->addFolder("Folder");
+    QCOMPARE(m_model->rowCount(), 2);
+    QModelIndex index = m_model->index(1);
+    QVERIFY(m_model->data(index, DeclarativeBookmarkModel::FolderRole).toBool());
+    QVERIFY(!m_model->data(m_model->index(0), DeclarativeBookmarkModel::FolderRole).toBool());
+    QCOMPARE(m_model->data(index, DeclarativeBookmarkModel::TitleRole).toString(), QString("Folder"));
+
+    QTRY_VERIFY(m_model->data(index, DeclarativeBookmarkModel::IdRole).toInt() > 0);
+    const int folderId = m_model->data(index, DeclarativeBookmarkModel::IdRole).toInt();
+    m_model->setFolderId(folderId);
+    QCOMPARE(folderIdChangedSpy.count(), 1);
+    QCOMPARE(m_model->rowCount(), 0);
+    m_model->add(TEST_URL, "test", "");
+    m_model->addFolder("Subfolder");
+    QCOMPARE(m_model->rowCount(), 2);
+
+    // Bookmarks of other folders count as bookmarked.
+    m_model->setFolderId(0);
+    QCOMPARE(m_model->rowCount(), 2);
+    QVERIFY(m_model->contains(TEST_URL));
+    m_model->setActiveUrl(TEST_URL);
+    QVERIFY(m_model->activeUrlBookmarked());
+
+    // Removing a folder removes its contents.
+    m_model->remove(1);
+    QVERIFY(!m_model->contains(TEST_URL));
+    QCOMPARE(DBManager::instance()->getBookmarkCount(folderId), 0);
+}
+
+void tst_declarativebookmarkmodel::importExport()
+{
+    QImage image(16, 16, QImage::Format_ARGB32);
+    image.fill(Qt::blue);
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(image.save(&buffer, "PNG"));
+    const QString hash = QString::fromLatin1(QCryptographicHash::hash(png, QCryptographicHash::Sha1).toHex());
+    const QString dataUrl = QString("data:image/png;base64,%1").arg(QString::fromLatin1(png.toBase64()));
+
+    QJsonObject folder;
+    folder.insert("type", QString("folder"));
+    folder.insert("id", 7);
+    folder.insert("title", QString("Folder"));
+    QJsonObject bookmark;
+    bookmark.insert("url", TEST_URL);
+    bookmark.insert("title", QString("Test & <test>"));
+    bookmark.insert("favicon", dataUrl);
+    bookmark.insert("folderId", 7);
+
+    const QString jsonFile = QDir::tempPath() + "/tst_declarativebookmarkmodel.json";
+    const QString htmlFile = QDir::tempPath() + "/tst_declarativebookmarkmodel.html";
+    QFile file(jsonFile);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write(QJsonDocument(QJsonArray() << folder << bookmark).toJson());
+    file.close();
+
+    BookmarkManager *manager = BookmarkManager::instance();
+    QCOMPARE(manager->importBookmarks(jsonFile), 2);
+
+    // Icon data is stored once and shown through the favicon provider.
+    DeclarativeBookmarkModel model;
+    QCOMPARE(model.rowCount(), 2);
+    model.setFolderId(model.bookmarkId(1));
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.data(model.index(0), DeclarativeBookmarkModel::TitleRole).toString(), QString("Test & <test>"));
+    QCOMPARE(model.data(model.index(0), DeclarativeBookmarkModel::FaviconRole).toString(),
+             QString("image://%1/%2").arg(QStringLiteral(FAVICON_PROVIDER), hash));
+    QCOMPARE(DBManager::instance()->getFaviconData(hash), png);
+
+    // Exported icons are data urls again.
+    QVERIFY(manager->exportBookmarks(jsonFile));
+    const QJsonArray exported = QJsonDocument::fromJson(readFile(jsonFile)).array();
+    QCOMPARE(exported.count(), 3);
+    QCOMPARE(exported.at(1).toObject().value("type").toString(), QString("folder"));
+    QCOMPARE(exported.at(2).toObject().value("favicon").toString(), dataUrl);
+    QCOMPARE(exported.at(2).toObject().value("folderId").toInt(), exported.at(1).toObject().value("id").toInt());
+
+    QVERIFY(manager->exportBookmarks(htmlFile));
+    QVERIFY(readFile(htmlFile).contains("<H3>Folder</H3>"));
+    manager->clear();
+    QCOMPARE(manager->importBookmarks(htmlFile), 3);
+
+    model.setFolderId(0);
+    QCOMPARE(model.rowCount(), 2);
+    QCOMPARE(model.data(model.index(0), DeclarativeBookmarkModel::UrlRole).toString(), JOLLA_URL);
+    model.setFolderId(model.bookmarkId(1));
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.data(model.index(0), DeclarativeBookmarkModel::UrlRole).toString(), TEST_URL);
+    QCOMPARE(model.data(model.index(0), DeclarativeBookmarkModel::TitleRole).toString(), QString("Test & <test>"));
+    QCOMPARE(model.data(model.index(0), DeclarativeBookmarkModel::FaviconRole).toString(),
+             QString("image://%1/%2").arg(QStringLiteral(FAVICON_PROVIDER), hash));
+
+    QFile::remove(jsonFile);
+    QFile::remove(htmlFile);
+}
+
+void tst_declarativebookmarkmodel::importLegacyFailure()
+{
+    // The array is not closed.
+    QFile file(m_bookmarksFile);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write("[{\"url\": \"http://example.com/\", \"title\": \"Example\"},");
+    file.close();
+
+    BookmarkManager::instance()->initialize();
+    const QString backup = m_bookmarksFile + ".bak";
+    QVERIFY(QFile::exists(backup));
+    QFile::remove(backup);
+}
+
+void tst_declarativebookmarkmodel::manyBookmarks()
+{
+    loadBookmarks(MANY_BOOKMARKS);
+    fetchAll();
+    QCOMPARE(m_model->rowCount(), MANY_BOOKMARKS);
+
+    const int lastId = m_model->bookmarkId(MANY_BOOKMARKS - 1);
+    const int middleId = m_model->bookmarkId(MANY_BOOKMARKS / 2);
+    QCOMPARE(m_model->row(lastId), MANY_BOOKMARKS - 1);
+    QCOMPARE(m_model->bookmarkId(MANY_BOOKMARKS), -1);
+
+    // Ids stay while earlier rows are removed.
+    QSignalSpy countChangeSpy(m_model, SIGNAL(countChanged()));
+    for (int i = 0; i < 2000; i += 2) {
+        m_model->remove(QString("http://www.test.jolla.com/%1").arg(i));
+    }
+    QCOMPARE(countChangeSpy.count(), 1000);
+    QCOMPARE(m_model->rowCount(), MANY_BOOKMARKS - 1000);
+    QCOMPARE(m_model->row(lastId), MANY_BOOKMARKS - 1001);
+    QCOMPARE(m_model->row(middleId), MANY_BOOKMARKS / 2 - 1000);
+    QVERIFY(!m_model->contains("http://www.test.jolla.com/0"));
+    QVERIFY(m_model->contains("http://www.test.jolla.com/1"));
+    for (int row = 0; row < m_model->rowCount(); ++row) {
+        QCOMPARE(m_model->row(m_model->bookmarkId(row)), row);
+    }
+
+    // Removing by row after lookups keeps the index in sync.
+    m_model->remove(0);
+    QCOMPARE(m_model->row(lastId), MANY_BOOKMARKS - 1002);
+    QCOMPARE(m_model->data(m_model->index(0), DeclarativeBookmarkModel::UrlRole).toString(),
+             QString("http://www.test.jolla.com/3"));
+
+    // Editing the url re-keys the bookmark without moving it.
+    const int row = m_model->row(middleId);
+    m_model->edit(row, "http://www.edited.jolla.com", "edited");
+    QCOMPARE(m_model->row(middleId), row);
+    QVERIFY(m_model->contains("http://www.edited.jolla.com"));
+    QVERIFY(!m_model->contains(QString("http://www.test.jolla.com/%1").arg(MANY_BOOKMARKS / 2)));
+
+    QSignalSpy dataChangedSpy(m_model, SIGNAL(dataChanged(QModelIndex, QModelIndex, QVector<int>)));
+    m_model->updateFavoriteIcon("http://www.edited.jolla.com", "image://theme/icon-launcher-test1", false);
+    QCOMPARE(dataChangedSpy.count(), 1);
+    QCOMPARE(dataChangedSpy.first().at(0).toModelIndex().row(), row);
+
+    // Appended bookmarks are found while rows are pending refresh.
+    m_model->remove(1);
+    m_model->add(TEST_URL, "test", "");
+    QCOMPARE(m_model->row(m_model->bookmarkId(m_model->rowCount() - 1)), m_model->rowCount() - 1);
+    m_model->remove(TEST_URL);
+    QVERIFY(!m_model->contains(TEST_URL));
+    QCOMPARE(m_model->row(lastId), m_model->rowCount() - 1);
+}
+
+void tst_declarativebookmarkmodel::benchmarkRemove()
+{
+    loadBookmarks(MANY_BOOKMARKS);
+    fetchAll();
+
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < MANY_BOOKMARKS; i += 2) {
+            m_model->remove(QString("http://www.test.jolla.com/%1").arg(i));
+        }
+    }
+    QCOMPARE(m_model->rowCount(), MANY_BOOKMARKS / 2);
+}
+
+void tst_declarativebookmarkmodel::filter()
+{
+    m_model->add("http://www.example.com/one", "  Sailfish OS  ", "");
+    m_model->add("http://www.EXAMPLE.org/two", "Example two", "");
+
+    BookmarkFilterModel filter;
+    filter.setSourceModel(m_model);
+    QCOMPARE(filter.rowCount(), 3);
+
+    filter.setSearch("example");
+    QCOMPARE(filter.rowCount(), 2);
+    filter.setSearch("example.org");
+    QCOMPARE(filter.rowCount(), 1);
+    QCOMPARE(filter.getIndex(0), 2);
+    filter.setSearch("sailfish os");
+    QCOMPARE(filter.rowCount(), 1);
+    QCOMPARE(filter.getIndex(0), 1);
+    filter.setSearch("SAILFISH OS  ");
+    QCOMPARE(filter.rowCount(), 0);
+
+    // Changes of the source are searched.
+    filter.setSearch("example.org");
+    m_model->add("http://www.example.org/three", "three", "");
+    QCOMPARE(filter.rowCount(), 2);
+    m_model->edit(1, "http://www.example.org/one", "one");
+    QCOMPARE(filter.rowCount(), 3);
+    m_model->remove(2);
+    QCOMPARE(filter.rowCount(), 2);
+
+    filter.setSearch(QString());
+    QCOMPARE(filter.rowCount(), 3);
+}
+
+void tst_declarativebookmarkmodel::refineFilter()
+{
+    loadBookmarks(MANY_BOOKMARKS);
+    fetchAll();
+
+    BookmarkFilterModel filter;
+    filter.setSourceModel(m_model);
+    filter.setSearch("/123");
+    QCOMPARE(filter.rowCount(), 111);
+
+    // Extending the query checks only the rows that matched.
+    const int checked = filter.rowsChecked();
+    filter.setSearch("/1234");
+    QCOMPARE(filter.rowCount(), 11);
+    QVERIFY(filter.rowsChecked() - checked <= 2 * 111);
+
+    // Other queries check all rows.
+    filter.setSearch("/124");
+    QCOMPARE(filter.rowCount(), 111);
+    QVERIFY(filter.rowsChecked() - checked >= MANY_BOOKMARKS);
+}
+
+void tst_declarativebookmarkmodel::filterUnfetched()
+{
+    loadBookmarks(1000);
+    QVERIFY(m_model->rowCount() < 1000);
+
+    BookmarkFilterModel filter;
+    filter.setSourceModel(m_model);
+    filter.setSearch("/999");
+    QCOMPARE(filter.rowCount(), 1);
+    QCOMPARE(m_model->rowCount(), 1000);
+}
+
+void tst_declarativebookmarkmodel::benchmarkFilter()
+{
+    loadBookmarks(MANY_BOOKMARKS);
+    fetchAll();
+
+    BookmarkFilterModel filter;
+    filter.setSourceModel(m_model);
+
+    // Typing a query one character at a time.
+    QBENCHMARK {
+        filter.setSearch("t");
+        filter.setSearch("te");
+        filter.setSearch("tes");
+        filter.setSearch("test 1");
+        filter.setSearch("test 12");
+        filter.setSearch("test 123");
+        QCOMPARE(filter.rowCount(), 111);
+    }
+}
+
+// Replaces the model with one that has the given number of bookmarks.
+void tst_declarativebookmarkmodel::loadBookmarks(int count)
+{
+    delete m_model;
+    BookmarkManager::instance()->clear();
+
+    QJsonArray items;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject item;
+        item.insert("url", QString("http://www.test.jolla.com/%1").arg(i));
+        item.insert("title", QString("Test %1").arg(i));
+        item.insert("favicon", QString("image://theme/icon-launcher-jollacom"));
+        item.insert("hasTouchIcon", true);
+        items.append(item);
+    }
+
+    QFile file(m_bookmarksFile);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write(QJsonDocument(items).toJson());
+    file.close();
+
+    m_model = new DeclarativeBookmarkModel(this);
+}
+
+void tst_declarativebookmarkmodel::fetchAll()
+{
+    while (m_model->canFetchMore(QModelIndex())) {
+        m_model->fetchMore(QModelIndex());
+    }
+}
+
+// Appended bookmarks have their ids once they are written.
+void tst_declarativebookmarkmodel::waitForWrites()
+{
+    for (int row = 0; row < m_model->rowCount(); ++row) {
+        QTRY_VERIFY(m_model->bookmarkId(row) > 0);
+    }
+}
+
+QByteArray tst_declarativebookmarkmodel::readFile(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
 QTEST_MAIN(tst_declarativebookmarkmodel)
 #include "tst_declarativebookmarkmodel.moc"
@@ -1,6 +1,6 @@
 TARGET = tst_declarativebookmarkmodel
 
-QT += network concurrent
+QT += network concurrent sql quick
 
 CONFIG += link_pkgconfig
 
@@ -8,6 +8,8 @@ PKGCONFIG += mlite5
 
 include(../test_common.pri)
 include(../../../apps/browser/bookmarks/bookmarks.pri)
+include(../../../apps/storage/storage.pri)
+include(../mocks/faviconmanager/faviconmanager_mock.pri)
 include(../../../common/browserapp.pri)
 include(../../../common/opensearchconfigs.pri)
 
@@ -18,6 +18,7 @@
 #include "testobject.h"
 #include "dbmanager.h"
 #include "browserpaths.h"
+#include "faviconmanager.h"
 
 struct HistoryEntry {
     HistoryEntry(QString url, QString title) : url(url), title(title) {}
@@ -57,9 +58,24 @@ private slots:
     void searchWithSpecialChars_data();
     void searchWithSpecialChars();
 
+    void addVisits();
+    void addFilteredVisits();
+    void fullWindow();
+    void inactive();
+
+    void updateInsertAtTop();
+    void updateRemove();
+    void updateReorder();
+    void updateRoles();
+
+    void removeLastHostEntry();
+    void removeManyEntries();
+
     void cleanup();
 
 private:
+    QList<Link> links(const QList<int> &ids) const;
+    QList<int> modelIds() const;
     void addEntries(const QList<HistoryEntry> &entries);
     void verifySearchResult(QString searchTerm, int expectedCount);
 
@@ -313,6 +329,254 @@ void tst_declarativehistorymodel::searchWithSpecialChars()
     // QEXPECT_FAIL("special_upper_case_special_char", "due to sqlite bug accented char is case sensitive with LIKE op", Continue);
 }
 
+void tst_declarativehistorymodel::addVisits()
+{
+    QSignalSpy historyAvailable(DBManager::instance(), SIGNAL(historyAvailable(QList<Link>)));
+    QSignalSpy rowsInserted(historyModel, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy rowsMoved(historyModel, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+    QSignalSpy dataChanged(historyModel, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+    addEntries(QList<HistoryEntry>()
+               << HistoryEntry(QStringLiteral("http://www.foobar.com/page1/"), QStringLiteral("FooBar Page1"))
+               << HistoryEntry(QStringLiteral("http://www.foobar.com/page2/"), QStringLiteral("FooBar Page2")));
+
+    // Visits are inserted at the top without searching the history again.
+    QCOMPARE(historyAvailable.count(), 0);
+    QCOMPARE(rowsInserted.count(), 2);
+    QCOMPARE(historyModel->rowCount(), 2);
+    QCOMPARE(historyModel->data(historyModel->index(0), DeclarativeHistoryModel::UrlRole).toString(),
+             QStringLiteral("http://www.foobar.com/page2/"));
+
+    // Visiting again moves the row and keeps the stored title.
+    addEntries(QList<HistoryEntry>() << HistoryEntry(QStringLiteral("http://www.foobar.com/page1/"), QString()));
+    QCOMPARE(historyAvailable.count(), 0);
+    QCOMPARE(rowsMoved.count(), 1);
+    QCOMPARE(dataChanged.count(), 0);
+    QCOMPARE(historyModel->rowCount(), 2);
+    QCOMPARE(historyModel->data(historyModel->index(0), DeclarativeHistoryModel::UrlRole).toString(),
+             QStringLiteral("http://www.foobar.com/page1/"));
+    QCOMPARE(historyModel->data(historyModel->index(0), DeclarativeHistoryModel::TitleRole).toString(),
+             QStringLiteral("FooBar Page1"));
+
+    addEntries(QList<HistoryEntry>() << HistoryEntry(QStringLiteral("http://www.foobar.com/page1/"), QStringLiteral("Renamed")));
+    QCOMPARE(rowsMoved.count(), 1);
+    QCOMPARE(dataChanged.count(), 1);
+    QCOMPARE(dataChanged.first().at(2).value<QVector<int> >(), QVector<int>() << DeclarativeHistoryModel::TitleRole);
+
+    // The rows are the same as searched.
+    verifySearchResult("", 2);
+    QCOMPARE(historyModel->data(historyModel->index(0), DeclarativeHistoryModel::TitleRole).toString(),
+             QStringLiteral("Renamed"));
+}
+
+void tst_declarativehistorymodel::addFilteredVisits()
+{
+    verifySearchResult("page", 0);
+
+    addEntries(QList<HistoryEntry>()
+               << HistoryEntry(QStringLiteral("http://www.foobar.com/PAGE1/"), QStringLiteral("FooBar"))
+               << HistoryEntry(QStringLiteral("http://www.other.com/"), QStringLiteral("Other"))
+               << HistoryEntry(QStringLiteral("http://www.foobar.com/"), QStringLiteral("A page")));
+    QCOMPARE(historyModel->rowCount(), 2);
+
+    // Visited more often ranks first.
+    addEntries(QList<HistoryEntry>() << HistoryEntry(QStringLiteral("http://www.foobar.com/PAGE1/"), QString()));
+    QStringList urls;
+    for (int i = 0; i < historyModel->rowCount(); ++i) {
+        urls << historyModel->data(historyModel->index(i), DeclarativeHistoryModel::UrlRole).toString();
+    }
+
+    verifySearchResult("page", 2);
+    for (int i = 0; i < historyModel->rowCount(); ++i) {
+        QCOMPARE(historyModel->data(historyModel->index(i), DeclarativeHistoryModel::UrlRole).toString(), urls.at(i));
+    }
+
+    // A title that no longer matches removes the row.
+    addEntries(QList<HistoryEntry>() << HistoryEntry(QStringLiteral("http://www.foobar.com/"), QStringLiteral("Home")));
+    QCOMPARE(historyModel->rowCount(), 1);
+}
+
+void tst_declarativehistorymodel::fullWindow()
+{
+    QList<HistoryEntry> entries;
+    for (int i = 0; i < HISTORY_LIMIT + 5; ++i) {
+        entries << HistoryEntry(QString("http://www.foobar.com/%1").arg(i), QString("Page %1").arg(i));
+    }
+    addEntries(entries);
+    QCOMPARE(historyModel->rowCount(), HISTORY_LIMIT);
+
+    // Removing a row of a full window fills the gap.
+    QSignalSpy historyAvailable(DBManager::instance(), SIGNAL(historyAvailable(QList<Link>)));
+    historyModel->remove(0);
+    QCOMPARE(historyModel->rowCount(), HISTORY_LIMIT - 1);
+    QVERIFY(historyAvailable.wait());
+    QCOMPARE(historyModel->rowCount(), HISTORY_LIMIT);
+}
+
+void tst_declarativehistorymodel::inactive()
+{
+    historyModel->setActive(false);
+    QSignalSpy historyAvailable(DBManager::instance(), SIGNAL(historyAvailable(QList<Link>)));
+    addEntries(QList<HistoryEntry>() << HistoryEntry(QStringLiteral("http://www.foobar.com/"), QStringLiteral("FooBar")));
+    QCOMPARE(historyModel->rowCount(), 0);
+    QCOMPARE(historyAvailable.count(), 0);
+
+    // Activating searches again.
+    historyModel->setActive(true);
+    QVERIFY(historyAvailable.wait());
+    QCOMPARE(historyModel->rowCount(), 1);
+}
+
+void tst_declarativehistorymodel::updateInsertAtTop()
+{
+    historyModel->updateModel(links({ 1, 2, 3, 4 }));
+
+    QSignalSpy rowsInserted(historyModel, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy rowsRemoved(historyModel, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    QSignalSpy rowsMoved(historyModel, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+    QSignalSpy dataChanged(historyModel, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    QSignalSpy countChanged(historyModel, SIGNAL(countChanged()));
+
+    // A new visit pushes the last row out of the window.
+    historyModel->updateModel(links({ 5, 1, 2, 3 }));
+    QCOMPARE(modelIds(), QList<int>({ 5, 1, 2, 3 }));
+    QCOMPARE(rowsInserted.count(), 1);
+    QCOMPARE(rowsInserted.first().at(1).toInt(), 0);
+    QCOMPARE(rowsRemoved.count(), 1);
+    QCOMPARE(rowsRemoved.first().at(1).toInt(), 3);
+    QCOMPARE(rowsMoved.count(), 0);
+    QCOMPARE(dataChanged.count(), 0);
+    QCOMPARE(countChanged.count(), 0);
+
+    historyModel->updateModel(links({ 6, 5, 1, 2, 3 }));
+    QCOMPARE(rowsInserted.count(), 2);
+    QCOMPARE(rowsRemoved.count(), 1);
+    QCOMPARE(dataChanged.count(), 0);
+    QCOMPARE(countChanged.count(), 1);
+}
+
+void tst_declarativehistorymodel::updateRemove()
+{
+    historyModel->updateModel(links({ 1, 2, 3, 4, 5, 6 }));
+
+    QSignalSpy rowsRemoved(historyModel, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    QSignalSpy dataChanged(historyModel, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+    // Contiguous rows are removed at once.
+    historyModel->updateModel(links({ 1, 4, 6 }));
+    QCOMPARE(modelIds(), QList<int>({ 1, 4, 6 }));
+    QCOMPARE(rowsRemoved.count(), 2);
+    QCOMPARE(rowsRemoved.at(0).at(1).toInt(), 4);
+    QCOMPARE(rowsRemoved.at(0).at(2).toInt(), 4);
+    QCOMPARE(rowsRemoved.at(1).at(1).toInt(), 1);
+    QCOMPARE(rowsRemoved.at(1).at(2).toInt(), 2);
+    QCOMPARE(dataChanged.count(), 0);
+
+    historyModel->updateModel(QList<Link>());
+    QCOMPARE(historyModel->rowCount(), 0);
+    QCOMPARE(rowsRemoved.count(), 3);
+}
+
+void tst_declarativehistorymodel::updateReorder()
+{
+    historyModel->updateModel(links({ 1, 2, 3, 4 }));
+
+    QSignalSpy rowsInserted(historyModel, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy rowsRemoved(historyModel, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    QSignalSpy rowsMoved(historyModel, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)));
+    QSignalSpy dataChanged(historyModel, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+    // Visiting a row again moves it to the top.
+    historyModel->updateModel(links({ 3, 1, 2, 4 }));
+    QCOMPARE(modelIds(), QList<int>({ 3, 1, 2, 4 }));
+    QCOMPARE(rowsMoved.count(), 1);
+    QCOMPARE(rowsMoved.first().at(1).toInt(), 2);
+    QCOMPARE(rowsMoved.first().at(4).toInt(), 0);
+
+    historyModel->updateModel(links({ 4, 2, 1, 3 }));
+    QCOMPARE(modelIds(), QList<int>({ 4, 2, 1, 3 }));
+    QCOMPARE(rowsInserted.count(), 0);
+    QCOMPARE(rowsRemoved.count(), 0);
+    QCOMPARE(dataChanged.count(), 0);
+}
+
+void tst_declarativehistorymodel::updateRoles()
+{
+    historyModel->updateModel(links({ 1, 2, 3 }));
+
+    QSignalSpy dataChanged(historyModel, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+    QList<Link> changed = links({ 1, 2, 3 });
+    changed[1].setTitle("Changed");
+    changed[2].setDate(changed.at(2).date().addDays(-1));
+    historyModel->updateModel(changed);
+
+    QCOMPARE(dataChanged.count(), 2);
+    QCOMPARE(dataChanged.at(0).at(0).toModelIndex().row(), 1);
+    QCOMPARE(dataChanged.at(0).at(2).value<QVector<int> >(), QVector<int>() << DeclarativeHistoryModel::TitleRole);
+    QCOMPARE(dataChanged.at(1).at(0).toModelIndex().row(), 2);
+    QCOMPARE(dataChanged.at(1).at(2).value<QVector<int> >(), QVector<int>() << DeclarativeHistoryModel::DateRole);
+    QCOMPARE(historyModel->data(historyModel->index(1), DeclarativeHistoryModel::TitleRole).toString(), QString("Changed"));
+}
+
+void tst_declarativehistorymodel::removeLastHostEntry()
+{
+    const QString hostA("http://a.foobar.com");
+    const QString hostB("http://b.foobar.com");
+
+    // The oldest entry of host a is outside the window.
+    QList<HistoryEntry> entries;
+    entries << HistoryEntry(hostA + "/0", "A 0");
+    for (int i = 0; i < HISTORY_LIMIT; ++i) {
+        entries << HistoryEntry(QString("%1/%2").arg(hostB).arg(i), QString("B %1").arg(i));
+    }
+    entries << HistoryEntry(hostA + "/1", "A 1");
+    addEntries(entries);
+    verifySearchResult("", HISTORY_LIMIT);
+
+    QSignalSpy hostsRemoved(DBManager::instance(), SIGNAL(historyHostsRemoved(QStringList)));
+    QSignalSpy historyAvailable(DBManager::instance(), SIGNAL(historyAvailable(QList<Link>)));
+    historyModel->remove(hostA + "/1");
+    QVERIFY(historyAvailable.wait());
+    QCOMPARE(hostsRemoved.count(), 0);
+
+    historyModel->remove(hostA + "/0");
+    QVERIFY(hostsRemoved.wait());
+    QCOMPARE(hostsRemoved.first().at(0).toStringList(), QStringList() << hostA);
+}
+
+void tst_declarativehistorymodel::removeManyEntries()
+{
+    const QString hostA("http://a.foobar.com");
+    const QString hostB("http://b.foobar.com");
+
+    QList<HistoryEntry> entries;
+    for (int i = 0; i < HISTORY_LIMIT / 2; ++i) {
+        entries << HistoryEntry(QString("%1/%2").arg(hostA).arg(i), QString("A %1").arg(i));
+        entries << HistoryEntry(QString("%1/%2").arg(hostB).arg(i), QString("B %1").arg(i));
+    }
+    addEntries(entries);
+    verifySearchResult("", HISTORY_LIMIT);
+
+    QList<int> idsA;
+    QList<int> idsB;
+    for (const Link &link : historyModel->m_links) {
+        (link.url().startsWith(hostA) ? idsA : idsB) << link.linkId();
+    }
+
+    // Hosts are reported once, when their last entry is removed.
+    QSignalSpy hostsRemoved(DBManager::instance(), SIGNAL(historyHostsRemoved(QStringList)));
+    DBManager::instance()->removeHistoryEntries(idsA + idsB.mid(1));
+    QVERIFY(hostsRemoved.wait());
+    QCOMPARE(hostsRemoved.first().at(0).toStringList(), QStringList() << hostA);
+
+    DBManager::instance()->removeHistoryEntries(idsB);
+    QVERIFY(hostsRemoved.wait());
+    QCOMPARE(hostsRemoved.count(), 2);
+    QCOMPARE(hostsRemoved.at(1).at(0).toStringList(), QStringList() << hostB);
+    verifySearchResult("", 0);
+}
+
 void tst_declarativehistorymodel::cleanup()
 {
     delete historyModel;
@@ -322,14 +586,32 @@ void tst_declarativehistorymodel::cleanup()
     QVERIFY(dbFile.remove());
 }
 
+QList<Link> tst_declarativehistorymodel::links(const QList<int> &ids) const
+{
+    QList<Link> links;
+    for (int id : ids) {
+        links << Link(id, QString("http://www.foobar.com/%1").arg(id), "", QString("Page %1").arg(id), QDate(2021, 1, 1));
+    }
+    return links;
+}
+
+QList<int> tst_declarativehistorymodel::modelIds() const
+{
+    QList<int> ids;
+    for (const Link &link : historyModel->m_links) {
+        ids << link.linkId();
+    }
+    return ids;
+}
+
 void tst_declarativehistorymodel::addEntries(const QList<HistoryEntry> &entiries)
 {
-    QSignalSpy historyAvailable(DBManager::instance(), SIGNAL(historyAvailable(QList<Link>)));
+    QSignalSpy historyEntryAdded(DBManager::instance(), SIGNAL(historyEntryAdded(Link)));
     for (int i = 0; i < entiries.count(); ++i) {
         historyModel->add(entiries.at(i).url, entiries.at(i).title);
     }
 
-    waitSignals(historyAvailable, entiries.count());
+    waitSignals(historyEntryAdded, entiries.count());
 }
 
 void tst_declarativehistorymodel::verifySearchResult(QString searchTerm, int expectedCount)
@@ -5,6 +5,7 @@ QT += quick sql
 include(../test_common.pri)
 include(../common/testobject.pri)
 include(../mocks/declarativewebpage/declarativewebpage_mock.pri)
+include(../mocks/tabthumbnailprovider/tabthumbnailprovider_mock.pri)
 include(../mocks/declarativewebcontainer/declarativewebcontainer_mock.pri)
 include(../mocks/faviconmanager/faviconmanager_mock.pri)
 include(../../../common/browserapp.pri)
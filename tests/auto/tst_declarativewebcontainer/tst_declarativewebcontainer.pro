@@ -11,6 +11,7 @@ include(../mocks/qmozcontext/qmozcontext.pri)
 include(../mocks/qmozwindow/qmozwindow.pri)
 include(../mocks/webpagefactory/webpagefactory.pri)
 include(../mocks/declarativewebpage/declarativewebpage_mock.pri)
+include(../mocks/tabthumbnailprovider/tabthumbnailprovider_mock.pri)
 include(../mocks/declarativewebutils/declarativewebutils_mock.pri)
 include(../mocks/downloadmanager/downloadmanager_mock.pri)
 include(../mocks/opensearchconfigs/opensearchconfigs_mock.pri)
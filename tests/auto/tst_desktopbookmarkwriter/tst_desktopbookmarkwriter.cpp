@@ -10,6 +10,7 @@
 
 #include "desktopbookmarkwriter.h"
 #include "browserpaths.h"
+#include "dbmanager.h"
 
 #include <MDesktopEntry>
 #include <QtTest>
@@ -29,6 +30,8 @@ private slots:
     void invalidInput();
     void writeDesktopFile_data();
     void writeDesktopFile();
+    void writeStoredFavicon();
+    void writeMissingFavicon();
     void cleanupTestCase();
 
 private:
@@ -133,12 +136,44 @@ void tst_desktopbookmarkwriter::writeDesktopFile()
     QCOMPARE(desktopEntry.comment(), outputTitle);
 }
 
+void tst_desktopbookmarkwriter::writeStoredFavicon()
+{
+    QFile iconFile(QString("%1/too-small-icon-size.png").arg(TEST_DATA));
+    QVERIFY(iconFile.open(QFile::ReadOnly));
+    const QByteArray data = iconFile.readAll();
+    DBManager::instance()->storeFaviconData("0123456789abcdef0123456789abcdef01234567", data);
+
+    QSignalSpy savedSpy(&writer, SIGNAL(saved(QString)));
+    writer.save("http://www.test1.jolla.com", "Stored",
+                QString("image://%1/0123456789abcdef0123456789abcdef01234567").arg(FAVICON_PROVIDER));
+    QString desktopFile = writtenDesktopFile(savedSpy);
+    desktopFiles << desktopFile;
+    QVERIFY(!desktopFile.isEmpty());
+
+    MDesktopEntry desktopEntry(desktopFile);
+    QCOMPARE(desktopEntry.icon(), QString("data:image/png;base64,%1").arg(QString::fromLatin1(data.toBase64())));
+}
+
+void tst_desktopbookmarkwriter::writeMissingFavicon()
+{
+    QSignalSpy savedSpy(&writer, SIGNAL(saved(QString)));
+    writer.save("http://www.test1.jolla.com", "Missing",
+                QString("image://%1/fedcba9876543210fedcba9876543210fedcba98").arg(FAVICON_PROVIDER));
+    QString desktopFile = writtenDesktopFile(savedSpy);
+    desktopFiles << desktopFile;
+    QVERIFY(!desktopFile.isEmpty());
+
+    MDesktopEntry desktopEntry(desktopFile);
+    QCOMPARE(desktopEntry.icon(), QString(DEFAULT_DESKTOP_BOOKMARK_ICON));
+}
+
 void tst_desktopbookmarkwriter::cleanupTestCase()
 {
     for (const QString &desktopFile : desktopFiles) {
         QFile file(desktopFile);
         file.remove();
     }
+    delete DBManager::instance();
 }
 
 QTEST_GUILESS_MAIN(tst_desktopbookmarkwriter)
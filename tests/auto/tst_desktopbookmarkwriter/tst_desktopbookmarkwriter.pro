@@ -1,9 +1,11 @@
 TARGET = tst_desktopbookmarkwriter
 
-QT += concurrent network
+QT += concurrent network sql quick
 
 include(../test_common.pri)
 include(../../../apps/browser/bookmarks/bookmarks.pri)
+include(../../../apps/storage/storage.pri)
+include(../mocks/faviconmanager/faviconmanager_mock.pri)
 include(../../../common/browserapp.pri)
 include(../../../common/opensearchconfigs.pri)
 
@@ -0,0 +1,295 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <QtTest>
+#include <QCryptographicHash>
+
+#include "browserpaths.h"
+#include "dbmanager.h"
+#include "faviconmanager.h"
+
+static const QString gType = QStringLiteral("test");
+static const int gRows = 10000;
+
+class tst_faviconmanager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+
+    void host();
+    void add();
+    void addImage();
+    void remove();
+    void removeHistoryHosts();
+    void releaseCache();
+    void failedFetches();
+    void transientFailures();
+    void expiredFailures();
+
+    void benchmarkGet();
+    void benchmarkFavicon();
+
+private:
+    QStringList populate();
+
+    QString mDbFile;
+};
+
+void tst_faviconmanager::initTestCase()
+{
+    mDbFile = QString("%1/%2")
+            .arg(BrowserPaths::dataLocation())
+            .arg(QLatin1String(DB_NAME));
+    QFile::remove(mDbFile);
+}
+
+void tst_faviconmanager::cleanup()
+{
+    FaviconManager::instance()->clear(gType);
+}
+
+void tst_faviconmanager::host()
+{
+    FaviconManager::Host host = FaviconManager::host("http://example.com/page?query=1");
+    QCOMPARE(host.name, QString("http://example.com"));
+    QCOMPARE(host.hash, qHash(host.name));
+    QVERIFY(host == FaviconManager::host("http://example.com/other"));
+    QVERIFY(!(host == FaviconManager::host("https://example.com/page")));
+    QVERIFY(FaviconManager::Host().isNull());
+}
+
+void tst_faviconmanager::add()
+{
+    FaviconManager *manager = FaviconManager::instance();
+    manager->add(gType, "http://example.com/page", "icon-m-region", false);
+
+    QCOMPARE(manager->get(gType, "http://example.com/other"), QString("icon-m-region"));
+
+    // Lookups by the same key return the stored source, not a copy.
+    const FaviconManager::Host host = FaviconManager::host("http://example.com/");
+    const QString &favicon = manager->favicon(gType, host);
+    QCOMPARE(favicon, QString("icon-m-region"));
+    QCOMPARE(&manager->favicon(gType, host), &favicon);
+
+    QVERIFY(manager->get(gType, "http://example.org").isEmpty());
+    QVERIFY(manager->favicon(gType, FaviconManager::host("http://example.org")).isEmpty());
+    QVERIFY(manager->favicon("unknown", host).isEmpty());
+
+    // Replacing the favicon updates the index.
+    manager->add(gType, "http://example.com", "icon-m-other", true);
+    QCOMPARE(manager->favicon(gType, host), QString("icon-m-other"));
+}
+
+void tst_faviconmanager::addImage()
+{
+    FaviconManager *manager = FaviconManager::instance();
+    const QByteArray data("png data");
+    const QString hash = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+
+    manager->addImage(gType, "http://example.com", data, true);
+    QCOMPARE(manager->favicon(gType, FaviconManager::host("http://example.com/page")),
+             QString("image://%1/%2").arg(QStringLiteral(FAVICON_PROVIDER), hash));
+
+    // Data urls are stored as image data.
+    manager->add(gType, "http://example.org", QString("data:image/png;base64,%1").arg(QString(data.toBase64())), false);
+    QCOMPARE(manager->get(gType, "http://example.org"), QString("image://%1/%2").arg(QStringLiteral(FAVICON_PROVIDER), hash));
+    QCOMPARE(DBManager::instance()->getFaviconData(hash), data);
+}
+
+void tst_faviconmanager::remove()
+{
+    FaviconManager *manager = FaviconManager::instance();
+    const FaviconManager::Host host = FaviconManager::host("http://example.com");
+    manager->add(gType, "http://example.com/page", "icon-m-region", false);
+    QVERIFY(!manager->favicon(gType, host).isEmpty());
+
+    manager->remove(gType, "http://example.com/other");
+    QVERIFY(manager->favicon(gType, host).isEmpty());
+
+    manager->add(gType, "http://example.com/page", "icon-m-region", false);
+    manager->clear(gType);
+    QVERIFY(manager->favicon(gType, host).isEmpty());
+}
+
+void tst_faviconmanager::removeHistoryHosts()
+{
+    FaviconManager *manager = FaviconManager::instance();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    manager->add("history", "http://a.example.com/page", "icon-a", false);
+    manager->add("history", "http://b.example.com/page", "icon-b", false);
+    manager->fetchFailed("http://a.example.com", "http://a.example.com/icon.png", false, now);
+    manager->fetchFailed("http://b.example.com", "http://b.example.com/icon.png", false, now);
+
+    // Hosts without history left lose their favicon and failed fetches without a history model.
+    emit DBManager::instance()->historyHostsRemoved(QStringList() << "http://a.example.com");
+    QVERIFY(manager->get("history", "http://a.example.com").isEmpty());
+    QCOMPARE(manager->get("history", "http://b.example.com"), QString("icon-b"));
+    QVERIFY(manager->fetchAllowed("http://a.example.com", "http://a.example.com/icon.png", now));
+    QVERIFY(!manager->fetchAllowed("http://b.example.com", "http://b.example.com/icon.png", now));
+
+    manager->flush(true);
+    const FaviconFailureList failures = DBManager::instance()->getFaviconFailures();
+    QCOMPARE(failures.count(), 1);
+    QCOMPARE(failures.first().host, QString("http://b.example.com"));
+
+    manager->clear("history");
+}
+
+void tst_faviconmanager::releaseCache()
+{
+    FaviconManager *manager = FaviconManager::instance();
+    manager->add(gType, "http://example.com", "icon-m-region", false);
+    manager->addImage(gType, "http://example.org", QByteArray("png data"), false);
+    const QString image = manager->get(gType, "http://example.org");
+
+    // Released favicons are read back from the database with their index.
+    manager->releaseCache();
+    QCOMPARE(manager->favicon(gType, FaviconManager::host("http://example.com")), QString("icon-m-region"));
+    QCOMPARE(manager->favicon(gType, FaviconManager::host("http://example.org")), image);
+}
+
+void tst_faviconmanager::failedFetches()
+{
+    static const qint64 day = 24 * 60 * 60 * 1000LL;
+    FaviconManager *manager = FaviconManager::instance();
+    const QString host = "http://example.com";
+    const QString iconUrl = "http://example.com/apple-touch-icon.png";
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QVERIFY(manager->fetchAllowed(host, iconUrl, now));
+    manager->fetchFailed(host, iconUrl, false, now);
+
+    // Missing touch icons are asked again after a week.
+    const int avoided = manager->fetchesAvoided();
+    QVERIFY(!manager->fetchAllowed(host, iconUrl, now + day));
+    QVERIFY(!manager->fetchAllowed(host, iconUrl, now + 6 * day));
+    QCOMPARE(manager->fetchesAvoided(), avoided + 2);
+    QVERIFY(manager->fetchAllowed(host, iconUrl, now + 7 * day));
+    QVERIFY(manager->fetchAllowed(host, "http://example.com/icon.png", now));
+
+    // Failures are persisted.
+    manager->flush(true);
+    manager->m_failures.clear();
+    manager->m_failuresLoaded = false;
+    QVERIFY(!manager->fetchAllowed(host, iconUrl, now + day));
+
+    manager->fetchSucceeded(host, iconUrl);
+    QVERIFY(manager->fetchAllowed(host, iconUrl, now));
+    manager->flush(true);
+    QVERIFY(DBManager::instance()->getFaviconFailures().isEmpty());
+
+    // Clearing favicons forgets the hosts.
+    manager->fetchFailed(host, iconUrl, false, now);
+    manager->clear(gType);
+    QVERIFY(manager->fetchAllowed(host, iconUrl, now));
+    QVERIFY(DBManager::instance()->getFaviconFailures().isEmpty());
+}
+
+void tst_faviconmanager::transientFailures()
+{
+    static const qint64 minute = 60 * 1000LL;
+    FaviconManager *manager = FaviconManager::instance();
+    const QString host = "http://example.com";
+    const QString iconUrl = "http://example.com/apple-touch-icon.png";
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    // Network errors are retried with exponential backoff.
+    manager->fetchFailed(host, iconUrl, true, now);
+    QVERIFY(!manager->fetchAllowed(host, iconUrl, now + 4 * minute));
+    QVERIFY(manager->fetchAllowed(host, iconUrl, now + 5 * minute));
+
+    manager->fetchFailed(host, iconUrl, true, now);
+    QVERIFY(!manager->fetchAllowed(host, iconUrl, now + 9 * minute));
+    QVERIFY(manager->fetchAllowed(host, iconUrl, now + 10 * minute));
+
+    for (int i = 0; i < 20; ++i) {
+        manager->fetchFailed(host, iconUrl, true, now);
+    }
+    QVERIFY(manager->fetchAllowed(host, iconUrl, now + 7 * 24 * 60 * minute));
+    QCOMPARE(manager->m_failures.value(host + '\n' + iconUrl).failures, 22);
+}
+
+void tst_faviconmanager::expiredFailures()
+{
+    static const qint64 day = 24 * 60 * 60 * 1000LL;
+    FaviconManager *manager = FaviconManager::instance();
+    const QString host = "http://example.com";
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    manager->fetchFailed(host, "http://example.com/old.png", false, now - 8 * day);
+    manager->fetchFailed(host, "http://example.com/new.png", false, now);
+    manager->flush(true);
+    QCOMPARE(DBManager::instance()->getFaviconFailures().count(), 2);
+
+    // Rows past their retry time are removed when failures are loaded.
+    manager->m_failures.clear();
+    manager->m_failuresLoaded = false;
+    QVERIFY(manager->fetchAllowed(host, "http://example.com/old.png", now));
+    QVERIFY(!manager->m_failures.contains(host + '\n' + "http://example.com/old.png"));
+    manager->flush(true);
+    const FaviconFailureList failures = DBManager::instance()->getFaviconFailures();
+    QCOMPARE(failures.count(), 1);
+    QCOMPARE(failures.first().iconUrl, QString("http://example.com/new.png"));
+}
+
+void tst_faviconmanager::benchmarkGet()
+{
+    const QStringList urls = populate();
+    FaviconManager *manager = FaviconManager::instance();
+
+    // Every lookup parses and hashes the url, as before models cached hosts.
+    QBENCHMARK {
+        for (const QString &url : urls) {
+            manager->get(gType, url);
+        }
+    }
+}
+
+void tst_faviconmanager::benchmarkFavicon()
+{
+    const QStringList urls = populate();
+    FaviconManager *manager = FaviconManager::instance();
+
+    QVector<FaviconManager::Host> hosts;
+    hosts.reserve(urls.count());
+    for (const QString &url : urls) {
+        hosts.append(FaviconManager::host(url));
+    }
+
+    int found = 0;
+    QBENCHMARK {
+        found = 0;
+        for (const FaviconManager::Host &host : hosts) {
+            found += manager->favicon(gType, host).isEmpty() ? 0 : 1;
+        }
+    }
+    QCOMPARE(found, gRows);
+}
+
+// Rows of a history model, each host has a few pages.
+QStringList tst_faviconmanager::populate()
+{
+    FaviconManager *manager = FaviconManager::instance();
+    QStringList urls;
+    for (int i = 0; i < gRows; ++i) {
+        const QString url = QString("https://host%1.example.com/page/%2").arg(i / 4).arg(i);
+        if (i % 4 == 0) {
+            manager->add(gType, url, QString("icon-%1").arg(i), false);
+        }
+        urls.append(url);
+    }
+    return urls;
+}
+
+QTEST_MAIN(tst_faviconmanager)
+#include "tst_faviconmanager.moc"
@@ -0,0 +1,26 @@
+TARGET = tst_faviconmanager
+
+QT += quick concurrent sql network
+
+include(../mocks/webengine/webengine.pri)
+include(../mocks/declarativewebpage/declarativewebpage_mock.pri)
+include(../mocks/opensearchconfigs/opensearchconfigs_mock.pri)
+
+include(../test_common.pri)
+include(../../../common/browserapp.pri)
+include(../../../apps/storage/storage.pri)
+
+INCLUDEPATH += $$CORESRCDIR
+
+SOURCES += tst_faviconmanager.cpp \
+           $$CORESRCDIR/datafetcher.cpp \
+           $$CORESRCDIR/faviconmanager.cpp \
+           $$CORESRCDIR/fetchservice.cpp \
+           $$CORESRCDIR/logging.cpp
+
+HEADERS += $$CORESRCDIR/datafetcher.h \
+           $$CORESRCDIR/faviconmanager.h \
+           $$CORESRCDIR/fetchservice.h \
+           $$CORESRCDIR/logging.h
+
+LIBS += -lgtest -lgmock
@@ -0,0 +1,359 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <QtTest>
+#include <QBuffer>
+#include <QImage>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include "fetchservice.h"
+
+// Minimal HTTP server that answers requests of the test, optionally
+// holding the responses back until released.
+class HttpStandIn : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    struct Response {
+        int status;
+        QByteArray headers;
+        QByteArray body;
+    };
+
+    HttpStandIn()
+        : hold(false)
+    {
+        connect(this, &QTcpServer::newConnection, this, &HttpStandIn::accept);
+    }
+
+    QUrl url(const QString &path) const
+    {
+        return QUrl(QStringLiteral("http://127.0.0.1:%1%2").arg(serverPort()).arg(path));
+    }
+
+    void release()
+    {
+        hold = false;
+        const QList<QPair<QTcpSocket *, QString> > held = m_held;
+        m_held.clear();
+        for (const auto &request : held) {
+            respond(request.first, request.second);
+        }
+    }
+
+    void reset()
+    {
+        release();
+        responses.clear();
+        requests.clear();
+    }
+
+    QHash<QString, Response> responses;
+    QStringList requests;
+    bool hold;
+
+private slots:
+    void accept()
+    {
+        while (hasPendingConnections()) {
+            QTcpSocket *socket = nextPendingConnection();
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                read(socket);
+            });
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    }
+
+private:
+    void read(QTcpSocket *socket)
+    {
+        QByteArray &buffer = m_buffers[socket];
+        buffer += socket->readAll();
+        if (!buffer.contains("\r\n\r\n")) {
+            return;
+        }
+
+        const QString path = QString::fromLatin1(buffer.split(' ').value(1));
+        m_buffers.remove(socket);
+        requests.append(path);
+        if (hold) {
+            m_held.append(qMakePair(socket, path));
+        } else {
+            respond(socket, path);
+        }
+    }
+
+    void respond(QTcpSocket *socket, const QString &path)
+    {
+        const Response response = responses.value(path, { 404, QByteArray(), QByteArray() });
+        QByteArray reply = QByteArray("HTTP/1.1 ") + QByteArray::number(response.status)
+                + (response.status == 200 ? " OK\r\n" : " Not Found\r\n");
+        reply += "Connection: close\r\n";
+        reply += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+        reply += response.headers;
+        reply += "\r\n";
+        reply += response.body;
+        socket->write(reply);
+        socket->disconnectFromHost();
+    }
+
+    QHash<QTcpSocket *, QByteArray> m_buffers;
+    QList<QPair<QTcpSocket *, QString> > m_held;
+};
+
+class tst_fetchservice : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void fetch();
+    void error();
+    void sharedRequest();
+    void maximumActiveRequests();
+    void cancel();
+    void diskCache();
+    void clearCache();
+    void probeImage();
+    void encodeBase64();
+    void decodeImage();
+    void imageSize();
+
+private:
+    QByteArray png(const QSize &size) const;
+
+    HttpStandIn server;
+    FetchService *service;
+};
+
+void tst_fetchservice::initTestCase()
+{
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    service = FetchService::instance();
+    service->setCacheDirectory(QDir::tempPath() + QStringLiteral("/tst_fetchservice"));
+}
+
+void tst_fetchservice::init()
+{
+    service->clearCache();
+    service->setMaximumActiveRequests(4);
+}
+
+void tst_fetchservice::cleanup()
+{
+    server.reset();
+    QTRY_COMPARE(service->activeCount(), 0);
+}
+
+void tst_fetchservice::fetch()
+{
+    server.responses.insert("/opensearch.xml", { 200, "Content-Type: text/xml\r\n", "<OpenSearchDescription/>" });
+
+    QScopedPointer<FetchReply> reply(service->fetch(server.url("/opensearch.xml")));
+    QSignalSpy finishedSpy(reply.data(), SIGNAL(finished()));
+    QVERIFY(finishedSpy.wait());
+    QVERIFY(reply->isFinished());
+    QCOMPARE(reply->error(), QNetworkReply::NoError);
+    QCOMPARE(reply->data(), QByteArray("<OpenSearchDescription/>"));
+    QVERIFY(!reply->fromCache());
+    QVERIFY(!reply->imageSize().isValid());
+}
+
+void tst_fetchservice::error()
+{
+    QScopedPointer<FetchReply> reply(service->fetch(server.url("/missing.png"), FetchService::ProbeImage));
+    QSignalSpy finishedSpy(reply.data(), SIGNAL(finished()));
+    QVERIFY(finishedSpy.wait());
+    QCOMPARE(reply->error(), QNetworkReply::ContentNotFoundError);
+    QVERIFY(reply->data().isEmpty());
+}
+
+void tst_fetchservice::sharedRequest()
+{
+    server.responses.insert("/apple-touch-icon.png", { 200, QByteArray(), png(QSize(128, 128)) });
+    server.hold = true;
+
+    const int started = service->requestsStarted();
+    const int shared = service->requestsShared();
+    QList<FetchReply *> replies;
+    for (int i = 0; i < 3; ++i) {
+        replies.append(service->fetch(server.url("/apple-touch-icon.png"), FetchService::ProbeImage, this));
+    }
+    QCOMPARE(service->requestsStarted(), started + 1);
+    QCOMPARE(service->requestsShared(), shared + 2);
+    QTRY_COMPARE(server.requests.count(), 1);
+
+    server.release();
+    for (FetchReply *reply : replies) {
+        QTRY_VERIFY(reply->isFinished());
+        QCOMPARE(reply->data(), server.responses.value("/apple-touch-icon.png").body);
+        QCOMPARE(reply->imageSize(), QSize(128, 128));
+    }
+    QCOMPARE(server.requests.count(), 1);
+    qDeleteAll(replies);
+
+    // Finished requests are not shared.
+    QScopedPointer<FetchReply> reply(service->fetch(server.url("/apple-touch-icon.png"), FetchService::ProbeImage));
+    QTRY_VERIFY(reply->isFinished());
+    QCOMPARE(server.requests.count(), 2);
+}
+
+void tst_fetchservice::maximumActiveRequests()
+{
+    service->setMaximumActiveRequests(2);
+    server.hold = true;
+
+    QList<FetchReply *> replies;
+    for (int i = 0; i < 5; ++i) {
+        const QString path = QStringLiteral("/icon-%1.png").arg(i);
+        server.responses.insert(path, { 200, QByteArray(), png(QSize(64, 64)) });
+        replies.append(service->fetch(server.url(path), FetchService::ProbeImage, this));
+    }
+    QCOMPARE(service->activeCount(), 2);
+    QCOMPARE(service->queuedCount(), 3);
+    QTRY_COMPARE(server.requests.count(), 2);
+    QTest::qWait(100);
+    QCOMPARE(server.requests.count(), 2);
+
+    // Queued requests start as active ones finish.
+    server.release();
+    for (FetchReply *reply : replies) {
+        QTRY_VERIFY(reply->isFinished());
+        QCOMPARE(reply->imageSize(), QSize(64, 64));
+    }
+    QCOMPARE(server.requests.count(), 5);
+    QCOMPARE(service->queuedCount(), 0);
+    qDeleteAll(replies);
+}
+
+void tst_fetchservice::cancel()
+{
+    service->setMaximumActiveRequests(1);
+    server.responses.insert("/first.png", { 200, QByteArray(), png(QSize(64, 64)) });
+    server.responses.insert("/second.png", { 200, QByteArray(), png(QSize(64, 64)) });
+    server.hold = true;
+
+    QScopedPointer<FetchReply> first(service->fetch(server.url("/first.png")));
+    FetchReply *second = service->fetch(server.url("/second.png"));
+    QCOMPARE(service->queuedCount(), 1);
+
+    // Deleting the reply of a queued request drops the request.
+    delete second;
+    server.release();
+    QTRY_VERIFY(first->isFinished());
+    QTRY_COMPARE(service->queuedCount(), 0);
+    QCOMPARE(server.requests, QStringList() << "/first.png");
+}
+
+void tst_fetchservice::diskCache()
+{
+    server.responses.insert("/cached.png", { 200, "Cache-Control: max-age=3600\r\n", png(QSize(96, 96)) });
+
+    QScopedPointer<FetchReply> reply(service->fetch(server.url("/cached.png"), FetchService::ProbeImage));
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(!reply->fromCache());
+
+    const int cacheHits = service->cacheHits();
+    reply.reset(service->fetch(server.url("/cached.png"), FetchService::ProbeImage));
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(reply->fromCache());
+    QCOMPARE(reply->imageSize(), QSize(96, 96));
+    QCOMPARE(service->cacheHits(), cacheHits + 1);
+    QCOMPARE(server.requests.count(), 1);
+}
+
+void tst_fetchservice::clearCache()
+{
+    server.responses.insert("/cleared.png", { 200, "Cache-Control: max-age=3600\r\n", png(QSize(96, 96)) });
+
+    QScopedPointer<FetchReply> reply(service->fetch(server.url("/cleared.png")));
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(service->cacheSize() > 0);
+
+    // Cleared sites are fetched again.
+    service->clearCache();
+    QCOMPARE(service->cacheSize(), qint64(0));
+    reply.reset(service->fetch(server.url("/cleared.png")));
+    QTRY_VERIFY(reply->isFinished());
+    QVERIFY(!reply->fromCache());
+    QCOMPARE(server.requests.count(), 2);
+}
+
+void tst_fetchservice::probeImage()
+{
+    server.responses.insert("/small.png", { 200, QByteArray(), png(QSize(16, 32)) });
+    server.responses.insert("/text.png", { 200, QByteArray(), "not an image" });
+
+    QScopedPointer<FetchReply> small(service->fetch(server.url("/small.png"), FetchService::ProbeImage));
+    QScopedPointer<FetchReply> text(service->fetch(server.url("/text.png"), FetchService::ProbeImage));
+    QTRY_VERIFY(small->isFinished());
+    QTRY_VERIFY(text->isFinished());
+    QCOMPARE(small->imageSize(), QSize(16, 32));
+    QCOMPARE(text->error(), QNetworkReply::NoError);
+    QVERIFY(!text->imageSize().isValid());
+}
+
+void tst_fetchservice::encodeBase64()
+{
+    const QByteArray data = png(QSize(64, 64));
+    server.responses.insert("/encoded.png", { 200, QByteArray(), data });
+
+    QScopedPointer<FetchReply> plain(service->fetch(server.url("/encoded.png"), FetchService::ProbeImage));
+    QScopedPointer<FetchReply> encoded(service->fetch(server.url("/encoded.png"),
+                                                      FetchService::ProbeImage | FetchService::EncodeBase64));
+    QTRY_VERIFY(plain->isFinished());
+    QTRY_VERIFY(encoded->isFinished());
+
+    // Options of shared requests are combined.
+    QCOMPARE(encoded->base64Data(), data.toBase64());
+    QCOMPARE(encoded->imageSize(), QSize(64, 64));
+    QCOMPARE(encoded->data(), data);
+    QCOMPARE(server.requests.count(), 1);
+}
+
+void tst_fetchservice::decodeImage()
+{
+    // Fallback for formats whose header does not tell the size.
+    QImage image(48, 24, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(image.save(&buffer, "PPM"));
+
+    QCOMPARE(FetchService::decodedImageSize(data), QSize(48, 24));
+    QVERIFY(!FetchService::decodedImageSize("not an image").isValid());
+}
+
+void tst_fetchservice::imageSize()
+{
+    QCOMPARE(FetchService::imageSize(png(QSize(180, 120))), QSize(180, 120));
+    QVERIFY(!FetchService::imageSize(QByteArray()).isValid());
+    QVERIFY(!FetchService::imageSize("not an image").isValid());
+}
+
+QByteArray tst_fetchservice::png(const QSize &size) const
+{
+    QImage image(size, QImage::Format_ARGB32);
+    image.fill(Qt::blue);
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    return data;
+}
+
+QTEST_MAIN(tst_fetchservice)
+#include "tst_fetchservice.moc"
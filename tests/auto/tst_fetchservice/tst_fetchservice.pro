@@ -0,0 +1,15 @@
+TARGET = tst_fetchservice
+
+QT += gui network concurrent
+
+include(../test_common.pri)
+include(../../../common/browserapp.pri)
+
+INCLUDEPATH += $$CORESRCDIR
+
+SOURCES += tst_fetchservice.cpp \
+           $$CORESRCDIR/fetchservice.cpp \
+           $$CORESRCDIR/logging.cpp
+
+HEADERS += $$CORESRCDIR/fetchservice.h \
+           $$CORESRCDIR/logging.h
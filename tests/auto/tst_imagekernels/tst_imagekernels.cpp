@@ -0,0 +1,124 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <QtTest>
+#include <QImage>
+#include <QPainter>
+
+#include "imagekernels.h"
+
+static const QSize gFrameSize(1920, 1080);
+
+class tst_imagekernels : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void isBlack_data();
+    void isBlack();
+
+    void benchmarkBlankFrame();
+    void benchmarkContentFrame();
+
+private:
+    QImage contentFrame() const;
+};
+
+void tst_imagekernels::initTestCase()
+{
+    qDebug() << "Image kernels use" << ImageKernels::instructionSet();
+}
+
+void tst_imagekernels::isBlack_data()
+{
+    QTest::addColumn<QImage>("image");
+    QTest::addColumn<bool>("expected");
+
+    QImage image(gFrameSize, QImage::Format_RGB32);
+    image.fill(Qt::black);
+    QTest::newRow("black_rgb32") << image << true;
+
+    image.fill(Qt::white);
+    QTest::newRow("white_rgb32") << image << false;
+
+    // A single pixel on a row that the sampling pass skips.
+    image.fill(Qt::black);
+    image.setPixel(1000, 1, qRgb(0, 0, 1));
+    QTest::newRow("black_with_unsampled_pixel") << image << false;
+
+    image = QImage(gFrameSize, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    QTest::newRow("transparent_black_argb32") << image << true;
+
+    image = QImage(gFrameSize, QImage::Format_RGBA8888);
+    image.fill(Qt::black);
+    QTest::newRow("black_rgba8888") << image << true;
+
+    image.setPixel(0, 540, qRgb(255, 0, 0));
+    QTest::newRow("black_rgba8888_with_red") << image << false;
+
+    // Width that is not a multiple of the vector width.
+    image = QImage(1919, 3, QImage::Format_RGB32);
+    image.fill(Qt::black);
+    QTest::newRow("odd_width_black") << image << true;
+
+    image.setPixel(1918, 2, qRgb(0, 0, 1));
+    QTest::newRow("odd_width_last_pixel") << image << false;
+
+    image = QImage(64, 64, QImage::Format_RGB16);
+    image.fill(Qt::black);
+    QTest::newRow("converted_format") << image << true;
+
+    QTest::newRow("null") << QImage() << false;
+}
+
+void tst_imagekernels::isBlack()
+{
+    QFETCH(QImage, image);
+    QFETCH(bool, expected);
+
+    QCOMPARE(ImageKernels::isBlack(image), expected);
+}
+
+void tst_imagekernels::benchmarkBlankFrame()
+{
+    // Worst case, every pixel needs to be checked.
+    QImage image(gFrameSize, QImage::Format_RGB32);
+    image.fill(Qt::black);
+
+    QBENCHMARK {
+        ImageKernels::isBlack(image);
+    }
+}
+
+void tst_imagekernels::benchmarkContentFrame()
+{
+    QImage image = contentFrame();
+
+    QBENCHMARK {
+        ImageKernels::isBlack(image);
+    }
+}
+
+// Mostly black frame with content far from the top left corner.
+QImage tst_imagekernels::contentFrame() const
+{
+    QImage image(gFrameSize, QImage::Format_RGB32);
+    image.fill(Qt::black);
+    QPainter painter(&image);
+    painter.fillRect(gFrameSize.width() / 2, 40, 200, 100, QColor(30, 120, 220));
+    painter.end();
+    return image;
+}
+
+QTEST_MAIN(tst_imagekernels)
+#include "tst_imagekernels.moc"
@@ -0,0 +1,12 @@
+TARGET = tst_imagekernels
+
+QT += gui
+
+include(../test_common.pri)
+
+INCLUDEPATH += $$CORESRCDIR
+
+SOURCES += tst_imagekernels.cpp \
+           $$CORESRCDIR/imagekernels.cpp
+
+HEADERS += $$CORESRCDIR/imagekernels.h
@@ -13,10 +13,13 @@
 #include <QtTest/QtTest>
 
 #include "persistenttabmodel.h"
+#include "tabfiltermodel.h"
 #include "dbmanager.h"
 #include "declarativewebpage.h"
 #include "declarativewebcontainer.h"
 #include "browserpaths.h"
+#include "link.h"
+#include "tabthumbnailprovider.h"
 
 using ::testing::Return;
 
@@ -47,8 +50,13 @@ private slots:
     void removeTabById_data();
     void removeTabById();
     void clear();
+    void closeOtherTabs();
+    void closeTabs();
     void activateTabByUrl_data();
     void activateTabByUrl();
+    void canonicalUrl_data();
+    void canonicalUrl();
+    void tabIdForUrl();
     void activateTabById_data();
     void activateTabById();
     void activateTabByIndex_data();
@@ -57,6 +65,7 @@ private slots:
     void updateUrl_data();
     void updateUrl();
     void updateThumbnailPath();
+    void reuseTabIdThumbnail();
     void onUrlChanged();
     void onTitleChanged();
     void nextActiveTabIndex();
@@ -65,6 +74,9 @@ private slots:
     void data();
     void setUnloaded();
     void newTab();
+    void populateInChunks();
+    void lookupPendingTabs();
+    void filterTabs();
 
 private:
     void addThreeTabs();
@@ -302,6 +314,56 @@ void tst_persistenttabmodel::clear()
     QCOMPARE(tabModel->count(), 0);
 }
 
+void tst_persistenttabmodel::closeOtherTabs()
+{
+    addThreeTabs();
+    tabModel->activateTab(1);
+    int activeTabId = tabModel->activeTabId();
+
+    QSignalSpy tabClosedSpy(tabModel, SIGNAL(tabClosed(int)));
+    QSignalSpy modelResetSpy(tabModel, SIGNAL(modelReset()));
+    QSignalSpy rowsRemovedSpy(tabModel, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    QSignalSpy activeTabChangedSpy(tabModel, SIGNAL(activeTabChanged(int)));
+
+    tabModel->closeOtherTabs();
+
+    QCOMPARE(tabClosedSpy.count(), 2);
+    QCOMPARE(modelResetSpy.count(), 1);
+    QCOMPARE(rowsRemovedSpy.count(), 0);
+    QCOMPARE(activeTabChangedSpy.count(), 0);
+    QCOMPARE(tabModel->count(), 1);
+    QCOMPARE(tabModel->activeTabId(), activeTabId);
+    QCOMPARE(tabModel->activeTabIndex(), 0);
+}
+
+void tst_persistenttabmodel::closeTabs()
+{
+    addThreeTabs();
+    // Third tab is active after adding.
+    QCOMPARE(tabModel->activeTab().url(), QString("https://example.com"));
+
+    QSignalSpy tabClosedSpy(tabModel, SIGNAL(tabClosed(int)));
+    QSignalSpy modelResetSpy(tabModel, SIGNAL(modelReset()));
+    QSignalSpy activeTabChangedSpy(tabModel, SIGNAL(activeTabChanged(int)));
+
+    int closed = tabModel->closeTabs([](const Tab &tab) {
+        return tab.url().startsWith(QStringLiteral("https://"))
+                || tab.url().startsWith(QStringLiteral("file://"));
+    });
+
+    QCOMPARE(closed, 2);
+    QCOMPARE(tabClosedSpy.count(), 2);
+    QCOMPARE(modelResetSpy.count(), 1);
+    QCOMPARE(tabModel->count(), 1);
+    // Active tab was closed, the remaining one gets activated.
+    QCOMPARE(activeTabChangedSpy.count(), 1);
+    QCOMPARE(tabModel->activeTab().url(), QString("http://example.com"));
+
+    // Nothing matches.
+    QCOMPARE(tabModel->closeTabs([](const Tab &) { return false; }), 0);
+    QCOMPARE(modelResetSpy.count(), 1);
+}
+
 void tst_persistenttabmodel::activateTabByUrl_data()
 {
     QTest::addColumn<QString>("url");
@@ -335,6 +397,60 @@ void tst_persistenttabmodel::activateTabByUrl()
     QCOMPARE(activeTabChangedSpy.count(), expectedChanges);
 }
 
+void tst_persistenttabmodel::canonicalUrl_data()
+{
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("empty") << QString() << QString();
+    QTest::newRow("whitespace") << QString("  ") << QString();
+    QTest::newRow("plain") << QString("http://example.com") << QString("http://example.com");
+    QTest::newRow("root_trailing_slash") << QString("http://example.com/") << QString("http://example.com");
+    QTest::newRow("path_trailing_slash") << QString("http://example.com/a/b/") << QString("http://example.com/a/b");
+    QTest::newRow("upper_case_scheme_and_host") << QString("HTTP://Example.COM/Path") << QString("http://example.com/Path");
+    QTest::newRow("default_http_port") << QString("http://example.com:80/") << QString("http://example.com");
+    QTest::newRow("default_https_port") << QString("https://example.com:443/a") << QString("https://example.com/a");
+    QTest::newRow("non_default_port") << QString("http://example.com:8080/") << QString("http://example.com:8080");
+    QTest::newRow("https_port_on_http") << QString("http://example.com:443") << QString("http://example.com:443");
+    QTest::newRow("dot_segments") << QString("http://example.com/a/./b/../c") << QString("http://example.com/a/c");
+    QTest::newRow("query_keeps_slash") << QString("http://example.com/?q=1") << QString("http://example.com/?q=1");
+    QTest::newRow("fragment_keeps_slash") << QString("http://example.com/a/#top") << QString("http://example.com/a/#top");
+    QTest::newRow("surrounding_whitespace") << QString(" http://example.com/ ") << QString("http://example.com");
+    QTest::newRow("file") << QString("file:///opt/tests/") << QString("file:///opt/tests");
+}
+
+void tst_persistenttabmodel::canonicalUrl()
+{
+    QFETCH(QString, url);
+    QFETCH(QString, expected);
+
+    QCOMPARE(Link::canonicalUrl(url), expected);
+}
+
+void tst_persistenttabmodel::tabIdForUrl()
+{
+    addThreeTabs();
+
+    QCOMPARE(tabModel->tabIdForUrl(""), 0);
+    QCOMPARE(tabModel->tabIdForUrl("http://some.non.existing.url"), 0);
+    QCOMPARE(tabModel->tabIdForUrl("HTTP://EXAMPLE.COM:80/"), 1);
+    QCOMPARE(tabModel->tabIdForUrl("https://example.com/"), 3);
+
+    // Duplicates resolve to the first tab in the model.
+    tabModel->addTab("http://example.com/", "Duplicate", 0);
+    QCOMPARE(tabModel->tabIdForUrl("http://example.com"), 4);
+    tabModel->remove(0);
+    QCOMPARE(tabModel->tabIdForUrl("http://example.com"), 1);
+
+    // Url changes are reflected in the index.
+    tabModel->updateUrl(2, "http://sailfishos.org/", false);
+    QCOMPARE(tabModel->tabIdForUrl("file:///opt/tests/testpahe.html"), 0);
+    QCOMPARE(tabModel->tabIdForUrl("http://sailfishos.org"), 2);
+
+    QVERIFY(tabModel->activateTab("http://sailfishos.org"));
+    QCOMPARE(tabModel->activeTabId(), 2);
+}
+
 void tst_persistenttabmodel::activateTabById_data()
 {
     QTest::addColumn<int>("tabId");
@@ -474,8 +590,49 @@ void tst_persistenttabmodel::updateThumbnailPath()
 
     QString path("/path/to/thumbnail");
     tabModel->updateThumbnailPath(1, path);
-    QCOMPARE(dataChangedSpy.count(), 2);
+    QCOMPARE(dataChangedSpy.count(), 1);
     QCOMPARE(tabModel->m_tabs.at(0).thumbnailPath(), path);
+
+    QModelIndex modelIndex = tabModel->index(0, 0);
+    QString source = tabModel->data(modelIndex, DeclarativeTabModel::ThumbnailSourceRole).toString();
+    QCOMPARE(source, QString("image://%1/1/1%2").arg(TAB_THUMBNAIL_PROVIDER, path));
+
+    // Rewriting the same file changes the source so that the view reloads it.
+    tabModel->updateThumbnailPath(1, path);
+    QCOMPARE(dataChangedSpy.count(), 2);
+    QCOMPARE(tabModel->data(modelIndex, DeclarativeTabModel::ThumbnailSourceRole).toString(),
+             QString("image://%1/1/2%2").arg(TAB_THUMBNAIL_PROVIDER, path));
+
+    // Data urls are used as such.
+    QString dataUrl = QString(BASE64_IMAGE).arg("AAAA");
+    tabModel->updateThumbnailPath(1, dataUrl);
+    QCOMPARE(tabModel->data(modelIndex, DeclarativeTabModel::ThumbnailSourceRole).toString(), dataUrl);
+
+    tabModel->updateThumbnailPath(1, "");
+    QCOMPARE(tabModel->data(modelIndex, DeclarativeTabModel::ThumbnailSourceRole).toString(), QString());
+}
+
+void tst_persistenttabmodel::reuseTabIdThumbnail()
+{
+    tabModel->addTab("http://example.com", "initial title", 0);
+    QString path("/path/to/thumbnail");
+    tabModel->updateThumbnailPath(1, path);
+
+    // Closing all tabs starts the tab ids over.
+    tabModel->clear();
+    QVERIFY(TabThumbnailProvider::releasedThumbnails().contains(1));
+    delete tabModel;
+    tabModel = new PersistentTabModel(DBManager::instance()->getMaxTabId() + 1);
+    QSignalSpy loadedSpy(tabModel, SIGNAL(loadedChanged()));
+    QVERIFY(tabModel->loaded() || loadedSpy.wait());
+
+    tabModel->addTab("http://example.org", "new title", 0);
+    QCOMPARE(tabModel->m_tabs.at(0).tabId(), 1);
+    tabModel->updateThumbnailPath(1, path);
+
+    // The image provider released the image of the closed tab.
+    QCOMPARE(tabModel->data(tabModel->index(0, 0), DeclarativeTabModel::ThumbnailSourceRole).toString(),
+             QString("image://%1/1/1%2").arg(TAB_THUMBNAIL_PROVIDER, path));
 }
 
 void tst_persistenttabmodel::onUrlChanged()
@@ -575,6 +732,7 @@ void tst_persistenttabmodel::data_data()
     QTest::newRow("UrlRole") << modelIndex  << (int)DeclarativeTabModel::UrlRole << true;
     QTest::newRow("TitleRole") << modelIndex  << (int)DeclarativeTabModel::TitleRole << true;
     QTest::newRow("ThumbPathRole") << modelIndex  << (int)DeclarativeTabModel::ThumbPathRole << true;
+    QTest::newRow("ThumbnailSourceRole") << modelIndex  << (int)DeclarativeTabModel::ThumbnailSourceRole << true;
     QTest::newRow("InvalidRole") << modelIndex  << -10000 << false;
 }
 
@@ -616,6 +774,92 @@ void tst_persistenttabmodel::newTab()
     QCOMPARE(tabModel->waitingForNewTab(), true);
 }
 
+void tst_persistenttabmodel::populateInChunks()
+{
+    QList<Tab> tabs;
+    for (int i = 1; i <= 1000; ++i) {
+        tabs << Tab(i, QString("http://example%1.com").arg(i), QString("Title %1").arg(i), "");
+    }
+    DBManager::instance()->saveSetting("activeTabId", "700");
+
+    QSignalSpy modelResetSpy(tabModel, SIGNAL(modelReset()));
+    QMetaObject::invokeMethod(tabModel, "tabsAvailable", Q_ARG(QList<Tab>, tabs));
+
+    // The first chunk contains at least the active tab, the count covers all tabs.
+    QCOMPARE(modelResetSpy.count(), 1);
+    QVERIFY(tabModel->rowCount() >= 700);
+    QVERIFY(tabModel->rowCount() < 1000);
+    QCOMPARE(tabModel->count(), 1000);
+    QCOMPARE(tabModel->activeTabId(), 700);
+    QCOMPARE(tabModel->activeTabIndex(), 699);
+
+    QTRY_COMPARE(tabModel->rowCount(), 1000);
+    QCOMPARE(tabModel->tabs().last().tabId(), 1000);
+    QCOMPARE(tabModel->nextTabId(), 1001);
+}
+
+void tst_persistenttabmodel::lookupPendingTabs()
+{
+    QList<Tab> tabs;
+    for (int i = 1; i <= 1000; ++i) {
+        tabs << Tab(i, QString("http://example%1.com").arg(i), QString("Title %1").arg(i), "");
+    }
+    DBManager::instance()->saveSetting("activeTabId", "1");
+
+    TabFilterModel filterModel;
+    filterModel.setSourceModel(tabModel);
+    filterModel.setSearch("example99");
+
+    QMetaObject::invokeMethod(tabModel, "tabsAvailable", Q_ARG(QList<Tab>, tabs));
+    QVERIFY(tabModel->rowCount() < 1000);
+    QCOMPARE(filterModel.rowCount(), 0);
+
+    // Tabs of the session not yet populated are found by id.
+    QVERIFY(tabModel->contains(990));
+    QCOMPARE(tabModel->url(995), QString("http://example995.com"));
+    QVERIFY(tabModel->activateTabById(999));
+    QCOMPARE(tabModel->activeTabIndex(), 998);
+    QCOMPARE(tabModel->rowCount(), 1000);
+
+    // Appended rows extend the filter.
+    QCOMPARE(filterModel.rowCount(), 11);
+    QCOMPARE(filterModel.getIndex(0), 98);
+}
+
+void tst_persistenttabmodel::filterTabs()
+{
+    addThreeTabs();
+
+    TabFilterModel filterModel;
+    filterModel.setSourceModel(tabModel);
+    QCOMPARE(filterModel.rowCount(), 3);
+
+    filterModel.setSearch("example");
+    QCOMPARE(filterModel.rowCount(), 2);
+
+    // Refined query
+    filterModel.setSearch("https://EXAMPLE");
+    QCOMPARE(filterModel.rowCount(), 1);
+    QCOMPARE(filterModel.getIndex(0), 2);
+
+    // Broader query again
+    filterModel.setSearch("title");
+    QCOMPARE(filterModel.rowCount(), 3);
+
+    // Title matches
+    filterModel.setSearch("title2");
+    QCOMPARE(filterModel.rowCount(), 1);
+    QCOMPARE(filterModel.getIndex(0), 1);
+
+    // Source changes are reflected
+    tabModel->addTab("http://title2.org", "Another", tabModel->count());
+    QCOMPARE(filterModel.rowCount(), 2);
+    QCOMPARE(filterModel.getIndex(1), 3);
+
+    filterModel.setSearch("");
+    QCOMPARE(filterModel.rowCount(), 4);
+}
+
 void tst_persistenttabmodel::addThreeTabs()
 {
     QList<QString> urls, titles;
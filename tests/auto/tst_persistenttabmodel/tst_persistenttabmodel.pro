@@ -4,6 +4,7 @@ QT += qml sql
 
 include(../test_common.pri)
 include(../mocks/declarativewebpage/declarativewebpage_mock.pri)
+include(../mocks/tabthumbnailprovider/tabthumbnailprovider_mock.pri)
 include(../mocks/declarativewebcontainer/declarativewebcontainer_mock.pri)
 include(../mocks/faviconmanager/faviconmanager_mock.pri)
 
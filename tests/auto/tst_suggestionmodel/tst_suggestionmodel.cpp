@@ -0,0 +1,361 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <QtTest>
+#include <QStandardItemModel>
+
+#include "browserpaths.h"
+#include "dbmanager.h"
+#include "searchenginemodel.h"
+#include "suggestionmodel.h"
+#include "suggestionprovider.h"
+
+static const int gUrlRole = Qt::UserRole + 1;
+static const int gTitleRole = Qt::UserRole + 2;
+static const int gStatusRole = Qt::UserRole + 3;
+
+// Answers after a delay with one suggestion for the text.
+class SlowProvider : public SuggestionProvider
+{
+    Q_OBJECT
+
+public:
+    SlowProvider(int delay)
+        : cancelCount(0)
+        , m_queryId(0)
+    {
+        m_timer.setSingleShot(true);
+        m_timer.setInterval(delay);
+        connect(&m_timer, &QTimer::timeout, this, [this]() {
+            Suggestion suggestion;
+            suggestion.url = QStringLiteral("http://slow.example.com/%1").arg(m_text);
+            suggestion.title = m_text;
+            suggestion.sources = Suggestion::History;
+            emit finished(m_queryId, SuggestionList() << suggestion);
+        });
+    }
+
+    void start(int queryId, const QString &text, int limit) override
+    {
+        Q_UNUSED(limit);
+        m_queryId = queryId;
+        m_text = text;
+        m_timer.start();
+    }
+
+    void cancel() override
+    {
+        if (m_timer.isActive()) {
+            m_timer.stop();
+            ++cancelCount;
+        }
+    }
+
+    int cancelCount;
+
+private:
+    QTimer m_timer;
+    int m_queryId;
+    QString m_text;
+};
+
+class tst_suggestionmodel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+
+    void canonicalUrl_data();
+    void canonicalUrl();
+    void score();
+    void mergeSources();
+    void tabs();
+    void searchEngines();
+    void timeBudget();
+    void cancel();
+    void emptySearch();
+    void removeHistory();
+
+    void benchmarkSetSearch();
+
+private:
+    void addHistory(const QStringList &urls);
+    QStandardItemModel *tabModel(const QStringList &urls);
+    QStringList urls(const SuggestionModel &model) const;
+    void waitComplete(const SuggestionModel &model);
+
+    QString mDbFile;
+};
+
+void tst_suggestionmodel::initTestCase()
+{
+    mDbFile = QString("%1/%2")
+            .arg(BrowserPaths::dataLocation())
+            .arg(QLatin1String(DB_NAME));
+    QFile::remove(mDbFile);
+}
+
+void tst_suggestionmodel::cleanup()
+{
+    DBManager::instance()->clearHistory();
+    DBManager::instance()->clearBookmarks();
+}
+
+void tst_suggestionmodel::canonicalUrl_data()
+{
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<QString>("canonical");
+
+    QTest::newRow("scheme") << "https://example.com/page" << "example.com/page";
+    QTest::newRow("www") << "http://www.example.com/page" << "example.com/page";
+    QTest::newRow("host case") << "http://Example.COM/Page" << "example.com/Page";
+    QTest::newRow("trailing slash") << "http://example.com/" << "example.com";
+    QTest::newRow("default port") << "https://example.com:443/page" << "example.com/page";
+    QTest::newRow("other port") << "http://example.com:8080/page" << "example.com:8080/page";
+    QTest::newRow("fragment") << "http://example.com/page#top" << "example.com/page";
+    QTest::newRow("query") << "http://example.com/search?q=1" << "example.com/search?q=1";
+    // Same rules as tab urls, the slash before a query is kept.
+    QTest::newRow("query after slash") << "http://example.com/?q=1" << "example.com/?q=1";
+    QTest::newRow("dot segments") << "http://example.com/a/./b/../c" << "example.com/a/c";
+    QTest::newRow("no host") << "about:blank" << "about:blank";
+}
+
+void tst_suggestionmodel::canonicalUrl()
+{
+    QFETCH(QString, url);
+    QFETCH(QString, canonical);
+
+    QCOMPARE(SuggestionModel::canonicalUrl(url), canonical);
+}
+
+void tst_suggestionmodel::score()
+{
+    const uint now = QDateTime::currentDateTimeUtc().toTime_t();
+    Suggestion suggestion;
+    suggestion.url = "http://example.com/page";
+    suggestion.title = "Some page";
+    suggestion.sources = Suggestion::History;
+
+    // Prefix of the url matches better than a part of it.
+    QVERIFY(SuggestionModel::score(suggestion, "exa", now) > SuggestionModel::score(suggestion, "page", now));
+
+    // Visits count, recent ones more.
+    Suggestion visited = suggestion;
+    visited.visitCount = 10;
+    visited.lastVisit = now;
+    QVERIFY(SuggestionModel::score(visited, "exa", now) > SuggestionModel::score(suggestion, "exa", now));
+    Suggestion old = visited;
+    old.lastVisit = now - 60 * 24 * 60 * 60;
+    QVERIFY(SuggestionModel::score(visited, "exa", now) > SuggestionModel::score(old, "exa", now));
+
+    // Bookmarked history outranks plain history.
+    Suggestion bookmarked = suggestion;
+    bookmarked.sources |= Suggestion::Bookmark;
+    QVERIFY(SuggestionModel::score(bookmarked, "exa", now) > SuggestionModel::score(suggestion, "exa", now));
+}
+
+void tst_suggestionmodel::mergeSources()
+{
+    addHistory(QStringList() << "http://www.example.com/" << "http://example.org/");
+    DBManager::instance()->addBookmark(Bookmark("Example", "https://example.com", "icon-m-bookmark", false));
+
+    SuggestionModel model;
+    model.setSearch("example");
+    waitComplete(model);
+
+    // Variants of the same url are one suggestion, the bookmark ranks first.
+    QCOMPARE(urls(model).count(), 2);
+    const QModelIndex first = model.index(0);
+    QCOMPARE(model.data(first, SuggestionModel::SourceRole).toInt(), int(Suggestion::History | Suggestion::Bookmark));
+    QCOMPARE(model.data(first, SuggestionModel::TitleRole).toString(), QString("Example"));
+    QCOMPARE(model.data(first, SuggestionModel::FaviconRole).toString(), QString("icon-m-bookmark"));
+    QCOMPARE(model.data(model.index(1), SuggestionModel::UrlRole).toString(), QString("http://example.org/"));
+}
+
+void tst_suggestionmodel::tabs()
+{
+    addHistory(QStringList() << "http://example.com/history");
+    QScopedPointer<QStandardItemModel> tabs(tabModel(QStringList() << "http://example.com/tab" << "http://other.com"));
+
+    SuggestionModel model;
+    model.setTabModel(tabs.data());
+    model.setSearch("example");
+    waitComplete(model);
+
+    QCOMPARE(urls(model), QStringList() << "http://example.com/tab" << "http://example.com/history");
+    QCOMPARE(model.data(model.index(0), SuggestionModel::SourceRole).toInt(), int(Suggestion::Tab));
+}
+
+void tst_suggestionmodel::searchEngines()
+{
+    QStandardItemModel engines;
+    engines.setItemRoleNames({ { gUrlRole, "url" }, { gTitleRole, "title" }, { gStatusRole, "status" } });
+    const QList<QPair<QString, int> > rows = {
+        { "Duck", SearchEngineModel::System },
+        { "Duckling", SearchEngineModel::Available },
+        { "Goose", SearchEngineModel::UserInstalled }
+    };
+    for (const auto &row : rows) {
+        QStandardItem *item = new QStandardItem;
+        item->setData(row.first, gTitleRole);
+        item->setData(row.second, gStatusRole);
+        engines.appendRow(item);
+    }
+
+    SuggestionModel model;
+    model.setSearchEngineModel(&engines);
+    model.setSearch("duck");
+    waitComplete(model);
+
+    // Engines that are not installed are not suggested.
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.data(model.index(0), SuggestionModel::TitleRole).toString(), QString("Duck"));
+    QCOMPARE(model.data(model.index(0), SuggestionModel::SourceRole).toInt(), int(Suggestion::SearchEngine));
+}
+
+void tst_suggestionmodel::timeBudget()
+{
+    QScopedPointer<QStandardItemModel> tabs(tabModel(QStringList() << "http://fast.example.com"));
+
+    SuggestionModel model;
+    SlowProvider *slow = new SlowProvider(200);
+    model.addProvider(slow);
+    model.setTabModel(tabs.data());
+    model.setTimeBudget(10);
+
+    QElapsedTimer timer;
+    timer.start();
+    model.setSearch("example");
+
+    // Answers at hand are shown when the budget runs out.
+    QTRY_COMPARE(model.rowCount(), 1);
+    QVERIFY(timer.elapsed() < 200);
+    QVERIFY(!model.complete());
+
+    // The late answer updates the model.
+    QSignalSpy rowsInserted(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    waitComplete(model);
+    QCOMPARE(model.rowCount(), 2);
+    QCOMPARE(rowsInserted.count(), 1);
+    QVERIFY(urls(model).contains("http://slow.example.com/example"));
+}
+
+void tst_suggestionmodel::cancel()
+{
+    SuggestionModel model;
+    SlowProvider *slow = new SlowProvider(50);
+    model.addProvider(slow);
+
+    // Typing cancels the query of the previous text.
+    model.setSearch("e");
+    model.setSearch("ex");
+    QCOMPARE(slow->cancelCount, 1);
+    waitComplete(model);
+    QCOMPARE(urls(model), QStringList() << "http://slow.example.com/ex");
+}
+
+void tst_suggestionmodel::emptySearch()
+{
+    addHistory(QStringList() << "http://example.com");
+
+    SuggestionModel model;
+    model.setSearch("example");
+    waitComplete(model);
+    QCOMPARE(model.rowCount(), 1);
+
+    QSignalSpy countChanged(&model, SIGNAL(countChanged()));
+    model.setSearch("  ");
+    QVERIFY(model.complete());
+    QCOMPARE(model.rowCount(), 0);
+    QCOMPARE(countChanged.count(), 1);
+}
+
+void tst_suggestionmodel::removeHistory()
+{
+    addHistory(QStringList() << "http://example.com/one" << "http://example.com/two");
+    DBManager::instance()->addBookmark(Bookmark("Two", "http://example.com/two", "icon-m-bookmark", false));
+
+    SuggestionModel model;
+    model.setSearch("example");
+    waitComplete(model);
+    QCOMPARE(model.rowCount(), 2);
+
+    // Bookmarked urls stay suggested.
+    model.remove("http://example.com/two");
+    QCOMPARE(model.rowCount(), 2);
+    model.remove("http://example.com/one");
+    QCOMPARE(urls(model), QStringList() << "http://example.com/two");
+    QCOMPARE(model.data(model.index(0), SuggestionModel::SourceRole).toInt(), int(Suggestion::Bookmark));
+
+    // Removed from the history.
+    model.setSearch("example.com");
+    waitComplete(model);
+    QCOMPARE(urls(model), QStringList() << "http://example.com/two");
+    QCOMPARE(model.data(model.index(0), SuggestionModel::SourceRole).toInt(), int(Suggestion::Bookmark));
+}
+
+void tst_suggestionmodel::benchmarkSetSearch()
+{
+    QStringList urls;
+    for (int i = 0; i < 100; ++i) {
+        urls << QString("https://host%1.example.com/page").arg(i);
+    }
+    QScopedPointer<QStandardItemModel> tabs(tabModel(urls));
+
+    SuggestionModel model;
+    model.setTabModel(tabs.data());
+
+    // Work done on the keystroke, database searches run in their own thread.
+    int i = 0;
+    QBENCHMARK {
+        model.setSearch(QString("host%1").arg(i++ % 10));
+    }
+}
+
+void tst_suggestionmodel::addHistory(const QStringList &urls)
+{
+    QSignalSpy historyEntryAdded(DBManager::instance(), SIGNAL(historyEntryAdded(Link)));
+    for (const QString &url : urls) {
+        DBManager::instance()->addHistoryEntry(url, QString());
+    }
+    QTRY_COMPARE(historyEntryAdded.count(), urls.count());
+}
+
+QStandardItemModel *tst_suggestionmodel::tabModel(const QStringList &urls)
+{
+    QStandardItemModel *model = new QStandardItemModel;
+    model->setItemRoleNames({ { gUrlRole, "url" }, { gTitleRole, "title" } });
+    for (const QString &url : urls) {
+        QStandardItem *item = new QStandardItem;
+        item->setData(url, gUrlRole);
+        item->setData(QUrl(url).host(), gTitleRole);
+        model->appendRow(item);
+    }
+    return model;
+}
+
+QStringList tst_suggestionmodel::urls(const SuggestionModel &model) const
+{
+    QStringList urls;
+    for (int i = 0; i < model.rowCount(); ++i) {
+        urls << model.data(model.index(i), SuggestionModel::UrlRole).toString();
+    }
+    return urls;
+}
+
+void tst_suggestionmodel::waitComplete(const SuggestionModel &model)
+{
+    QTRY_VERIFY(model.complete());
+}
+
+QTEST_MAIN(tst_suggestionmodel)
+#include "tst_suggestionmodel.moc"
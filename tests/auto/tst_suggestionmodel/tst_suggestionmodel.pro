@@ -0,0 +1,14 @@
+TARGET = tst_suggestionmodel
+
+QT += quick concurrent sql
+
+include(../test_common.pri)
+include(../mocks/faviconmanager/faviconmanager_mock.pri)
+include(../../../common/browserapp.pri)
+include(../../../apps/storage/storage.pri)
+include(../../../apps/browser/suggestions/suggestions.pri)
+
+# Search engine status only
+INCLUDEPATH += $$BROWSERSRCDIR/settings
+
+SOURCES += tst_suggestionmodel.cpp
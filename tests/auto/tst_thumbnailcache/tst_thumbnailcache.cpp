@@ -0,0 +1,274 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <QtConcurrent>
+#include <QtTest>
+
+#include "browserpaths.h"
+#include "thumbnailcache.h"
+
+class tst_thumbnailcache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void insert();
+    void evictLeastRecentlyUsed();
+    void evictKeepsRewrittenThumbnail();
+    void remove();
+    void sweepOrphans();
+    void clear();
+    void clearKeepsNewThumbnails();
+    void clearCancelsSweep();
+
+private:
+    QString createThumbnail(int tabId, int size);
+    void holdPool(QSemaphore &semaphore);
+    void releasePool(QSemaphore &semaphore);
+
+    int maxThreadCount;
+
+    ThumbnailCache *cache;
+};
+
+void tst_thumbnailcache::initTestCase()
+{
+    QVERIFY(BrowserPaths::createDirectory(BrowserPaths::cacheLocation()));
+    cache = ThumbnailCache::instance();
+}
+
+void tst_thumbnailcache::init()
+{
+    cache->restore(QList<Tab>());
+    cache->m_sweepTimer.stop();
+    cache->m_maxTabId = 0;
+    cache->setBudget(1024 * 1024);
+}
+
+void tst_thumbnailcache::cleanup()
+{
+    // Let pending file removals finish before the next test creates files.
+    QThreadPool::globalInstance()->waitForDone();
+    for (int tabId = 1; tabId <= 10; ++tabId) {
+        QFile::remove(ThumbnailCache::instance()->path(tabId));
+        QFile::remove(QString("%1/tab-%2-thumb.jpg").arg(BrowserPaths::cacheLocation()).arg(tabId));
+    }
+}
+
+void tst_thumbnailcache::insert()
+{
+    QString path = createThumbnail(1, 100);
+    cache->insert(1, path);
+    QCOMPARE(cache->count(), 1);
+    QCOMPARE(cache->size(), qint64(100));
+    QCOMPARE(cache->path(1), path);
+
+    // Rewriting the thumbnail replaces the size.
+    createThumbnail(1, 300);
+    cache->insert(1, path);
+    QCOMPARE(cache->count(), 1);
+    QCOMPARE(cache->size(), qint64(300));
+
+    // Data urls of private tabs are not indexed.
+    cache->insert(2, "data:image/png;base64,AAAA");
+    QCOMPARE(cache->count(), 1);
+}
+
+void tst_thumbnailcache::evictLeastRecentlyUsed()
+{
+    QSignalSpy evictedSpy(cache, SIGNAL(evicted(int)));
+    cache->setBudget(1000);
+
+    cache->insert(1, createThumbnail(1, 400));
+    cache->insert(2, createThumbnail(2, 400));
+    cache->touch(1);
+    QCOMPARE(evictedSpy.count(), 0);
+
+    // Tab 2 is the least recently used one.
+    QString path2 = cache->path(2);
+    cache->insert(3, createThumbnail(3, 400));
+    QCOMPARE(evictedSpy.count(), 1);
+    QCOMPARE(evictedSpy.at(0).at(0).toInt(), 2);
+    QCOMPARE(cache->count(), 2);
+    QCOMPARE(cache->size(), qint64(800));
+    QTRY_VERIFY(!QFile::exists(path2));
+
+    // Lowering the budget evicts down to the most recently used thumbnail.
+    cache->setBudget(100);
+    QCOMPARE(evictedSpy.count(), 2);
+    QCOMPARE(evictedSpy.at(1).at(0).toInt(), 1);
+    QCOMPARE(cache->count(), 1);
+    QVERIFY(!cache->path(3).isEmpty());
+}
+
+void tst_thumbnailcache::evictKeepsRewrittenThumbnail()
+{
+    cache->setBudget(1000);
+    QString path1 = createThumbnail(1, 400);
+    cache->insert(1, path1);
+    cache->insert(2, createThumbnail(2, 400));
+
+    // Tab 1 is evicted and rewrites its thumbnail before the file is removed.
+    QSemaphore semaphore;
+    holdPool(semaphore);
+    cache->insert(3, createThumbnail(3, 400));
+    QVERIFY(cache->path(1).isEmpty());
+    createThumbnail(1, 400);
+    cache->insert(1, path1);
+    releasePool(semaphore);
+
+    QVERIFY(QFile::exists(path1));
+    QCOMPARE(cache->path(1), path1);
+    QVERIFY(!QFile::exists(QString("%1/tab-2-thumb.jpg").arg(BrowserPaths::cacheLocation())));
+}
+
+void tst_thumbnailcache::remove()
+{
+    QString path1 = createThumbnail(1, 100);
+    QString path2 = createThumbnail(2, 100);
+    cache->insert(1, path1);
+
+    // Files of unindexed thumbnails are removed as well.
+    cache->remove(QList<int>() << 1 << 2, QStringList() << path1 << path2);
+    QCOMPARE(cache->count(), 0);
+    QCOMPARE(cache->size(), qint64(0));
+    QTRY_VERIFY(!QFile::exists(path1));
+    QTRY_VERIFY(!QFile::exists(path2));
+}
+
+void tst_thumbnailcache::sweepOrphans()
+{
+    QList<Tab> tabs;
+    tabs << Tab(1, "http://example1.com", "", createThumbnail(1, 100));
+    // Thumbnail file of tab 2 is missing.
+    tabs << Tab(2, "http://example2.com", "", QString("%1/tab-2-thumb.jpg").arg(BrowserPaths::cacheLocation()));
+    tabs << Tab(6, "http://example6.com", "", "");
+    QString orphan3 = createThumbnail(3, 100);
+    QString orphan5 = createThumbnail(5, 100);
+    // Newer than the restored tabs, e.g. created while sweeping.
+    QString newer = createThumbnail(7, 100);
+    // Not owned by an indexed entry but by a live tab.
+    QString unindexed = createThumbnail(6, 50);
+
+    QSignalSpy evictedSpy(cache, SIGNAL(evicted(int)));
+    QSignalSpy sweepFinishedSpy(cache, SIGNAL(sweepFinished(int)));
+    cache->restore(tabs);
+    QVERIFY(cache->m_sweepTimer.isActive());
+    QCOMPARE(cache->count(), 2);
+    QCOMPARE(cache->size(), qint64(0));
+
+    cache->sweep();
+    QVERIFY(sweepFinishedSpy.wait());
+    QCOMPARE(sweepFinishedSpy.at(0).at(0).toInt(), 2);
+    QVERIFY(!QFile::exists(orphan3));
+    QVERIFY(!QFile::exists(orphan5));
+    QVERIFY(QFile::exists(newer));
+    QVERIFY(QFile::exists(unindexed));
+
+    // Sizes of restored thumbnails are resolved and missing ones dropped.
+    QCOMPARE(evictedSpy.count(), 1);
+    QCOMPARE(evictedSpy.at(0).at(0).toInt(), 2);
+    QCOMPARE(cache->count(), 1);
+    QCOMPARE(cache->size(), qint64(100));
+}
+
+void tst_thumbnailcache::clear()
+{
+    QString orphan = createThumbnail(1, 100);
+    QString path = createThumbnail(2, 100);
+    cache->insert(2, path);
+
+    cache->clear();
+    QCOMPARE(cache->count(), 0);
+    QCOMPARE(cache->size(), qint64(0));
+    QCOMPARE(cache->m_maxTabId, 0);
+    QTRY_VERIFY(!QFile::exists(path) && !QFile::exists(orphan));
+}
+
+void tst_thumbnailcache::clearKeepsNewThumbnails()
+{
+    createThumbnail(1, 100);
+    cache->insert(2, createThumbnail(2, 100));
+
+    // Hold the removal until a new tab has reused an id.
+    QSemaphore semaphore;
+    holdPool(semaphore);
+    cache->clear();
+    QString path = createThumbnail(1, 100);
+    cache->insert(1, path);
+    releasePool(semaphore);
+
+    QVERIFY(QFile::exists(path));
+    QVERIFY(!QFile::exists(QString("%1/tab-2-thumb.jpg").arg(BrowserPaths::cacheLocation())));
+    QCOMPARE(cache->path(1), path);
+}
+
+void tst_thumbnailcache::clearCancelsSweep()
+{
+    QList<Tab> tabs;
+    tabs << Tab(3, "http://example3.com", "", "");
+    QString orphan = createThumbnail(2, 100);
+    cache->restore(tabs);
+    cache->m_sweepTimer.stop();
+
+    // Clearing does not wait for the sweep that is held in the pool.
+    QSignalSpy sweepFinishedSpy(cache, SIGNAL(sweepFinished(int)));
+    QSemaphore semaphore;
+    holdPool(semaphore);
+    cache->sweep();
+    cache->clear();
+    QString path = createThumbnail(1, 100);
+    cache->insert(1, path);
+    releasePool(semaphore);
+    QCoreApplication::processEvents();
+
+    // The sweep knew tab 1 as an orphan.
+    QVERIFY(QFile::exists(path));
+    QVERIFY(!QFile::exists(orphan));
+    QCOMPARE(sweepFinishedSpy.count(), 0);
+    QCOMPARE(cache->count(), 1);
+}
+
+// Queued work waits until the pool is released.
+void tst_thumbnailcache::holdPool(QSemaphore &semaphore)
+{
+    QThreadPool *pool = QThreadPool::globalInstance();
+    maxThreadCount = pool->maxThreadCount();
+    pool->setMaxThreadCount(1);
+    QtConcurrent::run([&semaphore]() { semaphore.acquire(); });
+}
+
+void tst_thumbnailcache::releasePool(QSemaphore &semaphore)
+{
+    QThreadPool *pool = QThreadPool::globalInstance();
+    semaphore.release();
+    pool->waitForDone();
+    pool->setMaxThreadCount(maxThreadCount);
+}
+
+QString tst_thumbnailcache::createThumbnail(int tabId, int size)
+{
+    QString path = QString("%1/tab-%2-thumb.jpg").arg(BrowserPaths::cacheLocation()).arg(tabId);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot create" << path;
+        return QString();
+    }
+    file.write(QByteArray(size, 'x'));
+    file.close();
+    return path;
+}
+
+QTEST_MAIN(tst_thumbnailcache)
+#include "tst_thumbnailcache.moc"
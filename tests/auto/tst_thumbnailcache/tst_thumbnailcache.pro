@@ -0,0 +1,10 @@
+TARGET = tst_thumbnailcache
+
+QT += concurrent sql
+
+include(../test_common.pri)
+include(../../../common/browserapp.pri)
+include(../../../apps/storage/storage.pri)
+include(../mocks/faviconmanager/faviconmanager_mock.pri)
+
+SOURCES += tst_thumbnailcache.cpp
@@ -0,0 +1,116 @@
+/****************************************************************************
+**
+** Copyright (c) 2021 Jolla Ltd.
+**
+****************************************************************************/
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <QtTest>
+
+#include "thumbnailgeneration.h"
+
+static const QSize gCaptureSize(540, 960);
+static const QSize gThumbnailSize(270, 480);
+
+class tst_thumbnailgeneration : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void skipUnchanged();
+    void grabAfterChange();
+    void grabAtOtherSize();
+    void ignoreGrabFrame();
+    void countFrameAfterChangedGrab();
+    void keepNewerSaved();
+};
+
+void tst_thumbnailgeneration::skipUnchanged()
+{
+    ThumbnailGeneration generation;
+    QVERIFY(!generation.isSaved(gCaptureSize, gThumbnailSize));
+
+    const quint64 grabbed = generation.current();
+    generation.grabReady(grabbed);
+    generation.saved(grabbed, gCaptureSize, gThumbnailSize);
+    QVERIFY(generation.isSaved(gCaptureSize, gThumbnailSize));
+}
+
+void tst_thumbnailgeneration::grabAfterChange()
+{
+    ThumbnailGeneration generation;
+    generation.saved(generation.current(), gCaptureSize, gThumbnailSize);
+
+    generation.contentChanged();
+    QVERIFY(!generation.isSaved(gCaptureSize, gThumbnailSize));
+
+    // Frames without a grab change the content.
+    generation.saved(generation.current(), gCaptureSize, gThumbnailSize);
+    generation.frameRendered();
+    QVERIFY(!generation.isSaved(gCaptureSize, gThumbnailSize));
+}
+
+void tst_thumbnailgeneration::grabAtOtherSize()
+{
+    ThumbnailGeneration generation;
+    generation.saved(generation.current(), gCaptureSize, gThumbnailSize);
+
+    QVERIFY(!generation.isSaved(gCaptureSize, gThumbnailSize / 2));
+    QVERIFY(!generation.isSaved(gCaptureSize / 2, gThumbnailSize));
+}
+
+void tst_thumbnailgeneration::ignoreGrabFrame()
+{
+    ThumbnailGeneration generation;
+    const quint64 grabbed = generation.current();
+    generation.grabReady(grabbed);
+    generation.saved(grabbed, gCaptureSize, gThumbnailSize);
+
+    // Only the frame that completes the grab is ignored.
+    generation.frameRendered();
+    QVERIFY(generation.isSaved(gCaptureSize, gThumbnailSize));
+    generation.frameRendered();
+    QVERIFY(!generation.isSaved(gCaptureSize, gThumbnailSize));
+}
+
+void tst_thumbnailgeneration::countFrameAfterChangedGrab()
+{
+    ThumbnailGeneration generation;
+    const quint64 grabbed = generation.current();
+
+    // The page scrolled while the grab was in flight.
+    generation.contentChanged();
+    generation.grabReady(grabbed);
+    generation.saved(grabbed, gCaptureSize, gThumbnailSize);
+    QVERIFY(!generation.isSaved(gCaptureSize, gThumbnailSize));
+
+    const quint64 current = generation.current();
+    generation.frameRendered();
+    QVERIFY(generation.current() > current);
+
+    // An earlier ignored frame does not outlive a content change.
+    const quint64 regrabbed = generation.current();
+    generation.grabReady(regrabbed);
+    generation.contentChanged();
+    generation.saved(generation.current(), gCaptureSize, gThumbnailSize);
+    generation.frameRendered();
+    QVERIFY(!generation.isSaved(gCaptureSize, gThumbnailSize));
+}
+
+void tst_thumbnailgeneration::keepNewerSaved()
+{
+    ThumbnailGeneration generation;
+    const quint64 older = generation.current();
+    generation.contentChanged();
+    const quint64 newer = generation.current();
+
+    generation.saved(newer, gCaptureSize, gThumbnailSize);
+    generation.saved(older, gCaptureSize / 2, gThumbnailSize / 2);
+    QVERIFY(generation.isSaved(gCaptureSize, gThumbnailSize));
+}
+
+QTEST_APPLESS_MAIN(tst_thumbnailgeneration)
+#include "tst_thumbnailgeneration.moc"
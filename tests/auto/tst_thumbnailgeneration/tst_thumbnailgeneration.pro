@@ -0,0 +1,11 @@
+TARGET = tst_thumbnailgeneration
+
+include(../test_common.pri)
+
+QTMOZEMBEDSRCDIR = $$SRCDIR/qtmozembed
+INCLUDEPATH += $$QTMOZEMBEDSRCDIR
+
+SOURCES += tst_thumbnailgeneration.cpp \
+           $$QTMOZEMBEDSRCDIR/thumbnailgeneration.cpp
+
+HEADERS += $$QTMOZEMBEDSRCDIR/thumbnailgeneration.h
@@ -17,6 +17,7 @@
 #include "declarativewebpage.h"
 #include "tab.h"
 
+#include "tabthumbnailprovider.h"
 #include "webpages.h"
 
 Q_DECLARE_METATYPE(QList<Tab>)
@@ -24,6 +25,7 @@ Q_DECLARE_METATYPE(Tab)
 
 using ::testing::NiceMock;
 using ::testing::Return;
+using ::testing::ReturnPointee;
 using ::testing::AnyNumber;
 using ::testing::_;
 
@@ -39,6 +41,7 @@ private slots:
 
     void initialize();
     void count();
+    void countVirtualized();
     void setMaxLivePages();
     void maxLivePages();
     void alive();
@@ -51,6 +54,11 @@ private slots:
     void clear();
     void parentTabId_data();
     void parentTabId();
+    void sleepIdle_data();
+    void sleepIdle();
+    void backgroundLoad();
+    void restartQueuedLoads();
+    void criticalBeforeCompleted();
 
 private:
     WebPages* m_webPages;
@@ -103,13 +111,40 @@ void tst_webpages::count()
 
     // add one page and check count()
     EXPECT_CALL(*page, tabId());
-    EXPECT_CALL(*page, uniqueID());
+    EXPECT_CALL(*page, uniqueId());
     EXPECT_CALL(*page, parentId());
     EXPECT_CALL(*page, completed());
     m_webPages->page(Tab(1, "http://example.com", "Test title", ""));
     QCOMPARE(m_webPages->count(), 1);
 }
 
+void tst_webpages::countVirtualized()
+{
+    QList<Tab> threeTabs {
+        Tab(1, "http://example1.com", "Title1", ""),
+        Tab(2, "http://example2.com", "Title2", ""),
+        Tab(3, "http://example3.com", "Title3", "")
+    };
+
+    for (const Tab &initialTab : threeTabs) {
+        NiceMock<DeclarativeWebPage> *page = new NiceMock<DeclarativeWebPage>();
+        EXPECT_CALL(*page, tabId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, uniqueId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, completed()).Times(AnyNumber()).WillRepeatedly(Return(true));
+        EXPECT_CALL(*page, contentRect()).Times(AnyNumber()).WillRepeatedly(Return(QRectF()));
+
+        EXPECT_CALL(m_pageFactory, createWebPage(_, _, _)).WillOnce(Return(page));
+        m_webPages->page(initialTab);
+    }
+    QCOMPARE(m_webPages->count(), 3);
+
+    // Virtualized entries stay in the middle of the queue.
+    m_webPages->m_activePages.release(2, true);
+    QVERIFY(!m_webPages->alive(2));
+    QVERIFY(m_webPages->alive(1));
+    QCOMPARE(m_webPages->count(), 2);
+}
+
 void tst_webpages::setMaxLivePages()
 {
     m_webPages->setMaxLivePages(171);
@@ -167,7 +202,7 @@ void tst_webpages::page()
     foreach (Tab initialTab, initialTabs) {
         page = new DeclarativeWebPage();
         EXPECT_CALL(*page, tabId()).Times(2).WillRepeatedly(Return(initialTab.tabId()));
-        EXPECT_CALL(*page, uniqueID()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, uniqueId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
         EXPECT_CALL(*page, parentId()).Times(initialTab.tabId() == 1 && (tab.tabId() != 1 || maxLiveTabs < initialTabs.count()) ? 1 : 2);
         EXPECT_CALL(*page, resumeView()).Times(AnyNumber());
         EXPECT_CALL(*page, update()).Times(initialTab.tabId() == 1 && tab.tabId() == 1 && maxLiveTabs > initialTabs.count() ? 2 : 1);
@@ -177,8 +212,9 @@ void tst_webpages::page()
         if (!(initialTab.tabId() == 3 && tab.tabId() == 3)) {
             // no need to suspend active view
             EXPECT_CALL(*page, suspendView());
-            EXPECT_CALL(*page, loading()).WillOnce(Return(false));
         }
+        // Foreground pages are also asked whether they hold back queued background loads.
+        EXPECT_CALL(*page, loading()).Times(AnyNumber()).WillRepeatedly(Return(false));
 
         m_webPages->page(initialTab);
     }
@@ -190,7 +226,7 @@ void tst_webpages::page()
         if (!(tab.tabId() == 1 && maxLiveTabs < initialTabs.count())) {
             EXPECT_CALL(*page, tabId()).WillOnce(Return(tab.tabId()));
         }
-        EXPECT_CALL(*page, uniqueID()).WillOnce(Return(tab.tabId()));
+        EXPECT_CALL(*page, uniqueId()).WillOnce(Return(tab.tabId()));
         EXPECT_CALL(*page, parentId()).Times(initialTabs.count() ? 2 : 1).WillRepeatedly(Return(parentId));
         EXPECT_CALL(*page, resumeView());
         EXPECT_CALL(*page, update());
@@ -249,7 +285,7 @@ void tst_webpages::release()
     foreach (Tab initialTab, initialTabs) {
         page = new DeclarativeWebPage();
         EXPECT_CALL(*page, tabId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
-        EXPECT_CALL(*page, uniqueID()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, uniqueId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
         EXPECT_CALL(*page, parentId()).Times(AnyNumber());
         EXPECT_CALL(*page, resumeView()).Times(AnyNumber());
         EXPECT_CALL(*page, update()).Times(AnyNumber());
@@ -290,7 +326,7 @@ void tst_webpages::clear()
     foreach (Tab initialTab, initialTabs) {
         page = new NiceMock<DeclarativeWebPage>();
         EXPECT_CALL(*page, tabId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
-        EXPECT_CALL(*page, uniqueID()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, uniqueId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
         EXPECT_CALL(*page, completed()).WillOnce(Return(true));
         EXPECT_CALL(*page, contentRect()).Times(AnyNumber()).WillRepeatedly(Return(QRectF()));
 
@@ -337,7 +373,7 @@ void tst_webpages::parentTabId()
         page = new NiceMock<DeclarativeWebPage>();
         EXPECT_CALL(*page, parentId()).Times(AnyNumber()).WillRepeatedly(Return(parentId));
         EXPECT_CALL(*page, tabId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
-        EXPECT_CALL(*page, uniqueID()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, uniqueId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
         EXPECT_CALL(*page, completed()).WillOnce(Return(true));
         EXPECT_CALL(*page, contentRect()).Times(AnyNumber()).WillRepeatedly(Return(QRectF()));
 
@@ -348,5 +384,163 @@ void tst_webpages::parentTabId()
     QCOMPARE(m_webPages->parentTabId(tabId), expectedParentId);
 }
 
+void tst_webpages::sleepIdle_data()
+{
+    QTest::addColumn<int>("idleSeconds");
+    QTest::addColumn<bool>("mediaActive");
+    QTest::addColumn<int>("expectedSuspendCount");
+    QTest::addColumn<int>("expectedCount");
+
+    // Inactive pages are suspended once upon deactivation.
+    QTest::newRow("not_idle") << 30 << false << 1 << 3;
+    QTest::newRow("idle") << 90 << false << 2 << 3;
+    QTest::newRow("idle_twice_timeout") << 150 << false << 1 << 1;
+    QTest::newRow("media_active") << 150 << true << 1 << 3;
+}
+
+void tst_webpages::sleepIdle()
+{
+    QFETCH(int, idleSeconds);
+    QFETCH(bool, mediaActive);
+    QFETCH(int, expectedSuspendCount);
+    QFETCH(int, expectedCount);
+
+    QList<Tab> threeTabs {
+        Tab(1, "http://example1.com", "Title1", ""),
+        Tab(2, "http://example2.com", "Title2", ""),
+        Tab(3, "http://example3.com", "Title3", "")
+    };
+
+    NiceMock<DeclarativeWebPage>* page = nullptr;
+
+    for (int i = 0; i < threeTabs.count(); i++) {
+        Tab initialTab = threeTabs.at(i);
+        bool activePage = i == threeTabs.count() - 1;
+
+        page = new NiceMock<DeclarativeWebPage>();
+        EXPECT_CALL(*page, tabId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, uniqueId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, completed()).Times(AnyNumber()).WillRepeatedly(Return(true));
+        EXPECT_CALL(*page, contentRect()).Times(AnyNumber()).WillRepeatedly(Return(QRectF()));
+        EXPECT_CALL(*page, mediaActive()).Times(AnyNumber()).WillRepeatedly(Return(mediaActive));
+        EXPECT_CALL(*page, suspendView()).Times(activePage ? 0 : expectedSuspendCount);
+
+        EXPECT_CALL(m_pageFactory, createWebPage(_, _, _)).WillOnce(Return(page));
+        m_webPages->page(initialTab);
+    }
+
+    const qint64 idleTimeout = 60 * 1000;
+    m_webPages->m_activePages.sleepIdle(QDateTime::currentMSecsSinceEpoch() + idleSeconds * 1000, idleTimeout);
+    QCOMPARE(m_webPages->count(), expectedCount);
+}
+
+void tst_webpages::backgroundLoad()
+{
+    QList<Tab> fourTabs {
+        Tab(1, "http://example1.com", "Title1", ""),
+        Tab(2, "http://example2.com", "Title2", ""),
+        Tab(3, "http://example3.com", "Title3", ""),
+        Tab(4, "http://example4.com", "Title4", "")
+    };
+
+    NiceMock<DeclarativeWebPage>* page = nullptr;
+
+    for (int i = 0; i < fourTabs.count(); i++) {
+        Tab initialTab = fourTabs.at(i);
+
+        page = new NiceMock<DeclarativeWebPage>();
+        EXPECT_CALL(*page, tabId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, uniqueId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, completed()).Times(AnyNumber()).WillRepeatedly(Return(true));
+        EXPECT_CALL(*page, contentRect()).Times(AnyNumber()).WillRepeatedly(Return(QRectF()));
+        EXPECT_CALL(*page, loading()).Times(AnyNumber()).WillRepeatedly(Return(true));
+        // Two first pages keep loading in the background, the third one is queued.
+        EXPECT_CALL(*page, stop()).Times(i == 2 ? 1 : 0);
+        EXPECT_CALL(*page, setActive(false)).Times(i < 2 ? 1 : 0);
+
+        EXPECT_CALL(m_pageFactory, createWebPage(_, _, _)).WillOnce(Return(page));
+        m_webPages->page(initialTab);
+    }
+
+    QCOMPARE(m_webPages->m_loadScheduler.maxConcurrentLoads(), 2);
+    QCOMPARE(m_webPages->m_loadScheduler.loadingCount(), 2);
+    QCOMPARE(m_webPages->m_loadScheduler.queuedCount(), 1);
+}
+
+void tst_webpages::restartQueuedLoads()
+{
+    QList<Tab> fiveTabs {
+        Tab(1, "http://example1.com", "Title1", ""),
+        Tab(2, "http://example2.com", "Title2", ""),
+        Tab(3, "http://example3.com", "Title3", ""),
+        Tab(4, "http://example4.com", "Title4", ""),
+        Tab(5, "http://example5.com", "Title5", "")
+    };
+
+    bool loading[] = { true, true, true, true, true };
+    QList<NiceMock<DeclarativeWebPage> *> pages;
+
+    for (int i = 0; i < fiveTabs.count(); i++) {
+        Tab initialTab = fiveTabs.at(i);
+
+        NiceMock<DeclarativeWebPage> *page = new NiceMock<DeclarativeWebPage>();
+        EXPECT_CALL(*page, tabId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, uniqueId()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.tabId()));
+        EXPECT_CALL(*page, completed()).Times(AnyNumber()).WillRepeatedly(Return(true));
+        EXPECT_CALL(*page, contentRect()).Times(AnyNumber()).WillRepeatedly(Return(QRectF()));
+        EXPECT_CALL(*page, loading()).Times(AnyNumber()).WillRepeatedly(ReturnPointee(&loading[i]));
+        EXPECT_CALL(*page, initialUrl()).Times(AnyNumber()).WillRepeatedly(Return(initialTab.url()));
+        // The third page is queued before its first url was committed, the fourth one after.
+        EXPECT_CALL(*page, initialLoadHasHappened()).Times(AnyNumber()).WillRepeatedly(Return(i != 2));
+        EXPECT_CALL(*page, load(initialTab.url())).Times(i == 2 ? 1 : 0);
+        EXPECT_CALL(*page, reload()).Times(i == 3 ? 1 : 0);
+
+        EXPECT_CALL(m_pageFactory, createWebPage(_, _, _)).WillOnce(Return(page));
+        m_webPages->page(initialTab);
+        pages.append(page);
+    }
+    QCOMPARE(m_webPages->m_loadScheduler.loadingCount(), 2);
+    QCOMPARE(m_webPages->m_loadScheduler.queuedCount(), 2);
+
+    // Queued loads wait for the foreground page.
+    loading[0] = false;
+    loading[1] = false;
+    emit pages.at(0)->loadingChanged();
+    emit pages.at(1)->loadingChanged();
+    QCOMPARE(m_webPages->m_loadScheduler.queuedCount(), 2);
+
+    loading[4] = false;
+    emit pages.at(4)->loadingChanged();
+    QCOMPARE(m_webPages->m_loadScheduler.loadingCount(), 2);
+    QCOMPARE(m_webPages->m_loadScheduler.queuedCount(), 0);
+}
+
+void tst_webpages::criticalBeforeCompleted()
+{
+    DeclarativeWebContainer webContainer;
+    webContainer.setCompleted(false);
+    m_webPages->initialize(&webContainer);
+
+    const int releaseCount = TabThumbnailProvider::releaseCount();
+    m_webPages->handleMemNotify("critical");
+    QCOMPARE(TabThumbnailProvider::releaseCount(), releaseCount);
+
+    // Level that arrived early is handled once a page is activated.
+    webContainer.setCompleted(true);
+    NiceMock<DeclarativeWebPage> *page = new NiceMock<DeclarativeWebPage>();
+    EXPECT_CALL(*page, tabId()).Times(AnyNumber()).WillRepeatedly(Return(1));
+    EXPECT_CALL(*page, completed()).Times(AnyNumber()).WillRepeatedly(Return(true));
+    EXPECT_CALL(m_pageFactory, createWebPage(_, _, _)).WillOnce(Return(page));
+    m_webPages->page(Tab(1, "http://example1.com", "Title1", ""));
+    QCOMPARE(TabThumbnailProvider::releaseCount(), releaseCount + 1);
+
+    // Caches are released once per critical level.
+    m_webPages->handleMemNotify("critical");
+    QCOMPARE(TabThumbnailProvider::releaseCount(), releaseCount + 1);
+    m_webPages->handleMemNotify("normal");
+    m_webPages->handleMemNotify("critical");
+    QCOMPARE(TabThumbnailProvider::releaseCount(), releaseCount + 2);
+}
+
 QTEST_MAIN(tst_webpages)
 #include "tst_webpages.moc"
@@ -1,29 +1,31 @@
 TARGET = tst_webpages
 
-CONFIG += link_pkgconfig
-
-PKGCONFIG += mlite5
-
-QT += qml quick concurrent sql gui-private
+QT += qml quick concurrent sql dbus
 
 include(../mocks/webengine/webengine.pri)
-include(../mocks/qmozcontext/qmozcontext.pri)
-include(../mocks/qmozwindow/qmozwindow.pri)
 include(../mocks/webpagefactory/webpagefactory.pri)
+include(../mocks/declarativewebcontainer/declarativewebcontainer_mock.pri)
 include(../mocks/declarativewebpage/declarativewebpage_mock.pri)
-include(../mocks/declarativewebutils/declarativewebutils_mock.pri)
 include(../mocks/downloadmanager/downloadmanager_mock.pri)
-include(../mocks/opensearchconfigs/opensearchconfigs_mock.pri)
+include(../mocks/faviconmanager/faviconmanager_mock.pri)
 include(../mocks/qmozsecurity/qmozsecurity.pri)
+include(../mocks/tabthumbnailprovider/tabthumbnailprovider_mock.pri)
 
 include(../test_common.pri)
 include(../../../common/browserapp.pri)
-include(../../../apps/core/core.pri)
-include(../../../apps/history/history.pri)
+include(../../../apps/storage/storage.pri)
 
-LIBS += -lgtest -lgmock
+INCLUDEPATH += $$CORESRCDIR
 
-SOURCES += tst_webpages.cpp
+SOURCES += tst_webpages.cpp \
+           $$CORESRCDIR/loadscheduler.cpp \
+           $$CORESRCDIR/logging.cpp \
+           $$CORESRCDIR/webpagequeue.cpp \
+           $$CORESRCDIR/webpages.cpp
 
-# Avoid inclusion of qtmozembed headers in devel environment
-INCLUDEPATH -= $$absolute_path(../../../../qtmozembed/src)
+HEADERS += $$CORESRCDIR/loadscheduler.h \
+           $$CORESRCDIR/logging.h \
+           $$CORESRCDIR/webpagequeue.h \
+           $$CORESRCDIR/webpages.h
+
+LIBS += -lgtest -lgmock